@@ -0,0 +1,222 @@
+"""
+cluster_bench.py - Coordinator Throughput as the Cluster Grows
+===============================================================
+Starts N native coordinators on this machine (hydra_coordinator --peers),
+points a crowd of simulated workers at them and measures how many tasks
+per second the cluster completes. Repeats for every N you ask for, so you
+can see how throughput scales.
+
+The simulated workers don't train: they claim a task and immediately hand
+the parameters back. That puts all the load on the coordinators (task
+queue, database, aggregation) instead of on PyTorch. A tiny model keeps
+the JSON small for the same reason.
+
+Workers register with a random coordinator and follow the 307 redirect to
+the one that owns them, exactly like worker.py.
+
+With --relay, the same runs are repeated with hydra_relay processes in
+front of a single coordinator, so you can compare direct submissions with
+hierarchical aggregation (each relay forwards one update per batch).
+
+Usage:
+    python cluster_bench.py build/hydra_coordinator --nodes 1 2 4 --clients 32 --seconds 20
+    python cluster_bench.py build/hydra_coordinator --nodes 1 --relay build/hydra_relay --relays 0 2 4
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import http.client
+import json
+import multiprocessing
+import os
+import secrets
+import subprocess
+import tempfile
+import time
+import urllib.parse
+
+# Small enough that parameter JSON is a few hundred KB, not hundreds of MB
+TINY_MODEL = ["--vocab-size", "64", "--embed-dim", "16", "--num-heads", "2", "--num-layers", "1"]
+
+
+class Client:
+    """
+    Keep-alive HTTP connection that follows redirects and then sticks to
+    the coordinator it was redirected to.
+    """
+
+    def __init__(self, base_url):
+        self.connect(base_url)
+
+    def connect(self, base_url):
+        parts = urllib.parse.urlsplit(base_url)
+        self.base_url = base_url
+        self.conn = http.client.HTTPConnection(parts.hostname, parts.port, timeout=60)
+
+    def post(self, path, body):
+        data = json.dumps(body)
+        for _ in range(3):
+            self.conn.request("POST", path, data, {"Content-Type": "application/json"})
+            response = self.conn.getresponse()
+            payload = response.read()
+            if response.status == 307:
+                location = response.getheader("Location")
+                self.conn.close()
+                self.connect(location[:-len(path)])
+                continue
+            return response.status, payload
+        return 508, b""  # Redirect loop
+
+
+def run_worker(args):
+    """One simulated worker; returns the number of tasks it completed."""
+    entry_url, user_id, seconds = args
+    client = Client(entry_url)
+    client.post("/register", {"user_id": user_id})
+
+    completed = 0
+    deadline = time.time() + seconds
+    while time.time() < deadline:
+        status, payload = client.post("/get_task", {"user_id": user_id})
+        if status != 200:
+            time.sleep(0.01)
+            continue
+
+        task = json.loads(payload)
+        status, _ = client.post("/submit_result", {
+            "user_id": user_id,
+            "task_id": task["task_id"],
+            "updated_parameters": task["model_parameters"],
+        })
+        if status == 200:
+            completed += 1
+    return completed
+
+
+def wait_until_healthy(urls, timeout=30):
+    deadline = time.time() + timeout
+    for url in urls:
+        parts = urllib.parse.urlsplit(url)
+        while True:
+            try:
+                conn = http.client.HTTPConnection(parts.hostname, parts.port, timeout=2)
+                conn.request("GET", "/health")
+                if conn.getresponse().status == 200:
+                    break
+            except OSError:
+                pass
+            if time.time() > deadline:
+                raise RuntimeError(f"Coordinator {url} did not start")
+            time.sleep(0.2)
+
+
+def start_cluster(binary, nodes, base_port, workdir):
+    peers = [f"http://127.0.0.1:{base_port + i}" for i in range(nodes)]
+    secret_file = os.path.join(workdir, "cluster.secret")
+    with open(secret_file, "w") as f:
+        f.write(secrets.token_hex(16))
+    relay_secret_file = os.path.join(workdir, "relay.secret")
+    with open(relay_secret_file, "w") as f:
+        f.write(secrets.token_hex(16))
+    processes = []
+    for i in range(nodes):
+        command = [
+            binary,
+            "--host", "127.0.0.1",
+            "--port", str(base_port + i),
+            "--db", os.path.join(workdir, f"node-{i}.db"),
+            # Measure the coordinators, not the admission limits
+            "--rate-limit", "1000000", "--burst", "1000000", "--max-submits", "0",
+            "--high-watermark", "5000",
+            "--relay-secret-file", relay_secret_file,
+        ] + TINY_MODEL
+        if nodes > 1:
+            command += ["--peers", ",".join(peers), "--node-index", str(i), "--sync-interval", "2",
+                        "--cluster-secret-file", secret_file]
+        processes.append(subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+
+    try:
+        wait_until_healthy(peers)
+    except RuntimeError:
+        stop_cluster(processes)
+        raise
+    return peers, processes
+
+
+def start_relays(binary, count, upstream, base_port, secret_file):
+    urls = [f"http://127.0.0.1:{base_port + i}" for i in range(count)]
+    processes = []
+    for i in range(count):
+        command = [
+            binary,
+            "--upstream", upstream,
+            "--host", "127.0.0.1",
+            "--port", str(base_port + i),
+            "--max-queued", "256",
+            "--relay-secret-file", secret_file,
+        ]
+        processes.append(subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+
+    try:
+        wait_until_healthy(urls)   # /health is forwarded, so this also checks the upstream link
+    except RuntimeError:
+        stop_cluster(processes)
+        raise
+    return urls, processes
+
+
+def stop_cluster(processes):
+    for process in processes:
+        process.terminate()
+    for process in processes:
+        process.wait(timeout=10)
+
+
+def measure(binary, nodes, clients, seconds, base_port, relay_binary=None, relays=0):
+    with tempfile.TemporaryDirectory() as workdir:
+        peers, processes = start_cluster(binary, nodes, base_port, workdir)
+        try:
+            entry = peers
+            if relays:
+                # A relay fronts one coordinator; spread them over the nodes
+                entry = []
+                for i in range(relays):
+                    urls, relay_processes = start_relays(relay_binary, 1, peers[i % nodes],
+                                                         base_port + 100 + i,
+                                                         os.path.join(workdir, "relay.secret"))
+                    entry += urls
+                    processes += relay_processes
+            jobs = [(entry[i % len(entry)], f"bench-{nodes}-{relays}-{i}", seconds) for i in range(clients)]
+            with multiprocessing.Pool(clients) as pool:
+                completed = sum(pool.map(run_worker, jobs))
+        finally:
+            stop_cluster(processes)
+    return completed / seconds
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure coordinator throughput vs. cluster size")
+    parser.add_argument("binary", help="Path to hydra_coordinator")
+    parser.add_argument("--nodes", type=int, nargs="+", default=[1, 2, 4], help="Cluster sizes to try")
+    parser.add_argument("--clients", type=int, default=32, help="Simulated workers")
+    parser.add_argument("--seconds", type=float, default=20, help="Duration of each run")
+    parser.add_argument("--port", type=int, default=5100, help="First coordinator port")
+    parser.add_argument("--relay", help="Path to hydra_relay (enables --relays)")
+    parser.add_argument("--relays", type=int, nargs="+", default=[0], help="Relay counts to try")
+    args = parser.parse_args()
+
+    if any(args.relays) and not args.relay:
+        parser.error("--relays needs --relay")
+
+    print(f"{'nodes':>5}  {'relays':>6}  {'tasks/s':>10}  {'speedup':>8}")
+    baseline = None
+    for nodes in args.nodes:
+        for relays in args.relays:
+            rate = measure(args.binary, nodes, args.clients, args.seconds, args.port, args.relay, relays)
+            baseline = baseline or rate
+            print(f"{nodes:>5}  {relays:>6}  {rate:>10.1f}  {rate / baseline:>7.2f}x")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,196 @@
+"""
+corpus.py - Corpus Shard Reader for HydraAI Workers
+====================================================
+The native coordinator (hydra_coordinator --corpus DIR) doesn't put the
+training text inside each task. Instead a task says "train on records
+120-122 of shard 3", and the worker downloads shard 3 once and keeps it.
+
+This file knows how to:
+1. Download shard files from the coordinator (only once!)
+2. Open them with mmap (the operating system loads only the parts we read)
+3. Return the text records a task points to
+4. Fetch pre-tokenized token ranges (hydra_coordinator --tokens FILE),
+   so the worker never has to tokenize anything while training
+
+Shard file layout (see include/hydra/corpus.hpp):
+    [64-byte header][record text ...][padding][offsets table]
+"""
+
+import json
+import mmap
+import os
+import struct
+
+import numpy as np
+import requests  # For downloading shards from the coordinator
+
+# Header: magic, version, flags, shard_id, num_records, data_offset, index_offset, reserved
+SHARD_HEADER = struct.Struct("<8sIIQQQQ16x")
+SHARD_MAGIC = b"HYDRACS1"
+
+
+class CorpusShard:
+    """
+    One memory-mapped shard file.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.file = open(path, "rb")
+        self.data = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+
+        (magic, version, _flags, self.shard_id, self.num_records,
+         self.data_offset, self.index_offset) = SHARD_HEADER.unpack_from(self.data, 0)
+
+        if magic != SHARD_MAGIC or version != 1:
+            raise ValueError(f"{path} is not a corpus shard")
+
+    def record(self, i):
+        """Get the text of record number i."""
+        start, end = struct.unpack_from("<QQ", self.data, self.index_offset + 8 * i)
+        begin = self.data_offset + start
+        return self.data[begin:self.data_offset + end].decode("utf-8")
+
+    def close(self):
+        self.data.close()
+        self.file.close()
+
+
+class CorpusCache:
+    """
+    Downloads shards on first use and keeps them on disk for next time.
+
+    Shards never change once written, so a cached file is only downloaded
+    again if its size doesn't match the coordinator's manifest.
+    """
+
+    def __init__(self, coordinator_url, cache_dir="corpus_cache"):
+        self.coordinator_url = coordinator_url
+        self.cache_dir = cache_dir
+        self.manifest = None   # shard id -> file size, loaded on first use
+        self.shards = {}       # shard id -> open CorpusShard
+        self.token_dtype = None   # '<u2' or '<u4', from /dataset/manifest
+
+    def read(self, shard_id, offset, count):
+        """
+        Get the records a task refers to.
+
+        Args:
+            shard_id: Which shard
+            offset: First record
+            count: How many records
+
+        Returns:
+            List of text strings
+        """
+        shard = self.get_shard(shard_id)
+        if offset + count > shard.num_records:
+            raise ValueError(f"Task refers to records past the end of shard {shard_id}")
+        return [shard.record(offset + i) for i in range(count)]
+
+    def read_tokens(self, start, count):
+        """
+        Get a range of the coordinator's pre-tokenized dataset.
+
+        Returns:
+            numpy array of token ids (int64, ready for torch)
+        """
+        if self.token_dtype is None:
+            response = requests.get(f"{self.coordinator_url}/dataset/manifest", timeout=30)
+            response.raise_for_status()
+            self.token_dtype = "<u2" if response.json()["token_bytes"] == 2 else "<u4"
+
+        response = requests.get(f"{self.coordinator_url}/dataset/tokens",
+                                params={"start": start, "count": count}, timeout=60)
+        response.raise_for_status()
+        return np.frombuffer(response.content, dtype=self.token_dtype).astype(np.int64)
+
+    def get_shard(self, shard_id):
+        if shard_id in self.shards:
+            return self.shards[shard_id]
+
+        path = os.path.join(self.cache_dir, f"shard-{shard_id:06d}.hcs")
+        expected_size = self.get_manifest().get(shard_id)
+        if expected_size is None:
+            raise ValueError(f"Coordinator has no corpus shard {shard_id}")
+
+        if not os.path.exists(path) or os.path.getsize(path) != expected_size:
+            self.download(shard_id, path)
+
+        shard = CorpusShard(path)
+        self.shards[shard_id] = shard
+        return shard
+
+    def get_manifest(self):
+        if self.manifest is None:
+            response = requests.get(f"{self.coordinator_url}/corpus/manifest", timeout=30)
+            response.raise_for_status()
+            self.manifest = {s["id"]: s["bytes"] for s in response.json()["shards"]}
+        return self.manifest
+
+    def download(self, shard_id, path):
+        print(f"  Downloading corpus shard {shard_id}...")
+        os.makedirs(self.cache_dir, exist_ok=True)
+
+        # Write to a temporary name first so a broken download is never used
+        temp_path = path + ".part"
+        with requests.get(f"{self.coordinator_url}/corpus/shard/{shard_id}",
+                          stream=True, timeout=60) as response:
+            response.raise_for_status()
+            with open(temp_path, "wb") as f:
+                for chunk in response.iter_content(chunk_size=1 << 20):
+                    f.write(chunk)
+        os.replace(temp_path, path)
+
+
+def resolve_data_batch(data_batch_json, corpus):
+    """
+    Turn a task's data_batch into a list of training texts.
+
+    Args:
+        data_batch_json: The task's data_batch (JSON text)
+        corpus: CorpusCache to read shard references from
+
+    Returns:
+        List of text strings
+    """
+    data_batch = json.loads(data_batch_json)
+    if isinstance(data_batch, dict):
+        # {"shard": 3, "offset": 120, "count": 3} - a reference, not the text itself
+        return corpus.read(data_batch["shard"], data_batch["offset"], data_batch["count"])
+    return data_batch  # Old-style task: the text is right there
+
+
+def prepare_examples(data_batch_json, corpus, tokenizer, max_length=128):
+    """
+    Turn a task's data_batch into training examples, once per task.
+
+    Token range tasks are already tokenized: the range is cut into windows
+    of seq_len + 1 tokens (inputs plus the shifted target) with no padding.
+    Text tasks are tokenized here, before training starts, instead of on
+    every epoch.
+
+    Returns:
+        List of (input_ids, attention_mask) lists, each max_length or
+        seq_len + 1 long
+    """
+    data_batch = json.loads(data_batch_json)
+    if isinstance(data_batch, dict) and "token_start" in data_batch:
+        # {"token_start": 4096, "token_count": 1024, "seq_len": 128}
+        tokens = corpus.read_tokens(data_batch["token_start"], data_batch["token_count"])
+        window = data_batch["seq_len"] + 1
+        if len(tokens) < 2:
+            return []
+        if len(tokens) < window:
+            window = len(tokens)
+        examples = []
+        for begin in range(0, len(tokens) - window + 1, window):
+            ids = tokens[begin:begin + window].tolist()
+            examples.append((ids, [1] * window))
+        return examples
+
+    examples = []
+    for text in resolve_data_batch(data_batch_json, corpus):
+        encoded = tokenizer.encode(text, max_length=max_length)
+        examples.append((encoded['input_ids'], encoded['attention_mask']))
+    return examples
@@ -0,0 +1,175 @@
+/**
+ * @file admission.hpp
+ * @brief Admission control in front of the coordinator's API handlers
+ *
+ * Two independent gates:
+ *
+ * - RateLimiter: a token bucket per client address. Buckets are spread
+ *   over shards by hash and updated with a single compare-and-swap, so
+ *   admitting a known client never takes an exclusive lock.
+ * - ConcurrencyLimit: a cap on requests in flight for expensive routes
+ *   (submit_result, query_model), so a burst of uploads cannot occupy
+ *   every request thread and the database.
+ *
+ * Rejected requests get 429 with Retry-After; well-behaved clients back off
+ * and everyone else keeps normal latency. Peer routes (cluster, relay)
+ * check a shared secret with credentials_match() instead.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace hydra {
+
+/**
+ * @struct RateLimitOptions
+ * @brief Per-client token bucket settings
+ */
+struct RateLimitOptions {
+    double rate{10.0};                 // Sustained requests per second per client
+    double burst{20.0};                // Bucket size (requests allowed back to back)
+    std::size_t shards{64};            // Independent bucket maps
+    std::size_t max_clients_per_shard{4096};   // Beyond this, idle buckets are dropped
+};
+
+/**
+ * @class RateLimiter
+ * @brief Per-client token buckets
+ *
+ * Each bucket is one atomic "theoretical arrival time" (the GCRA form of a
+ * token bucket): a request is admitted if pushing that time forward by
+ * 1/rate keeps it within burst/rate of now. A bucket whose time is in the
+ * past is full, so idle clients can be forgotten without changing any
+ * decision.
+ *
+ * Thread Safety: acquire() may be called from any thread.
+ */
+class RateLimiter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Constructor
+     * @throws std::invalid_argument if rate, burst or shards is not positive
+     */
+    explicit RateLimiter(RateLimitOptions options = {});
+
+    /**
+     * @brief Take one token from a client's bucket
+     * @param client Client key (the connection's address)
+     * @param now Current time
+     * @return Zero if admitted, otherwise how long until a token is available
+     */
+    std::chrono::nanoseconds acquire(std::string_view client, clock::time_point now = clock::now());
+
+    /**
+     * @brief Number of clients with a bucket
+     */
+    std::size_t clients() const;
+
+    const RateLimitOptions& options() const { return options_; }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::atomic<std::int64_t>, Hash, std::equal_to<>> buckets;
+    };
+
+    RateLimitOptions options_;
+    clock::time_point epoch_;
+    std::int64_t interval_;            // Nanoseconds per token
+    std::int64_t tolerance_;           // Nanoseconds of burst
+    std::unique_ptr<Shard[]> shards_;
+
+    std::int64_t take(std::atomic<std::int64_t>& tat, std::int64_t now) const;
+};
+
+/**
+ * @class ConcurrencyLimit
+ * @brief Caps the number of requests in flight on a route
+ *
+ * Example usage:
+ * @code
+ * if (auto permit = submits.try_acquire()) {
+ *     handle(req, res);      // Released when permit goes out of scope
+ * } else {
+ *     reject(res);
+ * }
+ * @endcode
+ */
+class ConcurrencyLimit {
+public:
+    /**
+     * @class Permit
+     * @brief Holds one slot until destroyed
+     */
+    class Permit {
+    public:
+        Permit() = default;
+        explicit Permit(ConcurrencyLimit* owner) : owner_(owner) {}
+        Permit(Permit&& other) noexcept : owner_(other.owner_) { other.owner_ = nullptr; }
+        Permit& operator=(Permit&& other) noexcept;
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+        ~Permit() { release(); }
+
+        explicit operator bool() const { return owner_ != nullptr; }
+        void release();
+
+    private:
+        ConcurrencyLimit* owner_{nullptr};
+    };
+
+    /**
+     * @param max_in_flight Slots (0 = unlimited)
+     */
+    explicit ConcurrencyLimit(std::size_t max_in_flight) : max_(max_in_flight) {}
+
+    /**
+     * @brief Take a slot if one is free (never blocks)
+     */
+    Permit try_acquire();
+
+    std::size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+    std::size_t max_in_flight() const { return max_; }
+
+private:
+    std::size_t max_;
+    std::atomic<std::size_t> in_flight_{0};
+};
+
+/**
+ * @brief Compare a presented credential with the configured one
+ *
+ * Takes the same time wherever the first difference is, so the secret
+ * cannot be guessed byte by byte from response times.
+ *
+ * @return false if expected is empty (no credential configured)
+ */
+bool credentials_match(std::string_view expected, std::string_view presented);
+
+/**
+ * @brief Read a credential from a file
+ *
+ * Secrets are passed as files so they do not show up in ps. Surrounding
+ * whitespace (the trailing newline of echo) is not part of the secret.
+ *
+ * @throws std::invalid_argument if the file can't be read or holds no secret
+ */
+std::string read_secret_file(const std::string& path);
+
+} // namespace hydra
@@ -0,0 +1,144 @@
+/**
+ * @file aggregation.hpp
+ * @brief Robust aggregation of worker parameter updates
+ *
+ * This header defines the kernels the coordinator uses to combine the
+ * parameter updates submitted during one training round:
+ * - Weighted mean (plain federated averaging)
+ * - Coordinate-wise trimmed mean (drops the largest and smallest values)
+ * - Coordinate-wise median
+ *
+ * Trimmed mean and median bound the influence of any single bad or
+ * malicious worker, which the plain average cannot do.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace hydra {
+
+/**
+ * @enum AggregationRule
+ * @brief How the updates of one round are combined per coordinate
+ */
+enum class AggregationRule {
+    Mean,          // Weighted average of all updates
+    TrimmedMean,   // Average after dropping trim_fraction from each end
+    Median         // Middle value (average of the two middle values for even K)
+};
+
+/**
+ * @struct AggregationOptions
+ * @brief Tuning knobs for aggregate_updates()
+ */
+struct AggregationOptions {
+    AggregationRule rule{AggregationRule::Mean};
+    double trim_fraction{0.1};     // Fraction trimmed from EACH end (TrimmedMean only)
+    std::size_t num_threads{0};    // Worker threads (0 = hardware concurrency)
+    std::size_t block_size{512};   // Coordinates per cache block (multiple of 16)
+};
+
+/**
+ * @struct UpdateView
+ * @brief Non-owning view of one worker's flattened parameter update
+ *
+ * All views passed to one aggregate_updates() call must have the same
+ * length as the output span. The weight is used by AggregationRule::Mean
+ * only; the robust rules treat every update equally so that a worker
+ * cannot buy influence by claiming a large weight.
+ */
+struct UpdateView {
+    const float* data{nullptr};    // Flattened parameters
+    double weight{1.0};            // Relative weight (e.g. number of samples)
+};
+
+/**
+ * @brief Aggregate K parameter updates coordinate by coordinate
+ *
+ * The coordinate range is split into shards processed in parallel. Each
+ * shard is walked in cache-sized blocks: the K values of a block are
+ * gathered into a contiguous scratch buffer and reduced with SIMD
+ * min/max sorting networks, falling back to selection for rounds with
+ * very many updates. The vector loops use AVX2/FMA when the CPU has it
+ * (checked at runtime) and a portable version otherwise.
+ *
+ * @param updates Updates to combine (at least one)
+ * @param out Output buffer, one float per coordinate
+ * @param options Rule and tuning options
+ * @throws std::invalid_argument if updates is empty or options are invalid
+ */
+void aggregate_updates(std::span<const UpdateView> updates,
+                       std::span<float> out,
+                       const AggregationOptions& options = {});
+
+/**
+ * @brief Blend an aggregate into the global parameters
+ *
+ * Computes global = (1 - learning_rate) * global + learning_rate * update,
+ * the same rule as CoordinatorServer.aggregate_parameters in coordinator.py.
+ *
+ * @param global Global parameters, updated in place
+ * @param update Aggregated update of the same length
+ * @param learning_rate How much to trust the update (0..1)
+ */
+void blend_into(std::span<float> global, std::span<const float> update,
+                double learning_rate);
+
+namespace detail {
+
+struct Comparator {
+    std::uint16_t a;
+    std::uint16_t b;
+};
+
+// Sorting networks are used up to this many updates per round; above it
+// per-coordinate selection (std::nth_element) is cheaper.
+constexpr std::size_t kMaxNetworkSize = 64;
+
+/**
+ * @struct AggregationKernels
+ * @brief Vector loops of aggregate_updates() for one instruction set
+ */
+struct AggregationKernels {
+    const char* name;
+
+    // out[0, len) += weight * src[0, len)
+    void (*accumulate)(float* out, const float* src, float weight, std::size_t len);
+
+    // Sorts every coordinate of k rows (stride apart) through the network
+    // and reduces it to the median (median) or to the mean of the values
+    // ranked [trim, k - trim). Covers whole vectors only; returns how many
+    // leading coordinates of out it wrote.
+    std::size_t (*network)(const float* rows, std::size_t stride, std::size_t k, std::size_t len,
+                           const Comparator* network, std::size_t comparators,
+                           bool median, std::size_t trim, float* out);
+};
+
+const AggregationKernels& aggregation_kernels_portable();
+#if defined(HYDRA_AGGREGATION_X86)
+const AggregationKernels& aggregation_kernels_avx2();
+#endif
+
+/**
+ * @brief The kernels aggregate_updates() uses on this CPU
+ */
+const AggregationKernels& aggregation_kernels();
+
+} // namespace detail
+
+/**
+ * @brief Parse a rule name ("mean", "trimmed_mean", "median")
+ * @throws std::invalid_argument for unknown names
+ */
+AggregationRule parse_aggregation_rule(const std::string& name);
+
+/**
+ * @brief Name of a rule, inverse of parse_aggregation_rule()
+ */
+const char* aggregation_rule_name(AggregationRule rule);
+
+} // namespace hydra
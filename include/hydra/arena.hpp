@@ -0,0 +1,124 @@
+/**
+ * @file arena.hpp
+ * @brief Bump allocator for the tensors of one training step
+ *
+ * Every activation, gradient and scratch buffer of a step is carved out of
+ * the arena by moving a pointer, and the whole step is freed at once with
+ * reset(). Allocations are 64-byte aligned (a cache line, and the widest
+ * SIMD load), so kernels never straddle lines at the start of a tensor.
+ *
+ * Memory comes in blocks. When a step outgrows the current block a new
+ * one is added; at the next reset() the blocks are merged into one as
+ * large as the step needed, so from the second step on a step of the same
+ * shape allocates nothing from the system.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @class Arena
+ * @brief Aligned bump allocator, freed all at once
+ *
+ * Thread Safety: none; use one arena per thread.
+ */
+class Arena {
+public:
+    static constexpr std::size_t kAlignment = 64;
+
+    /**
+     * @brief Constructor
+     * @param block_bytes Size of the first block (later blocks are at
+     *                    least as large as the allocation that needs them)
+     */
+    explicit Arena(std::size_t block_bytes = std::size_t{1} << 20);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) noexcept = default;
+    Arena& operator=(Arena&&) noexcept = default;
+
+    /**
+     * @brief Uninitialized memory for bytes, aligned to kAlignment
+     * @throws std::bad_alloc if the system is out of memory
+     */
+    void* allocate(std::size_t bytes);
+
+    /**
+     * @brief Uninitialized array of count floats
+     */
+    float* allocate_floats(std::size_t count) { return static_cast<float*>(allocate(count * sizeof(float))); }
+
+    /**
+     * @brief Position to rewind() to, for scratch memory inside a step
+     */
+    struct Mark {
+        std::size_t block{0};
+        std::size_t used{0};
+    };
+
+    Mark mark() const { return {current_, used_}; }
+
+    /**
+     * @brief Free everything allocated since mark (blocks are kept)
+     */
+    void rewind(Mark mark);
+
+    /**
+     * @brief Rewinds to where it was made when it goes out of scope
+     */
+    class Scope {
+    public:
+        explicit Scope(Arena& arena) : arena_(arena), mark_(arena.mark()) {}
+        ~Scope() { arena_.rewind(mark_); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Arena& arena_;
+        Mark mark_;
+    };
+
+    /**
+     * @brief Free everything; invalidates every pointer handed out
+     */
+    void reset();
+
+    /**
+     * @brief Bytes handed out since the last reset (with alignment padding)
+     */
+    std::size_t used() const;
+
+    /**
+     * @brief Bytes reserved from the system
+     */
+    std::size_t capacity() const;
+
+    /**
+     * @brief Most bytes in use at once since construction
+     */
+    std::size_t peak() const { return peak_; }
+
+private:
+    struct Free {
+        void operator()(std::byte* block) const;
+    };
+    struct Block {
+        std::unique_ptr<std::byte[], Free> data;
+        std::size_t bytes{0};
+    };
+
+    std::vector<Block> blocks_;
+    std::size_t current_{0};       // Block being bumped
+    std::size_t used_{0};          // Bytes used in blocks_[current_]
+    std::size_t peak_{0};
+
+    static Block make_block(std::size_t bytes);
+};
+
+} // namespace hydra
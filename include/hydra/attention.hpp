@@ -0,0 +1,94 @@
+/**
+ * @file attention.hpp
+ * @brief Fused scaled dot-product attention, forward and backward
+ *
+ * softmax(scale * Q K^T) V for one head without ever holding the
+ * [queries x keys] score matrix. Queries are processed in blocks of
+ * kAttentionQueryBlock and keys in blocks of kAttentionKeyBlock, so a
+ * block of Q, a block of K and V and one score tile stay in L1/L2 while
+ * they meet. The softmax is computed online: every query keeps a running
+ * maximum, normalizer and weighted sum of values, rescaled whenever a new
+ * key block raises the maximum (FlashAttention). Memory beyond the
+ * operands is O(queries).
+ *
+ * The backward pass recomputes each score tile from Q, K and the
+ * log-sum-exp the forward pass saved instead of storing the
+ * probabilities, so training memory is O(seq) as well.
+ *
+ * Rows of every operand may be strided: one head's columns inside the
+ * packed [rows][3 * embed] output of the QKV projection are addressed
+ * directly, with ld = 3 * embed.
+ *
+ * @code
+ * hydra::AttentionHead head{q, 3 * embed, k, 3 * embed, v, 3 * embed,
+ *                           seq, seq, head_dim, 1.0f / std::sqrt(float(head_dim))};
+ * hydra::attention_forward(head, out, embed, lse.data());
+ * @endcode
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace hydra {
+
+constexpr std::size_t kAttentionQueryBlock = 64;
+constexpr std::size_t kAttentionKeyBlock = 64;
+
+/**
+ * @struct AttentionHead
+ * @brief Operands of one head; row r of X is x + r * ldx
+ */
+struct AttentionHead {
+    const float* q{nullptr};
+    std::size_t ldq{0};
+    const float* k{nullptr};
+    std::size_t ldk{0};
+    const float* v{nullptr};
+    std::size_t ldv{0};
+    std::size_t queries{0};
+    std::size_t keys{0};
+    std::size_t head_dim{0};
+    float scale{1.0f};                 // Usually 1 / sqrt(head_dim)
+    const bool* key_padding{nullptr};  // Optional, per key: true = ignore it
+                                       // (src_key_padding_mask convention)
+};
+
+/**
+ * @brief out = softmax(scale * Q K^T) V, row by row
+ *
+ * @param out queries x head_dim, rows ldo apart (overwritten)
+ * @param lse Optional, queries floats: log-sum-exp of each query's scaled
+ *            scores, needed by attention_backward()
+ *
+ * A query whose keys are all padding gets a zero row and lse = -infinity
+ * (PyTorch would give NaN).
+ */
+void attention_forward(const AttentionHead& head, float* out, std::size_t ldo, float* lse = nullptr);
+
+/**
+ * @struct AttentionGradients
+ * @brief Outputs of attention_backward(), laid out like q, k and v
+ */
+struct AttentionGradients {
+    float* dq{nullptr};
+    std::size_t lddq{0};
+    float* dk{nullptr};
+    std::size_t lddk{0};
+    float* dv{nullptr};
+    std::size_t lddv{0};
+};
+
+/**
+ * @brief Gradients of attention_forward() with respect to Q, K and V
+ *
+ * @param out, lse What attention_forward() produced for head
+ * @param d_out Gradient of the loss with respect to out, rows ldd apart
+ * @param grads Overwritten (not accumulated); padding keys get zero
+ */
+void attention_backward(const AttentionHead& head,
+                        const float* out, std::size_t ldo, const float* lse,
+                        const float* d_out, std::size_t ldd,
+                        const AttentionGradients& grads);
+
+} // namespace hydra
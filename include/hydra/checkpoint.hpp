@@ -0,0 +1,253 @@
+/**
+ * @file checkpoint.hpp
+ * @brief Native, memory-mappable checkpoints of the global model
+ *
+ * A checkpoint file holds one model version as a table of tensors:
+ *
+ *   [CheckpointHeader, 64 bytes]
+ *   [CheckpointTensor table, 64 bytes per tensor, in ModelState order]
+ *   [tensor names, back to back]
+ *   [tensor data: float32, each tensor starting on a 64-byte boundary]
+ *
+ * Tensors are stored in the machine's byte order (checked on load), so a
+ * mapped checkpoint can be read in place without copying or decoding.
+ *
+ * A checkpoint is either full or incremental. An incremental checkpoint
+ * stores only the tensors that differ from its base version; the others
+ * are listed with data_offset 0 and read from the base. Loading follows
+ * base_version back to a full checkpoint and applies the increments in
+ * order. Files are named model-<version>.hck, so a directory of them is
+ * self-describing.
+ *
+ * Versions published between two checkpoints go to a model log,
+ * model-<checkpoint version>.hlog: append-only records, each holding the
+ * tensors that changed from one version to the next. Recovery loads the
+ * newest checkpoint and replays its log up to the first torn record.
+ *
+ * Both are written as one gathered write per file (or per record) straight
+ * from the model's memory, then fsync'd. Given an IoLoop, the writes and
+ * the fsync are submitted together to io_uring (see io_loop.hpp).
+ */
+
+#pragma once
+
+#include "hydra/mapped_file.hpp"
+#include "hydra/model_state.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hydra {
+
+class IoLoop;
+
+/**
+ * @struct CheckpointHeader
+ * @brief Fixed 64-byte header at the start of a checkpoint
+ */
+struct CheckpointHeader {
+    char magic[8];                 // "HYDRACK1"
+    std::uint32_t version;         // Format version (1)
+    std::uint32_t flags;           // kCheckpointFull | kCheckpointLittleEndian
+    std::uint64_t model_version;   // Version of the model stored
+    std::uint64_t base_version;    // Version the increments apply to (incremental only)
+    std::int32_t vocab_size;       // ModelConfig, checked on load
+    std::int32_t embed_dim;
+    std::int32_t num_heads;
+    std::int32_t num_layers;
+    std::int32_t max_seq_length;
+    std::uint32_t num_tensors;
+    std::uint64_t names_offset;    // File offset of the name bytes
+};
+static_assert(sizeof(CheckpointHeader) == 64, "CheckpointHeader must be 64 bytes");
+
+/**
+ * @struct CheckpointTensor
+ * @brief One 64-byte entry of the tensor table
+ */
+struct CheckpointTensor {
+    std::uint64_t data_offset;     // File offset of the data (0 = same as base)
+    std::uint64_t elements;        // Number of floats
+    std::uint64_t checksum;        // FNV-1a of the data bytes (of the base's, if not stored)
+    std::uint32_t name_offset;     // Relative to names_offset
+    std::uint32_t name_bytes;
+    std::uint32_t rank;
+    std::uint32_t shape[4];
+    std::uint32_t reserved[3];
+};
+static_assert(sizeof(CheckpointTensor) == 64, "CheckpointTensor must be 64 bytes");
+
+constexpr std::uint32_t kCheckpointFull = 1u << 0;
+constexpr std::uint32_t kCheckpointLittleEndian = 1u << 1;   // Byte order of the data
+
+/**
+ * @struct CheckpointStats
+ * @brief What a write produced
+ */
+struct CheckpointStats {
+    std::string path;
+    std::uint64_t bytes{0};        // File size
+    std::size_t tensors_written{0};
+    std::size_t tensors_total{0};
+    bool full{true};
+};
+
+/**
+ * @brief File name of the checkpoint of version in dir
+ */
+std::string checkpoint_path(const std::string& dir, std::uint64_t version);
+
+/**
+ * @brief Write a checkpoint of model
+ *
+ * The file is written under a temporary name, flushed to disk and renamed,
+ * so a crash never leaves a torn checkpoint behind.
+ *
+ * @param dir Checkpoint directory (created if missing)
+ * @param model Model to store
+ * @param base Last checkpointed model, or nullptr for a full checkpoint;
+ *             only tensors that differ from it are written
+ * @param io Loop to write through (one that is not running), or nullptr
+ * @throws std::runtime_error if the file cannot be written
+ * @throws std::invalid_argument if base has a different layout
+ */
+CheckpointStats write_checkpoint(const std::string& dir, const ModelState& model,
+                                 const ModelState* base = nullptr, IoLoop* io = nullptr);
+
+/**
+ * @class CheckpointFile
+ * @brief Read-only, zero-copy view of one mapped checkpoint
+ */
+class CheckpointFile {
+public:
+    /**
+     * @brief Map and validate a checkpoint
+     * @throws std::runtime_error if the file is missing or corrupt
+     */
+    explicit CheckpointFile(const std::string& path);
+
+    const CheckpointHeader& header() const { return *header_; }
+    bool full() const { return (header_->flags & kCheckpointFull) != 0; }
+    std::size_t num_tensors() const { return header_->num_tensors; }
+    const CheckpointTensor& tensor(std::size_t i) const { return table_[i]; }
+    std::string_view name(std::size_t i) const;
+
+    /**
+     * @brief Data of tensor i, straight from the mapping
+     * @return Empty span if the tensor is not stored in this file
+     */
+    std::span<const float> data(std::size_t i) const;
+
+    /**
+     * @brief Whether stored tensor i matches its checksum
+     */
+    bool verify(std::size_t i) const;
+
+    ModelConfig config() const;
+
+private:
+    MappedFile file_;
+    const CheckpointHeader* header_{nullptr};
+    const CheckpointTensor* table_{nullptr};
+};
+
+/**
+ * @brief Versions of the checkpoints in dir, ascending
+ */
+std::vector<std::uint64_t> list_checkpoints(const std::string& dir);
+
+/**
+ * @brief Load the newest model in dir
+ *
+ * Follows the newest checkpoint's chain of increments back to a full
+ * checkpoint and replays it, verifying every tensor's checksum.
+ *
+ * @param dir Checkpoint directory
+ * @param config Architecture the checkpoint must have
+ * @return The model (with its version), or nullopt if dir has none
+ * @throws std::runtime_error if the chain is broken, corrupt or was
+ *         written for a different architecture
+ */
+std::optional<ModelState> load_latest_checkpoint(const std::string& dir, const ModelConfig& config);
+
+// =============================================================================
+// Model Log
+// =============================================================================
+
+/**
+ * @struct ModelLogRecord
+ * @brief Header of one log record, followed by the uint32 indices of the
+ *        tensors it holds (padded to 8 bytes) and then their data
+ */
+struct ModelLogRecord {
+    char magic[4];                 // "HLR1"
+    std::uint32_t tensors;         // Number of tensors in the record
+    std::uint64_t base_version;    // Version the record applies to
+    std::uint64_t model_version;   // Version it produces
+    std::uint64_t payload_bytes;   // Indices, padding and data
+    std::uint64_t checksum;        // FNV-1a of the payload
+};
+static_assert(sizeof(ModelLogRecord) == 40, "ModelLogRecord must be 40 bytes");
+
+/**
+ * @brief File name of the log that follows checkpoint version in dir
+ */
+std::string model_log_path(const std::string& dir, std::uint64_t checkpoint_version);
+
+/**
+ * @class ModelLogWriter
+ * @brief Appends version-to-version records to a model log
+ */
+class ModelLogWriter {
+public:
+    /**
+     * @brief Start a new (empty) log
+     * @param io Loop to write through (one that is not running), or nullptr
+     * @throws std::runtime_error if the file cannot be created
+     */
+    explicit ModelLogWriter(std::string path, IoLoop* io = nullptr);
+
+    ~ModelLogWriter();
+
+    ModelLogWriter(const ModelLogWriter&) = delete;
+    ModelLogWriter& operator=(const ModelLogWriter&) = delete;
+
+    /**
+     * @brief Append the tensors of model that differ from previous, and
+     *        flush them to disk
+     * @return Bytes appended
+     * @throws std::runtime_error if the write fails
+     */
+    std::uint64_t append(const ModelState& model, const ModelState& previous);
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    IoLoop* io_{nullptr};
+#ifdef _WIN32
+    std::ofstream out_;
+#else
+    int fd_{-1};
+    std::uint64_t size_{0};        // Where the next record goes
+#endif
+};
+
+/**
+ * @brief Apply the records of a model log that continue model's version
+ *
+ * Stops at the end of the file, at a torn or corrupt record (a crash
+ * during an append) or at a record for another version.
+ *
+ * @param path Log file (a missing file replays nothing)
+ * @param model Model at the log's checkpoint version, advanced in place
+ * @return Number of records applied
+ */
+std::size_t replay_model_log(const std::string& path, ModelState& model);
+
+} // namespace hydra
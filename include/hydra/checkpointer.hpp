@@ -0,0 +1,138 @@
+/**
+ * @file checkpointer.hpp
+ * @brief Background checkpointing of the global model
+ *
+ * Every interval the checkpointer loads the aggregator's current snapshot
+ * (an RCU read: aggregation is never blocked) and, if its version is new,
+ * writes it to the checkpoint directory. Most checkpoints are incremental
+ * against the previous one; every full_every-th is full, which bounds the
+ * chain a restart has to replay. Chains older than the last keep_full full
+ * checkpoints are deleted.
+ *
+ * Between checkpoints, every version the aggregator publishes is appended
+ * to the model log of the last checkpoint (see checkpoint.hpp), so a
+ * restart loses at most the round in flight instead of a whole interval.
+ * When the writer falls behind, intermediate versions are coalesced into
+ * one record.
+ *
+ * With an I/O backend set, each checkpoint and log record is written and
+ * fsync'd through the checkpointer's own io_uring (or epoll) loop.
+ */
+
+#pragma once
+
+#include "hydra/checkpoint.hpp"
+#include "hydra/io_loop.hpp"
+#include "hydra/model_state.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace hydra {
+
+/**
+ * @struct CheckpointOptions
+ * @brief Where and how often the global model is checkpointed
+ */
+struct CheckpointOptions {
+    std::string dir;                               // Empty = no checkpoints
+    std::chrono::milliseconds interval{60000};     // Time between checkpoints
+    std::size_t full_every{10};                    // Every n-th checkpoint is full
+    std::size_t keep_full{2};                      // Full checkpoints (with their chains) kept
+    bool log_versions{true};                       // Log versions between checkpoints
+    IoBackend io{IoBackend::Off};                  // Off = pwritev and fsync from the thread
+
+    bool enabled() const { return !dir.empty(); }
+};
+
+/**
+ * @class Checkpointer
+ * @brief Background thread writing full and incremental checkpoints
+ *
+ * Thread Safety: all methods may be called from any thread.
+ */
+class Checkpointer {
+public:
+    using SnapshotSource = std::function<std::shared_ptr<const ModelState>()>;
+
+    /**
+     * @brief Constructor
+     * @param options Directory and schedule
+     * @param snapshot Returns the model to checkpoint
+     * @throws std::invalid_argument if the directory is empty or full_every is 0
+     * @throws std::runtime_error if options.io cannot be set up
+     */
+    Checkpointer(CheckpointOptions options, SnapshotSource snapshot);
+
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    /**
+     * @brief Start the background thread
+     *
+     * If the current snapshot is the newest checkpoint in the directory
+     * (it was restored from it) logging continues from there; otherwise
+     * the snapshot is checkpointed first.
+     */
+    void start();
+
+    /**
+     * @brief Tell the thread a new version was published (cheap; safe to
+     *        call under the aggregator's lock)
+     */
+    void notify();
+
+    /**
+     * @brief Stop the thread, writing a final checkpoint (idempotent)
+     */
+    void stop();
+
+    /**
+     * @brief Checkpoint the current snapshot now if its version is new
+     * @return true if a checkpoint was written
+     * @throws std::runtime_error if writing fails
+     */
+    bool checkpoint_now();
+
+    std::uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    std::uint64_t last_version() const { return last_version_.load(std::memory_order_relaxed); }
+    std::uint64_t logged_version() const { return logged_version_.load(std::memory_order_relaxed); }
+
+private:
+    CheckpointOptions options_;
+    SnapshotSource snapshot_;
+    std::unique_ptr<IoLoop> io_;                   // Null with IoBackend::Off
+
+    std::mutex write_mutex_;                       // One checkpoint or log append at a time
+    std::shared_ptr<const ModelState> last_;       // Last model written (the next increment's base)
+    std::size_t since_full_{0};                    // Increments since the last full checkpoint
+    std::unique_ptr<ModelLogWriter> log_;          // Null when logging is off or failed
+    std::shared_ptr<const ModelState> logged_;     // Last model in the log (the next record's base)
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    bool published_{false};                        // A version arrived since the last append
+    std::thread thread_;
+
+    std::atomic<std::uint64_t> written_{0};
+    std::atomic<std::uint64_t> last_version_{0};
+    std::atomic<std::uint64_t> logged_version_{0};
+
+    void run();
+    void resume();
+    void log_latest();
+    void open_log();
+    void prune();
+};
+
+} // namespace hydra
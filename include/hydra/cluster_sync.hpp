@@ -0,0 +1,132 @@
+/**
+ * @file cluster_sync.hpp
+ * @brief Several coordinator processes acting as one
+ *
+ * In cluster mode every coordinator is given the same ordered list of peer
+ * URLs. Users and task ids are split between them with a HashRing; a
+ * request that reaches the wrong coordinator is answered with a 307
+ * redirect to the owner, which workers follow and then stick to.
+ *
+ * Each coordinator runs its own aggregation rounds on its own workers'
+ * updates. The shared step is a periodic model average: the first peer
+ * (the leader) pulls every peer's model, averages them weighted by the
+ * rounds each completed since the last sync, and pushes the result back.
+ *
+ *   GET  /cluster/model   raw float32 parameters (+ X-Model-Version,
+ *                         X-Model-Rounds)
+ *   POST /cluster/model   install parameters from the leader
+ *
+ * Both routes take the model wholesale, so peers prove membership with a
+ * secret every coordinator of the cluster is given (X-Cluster-Secret).
+ */
+
+#pragma once
+
+#include "hydra/model_state.hpp"
+#include "hydra/round_aggregator.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace hydra {
+
+inline constexpr char kClusterSecretHeader[] = "X-Cluster-Secret";
+
+/**
+ * @struct ClusterOptions
+ * @brief Membership and timing of a coordinator cluster
+ */
+struct ClusterOptions {
+    std::vector<std::string> peers;    // Base URLs of all coordinators, same order on every peer
+    std::size_t self{0};               // This coordinator's index in peers (0 = leader)
+    std::chrono::milliseconds sync_interval{10000};   // Model averaging period
+    std::string secret;                // Shared by all peers, required in cluster mode
+
+    bool enabled() const { return peers.size() > 1; }
+};
+
+/**
+ * @class ClusterSync
+ * @brief Periodic model averaging across coordinators
+ *
+ * Thread Safety: install() may be called from request threads while the
+ * sync thread runs.
+ */
+class ClusterSync {
+public:
+    /**
+     * @brief Constructor
+     * @param options Peers and this coordinator's index
+     * @param aggregator This coordinator's aggregation engine
+     * @throws std::invalid_argument if self is not a valid peer index or
+     *         the secret is empty
+     */
+    ClusterSync(ClusterOptions options, RoundAggregator& aggregator);
+
+    ~ClusterSync();
+
+    ClusterSync(const ClusterSync&) = delete;
+    ClusterSync& operator=(const ClusterSync&) = delete;
+
+    /**
+     * @brief Start the sync thread (leader only; no-op on followers)
+     */
+    void start();
+
+    /**
+     * @brief Stop the sync thread (idempotent)
+     */
+    void stop();
+
+    bool leader() const { return options_.self == 0; }
+
+    /**
+     * @brief Whether a request's X-Cluster-Secret is this cluster's secret
+     */
+    bool authorized(std::string_view presented) const;
+
+    /**
+     * @brief Install parameters pushed by the leader
+     * @param body Raw float32 parameters in the snapshot's layout
+     * @param version Model version chosen by the leader
+     * @return false if the body has the wrong size
+     */
+    bool install(std::string_view body, std::uint64_t version);
+
+    /**
+     * @brief Number of completed averaging steps (leader)
+     */
+    std::uint64_t syncs() const { return syncs_.load(std::memory_order_relaxed); }
+
+private:
+    struct PeerModel {
+        std::uint64_t version{0};
+        std::uint64_t rounds{0};
+        std::vector<float> values;
+    };
+
+    ClusterOptions options_;
+    RoundAggregator& aggregator_;
+    std::vector<std::uint64_t> last_rounds_;   // Rounds per peer at the previous sync
+    std::atomic<std::uint64_t> syncs_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    std::thread thread_;
+
+    void run();
+    void sync_once();
+    std::optional<PeerModel> pull(const std::string& peer) const;
+    bool push(const std::string& peer, const ModelState& model) const;
+};
+
+} // namespace hydra
@@ -0,0 +1,236 @@
+/**
+ * @file compression.hpp
+ * @brief Content encodings for parameter payloads and JSON bodies
+ *
+ * Besides identity, three encodings are negotiated between workers and the
+ * coordinator:
+ * - x-hydra-lz: LZ77 sequences (the LZ4 block layout) over byte-shuffled
+ *   floats. Cheap on both ends; for fast links and relays.
+ * - x-hydra-deflate: deflate over byte-shuffled floats. Several times the
+ *   CPU of x-hydra-lz for a better ratio; for slow links.
+ * - gzip: standard gzip, for JSON bodies (the Python worker).
+ *
+ * The two x-hydra encodings cut the payload into blocks of at most
+ * kEncodedBlockBytes and write each as
+ *
+ *   [EncodedBlockHeader, 8 bytes][packed bytes]
+ *
+ * Shuffling stores byte 0 of every float, then byte 1 of every float, and
+ * so on. Sign and exponent bytes vary little across neighbouring weights,
+ * but interleaved with mantissa bytes no LZ or Huffman coder sees that;
+ * side by side they compress. A block that does not shrink is stored as
+ * is, so incompressible data costs 8 bytes per 64 KiB.
+ *
+ * Both directions work a block at a time: encoder and decoder never hold
+ * more than one block, however large the payload.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @enum ContentEncoding
+ * @brief How a body or payload is encoded on the wire
+ */
+enum class ContentEncoding : std::uint8_t {
+    Identity = 0,
+    Lz = 1,           // x-hydra-lz
+    Deflate = 2,      // x-hydra-deflate
+    Gzip = 3,         // gzip (HTTP bodies only)
+};
+
+/**
+ * @brief Parse a content-coding ("identity", "x-hydra-lz", "gzip", ...),
+ *        or "lz" and "deflate" for short
+ */
+std::optional<ContentEncoding> parse_content_encoding(std::string_view name);
+
+const char* content_encoding_name(ContentEncoding encoding);
+
+/**
+ * @brief Pick the encoding for a reply
+ *
+ * @param accept_encoding The request's Accept-Encoding header
+ * @param offered Encodings the server can produce, best first
+ * @return The offered encoding with the highest q-value (the earlier one
+ *         on a tie), or Identity if the client accepts none of them
+ */
+ContentEncoding negotiate_encoding(std::string_view accept_encoding, std::span<const ContentEncoding> offered);
+
+constexpr std::size_t kEncodedBlockBytes = 64 << 10;
+
+/**
+ * @struct EncodedBlockHeader
+ * @brief Header in front of every block of an x-hydra encoding
+ */
+struct EncodedBlockHeader {
+    std::uint32_t raw_bytes;       // Decoded size, 1 to kEncodedBlockBytes
+    std::uint32_t packed;          // Bytes that follow (low 24 bits) and kBlock* flags
+
+    static constexpr std::uint32_t kBlockStored = 1u << 31;     // Packed bytes are the raw bytes
+    static constexpr std::uint32_t kBlockShuffled = 1u << 30;   // Float bytes shuffled before packing
+
+    std::size_t packed_bytes() const { return packed & 0xFFFFFF; }
+};
+static_assert(sizeof(EncodedBlockHeader) == 8, "EncodedBlockHeader must be 8 bytes");
+
+/**
+ * @class Compressor
+ * @brief Streaming encoder for the x-hydra encodings
+ *
+ * Example:
+ * @code
+ * hydra::Compressor compressor(hydra::ContentEncoding::Lz);
+ * auto send = [&](std::span<const std::byte> bytes) { socket.write(bytes); };
+ * compressor.write(std::as_bytes(parameters), send);
+ * compressor.finish(send);
+ * @endcode
+ *
+ * Thread Safety: not thread-safe; use one per stream.
+ */
+class Compressor {
+public:
+    using Sink = std::function<void(std::span<const std::byte>)>;
+
+    /**
+     * @brief Constructor
+     * @param encoding Lz or Deflate
+     * @param shuffle Shuffle the bytes of float32 values (off for other data)
+     * @param level Deflate level, 1-9. On shuffled floats level 6 packs
+     *        about 1% smaller than level 1 at half the speed.
+     * @throws std::invalid_argument for Identity and Gzip
+     */
+    explicit Compressor(ContentEncoding encoding, bool shuffle = true, int level = 1);
+
+    ~Compressor();
+
+    Compressor(const Compressor&) = delete;
+    Compressor& operator=(const Compressor&) = delete;
+
+    ContentEncoding encoding() const { return encoding_; }
+
+    /**
+     * @brief Encode one block: header and packed bytes
+     * @param raw 1 to kEncodedBlockBytes bytes
+     * @return View of an internal buffer, valid until the next call
+     */
+    std::span<const std::byte> encode_block(std::span<const std::byte> raw);
+
+    /**
+     * @brief Encode data, handing every finished block to sink
+     *
+     * Input is cut into blocks at the same offsets however it is split
+     * across calls; a partial block waits for more data or finish().
+     */
+    void write(std::span<const std::byte> data, const Sink& sink);
+
+    /**
+     * @brief Encode the partial block, if any
+     */
+    void finish(const Sink& sink);
+
+private:
+    struct Deflater;
+
+    ContentEncoding encoding_;
+    bool shuffle_;
+    std::vector<std::byte> pending_;     // Partial block
+    std::vector<std::byte> shuffled_;
+    std::vector<std::byte> out_;         // Header and packed bytes of the last block
+    std::unique_ptr<Deflater> deflater_;
+};
+
+/**
+ * @class Decompressor
+ * @brief Block decoder for the x-hydra encodings
+ *
+ * Receivers read each EncodedBlockHeader, check it, read packed_bytes()
+ * more and decode them straight into their destination.
+ *
+ * Thread Safety: not thread-safe; use one per stream.
+ */
+class Decompressor {
+public:
+    Decompressor();
+    ~Decompressor();
+
+    Decompressor(const Decompressor&) = delete;
+    Decompressor& operator=(const Decompressor&) = delete;
+
+    /**
+     * @brief Check a block header before reading its packed bytes
+     * @param remaining Bytes the stream still has to decode to
+     * @throws std::runtime_error if the block is larger than a block may
+     *         be, or decodes past the end of the stream
+     */
+    static void check(const EncodedBlockHeader& header, std::size_t remaining);
+
+    /**
+     * @brief Decode one block
+     * @param out Exactly header.raw_bytes bytes
+     * @throws std::runtime_error if the packed bytes are corrupt
+     */
+    void decode_block(ContentEncoding encoding, const EncodedBlockHeader& header,
+                      std::span<const std::byte> packed, std::span<std::byte> out);
+
+private:
+    struct Inflater;
+
+    std::vector<std::byte> shuffled_;
+    std::unique_ptr<Inflater> inflater_;
+};
+
+/**
+ * @brief Encode a whole buffer with a Compressor
+ */
+std::vector<std::byte> compress(ContentEncoding encoding, std::span<const std::byte> data,
+                                bool shuffle = true, int level = 1);
+
+// =============================================================================
+// gzip splicing
+// =============================================================================
+
+/**
+ * @struct DeflateSegment
+ * @brief Part of a gzip body, compressed on its own
+ *
+ * A gzip body is gzip_header(), the segments' data in order, then
+ * gzip_trailer(). Segments end on a byte boundary without a final block,
+ * so a large part that many bodies share (the model parameters) is
+ * compressed once and spliced between parts compressed per request.
+ */
+struct DeflateSegment {
+    std::string data;              // Raw deflate blocks
+    std::uint32_t crc{0};          // CRC-32 of the uncompressed bytes
+    std::uint64_t size{0};         // Uncompressed bytes
+};
+
+/**
+ * @brief Compress text as one segment, in bounded chunks
+ * @param level 1-9 (-1 = zlib's default)
+ */
+DeflateSegment deflate_segment(std::string_view text, int level = -1);
+
+/**
+ * @brief The 10-byte gzip header
+ */
+std::string gzip_header();
+
+/**
+ * @brief Final empty block, CRC-32 and size of segments, in body order
+ */
+std::string gzip_trailer(std::initializer_list<const DeflateSegment*> segments);
+
+} // namespace hydra
@@ -0,0 +1,324 @@
+/**
+ * @file coro.hpp
+ * @brief Coroutine tasks for request handlers that wait on other stages
+ *
+ * A handler written as an Async<T> coroutine suspends while it waits for
+ * the database, the aggregation engine or a long-poll wakeup, and costs
+ * only its coroutine frame (a few hundred bytes to a few kilobytes) while
+ * it does, instead of a parked thread and its stack.
+ *
+ * Every coroutine runs on a Scheduler: the RPC server's I/O loop, or, for
+ * callers that block anyway (HTTP handlers), the calling thread through
+ * sync_wait(). Blocking work is sent to an Executor with offload(), and
+ * the coroutine is resumed on its scheduler when the work is done, so the
+ * scheduler's threads never block.
+ *
+ * @code
+ * hydra::Async<int> count_pending(hydra::Executor& db_thread, hydra::Database& db) {
+ *     co_return co_await hydra::offload(db_thread, [&] { return db.count_tasks("pending"); });
+ * }
+ * int n = hydra::sync_wait(count_pending(db_thread, db));
+ * @endcode
+ *
+ * (The type is Async rather than task<T>: Task is the database's
+ * training task.)
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @class Scheduler
+ * @brief Where suspended coroutines are resumed
+ */
+class Scheduler {
+public:
+    virtual ~Scheduler() = default;
+
+    /**
+     * @brief Resume handle on one of the scheduler's threads (thread-safe)
+     */
+    virtual void schedule(std::coroutine_handle<> handle) = 0;
+};
+
+/**
+ * @brief Resume handle on scheduler, or right here without one
+ */
+inline void resume_on(Scheduler* scheduler, std::coroutine_handle<> handle) {
+    if (scheduler) {
+        scheduler->schedule(handle);
+    } else {
+        handle.resume();
+    }
+}
+
+/**
+ * @class Executor
+ * @brief Fixed pool of threads for blocking work
+ *
+ * Thread Safety: post() may be called from any thread.
+ */
+class Executor {
+public:
+    explicit Executor(std::size_t threads);
+
+    /**
+     * @brief Run what is queued, then join the threads
+     */
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void post(std::function<void()> work);
+
+    std::size_t threads() const { return threads_.size(); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_{false};
+    std::vector<std::thread> threads_;
+
+    void run();
+};
+
+/**
+ * @class RunLoop
+ * @brief Scheduler that resumes coroutines on the thread calling run()
+ */
+class RunLoop : public Scheduler {
+public:
+    void schedule(std::coroutine_handle<> handle) override;
+
+    /**
+     * @brief Resume scheduled coroutines until finish() is called
+     */
+    void run();
+
+    /**
+     * @brief Make run() return once nothing is left to resume (thread-safe)
+     */
+    void finish();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::coroutine_handle<>> ready_;
+    bool finished_{false};
+};
+
+/**
+ * @class Async
+ * @brief Lazily started coroutine producing a T, awaited with co_await
+ *
+ * The coroutine starts when it is first awaited and runs on the awaiting
+ * coroutine's scheduler. Exceptions propagate to the awaiter.
+ */
+template <typename T>
+class [[nodiscard]] Async {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+        Scheduler* scheduler{nullptr};
+
+        Async get_return_object() { return Async(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept {
+                // Symmetric transfer: the awaiter continues without growing the stack
+                auto next = self.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        template <typename U>
+        void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Async(Async&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Async& operator=(Async&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Async() { destroy(); }
+
+    auto operator co_await() && noexcept { return Awaiter{handle_}; }
+
+private:
+    struct Awaiter {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            handle.promise().scheduler = awaiting.promise().scheduler;
+            return handle;
+        }
+
+        T await_resume() {
+            auto& promise = handle.promise();
+            if (promise.error) {
+                std::rethrow_exception(promise.error);
+            }
+            return std::move(*promise.value);
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle_;
+
+    explicit Async(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    void destroy() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+};
+
+namespace detail {
+
+// Top of a coroutine chain: starts on its scheduler, frees itself at the end
+struct Detached {
+    struct promise_type {
+        Scheduler* scheduler{nullptr};
+
+        Detached get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T, typename Done>
+Detached run_detached(Async<T> task, Done done) {
+    done(co_await std::move(task));
+}
+
+template <typename T>
+Detached run_sync(Async<T> task, std::optional<T>& value, std::exception_ptr& error, RunLoop& loop) {
+    try {
+        value.emplace(co_await std::move(task));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    loop.finish();
+}
+
+template <typename F>
+struct OffloadAwaiter {
+    using Result = std::invoke_result_t<F&>;
+
+    Executor& executor;
+    F work;
+    std::optional<std::conditional_t<std::is_void_v<Result>, bool, Result>> value{};
+    std::exception_ptr error{};
+
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> awaiting) {
+        Scheduler* scheduler = awaiting.promise().scheduler;
+        executor.post([this, awaiting, scheduler] {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    work();
+                    value.emplace(true);
+                } else {
+                    value.emplace(work());
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            resume_on(scheduler, awaiting);
+        });
+    }
+
+    Result await_resume() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if constexpr (!std::is_void_v<Result>) {
+            return std::move(*value);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Run task to completion on scheduler without waiting for it
+ *
+ * done is called with the result on the scheduler's thread. The task must
+ * not throw (std::terminate otherwise): catch inside it.
+ */
+template <typename T, typename Done>
+void spawn(Async<T> task, Scheduler& scheduler, Done done) {
+    auto top = detail::run_detached(std::move(task), std::move(done));
+    top.handle.promise().scheduler = &scheduler;
+    top.handle.resume();
+}
+
+/**
+ * @brief Run task on the calling thread and return its result
+ *
+ * Blocks until the task is done; offloaded work is waited for on this
+ * thread, and exceptions are rethrown here.
+ */
+template <typename T>
+T sync_wait(Async<T> task) {
+    RunLoop loop;
+    std::optional<T> value;
+    std::exception_ptr error;
+    auto top = detail::run_sync(std::move(task), value, error, loop);
+    top.handle.promise().scheduler = &loop;
+    top.handle.resume();
+    loop.run();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return std::move(*value);
+}
+
+/**
+ * @brief Awaitable that runs work() on executor and resumes the awaiting
+ *        coroutine on its scheduler with the result
+ *
+ * work runs while the coroutine is suspended, so it may capture the
+ * coroutine's locals by reference. Exceptions are rethrown at co_await.
+ */
+template <typename F>
+auto offload(Executor& executor, F work) {
+    return detail::OffloadAwaiter<F>{executor, std::move(work)};
+}
+
+} // namespace hydra
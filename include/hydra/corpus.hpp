@@ -0,0 +1,203 @@
+/**
+ * @file corpus.hpp
+ * @brief Memory-mapped, immutable corpus shards
+ *
+ * A corpus is a directory of shard files plus a manifest:
+ *
+ *   corpus/
+ *     corpus.manifest        One line per shard: "<id> <file> <records> <bytes>"
+ *     shard-000000.hcs
+ *     shard-000001.hcs
+ *
+ * Shard file layout (little-endian, 8-byte aligned):
+ *
+ *   [ShardHeader, 64 bytes]
+ *   [record bytes, UTF-8 text, back to back]
+ *   [padding to 8 bytes]
+ *   [uint64 offsets[num_records + 1], relative to data_offset]
+ *
+ * Tasks reference training data as (shard, offset, count) instead of
+ * carrying the text, so task rows stay tiny and the corpus can be far
+ * larger than memory.
+ */
+
+#pragma once
+
+#include "hydra/mapped_file.hpp"
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct ShardHeader
+ * @brief Fixed 64-byte header at the start of every shard file
+ */
+struct ShardHeader {
+    char magic[8];                 // "HYDRACS1"
+    std::uint32_t version;         // Format version (1)
+    std::uint32_t flags;           // Reserved (0)
+    std::uint64_t shard_id;        // Id used in task references
+    std::uint64_t num_records;     // Number of records
+    std::uint64_t data_offset;     // File offset of the first record
+    std::uint64_t index_offset;    // File offset of the offsets table
+    std::uint64_t reserved[2];
+};
+static_assert(sizeof(ShardHeader) == 64, "ShardHeader must be 64 bytes");
+
+/**
+ * @struct ShardRef
+ * @brief A task's reference to a contiguous range of corpus records
+ */
+struct ShardRef {
+    std::uint64_t shard{0};        // Shard id
+    std::uint64_t offset{0};       // First record
+    std::uint64_t count{0};        // Number of records
+
+    /**
+     * @brief Serialize as a task data_batch: {"shard": 3, "offset": 120, "count": 3}
+     */
+    std::string to_json() const;
+
+    /**
+     * @brief Parse a data_batch written by to_json()
+     * @return std::nullopt if the text is not a shard reference (e.g. a
+     *         legacy list of sentences)
+     */
+    static std::optional<ShardRef> from_json(std::string_view text);
+};
+
+/**
+ * @class CorpusShard
+ * @brief One mapped shard file
+ */
+class CorpusShard {
+public:
+    /**
+     * @brief Map and validate a shard file
+     * @throws std::runtime_error if the file is missing or corrupt
+     */
+    explicit CorpusShard(const std::string& path);
+
+    std::uint64_t id() const { return header_->shard_id; }
+    std::uint64_t num_records() const { return header_->num_records; }
+
+    /**
+     * @brief Text of record i (no copy; valid while the shard is alive)
+     */
+    std::string_view record(std::uint64_t i) const;
+
+    /**
+     * @brief Raw file contents, e.g. to serve the shard to workers
+     */
+    std::span<const std::byte> file_bytes() const { return file_.bytes(); }
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    MappedFile file_;
+    const ShardHeader* header_{nullptr};
+    const std::uint64_t* index_{nullptr};
+    const char* records_{nullptr};
+};
+
+/**
+ * @class CorpusStore
+ * @brief All shards of a corpus directory
+ *
+ * Example usage:
+ * @code
+ * auto store = hydra::CorpusStore("corpus");
+ * hydra::ShardRef ref = store.sample(rng, 3);
+ * for (auto text : store.read(ref)) { ... }
+ * @endcode
+ */
+class CorpusStore {
+public:
+    /**
+     * @brief Open every shard listed in dir/corpus.manifest
+     * @throws std::runtime_error if the manifest or a shard is invalid
+     */
+    explicit CorpusStore(const std::string& dir);
+
+    const std::vector<CorpusShard>& shards() const { return shards_; }
+    std::uint64_t total_records() const { return total_records_; }
+
+    /**
+     * @brief Find a shard by id
+     * @return nullptr if the corpus has no such shard
+     */
+    const CorpusShard* shard(std::uint64_t id) const;
+
+    /**
+     * @brief Records referenced by ref (views into the mapped shard)
+     * @throws std::out_of_range if the reference is outside the shard
+     */
+    std::vector<std::string_view> read(const ShardRef& ref) const;
+
+    /**
+     * @brief Pick a random range of count records, uniformly over all records
+     * @param random A uniformly distributed 64-bit random number
+     */
+    ShardRef sample(std::uint64_t random, std::uint64_t count) const;
+
+private:
+    std::vector<CorpusShard> shards_;
+    std::vector<std::uint64_t> first_record_;   // Global index of each shard's first record
+    std::uint64_t total_records_{0};
+};
+
+/**
+ * @class CorpusWriter
+ * @brief Builds a corpus directory from text records
+ */
+class CorpusWriter {
+public:
+    /**
+     * @brief Constructor
+     * @param dir Output directory (created if missing)
+     * @param max_shard_bytes Start a new shard once this much text is written
+     */
+    CorpusWriter(std::string dir, std::uint64_t max_shard_bytes = 64ull << 20);
+
+    ~CorpusWriter();
+
+    CorpusWriter(const CorpusWriter&) = delete;
+    CorpusWriter& operator=(const CorpusWriter&) = delete;
+
+    /**
+     * @brief Append one record (e.g. a sentence or document)
+     */
+    void add(std::string_view record);
+
+    /**
+     * @brief Close the last shard and write the manifest
+     * @return Number of shards written
+     */
+    std::size_t finish();
+
+private:
+    struct ShardEntry {
+        std::uint64_t id;
+        std::string file;
+        std::uint64_t records;
+        std::uint64_t bytes;
+    };
+
+    std::string dir_;
+    std::uint64_t max_shard_bytes_;
+    std::vector<ShardEntry> written_;
+    std::ofstream out_;
+    std::vector<std::uint64_t> offsets_;
+    bool finished_{false};
+
+    void open_shard();
+    void close_shard();
+};
+
+} // namespace hydra
@@ -0,0 +1,25 @@
+/**
+ * @file cpu_features.hpp
+ * @brief Instruction sets the running CPU and OS can execute
+ *
+ * SIMD kernels are compiled in their own translation units with their own
+ * instruction-set flags and only called when these report true, so one
+ * binary runs on any x86-64 (and any other architecture, where both are
+ * false).
+ */
+
+#pragma once
+
+namespace hydra {
+
+/**
+ * @brief AVX2 and FMA, with the OS saving ymm registers
+ */
+bool cpu_has_avx2_fma();
+
+/**
+ * @brief AVX-512F, with the OS saving zmm and mask registers
+ */
+bool cpu_has_avx512f();
+
+} // namespace hydra
@@ -15,6 +15,7 @@
 #include <optional>
 #include <memory>
 #include <ctime>
+#include <cstddef>
 
 // Forward declare SQLite3 types to avoid including sqlite3.h in header
 struct sqlite3;
@@ -46,6 +47,7 @@ struct Task {
     std::string result;            // Trained parameters (JSON string)
     double tokens_reward{0.0};     // Token reward for completion
     std::string completed_at;      // When task was completed
+    std::size_t size_units{0};     // Sizing units in data_batch (0 = unknown)
 };
 
 /**
@@ -146,6 +148,22 @@ public:
                     const std::string& data_batch,
                     double tokens_reward);
 
+    /**
+     * @brief Create many pending tasks in a single transaction
+     * @param tasks Tasks to insert (task_id, data_batch, tokens_reward and
+     *              size_units are used)
+     * @return Number of tasks inserted (all or nothing)
+     */
+    int create_tasks(const std::vector<Task>& tasks);
+
+    /**
+     * @brief Count tasks with a given status
+     * @param status Status to count ("pending", "assigned", ...)
+     * @param assigned_to Only count tasks of this user (empty string = all users)
+     * @return Number of matching tasks, or -1 on error
+     */
+    int count_tasks(const std::string& status, const std::string& assigned_to = "");
+
     /**
      * @brief Get one pending task
      * @return Task object if found, std::nullopt if no pending tasks
@@ -161,10 +179,29 @@ public:
     bool assign_task(const std::string& task_id, const std::string& user_id);
 
     /**
-     * @brief Mark a task as completed
+     * @brief Assign a task to a worker, replacing its data, reward and size
+     *        (a task resized for the worker)
+     * @return true if successful
+     */
+    bool assign_task(const std::string& task_id, const std::string& user_id,
+                     const std::string& data_batch, double tokens_reward, std::size_t size_units);
+
+    /**
+     * @brief Get a task by id
+     * @return Task object if found, std::nullopt otherwise
+     */
+    std::optional<Task> get_task(const std::string& task_id);
+
+    /**
+     * @brief Mark a task as completed, unless it already is
+     *
+     * The first result for a task wins: a later one (a duplicate from a
+     * speculative copy, or a retry) changes nothing and returns false, so
+     * the caller can drop it before rewarding anyone.
+     *
      * @param task_id Task to complete
      * @param result Training results (JSON string)
-     * @return true if successful
+     * @return true if this call completed the task
      */
     bool complete_task(const std::string& task_id, const std::string& result);
 
@@ -177,6 +214,39 @@ public:
     std::vector<Task> get_user_tasks(const std::string& user_id,
                                      const std::string& status = "");
 
+    /**
+     * @brief Return a user's assigned tasks to the pending queue
+     * @param user_id User whose leases are released
+     * @return Number of tasks requeued, or -1 on error
+     */
+    int requeue_tasks(const std::string& user_id);
+
+    /**
+     * @brief Return tasks leased to workers that are not online to the
+     *        pending queue (leases left behind by a crash)
+     * @return Number of tasks requeued, or -1 on error
+     */
+    int requeue_orphaned_tasks();
+
+    // =========================================================================
+    // Worker Operations
+    // =========================================================================
+
+    /**
+     * @brief Record a worker's liveness state change
+     * @param user_id Worker's user
+     * @param status "online" or "offline"
+     * @return true if successful
+     */
+    bool set_worker_status(const std::string& user_id, const std::string& status);
+
+    /**
+     * @brief Get the users whose last recorded status is status
+     * @param status "online" or "offline"
+     * @return Vector of user ids
+     */
+    std::vector<std::string> get_workers(const std::string& status);
+
     // =========================================================================
     // Transaction Operations
     // =========================================================================
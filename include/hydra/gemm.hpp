@@ -0,0 +1,98 @@
+/**
+ * @file gemm.hpp
+ * @brief Single-precision matrix multiply for Linear layers
+ *
+ * sgemm() computes C = alpha * op(A) * op(B) + beta * C on row-major
+ * matrices, where op() optionally transposes. The forward pass of a
+ * Linear layer (y = x W^T, W in PyTorch's [out][in] layout) is
+ * sgemm(No, Yes); its backward pass needs dx = dy W (No, No) and
+ * dW = dy^T x (Yes, No).
+ *
+ * The multiply is cache-blocked the usual way: a kc x nc panel of B is
+ * packed to stay in L3/L2, an mc x kc block of A is packed to stay in L2,
+ * and a register-tiled micro-kernel multiplies an mr-row sliver of A with
+ * an nr-column sliver of B out of L1. Packing absorbs the transposes, so
+ * every variant runs the same kernel at the same speed. A forward pass
+ * over at most four rows (decoding) skips packing, which would cost as
+ * much as the multiply, and streams each weight row through dot products.
+ *
+ * The micro-kernel is chosen once, at first use, from what the CPU reports:
+ * AVX-512F, else AVX2 with FMA, else a portable kernel the compiler
+ * vectorizes for the baseline target. Kernels are compiled separately with
+ * their own instruction-set flags, so one binary runs everywhere.
+ * hydra_gemm_bench compares them with a naive loop.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace hydra {
+
+enum class Transpose { No, Yes };
+
+/**
+ * @brief C = alpha * op(A) * op(B) + beta * C
+ *
+ * @param m, n, k op(A) is m x k, op(B) is k x n, C is m x n
+ * @param a Row-major; k x m if trans_a, else m x k, rows lda apart
+ * @param b Row-major; n x k if trans_b, else k x n, rows ldb apart
+ * @param beta 0 ignores what C holds (NaNs included)
+ * @param c Row-major m x n, rows ldc apart; must not overlap a or b
+ *
+ * Thread Safety: safe to call from several threads (packing buffers are
+ * per thread); runs on the calling thread only.
+ */
+void sgemm(Transpose trans_a, Transpose trans_b,
+           std::size_t m, std::size_t n, std::size_t k,
+           float alpha, const float* a, std::size_t lda,
+           const float* b, std::size_t ldb,
+           float beta, float* c, std::size_t ldc);
+
+enum class GemmIsa { Portable, Avx2, Avx512 };
+
+/**
+ * @brief "portable", "avx2" or "avx512"
+ */
+std::string_view to_string(GemmIsa isa);
+
+/**
+ * @brief Whether this build has the kernel and this CPU can run it
+ */
+bool gemm_isa_supported(GemmIsa isa);
+
+/**
+ * @brief Kernel sgemm() uses (the best supported one unless overridden)
+ */
+GemmIsa gemm_isa();
+
+/**
+ * @brief Use another kernel from now on, for benchmarks and comparisons
+ * @throws std::invalid_argument if !gemm_isa_supported(isa)
+ */
+void set_gemm_isa(GemmIsa isa);
+
+namespace detail {
+
+/**
+ * @brief Register-tiled micro-kernel: C[mr][nr] += A * B over kc
+ *
+ * a holds kc columns of mr values, b kc rows of nr values (packed, 64-byte
+ * aligned); c is a full mr x nr tile with rows ldc apart.
+ */
+struct GemmKernel {
+    std::size_t mr;
+    std::size_t nr;
+    void (*run)(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc);
+};
+
+const GemmKernel& gemm_kernel_portable();
+#if defined(HYDRA_GEMM_X86)
+const GemmKernel& gemm_kernel_avx2();
+const GemmKernel& gemm_kernel_avx512();
+#endif
+
+} // namespace detail
+
+} // namespace hydra
@@ -0,0 +1,108 @@
+/**
+ * @file generation.hpp
+ * @brief Autoregressive text generation with SimpleTransformer
+ *
+ * generate() prefills a batch of prompts into paged KV caches and then
+ * decodes all unfinished sequences in lockstep, one token per step, with
+ * greedy, top-k and/or top-p (nucleus) sampling. A sequence stops at
+ * <END>, at its token budget, at the model's max_seq_length, or when the
+ * cache pool has no page left for it.
+ */
+
+#pragma once
+
+#include "hydra/kv_cache.hpp"
+#include "hydra/model_state.hpp"
+#include "hydra/transformer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct SamplingOptions
+ * @brief How the next token is picked from the logits
+ */
+struct SamplingOptions {
+    float temperature{0.0f};           // 0 = greedy (always the most likely token)
+    std::size_t top_k{0};              // Keep only the k most likely tokens (0 = all)
+    float top_p{1.0f};                 // Keep the smallest set holding this probability mass
+    std::uint64_t seed{0};             // 0 = nondeterministic
+};
+
+/**
+ * @struct GenerationOptions
+ * @brief Limits and sampling for one sequence
+ */
+struct GenerationOptions {
+    std::size_t max_new_tokens{20};
+    SamplingOptions sampling;
+    std::uint32_t token_end{0};        // Ids at or above this are never produced (0 = vocabulary)
+};
+
+enum class FinishReason {
+    End,        // Model produced <END>
+    Length,     // Token budget or max_seq_length reached
+    CacheFull   // No KV cache page left
+};
+
+/**
+ * @brief Name used in API responses ("end", "length", "cache_full")
+ */
+const char* finish_reason_name(FinishReason reason);
+
+/**
+ * @struct Generation
+ * @brief Output of one sequence (without the prompt and without <END>)
+ */
+struct Generation {
+    std::vector<std::uint32_t> tokens;
+    FinishReason finish{FinishReason::Length};
+};
+
+/**
+ * @class TokenSampler
+ * @brief Picks tokens from logits according to SamplingOptions
+ */
+class TokenSampler {
+public:
+    explicit TokenSampler(const SamplingOptions& options);
+
+    /**
+     * @brief Pick an index into logits
+     * @param logits Candidate logits (non-empty)
+     */
+    std::size_t sample(std::span<const float> logits);
+
+private:
+    SamplingOptions options_;
+    std::mt19937_64 rng_;
+    std::vector<std::pair<float, std::uint32_t>> candidates_;
+};
+
+/**
+ * @brief Generate continuations for a batch of prompts
+ *
+ * Only <END> and ordinary tokens are produced; <PAD>, <UNK> and <START>
+ * are never sampled.
+ *
+ * @param model Parameters to run (held for the whole call)
+ * @param pool Page pool for the sequences' caches (built for model's config)
+ * @param prompts Token ids, each 1..max_seq_length long
+ * @param options One per prompt
+ * @param workspace Scratch buffers
+ * @return One Generation per prompt
+ * @throws std::invalid_argument if a prompt is empty or too long, or the
+ *         sizes of prompts and options differ
+ */
+std::vector<Generation> generate(const ModelState& model,
+                                 KvPagePool& pool,
+                                 std::span<const std::vector<std::uint32_t>> prompts,
+                                 std::span<const GenerationOptions> options,
+                                 ForwardWorkspace& workspace);
+
+} // namespace hydra
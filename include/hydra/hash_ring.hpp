@@ -0,0 +1,60 @@
+/**
+ * @file hash_ring.hpp
+ * @brief Consistent hashing of keys onto a set of nodes
+ *
+ * Used to split users and tasks between several coordinator processes.
+ * Each node is placed on a 64-bit ring at many pseudo-random points
+ * (virtual nodes); a key belongs to the first point at or after its own
+ * hash. Adding or removing a node only moves the keys next to its points.
+ *
+ * The hash is FNV-1a followed by a 64-bit mixer, not std::hash, so every
+ * process (and every build) agrees on who owns what.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @class HashRing
+ * @brief Immutable consistent-hash ring
+ *
+ * Thread Safety: const methods may be called concurrently.
+ */
+class HashRing {
+public:
+    /**
+     * @brief Constructor
+     * @param nodes Node names (e.g. coordinator URLs); order defines indices
+     * @param virtual_nodes Points per node (more = more even split)
+     * @throws std::invalid_argument if nodes is empty or virtual_nodes is 0
+     */
+    explicit HashRing(std::vector<std::string> nodes, std::size_t virtual_nodes = 128);
+
+    /**
+     * @brief Index of the node owning key
+     */
+    std::size_t owner(std::string_view key) const;
+
+    const std::string& node(std::size_t index) const { return nodes_[index]; }
+    const std::vector<std::string>& nodes() const { return nodes_; }
+    std::size_t size() const { return nodes_.size(); }
+
+    /**
+     * @brief The ring's hash function (stable across processes)
+     */
+    static std::uint64_t hash(std::string_view key);
+
+private:
+    std::vector<std::string> nodes_;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> points_;   // Sorted by hash
+};
+
+} // namespace hydra
@@ -0,0 +1,154 @@
+/**
+ * @file heartbeat.hpp
+ * @brief In-memory worker liveness tracking for the coordinator
+ *
+ * Every request a worker makes counts as a heartbeat. Heartbeats only
+ * touch memory; the database hears about a worker when it comes online
+ * or goes silent, which is what the dashboard and lease reaping need.
+ *
+ * Deadlines live in a hierarchical timing wheel (4 levels x 64 slots):
+ *
+ *   level 0: one slot per tick          (64 ticks)
+ *   level 1: one slot per 64 ticks      (4096 ticks)
+ *   level 2: one slot per 4096 ticks    (262144 ticks)
+ *   level 3: one slot per 262144 ticks  (16.7M ticks)
+ *
+ * A heartbeat just moves the worker's deadline forward; the entry stays
+ * in its slot. When the slot comes due, an entry whose deadline has moved
+ * is re-filed instead of expired. Heartbeats and expirations are O(1) and
+ * each entry is re-filed at most once per level per timeout period.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct HeartbeatOptions
+ * @brief Timing of the heartbeat registry
+ */
+struct HeartbeatOptions {
+    std::chrono::milliseconds tick{100};       // Wheel resolution
+    std::chrono::milliseconds timeout{60000};  // Silence before a worker is offline
+};
+
+/**
+ * @brief Called when a worker comes online (true) or times out (false)
+ *
+ * Runs on the thread that caused the change (a heartbeat or the expiry
+ * thread), in the order the changes happened. It must not call back into
+ * the registry.
+ */
+using WorkerStateCallback = std::function<void(const std::string& worker_id, bool online)>;
+
+/**
+ * @class HeartbeatRegistry
+ * @brief Tracks which workers are alive
+ *
+ * Thread Safety: all public methods may be called from any thread.
+ */
+class HeartbeatRegistry {
+public:
+    /**
+     * @brief Constructor
+     * @param options Tick and timeout
+     * @param on_change State change callback (may be empty)
+     * @throws std::invalid_argument if tick or timeout is not positive
+     */
+    explicit HeartbeatRegistry(HeartbeatOptions options = {}, WorkerStateCallback on_change = {});
+
+    ~HeartbeatRegistry();
+
+    HeartbeatRegistry(const HeartbeatRegistry&) = delete;
+    HeartbeatRegistry& operator=(const HeartbeatRegistry&) = delete;
+
+    /**
+     * @brief Start the expiry thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the expiry thread (idempotent)
+     */
+    void stop();
+
+    /**
+     * @brief Record a heartbeat
+     * @return true if the worker was offline until now
+     */
+    bool beat(const std::string& worker_id);
+
+    /**
+     * @brief Expire every worker whose deadline is before now
+     *
+     * Called by the expiry thread once per tick; exposed for tools and
+     * for driving the wheel with a synthetic clock.
+     *
+     * @return Number of workers that went offline
+     */
+    std::size_t advance(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Number of workers currently online
+     */
+    std::size_t online() const;
+
+    /**
+     * @brief Whether a worker is currently online
+     */
+    bool is_online(const std::string& worker_id) const;
+
+    /**
+     * @brief Ids of online workers (at most limit, in no particular order)
+     */
+    std::vector<std::string> online_workers(std::size_t limit = 100) const;
+
+private:
+    static constexpr std::size_t kLevels = 4;
+    static constexpr std::size_t kSlotBits = 6;
+    static constexpr std::size_t kSlots = std::size_t{1} << kSlotBits;
+    static constexpr std::uint32_t kNil = UINT32_MAX;
+
+    // Slots are only ever emptied as a whole, so a singly linked list
+    // threaded through the entries is enough
+    struct Entry {
+        std::string worker_id;
+        std::uint64_t deadline{0};     // Tick at which the worker expires
+        std::uint32_t next{kNil};
+    };
+
+    HeartbeatOptions options_;
+    WorkerStateCallback on_change_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::uint64_t timeout_ticks_;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::vector<std::uint32_t> free_;
+    std::unordered_map<std::string, std::uint32_t> index_;
+    std::uint32_t slots_[kLevels][kSlots];
+    std::uint64_t current_{0};         // Last tick processed
+    std::mutex notify_mutex_;          // Keeps callbacks in state-change order
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_{false};
+    std::thread thread_;
+
+    std::uint64_t tick_of(std::chrono::steady_clock::time_point t) const;
+    void link(std::uint32_t e);
+    void run();
+};
+
+} // namespace hydra
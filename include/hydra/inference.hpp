@@ -0,0 +1,148 @@
+/**
+ * @file inference.hpp
+ * @brief Dynamic-batching inference for /query_model
+ *
+ * Queries are tokenized on the request thread and queued. Inference
+ * threads take them off the queue in batches: a batch closes when it has
+ * max_batch queries or when its oldest query has waited max_wait, so a
+ * lone query is answered almost immediately while a burst shares one pass
+ * over the weights. Each batch runs on the model snapshot current when it
+ * starts; training never waits for queries, and queries never see a
+ * half-published model.
+ *
+ * A batch is generated with generate(): the prompts are prefilled together
+ * and then decoded in lockstep, with KV caches drawn from one page pool
+ * shared by all inference threads.
+ */
+
+#pragma once
+
+#include "hydra/generation.hpp"
+#include "hydra/kv_cache.hpp"
+#include "hydra/model_state.hpp"
+#include "hydra/tokenizer.hpp"
+#include "hydra/transformer.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct InferenceOptions
+ * @brief Batching policy of the inference service
+ */
+struct InferenceOptions {
+    std::size_t max_batch{16};                   // Queries per forward pass
+    std::chrono::milliseconds max_wait{5};       // Longest a query waits for company
+    std::size_t threads{0};                      // Inference threads (0 = hardware concurrency)
+    std::size_t max_queued{256};                 // Waiting queries before submit() refuses
+    std::size_t kv_cache_bytes{256u << 20};      // KV cache pool shared by all threads
+};
+
+/**
+ * @struct InferenceResult
+ * @brief Answer to one query
+ */
+struct InferenceResult {
+    std::string text;                  // Generated continuation
+    std::size_t tokens{0};             // Tokens generated
+    FinishReason finish{FinishReason::Length};
+    std::uint64_t model_version{0};    // Snapshot the answer came from
+    std::size_t batch_size{0};         // Queries that shared the forward pass
+};
+
+/**
+ * @class InferenceService
+ * @brief Queues queries and answers them in dynamic batches
+ *
+ * Thread Safety: submit() may be called from any number of threads.
+ */
+class InferenceService {
+public:
+    using SnapshotSource = std::function<std::shared_ptr<const ModelState>()>;
+
+    /**
+     * @brief Constructor
+     * @param snapshot Returns the model to run a batch on (e.g. the
+     *                 aggregator's current snapshot)
+     * @param tokenizer Vocabulary used to encode prompts and decode answers
+     * @param options Batching policy
+     * @throws std::invalid_argument if max_batch or max_queued is 0
+     */
+    InferenceService(SnapshotSource snapshot, Tokenizer tokenizer, InferenceOptions options = {});
+
+    ~InferenceService();
+
+    InferenceService(const InferenceService&) = delete;
+    InferenceService& operator=(const InferenceService&) = delete;
+
+    /**
+     * @brief Start the inference threads
+     */
+    void start();
+
+    /**
+     * @brief Answer queued queries, then stop the threads (idempotent)
+     */
+    void stop();
+
+    /**
+     * @brief Queue a prompt
+     * @param prompt Text to continue
+     * @param options Token budget and sampling (token_end is set by the
+     *                service to the tokenizer's vocabulary)
+     * @return Future answer, or nullopt if the queue is full or stopped
+     */
+    std::optional<std::future<InferenceResult>> submit(std::string_view prompt,
+                                                       GenerationOptions options = {});
+
+    /**
+     * @brief Queries waiting for a batch
+     */
+    std::size_t queued() const;
+
+    std::uint64_t batches() const { return batches_.load(std::memory_order_relaxed); }
+    std::uint64_t queries() const { return queries_.load(std::memory_order_relaxed); }
+    const InferenceOptions& options() const { return options_; }
+
+private:
+    struct Query {
+        std::vector<std::uint32_t> tokens;
+        GenerationOptions options;
+        std::chrono::steady_clock::time_point received;
+        std::promise<InferenceResult> done;
+    };
+
+    SnapshotSource snapshot_;
+    Tokenizer tokenizer_;
+    InferenceOptions options_;
+    std::size_t max_tokens_;           // Prompt window (model's max_seq_length)
+    KvPagePool kv_pool_;
+
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_ready_;
+    std::deque<Query> queue_;
+    bool stopping_{false};
+    std::vector<std::thread> threads_;
+
+    std::atomic<std::uint64_t> batches_{0};
+    std::atomic<std::uint64_t> queries_{0};
+
+    void run();
+    void answer(std::vector<Query>& batch, ForwardWorkspace& workspace);
+};
+
+} // namespace hydra
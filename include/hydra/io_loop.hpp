@@ -0,0 +1,215 @@
+/**
+ * @file io_loop.hpp
+ * @brief Completion-based I/O loop over io_uring, with an epoll fallback
+ *
+ * Operations are started with a callback that runs on the loop thread once
+ * the operation is complete, with its result: bytes transferred, a new
+ * descriptor, or -errno. recv() and send() complete only when every byte
+ * has moved (or the connection failed), so callers never handle short
+ * transfers.
+ *
+ * io_uring: operations go into the submission ring, and one io_uring_enter
+ * per loop iteration both submits everything queued and waits for
+ * completions. Memory registered with register_buffer() is sent with
+ * zero-copy sends that skip both the copy into socket buffers and pinning
+ * the pages again for every send.
+ *
+ * epoll: each operation is tried at once on the non-blocking socket; when
+ * it would block, the loop waits for readiness in epoll_wait and retries.
+ * Registered buffers are not supported and sends copy as usual.
+ *
+ * The ring is driven by raw syscalls (no liburing). Build with
+ * -DHYDRA_IO_URING=OFF, or run on a kernel without io_uring, and
+ * IoBackend::Auto falls back to epoll.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <sys/uio.h>
+
+namespace hydra {
+
+/**
+ * @enum IoBackend
+ * @brief How network and disk I/O is driven
+ */
+enum class IoBackend {
+    Off,        // Blocking syscalls on dedicated threads
+    Epoll,      // Readiness loop
+    IoUring,    // Completion ring
+    Auto,       // io_uring if the kernel allows it, else epoll
+};
+
+/**
+ * @brief Parse "off", "epoll", "io_uring" or "auto"
+ */
+std::optional<IoBackend> parse_io_backend(std::string_view name);
+
+const char* io_backend_name(IoBackend backend);
+
+/**
+ * @brief Whether this build and kernel can set up an io_uring
+ */
+bool io_uring_available();
+
+/**
+ * @struct IoLoopStats
+ * @brief Work done by a loop, for comparing backends
+ */
+struct IoLoopStats {
+    std::uint64_t syscalls{0};     // Every syscall the loop made (waits, retries, registration)
+    std::uint64_t operations{0};   // Operations completed
+};
+
+/**
+ * @class IoLoop
+ * @brief Event loop for sockets and file writes
+ *
+ * Thread Safety: post() and stop() may be called from any thread; all
+ * other methods only from the thread running the loop (or, for a loop
+ * that is never run, the thread owning it).
+ */
+class IoLoop {
+public:
+    using Callback = std::function<void(int result)>;
+
+    /**
+     * @brief Create a loop
+     * @param backend Epoll, IoUring or Auto
+     * @param entries Submission ring size (io_uring)
+     * @throws std::invalid_argument for IoBackend::Off
+     * @throws std::runtime_error if the backend cannot be set up
+     */
+    static std::unique_ptr<IoLoop> create(IoBackend backend, unsigned entries = 256);
+
+    virtual ~IoLoop();
+
+    IoLoop(const IoLoop&) = delete;
+    IoLoop& operator=(const IoLoop&) = delete;
+
+    /**
+     * @brief Epoll or IoUring
+     */
+    virtual IoBackend backend() const = 0;
+
+    /**
+     * @brief Accept a connection (the new socket is close-on-exec, and
+     *        non-blocking under epoll)
+     */
+    virtual void accept(int listener, Callback done) = 0;
+
+    /**
+     * @brief Receive exactly size bytes into data
+     *
+     * Completes with size, with fewer bytes if the peer closed the
+     * connection first, or with -errno. At most one recv per socket at a time.
+     */
+    virtual void recv(int fd, void* data, std::size_t size, Callback done) = 0;
+
+    /**
+     * @brief Send every byte of parts (which must stay valid until done)
+     *
+     * @param buffer Index from register_buffer() holding the last part,
+     *        which is then sent zero-copy; -1 for an ordinary send
+     *
+     * Completes with the bytes sent or -errno. At most one send per socket
+     * at a time.
+     */
+    virtual void send(int fd, std::span<const iovec> parts, Callback done, int buffer = -1) = 0;
+
+    /**
+     * @brief Register memory for zero-copy sends
+     * @return Buffer index, or -1 if the backend has none or the kernel
+     *         refused (e.g. RLIMIT_MEMLOCK)
+     */
+    virtual int register_buffer(std::span<const std::byte> memory);
+
+    /**
+     * @brief Release a registered buffer (no send may still use it)
+     */
+    virtual void unregister_buffer(int buffer);
+
+    /**
+     * @brief Number of buffers that can be registered at once
+     */
+    virtual std::size_t buffer_slots() const { return 0; }
+
+    /**
+     * @brief Write parts to fd at offset, then optionally fsync, and wait
+     *
+     * io_uring submits all writes at once and waits for them in a single
+     * io_uring_enter, then does the same for the fsync; epoll uses pwritev
+     * and fsync. Only on a loop that is not running.
+     *
+     * @throws std::runtime_error if a write or the fsync fails
+     */
+    virtual void write_file(int fd, std::span<const iovec> parts, std::uint64_t offset, bool sync);
+
+    /**
+     * @brief Make the operations in flight on fd complete with -ECANCELED
+     *        (or their result, if they got one first)
+     */
+    virtual void cancel(int fd) = 0;
+
+    /**
+     * @brief Close a socket that has no operation in flight
+     */
+    virtual void close(int fd);
+
+    /**
+     * @brief Run task on the loop thread (thread-safe)
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Run operations and posted tasks until stop()
+     */
+    void run();
+
+    /**
+     * @brief Make run() return after its current iteration (thread-safe)
+     */
+    void stop();
+
+    /**
+     * @brief Counters so far (thread-safe)
+     */
+    IoLoopStats stats() const;
+
+protected:
+    IoLoop();
+
+    /**
+     * @brief Wait for and run completions (or readiness), then posted tasks
+     */
+    virtual void poll() = 0;
+
+    /**
+     * @brief Run posted tasks; called by backends when wake_fd_ fires
+     */
+    void run_posted();
+
+    int wake_fd_{-1};              // eventfd signalled by post() and stop()
+    std::atomic<std::uint64_t> syscalls_{0};
+    std::atomic<std::uint64_t> operations_{0};
+
+private:
+    struct Posted;
+    std::unique_ptr<Posted> posted_;
+};
+
+/**
+ * @brief write_file() through io, or pwritev and fsync without one
+ * @throws std::runtime_error if a write or the fsync fails
+ */
+void write_file(int fd, std::span<const iovec> parts, std::uint64_t offset, bool sync, IoLoop* io = nullptr);
+
+} // namespace hydra
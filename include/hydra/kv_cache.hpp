@@ -0,0 +1,138 @@
+/**
+ * @file kv_cache.hpp
+ * @brief Paged key/value cache for incremental decoding
+ *
+ * During generation every layer's keys and values of past tokens are kept
+ * so each new token costs one pass over the prefix instead of recomputing
+ * it. Caches grow a page (a fixed number of token slots for all layers)
+ * at a time from a shared pool, so sequences of very different lengths
+ * don't fragment memory and finished sequences hand their pages straight
+ * to the next ones.
+ *
+ * Page layout: [layer][key|value][slot][embed_dim] floats.
+ */
+
+#pragma once
+
+#include "hydra/model_state.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @class KvPagePool
+ * @brief Fixed-capacity pool of cache pages for one model architecture
+ *
+ * Memory is reserved in slabs of pages as the pool grows and is only
+ * returned when the pool is destroyed.
+ *
+ * Thread Safety: allocate() and release() may be called concurrently.
+ */
+class KvPagePool {
+public:
+    static constexpr std::size_t kSlabPages = 64;
+
+    /**
+     * @brief Constructor
+     * @param config Model the pages are for (layers and width)
+     * @param max_bytes Upper bound on cache memory
+     * @param page_tokens Token slots per page
+     * @throws std::invalid_argument if not even one page fits
+     */
+    KvPagePool(const ModelConfig& config, std::size_t max_bytes, std::size_t page_tokens = 16);
+
+    KvPagePool(const KvPagePool&) = delete;
+    KvPagePool& operator=(const KvPagePool&) = delete;
+
+    /**
+     * @brief Take a page from the pool
+     * @return Page index, or nullopt if the pool is exhausted
+     */
+    std::optional<std::uint32_t> allocate();
+
+    /**
+     * @brief Give a page back
+     */
+    void release(std::uint32_t page);
+
+    /**
+     * @brief Storage of an allocated page (stable for the pool's lifetime)
+     */
+    float* page(std::uint32_t index) const {
+        return slabs_[index / kSlabPages].get() + (index % kSlabPages) * page_floats_;
+    }
+
+    std::size_t page_tokens() const { return page_tokens_; }
+    std::size_t embed_dim() const { return embed_; }
+    std::size_t max_pages() const { return max_pages_; }
+    std::size_t pages_in_use() const;
+
+private:
+    std::size_t layers_;
+    std::size_t embed_;
+    std::size_t page_tokens_;
+    std::size_t page_floats_;
+    std::size_t max_pages_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<float[]>> slabs_;   // Sized up front; entries filled on demand
+    std::vector<std::uint32_t> free_;
+    std::size_t created_{0};                        // Pages handed out at least once
+};
+
+/**
+ * @class KvCache
+ * @brief Keys and values of one sequence, stored in pool pages
+ *
+ * Pages go back to the pool when the cache is destroyed.
+ */
+class KvCache {
+public:
+    explicit KvCache(KvPagePool& pool) : pool_(&pool) {}
+    ~KvCache();
+
+    KvCache(KvCache&& other) noexcept;
+    KvCache& operator=(KvCache&& other) noexcept;
+    KvCache(const KvCache&) = delete;
+    KvCache& operator=(const KvCache&) = delete;
+
+    /**
+     * @brief Make room for tokens positions in total
+     * @return false if the pool ran out of pages (the cache is unchanged
+     *         in length, but keeps any pages it got)
+     */
+    bool reserve(std::size_t tokens);
+
+    /**
+     * @brief Number of positions whose keys and values are stored
+     */
+    std::size_t length() const { return length_; }
+    void set_length(std::size_t length) { length_ = length; }
+
+    float* key(std::size_t layer, std::size_t position) const { return slot(layer, 0, position); }
+    float* value(std::size_t layer, std::size_t position) const { return slot(layer, 1, position); }
+
+    /**
+     * @brief Return all pages and forget every position
+     */
+    void clear();
+
+private:
+    KvPagePool* pool_;
+    std::vector<std::uint32_t> pages_;
+    std::size_t length_{0};
+
+    float* slot(std::size_t layer, std::size_t which, std::size_t position) const {
+        std::size_t tokens = pool_->page_tokens();
+        std::size_t embed = pool_->embed_dim();
+        return pool_->page(pages_[position / tokens]) +
+               ((layer * 2 + which) * tokens + position % tokens) * embed;
+    }
+};
+
+} // namespace hydra
@@ -0,0 +1,60 @@
+/**
+ * @file mapped_file.hpp
+ * @brief Read-only memory-mapped files
+ *
+ * Large immutable data (corpus shards, token files, checkpoints) is mapped
+ * instead of read, so it is paged in on demand, shared between processes
+ * through the page cache and never copied into the heap.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace hydra {
+
+/**
+ * @class MappedFile
+ * @brief RAII wrapper around a read-only file mapping
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    /**
+     * @brief Map a whole file read-only
+     * @param path File to map
+     * @throws std::runtime_error if the file cannot be opened or mapped
+     */
+    explicit MappedFile(const std::string& path);
+
+    ~MappedFile();
+
+    // Disable copying (the mapping has one owner)
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Allow moving
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const std::byte* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    std::span<const std::byte> bytes() const { return {data_, size_}; }
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief Hint that the whole mapping will be read soon
+     */
+    void prefetch() const;
+
+private:
+    const std::byte* data_{nullptr};
+    std::size_t size_{0};
+
+    void unmap();
+};
+
+} // namespace hydra
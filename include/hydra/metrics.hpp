@@ -0,0 +1,201 @@
+/**
+ * @file metrics.hpp
+ * @brief Counters, gauges and histograms exported in Prometheus text format
+ *
+ * Hot paths only touch their own cache line: counters and histograms are
+ * split into slots, each thread adds to the slot it was given on first
+ * use, and the slots are summed when /metrics is scraped. Metrics are
+ * registered once (registration takes a lock) and the returned reference
+ * is kept by the caller.
+ *
+ * Values owned by other components (queue depths, versions) are read at
+ * scrape time through callbacks instead of being mirrored on every change.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hydra {
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+enum class MetricType { Counter, Gauge, Histogram };
+
+namespace detail {
+
+constexpr std::size_t kMetricSlots = 16;
+
+/**
+ * @brief Slot of the calling thread (assigned round-robin on first use)
+ */
+std::size_t metric_slot();
+
+} // namespace detail
+
+/**
+ * @class Counter
+ * @brief Monotonic count, sharded across threads
+ */
+class Counter {
+public:
+    void add(std::uint64_t n = 1) {
+        slots_[detail::metric_slot()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Slot, detail::kMetricSlots> slots_;
+};
+
+/**
+ * @class Gauge
+ * @brief Value that can go up and down
+ */
+class Gauge {
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void add(double delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+/**
+ * @class Histogram
+ * @brief Distribution of observations over fixed buckets, sharded across threads
+ */
+class Histogram {
+public:
+    /**
+     * @param bounds Upper bucket bounds, ascending (+Inf is implicit)
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value);
+
+    template <typename Rep, typename Period>
+    void observe(std::chrono::duration<Rep, Period> elapsed) {
+        observe(std::chrono::duration<double>(elapsed).count());
+    }
+
+    struct Totals {
+        std::vector<std::uint64_t> buckets;   // Cumulative, one per bound plus +Inf
+        double sum{0.0};
+    };
+    Totals totals() const;
+
+    const std::vector<double>& bounds() const { return bounds_; }
+
+    /**
+     * @brief Default latency buckets, 0.5 ms to 30 s
+     */
+    static std::vector<double> latency_bounds();
+
+private:
+    struct alignas(64) Slot {
+        std::unique_ptr<std::atomic<std::uint64_t>[]> counts;
+        std::atomic<double> sum{0.0};
+    };
+
+    std::vector<double> bounds_;
+    std::array<Slot, detail::kMetricSlots> slots_;
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Observes the lifetime of a scope into a histogram (in seconds)
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { histogram_.observe(std::chrono::steady_clock::now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Named, labelled metrics rendered as Prometheus text
+ *
+ * Registering the same name and labels twice returns the same metric.
+ * Metrics live as long as the registry.
+ *
+ * Thread Safety: all methods may be called concurrently.
+ */
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const MetricLabels& labels = {},
+                         std::vector<double> bounds = Histogram::latency_bounds());
+
+    /**
+     * @brief Register a value read at scrape time
+     * @param owner Tag for remove_callbacks() (e.g. the object read by read)
+     */
+    void callback(const std::string& name, const std::string& help, MetricType type,
+                  std::function<double()> read, const MetricLabels& labels = {},
+                  const void* owner = nullptr);
+
+    /**
+     * @brief Drop the callbacks registered with owner (call before it dies)
+     */
+    void remove_callbacks(const void* owner);
+
+    /**
+     * @brief All metrics in the Prometheus text exposition format (0.0.4)
+     */
+    std::string render() const;
+
+private:
+    struct Series {
+        std::string labels;            // Rendered label set, e.g. {route="/x"}
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> read;
+        const void* owner{nullptr};
+    };
+
+    struct Family {
+        std::string help;
+        MetricType type;
+        std::vector<Series> series;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+
+    Series& series(const std::string& name, const std::string& help, MetricType type,
+                   const MetricLabels& labels);
+};
+
+/**
+ * @brief The process-wide registry served on /metrics
+ */
+MetricsRegistry& metrics();
+
+} // namespace hydra
@@ -0,0 +1,145 @@
+/**
+ * @file model_state.hpp
+ * @brief Flattened parameter storage for the global SimpleTransformer model
+ *
+ * The coordinator never runs PyTorch; it only needs the model's parameters
+ * as numbers it can send to workers, aggregate and checkpoint. ModelState
+ * keeps every tensor of SimpleTransformer (model.py) in one contiguous
+ * float buffer, described by a table of named tensors in the same order
+ * and with the same names as PyTorch's named_parameters().
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct ModelConfig
+ * @brief Architecture of SimpleTransformer (see MODEL_CONFIG in config.py)
+ */
+struct ModelConfig {
+    int vocab_size{10000};         // Number of unique tokens
+    int embed_dim{256};            // Size of embeddings
+    int num_heads{4};              // Attention heads per layer
+    int num_layers{2};             // Transformer encoder layers
+    int max_seq_length{512};       // Maximum sequence length
+};
+
+/**
+ * @struct TensorInfo
+ * @brief Location of one named tensor inside the flat parameter buffer
+ */
+struct TensorInfo {
+    std::string name;              // PyTorch parameter name
+    std::vector<std::size_t> shape;
+    std::size_t offset{0};         // First element in the flat buffer
+    std::size_t size{0};           // Number of elements
+};
+
+/**
+ * @class ModelState
+ * @brief One version of the global model's parameters
+ *
+ * Instances are treated as immutable once published: the aggregation
+ * engine builds a new ModelState for every round and readers keep using
+ * the snapshot they loaded.
+ */
+class ModelState {
+public:
+    ModelState() = default;
+
+    /**
+     * @brief Create a freshly initialized model
+     *
+     * Uses the same initialization scheme as PyTorch's defaults (normal
+     * embeddings, fan-in scaled uniform weights, zero biases, unit
+     * LayerNorm scales, zero positional encoding).
+     *
+     * @param config Model architecture
+     * @param seed Random seed for reproducible initialization
+     */
+    static ModelState create(const ModelConfig& config, std::uint64_t seed = 42);
+
+    /**
+     * @brief Create the tensor table with all parameters zero
+     *
+     * For callers that overwrite every value anyway (e.g. checkpoint
+     * loading), which would otherwise pay for the random initialization.
+     *
+     * @throws std::invalid_argument if embed_dim is not a multiple of num_heads
+     */
+    static ModelState layout(const ModelConfig& config);
+
+    const ModelConfig& config() const { return config_; }
+    const std::vector<TensorInfo>& tensors() const { return tensors_; }
+
+    std::span<float> values() { return values_; }
+    std::span<const float> values() const { return values_; }
+
+    std::uint64_t version() const { return version_; }
+    void set_version(std::uint64_t version) { version_ = version; }
+
+    /**
+     * @brief Look up a tensor by name
+     * @return Pointer into the tensor table, or nullptr if unknown
+     */
+    const TensorInfo* find(std::string_view name) const;
+
+    /**
+     * @brief Serialize all parameters as a JSON object of nested lists
+     *
+     * The output matches SimpleTransformer.get_trainable_parameters() so
+     * worker.py can pass it straight to set_parameters().
+     */
+    std::string to_json() const;
+
+    /**
+     * @brief Parse a JSON object of nested lists into a flat buffer
+     *
+     * Tensors missing from the JSON leave the corresponding range of
+     * out untouched, so callers pre-fill it with the current global
+     * values. Unknown names are ignored, like set_parameters(strict=False).
+     *
+     * @param json JSON object text ({"name": [[...]], ...})
+     * @param out Buffer with this model's layout
+     * @return Number of tensors read
+     * @throws std::runtime_error on malformed JSON, wrong element counts
+     *         or non-finite values
+     */
+    std::size_t parse_json(std::string_view json, std::span<float> out) const;
+
+private:
+    ModelConfig config_;
+    std::vector<TensorInfo> tensors_;
+    std::vector<float> values_;
+    std::uint64_t version_{0};
+
+    void add_tensor(std::string name, std::vector<std::size_t> shape);
+};
+
+/**
+ * @brief Find a top-level member of a JSON object without parsing it all
+ *
+ * Skims over nested values (respecting strings and escapes) so large
+ * payloads such as parameter uploads can be located cheaply.
+ *
+ * @param object JSON object text
+ * @param key Member name (compared without unescaping)
+ * @return Raw text of the member's value, or an empty view if absent
+ */
+std::string_view find_json_member(std::string_view object, std::string_view key);
+
+/**
+ * @brief Decode a raw JSON string value (including its quotes)
+ * @return Unescaped string, or an empty string if raw is not a JSON string
+ */
+std::string json_string_value(std::string_view raw);
+
+} // namespace hydra
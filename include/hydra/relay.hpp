@@ -0,0 +1,180 @@
+/**
+ * @file relay.hpp
+ * @brief Relay node for hierarchical aggregation
+ *
+ * A relay sits between a group of workers and the coordinator. Workers
+ * point --server at the relay instead of the coordinator; every request
+ * except /submit_result is forwarded upstream unchanged. Submissions are
+ * parsed, collected into batches and pre-aggregated with the same kernels
+ * the coordinator uses (aggregate_updates), and each batch goes upstream
+ * as ONE update, in two steps:
+ *
+ *   POST /relay/reserve  application/json
+ *     {"relay_id": "...", "completions": [{"user_id", "task_id"}, ...]}
+ *     -> {"results": [...], "accepted": n, "batch": "...", "expires_in": s}
+ *   POST /relay/submit   application/octet-stream, see frame_relay_batch()
+ *     header: {"relay_id": "...", "batch": "..."}
+ *     values: the aggregate of the accepted submissions, raw float32
+ *
+ * The coordinator rewards the completions it accepts, one result per
+ * completion, and remembers their number under the batch token. The relay
+ * aggregates exactly those submissions, and the coordinator adds the
+ * aggregate to its round as that many worker updates (see
+ * RoundAggregator::submit), so its ingress grows with the number of relays
+ * rather than the number of workers. Workers are answered after the first
+ * step; an aggregate that never arrives is dropped when the batch expires.
+ *
+ * With upstream_rpc set, both steps go over one persistent binary RPC
+ * connection instead (RpcMethod::RelayReserve and RelaySubmit, same
+ * headers and values), e.g. through a Unix socket when the relay runs next
+ * to the coordinator.
+ *
+ * A relay rewards tasks on behalf of any user, so the coordinator only
+ * accepts relays that present its relay secret: the X-Relay-Secret header
+ * over HTTP, the header's "relay_secret" member over RPC.
+ */
+
+#pragma once
+
+#include "hydra/aggregation.hpp"
+#include "hydra/model_state.hpp"
+#include "hydra/rpc.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Forward declare cpp-httplib types to avoid including httplib.h in header
+namespace httplib {
+class Server;
+struct Request;
+struct Response;
+}
+
+namespace hydra {
+
+inline constexpr char kRelaySecretHeader[] = "X-Relay-Secret";
+
+/**
+ * @brief Build a /relay/submit body
+ *
+ * Layout: uint32 header length (little-endian), JSON header, float32
+ * values.
+ */
+std::string frame_relay_batch(std::string_view header, std::span<const float> values);
+
+/**
+ * @brief Split a /relay/submit body into its header and raw values
+ * @return false if the body is too short or the values are not whole floats
+ */
+bool split_relay_batch(std::string_view body, std::string_view& header, std::string_view& values);
+
+/**
+ * @struct RelayOptions
+ * @brief Relay settings
+ */
+struct RelayOptions {
+    std::string upstream{"http://localhost:5000"};   // Coordinator URL
+    std::string upstream_rpc;          // Coordinator RPC endpoint for batches (empty = HTTP)
+    ContentEncoding upstream_encoding{ContentEncoding::Identity};   // Of RPC batch payloads
+    std::string host{"0.0.0.0"};       // Address to listen on
+    int port{5100};                    // Port to listen on
+    std::string relay_id;              // Name reported upstream (empty = host:port)
+    std::string secret;                // The coordinator's relay secret (required)
+
+    std::size_t batch_size{8};         // Submissions combined per upstream update
+    std::chrono::milliseconds max_delay{2000};   // Longest a submission waits for its batch
+    std::size_t max_queued{32};        // Buffered submissions before answering 429
+    AggregationOptions aggregation{AggregationRule::TrimmedMean};   // Rule within a batch
+};
+
+/**
+ * @class RelayServer
+ * @brief Forwards worker traffic and batches submissions
+ *
+ * Example:
+ * @code
+ * hydra::RelayOptions options;
+ * options.upstream = "http://coordinator:5000";
+ * hydra::RelayServer relay(options);
+ * relay.run();   // Blocks until stop() is called
+ * @endcode
+ */
+class RelayServer {
+public:
+    /**
+     * @brief Constructor
+     * @throws std::invalid_argument if batch_size or max_queued is 0, or
+     *         the secret is empty
+     */
+    explicit RelayServer(RelayOptions options);
+
+    ~RelayServer();
+
+    RelayServer(const RelayServer&) = delete;
+    RelayServer& operator=(const RelayServer&) = delete;
+
+    /**
+     * @brief Fetch the model layout from upstream, then serve (blocking)
+     * @return false if upstream is unreachable or the port can't be bound
+     */
+    bool run();
+
+    /**
+     * @brief Stop serving; buffered submissions are still forwarded
+     */
+    void stop();
+
+    /**
+     * @brief Number of batch aggregates accepted upstream
+     */
+    std::uint64_t batches() const { return batches_.load(std::memory_order_relaxed); }
+
+private:
+    struct Outcome {
+        int status{502};
+        std::string body;
+        std::string retry_after;       // Passed through from a 429 upstream
+    };
+
+    struct Submission {
+        std::string user_id;
+        std::string task_id;
+        std::vector<float> update;
+        std::chrono::steady_clock::time_point received;
+        std::promise<Outcome> done;
+    };
+
+    RelayOptions options_;
+    std::unique_ptr<ModelState> layout_;   // Parameter layout of the upstream model
+    std::unique_ptr<httplib::Server> http_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_ready_;
+    std::deque<Submission> queue_;
+    bool stopping_{false};
+    std::thread flusher_;
+    std::unique_ptr<RpcClient> rpc_;   // Used by the flusher only; reconnected after failures
+    std::atomic<std::uint64_t> batches_{0};
+
+    bool fetch_layout();
+    void setup_routes();
+    void handle_submit_result(const httplib::Request& req, httplib::Response& res);
+    void proxy(const httplib::Request& req, httplib::Response& res);
+    void run_flusher();
+    void forward(std::vector<Submission> batch);
+    Outcome call_upstream(RpcMethod method, const char* path, const std::string& header,
+                          std::span<const float> values);
+};
+
+} // namespace hydra
@@ -0,0 +1,141 @@
+/**
+ * @file response_cache.hpp
+ * @brief Cache of /query_model answers keyed by prompt, model version and sampling
+ *
+ * Identical prompts (help text, demos) are common, and a repeated answer
+ * should not cost a generation. Only reproducible answers are cached:
+ * greedy decoding, or sampling with an explicit seed. The model version is
+ * part of every key, and the first lookup or insert that sees a newer
+ * version drops everything, so a published model invalidates the cache
+ * without any call from the aggregator.
+ *
+ * Entries live in sharded LRU lists. When a shard is full, a TinyLFU
+ * admission filter (a count-min sketch of recent key frequencies) decides
+ * whether the newcomer is worth more than the LRU victim, so a burst of
+ * one-off prompts cannot flush the popular ones. Optionally, entries that
+ * leave memory are appended to a memory-mapped spill file, a ring that
+ * serves as a second, larger tier until it wraps over them.
+ */
+
+#pragma once
+
+#include "hydra/generation.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct ResponseCacheOptions
+ * @brief Sizes of the response cache tiers
+ */
+struct ResponseCacheOptions {
+    std::size_t max_bytes{64u << 20};  // In-memory entries (0 = cache disabled)
+    std::size_t shards{16};            // Independently locked LRU lists
+    std::string spill_path;            // Spill file (empty = memory only)
+    std::size_t spill_bytes{256u << 20};   // Size of the spill ring
+};
+
+/**
+ * @struct CachedAnswer
+ * @brief The part of an answer that depends only on the key
+ */
+struct CachedAnswer {
+    std::string text;
+    std::size_t tokens{0};
+    FinishReason finish{FinishReason::Length};
+};
+
+/**
+ * @class ResponseCache
+ * @brief Two-tier LRU/TinyLFU cache of generated answers
+ *
+ * Thread Safety: all methods may be called concurrently.
+ */
+class ResponseCache {
+public:
+    /**
+     * @brief Constructor
+     * @param options Tier sizes
+     * @throws std::runtime_error if the spill file cannot be created or mapped
+     */
+    explicit ResponseCache(ResponseCacheOptions options = {});
+
+    ~ResponseCache();
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    /**
+     * @brief Whether answers generated with these options are reproducible
+     */
+    static bool cacheable(const GenerationOptions& options);
+
+    bool enabled() const { return !shards_.empty(); }
+
+    /**
+     * @brief Find the answer to prompt under model version
+     * @return The answer, or nullopt on a miss
+     */
+    std::optional<CachedAnswer> lookup(std::string_view prompt, const GenerationOptions& options,
+                                       std::uint64_t version);
+
+    /**
+     * @brief Remember an answer (ignored if version is already outdated)
+     */
+    void insert(std::string_view prompt, const GenerationOptions& options,
+                std::uint64_t version, const CachedAnswer& answer);
+
+    std::uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    std::uint64_t spill_hits() const { return spill_hits_.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    std::uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
+    std::uint64_t rejections() const { return rejections_.load(std::memory_order_relaxed); }
+    std::size_t bytes() const;
+
+private:
+    struct Entry {
+        std::uint64_t hash;
+        std::string key;               // Full key, compared on every hit
+        CachedAnswer answer;
+        std::size_t bytes;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;          // Most recently used first
+        std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+        std::size_t bytes{0};
+    };
+
+    class FrequencySketch;
+    class SpillRing;
+
+    ResponseCacheOptions options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::unique_ptr<FrequencySketch> sketch_;
+    std::unique_ptr<SpillRing> spill_;
+    std::atomic<std::uint64_t> version_{0};
+
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> spill_hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+    std::atomic<std::uint64_t> rejections_{0};
+
+    bool advance_version(std::uint64_t version);
+    void admit(Shard& shard, Entry entry);
+    static std::string make_key(std::string_view prompt, const GenerationOptions& options,
+                                std::uint64_t version);
+};
+
+} // namespace hydra
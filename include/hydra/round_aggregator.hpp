@@ -0,0 +1,119 @@
+/**
+ * @file round_aggregator.hpp
+ * @brief Round-based aggregation engine for the global model
+ *
+ * Worker submissions are buffered until a round is full, combined with
+ * aggregate_updates() and blended into a new ModelState, which is then
+ * published as the current snapshot. Readers (get_task, queries,
+ * checkpoints) load the snapshot without blocking aggregation.
+ *
+ * A submission may stand for several worker updates (a relay's batch
+ * aggregate). It then fills that many of the round's slots and counts as
+ * that many workers under every rule: as the weight under Mean, and as
+ * repeated copies under TrimmedMean and Median, which take no weights.
+ */
+
+#pragma once
+
+#include "hydra/aggregation.hpp"
+#include "hydra/model_state.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct RoundOptions
+ * @brief Configuration of the aggregation engine
+ */
+struct RoundOptions {
+    std::size_t round_size{10};        // Worker updates combined per round
+    double learning_rate{0.5};         // Blend factor of each round's aggregate
+    AggregationOptions aggregation{AggregationRule::TrimmedMean};
+};
+
+/**
+ * @class RoundAggregator
+ * @brief Buffers worker updates and publishes a new model every round
+ *
+ * Thread Safety: all methods may be called concurrently.
+ */
+class RoundAggregator {
+public:
+    /// Called with each newly published version, under the publication
+    /// lock (keep it short: it delays the next round)
+    using PublishListener = std::function<void(std::uint64_t version)>;
+
+    /**
+     * @brief Constructor
+     * @param initial Model to start from (becomes the first snapshot)
+     * @param options Round size, learning rate and aggregation rule
+     * @param on_publish Optional listener for new versions
+     */
+    RoundAggregator(std::shared_ptr<const ModelState> initial, RoundOptions options,
+                    PublishListener on_publish = nullptr);
+
+    /**
+     * @brief Current global model (RCU-style: never blocks, never torn)
+     */
+    std::shared_ptr<const ModelState> snapshot() const;
+
+    /**
+     * @brief Add flattened parameters to the current round
+     *
+     * The submission that fills the round runs the aggregation on the
+     * calling thread and publishes the new snapshot before returning.
+     *
+     * @param update Parameters with the snapshot's layout (moved in)
+     * @param count Worker updates it stands for (1, or a relay's batch)
+     * @return true if this submission closed a round
+     * @throws std::invalid_argument if update has the wrong size or count is 0
+     */
+    bool submit(std::vector<float> update, std::size_t count = 1);
+
+    /**
+     * @brief Replace the current model (e.g. with a cluster-wide average)
+     *
+     * Serialized with round publication; submissions buffered for the
+     * current round are blended into the new model when it closes. The
+     * model's version is raised above the current one if needed, so a
+     * version number never names two different models.
+     *
+     * @throws std::invalid_argument if model has a different layout
+     */
+    void publish(std::shared_ptr<ModelState> model);
+
+    /**
+     * @brief Number of worker updates waiting in the current round
+     */
+    std::size_t buffered() const;
+
+    /**
+     * @brief Number of rounds aggregated since construction
+     */
+    std::uint64_t rounds() const { return rounds_.load(std::memory_order_relaxed); }
+
+    const RoundOptions& options() const { return options_; }
+
+private:
+    RoundOptions options_;
+    PublishListener on_publish_;
+
+    std::atomic<std::shared_ptr<const ModelState>> current_;
+
+    mutable std::mutex pending_mutex_;         // Guards pending_, counts_ and buffered_
+    std::vector<std::vector<float>> pending_;
+    std::vector<std::size_t> counts_;
+    std::size_t buffered_{0};                  // Sum of counts_
+
+    std::mutex aggregate_mutex_;               // Serializes round publication
+    std::atomic<std::uint64_t> rounds_{0};
+
+    void aggregate_round(std::vector<std::vector<float>> updates, std::vector<std::size_t> counts);
+};
+
+} // namespace hydra
@@ -0,0 +1,288 @@
+/**
+ * @file rpc.hpp
+ * @brief Length-prefixed binary RPC over persistent TCP or Unix sockets
+ *
+ * The binary transport runs next to the HTTP API. Each message, request
+ * or reply, is one frame:
+ *
+ *   [RpcFrameHeader, 32 bytes]
+ *   [meta: meta_bytes of JSON, the fields the HTTP API uses]
+ *   [payload: payload_bytes of raw float32 parameters, machine byte order]
+ *
+ * Parameters travel as raw floats instead of JSON numbers, so neither side
+ * formats or parses them. Senders pass header, meta and payload to the
+ * kernel as one scatter/gather write from wherever they already live (for
+ * a task, the model snapshot itself); receivers read the payload straight
+ * into the float buffer it is used from.
+ *
+ * A payload may instead be encoded (x-hydra-lz or x-hydra-deflate, see
+ * compression.hpp): then it is a stream of blocks that decodes to
+ * payload_bytes. Requests name the encodings their sender accepts for the
+ * reply; replies name the one the server accepts for uploads. A sender
+ * that knows nothing of encodings leaves both zero, which is identity.
+ *
+ * Connections stay open, and requests may be pipelined: a client can send
+ * several requests before reading any reply. Replies come back in request
+ * order and echo the request id.
+ *
+ * Endpoints are "host:port" for TCP or "unix:/path" for a Unix socket
+ * (for relays on the coordinator's machine).
+ */
+
+#pragma once
+
+#include "hydra/compression.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @enum RpcMethod
+ * @brief Operations of the binary transport (HTTP route in brackets)
+ */
+enum class RpcMethod : std::uint16_t {
+    Register = 1,        // [/register]       meta {user_id}
+    Heartbeat = 2,       // [/heartbeat]      meta {user_id}
+    GetTask = 3,         // [/get_task]       meta {user_id, wait}; reply payload: model parameters
+    SubmitResult = 4,    // [/submit_result]  meta {user_id, task_id}; payload: all parameters
+    GetBalance = 5,      // [/get_balance]    meta {user_id}
+    ModelConfig = 6,     // [/model/config]
+    RelaySubmit = 7,     // [/relay/submit]   meta {relay_id, batch}; payload: the aggregate
+    RelayReserve = 8,    // [/relay/reserve]  meta: relay batch header
+};
+
+/**
+ * @brief Name of a method for logs and metrics ("unknown" if invalid)
+ */
+const char* rpc_method_name(RpcMethod method);
+
+/**
+ * @struct RpcFrameHeader
+ * @brief Fixed 32-byte header in front of every frame
+ */
+struct RpcFrameHeader {
+    char magic[4];                 // "HRPC"
+    std::uint16_t method;          // RpcMethod
+    std::uint16_t status;          // HTTP status code (replies only)
+    std::uint64_t request_id;      // Chosen by the client, echoed in the reply
+    std::uint64_t payload_bytes;   // Whole floats, decoded
+    std::uint32_t meta_bytes;
+    std::uint8_t encoding;         // ContentEncoding of the payload
+    std::uint8_t accept_encoding;  // Requests: for the reply; replies: for later requests
+    std::uint16_t reserved;
+};
+static_assert(sizeof(RpcFrameHeader) == 32, "RpcFrameHeader must be 32 bytes");
+
+constexpr std::uint32_t kRpcMaxMeta = 16u << 20;               // 16 MiB of JSON
+constexpr std::uint64_t kRpcMaxPayload = std::uint64_t{4} << 30;   // 4 GiB of parameters
+
+/**
+ * @brief Header of a frame with meta_bytes of meta and payload_bytes of payload
+ *        (decoded)
+ * @throws std::runtime_error if either is over its limit
+ */
+RpcFrameHeader rpc_frame_header(RpcMethod method, int status, std::uint64_t request_id,
+                                std::size_t meta_bytes, std::size_t payload_bytes,
+                                ContentEncoding encoding = ContentEncoding::Identity,
+                                ContentEncoding accept = ContentEncoding::Identity);
+
+/**
+ * @brief Check a received header's magic, sizes and encodings
+ * @throws std::runtime_error if it does not start a valid frame
+ */
+void rpc_check_header(const RpcFrameHeader& header);
+
+/**
+ * @brief Decoded payload bytes a request of a method must carry, for
+ *        receivers that know (see RpcConnection::receive())
+ */
+using RpcPayloadSize = std::function<std::uint64_t(RpcMethod method)>;
+
+/**
+ * @brief Whether a payload may travel in this encoding (identity,
+ *        x-hydra-lz or x-hydra-deflate)
+ */
+bool rpc_payload_encoding(ContentEncoding encoding);
+
+/**
+ * @brief Decode a whole encoded payload
+ * @param out Exactly the decoded size
+ * @throws std::runtime_error if the stream is corrupt or decodes to a
+ *         different size
+ */
+void rpc_decode_payload(ContentEncoding encoding, std::span<const std::byte> stream, std::span<std::byte> out);
+
+/**
+ * @struct RpcMessage
+ * @brief One received frame
+ */
+struct RpcMessage {
+    RpcMethod method{};
+    int status{0};
+    std::uint64_t request_id{0};
+    std::string meta;
+    std::vector<float> payload;                            // Decoded
+    ContentEncoding encoding{ContentEncoding::Identity};   // How the payload travelled
+    ContentEncoding accept{ContentEncoding::Identity};     // What the sender accepts
+    std::string peer;                                      // Sender's IP address (set by RpcServer;
+                                                           // empty on Unix sockets)
+};
+
+/**
+ * @class RpcConnection
+ * @brief Frames over one connected socket
+ *
+ * Thread Safety: one thread may send while another receives.
+ */
+class RpcConnection {
+public:
+    /**
+     * @brief Take ownership of a connected socket
+     */
+    explicit RpcConnection(int fd);
+
+    ~RpcConnection();
+
+    RpcConnection(RpcConnection&& other) noexcept;
+    RpcConnection& operator=(RpcConnection&& other) noexcept;
+    RpcConnection(const RpcConnection&) = delete;
+    RpcConnection& operator=(const RpcConnection&) = delete;
+
+    /**
+     * @brief Send one frame
+     *
+     * An identity payload goes out with header and meta in a single
+     * scatter/gather write (repeated only if the kernel takes it in
+     * parts). Otherwise the payload is encoded a block at a time and each
+     * block sent as it is ready.
+     *
+     * @throws std::runtime_error if the connection fails
+     */
+    void send(RpcMethod method, int status, std::uint64_t request_id, std::string_view meta,
+              std::span<const float> payload = {}, ContentEncoding encoding = ContentEncoding::Identity,
+              ContentEncoding accept = ContentEncoding::Identity);
+
+    /**
+     * @brief Send one frame whose payload is already encoded (a block
+     *        stream that decodes to payload_bytes), in one write
+     */
+    void send_encoded(RpcMethod method, int status, std::uint64_t request_id, std::string_view meta,
+                      std::size_t payload_bytes, ContentEncoding encoding, std::span<const std::byte> stream,
+                      ContentEncoding accept = ContentEncoding::Identity);
+
+    /**
+     * @brief Receive the next frame, decoding an encoded payload a block
+     *        at a time into message.payload
+     * @param expected If set, a frame whose payload is another size is
+     *        refused before anything is allocated for it
+     * @return false if the peer closed the connection between frames
+     * @throws std::runtime_error on a socket error, a closed connection in
+     *         the middle of a frame or a malformed frame
+     */
+    bool receive(RpcMessage& message, const RpcPayloadSize& expected = {});
+
+    /**
+     * @brief Wake up a thread blocked in receive() (it then returns false)
+     */
+    void shutdown();
+
+    int fd() const { return fd_; }
+
+    /**
+     * @brief Bytes written to and read from the socket, headers included
+     */
+    std::uint64_t bytes_sent() const { return sent_; }
+    std::uint64_t bytes_received() const { return received_; }
+
+private:
+    int fd_{-1};
+    std::uint64_t sent_{0};
+    std::uint64_t received_{0};
+    std::unique_ptr<Compressor> compressor_;       // Created on first use
+    std::unique_ptr<Decompressor> decompressor_;
+    std::vector<std::byte> packed_;                // One block being received
+};
+
+/**
+ * @brief Connect to "host:port" or "unix:/path"
+ * @return Connected socket
+ * @throws std::runtime_error if the endpoint is malformed or unreachable
+ */
+int rpc_connect(const std::string& endpoint);
+
+/**
+ * @brief Listen on "host:port" or "unix:/path" (a stale socket file at
+ *        the path is replaced)
+ * @return Listening socket
+ * @throws std::runtime_error if the endpoint is malformed or cannot be bound
+ */
+int rpc_listen(const std::string& endpoint);
+
+/**
+ * @class RpcClient
+ * @brief Persistent, pipelining client connection
+ *
+ * With an encoding, the client asks for encoded replies and, once a reply
+ * shows the server accepts the same encoding, encodes its uploads too.
+ *
+ * Example:
+ * @code
+ * hydra::RpcClient client("unix:/run/hydra.sock");
+ * auto first = client.send(hydra::RpcMethod::Heartbeat, R"({"user_id":"alice"})");
+ * auto second = client.send(hydra::RpcMethod::GetTask, R"({"user_id":"alice"})");
+ * hydra::RpcMessage beat = client.receive();   // Reply to first
+ * hydra::RpcMessage task = client.receive();   // Reply to second, parameters in task.payload
+ * @endcode
+ *
+ * Keep the number of outstanding requests bounded (tens, not thousands):
+ * the server answers in order, and a client that only sends eventually
+ * blocks on full socket buffers while the server blocks sending replies.
+ *
+ * Thread Safety: not thread-safe; use one client per thread.
+ */
+class RpcClient {
+public:
+    /**
+     * @brief Connect
+     * @param encoding Identity, Lz or Deflate
+     * @throws std::runtime_error if the endpoint is unreachable
+     */
+    explicit RpcClient(const std::string& endpoint, ContentEncoding encoding = ContentEncoding::Identity);
+
+    /**
+     * @brief Send a request without waiting for its reply
+     * @return The request's id
+     * @throws std::runtime_error if the connection fails
+     */
+    std::uint64_t send(RpcMethod method, std::string_view meta, std::span<const float> payload = {});
+
+    /**
+     * @brief Read the reply to the oldest outstanding request
+     * @throws std::runtime_error if the connection fails or closes
+     */
+    RpcMessage receive();
+
+    /**
+     * @brief send() and receive() in one
+     */
+    RpcMessage call(RpcMethod method, std::string_view meta, std::span<const float> payload = {});
+
+    const std::string& endpoint() const { return endpoint_; }
+    const RpcConnection& connection() const { return connection_; }
+
+private:
+    std::string endpoint_;
+    RpcConnection connection_;
+    ContentEncoding encoding_;
+    bool encode_uploads_{false};   // The server said it accepts encoding_
+    std::uint64_t next_id_{1};
+};
+
+} // namespace hydra
@@ -0,0 +1,220 @@
+/**
+ * @file rpc_server.hpp
+ * @brief Server side of the binary RPC transport (see rpc.hpp)
+ *
+ * Accepts connections on any number of TCP and Unix socket endpoints and
+ * serves each connection's frames in order: frames are read, handed to
+ * the handler and answered in order, so a client may pipeline as many
+ * requests as it likes. A reply's payload is sent straight from the
+ * buffer it points to; keep_alive holds its owner until the send is done.
+ *
+ * Handlers are coroutines (see coro.hpp). By default every connection gets
+ * its own thread doing blocking reads and writes, and runs its handler to
+ * completion with sync_wait(). With an I/O loop (RpcServerOptions::io),
+ * one thread drives all sockets through io_uring or epoll (see
+ * io_loop.hpp) and also runs the handlers, which must offload anything
+ * that blocks; a request waiting on the database or a long-poll is only a
+ * suspended coroutine. Payloads are decoded and encoded on a small pool.
+ * Under io_uring, large payloads that are sent repeatedly (the model
+ * snapshot every task carries) are registered with the ring and sent
+ * zero-copy.
+ *
+ * With RpcServerOptions::payload_bytes set, a request whose header
+ * announces a payload of any other size for its method is refused, and
+ * its connection closed, before any memory is allocated for the payload:
+ * a stranger's 32-byte header cannot make the server zero gigabytes.
+ *
+ * A request that accepts x-hydra-lz or x-hydra-deflate gets its reply
+ * payload in that encoding, and the reply says the server accepts the same
+ * for uploads. A payload with a keep_alive is taken to be shared (a model
+ * snapshot) and is encoded once per encoding, however many replies carry
+ * it; other payloads are encoded per reply.
+ */
+
+#pragma once
+
+#include "hydra/coro.hpp"
+#include "hydra/io_loop.hpp"
+#include "hydra/rpc.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct RpcReply
+ * @brief What a handler answers
+ */
+struct RpcReply {
+    int status{200};
+    std::string meta;                          // JSON
+    std::span<const float> payload;            // Sent without copying...
+    std::shared_ptr<const void> keep_alive;    // ...while this keeps it valid
+};
+
+/**
+ * @struct RpcServerOptions
+ * @brief How connections are driven
+ */
+struct RpcServerOptions {
+    IoBackend io{IoBackend::Off};        // Off = a thread per connection
+    std::size_t codec_threads{4};        // Payload decoding and encoding with an I/O loop
+    std::size_t max_connections{1024};   // Connections past this are closed on accept
+    RpcPayloadSize payload_bytes;        // Unset: any payload up to kRpcMaxPayload
+};
+
+/**
+ * @class RpcServer
+ * @brief Server for RPC frames, thread-per-connection or on an I/O loop
+ *
+ * Thread Safety: the handler is called concurrently from connection
+ * threads, or only from the loop thread with an I/O loop.
+ */
+class RpcServer {
+public:
+    /// request stays valid until the returned coroutine completes
+    using Handler = std::function<Async<RpcReply>(RpcMessage& request)>;
+
+    /**
+     * @brief Constructor
+     * @throws std::runtime_error if options.io names a backend this build
+     *         or kernel cannot provide
+     */
+    explicit RpcServer(Handler handler, RpcServerOptions options = {});
+
+    ~RpcServer();
+
+    RpcServer(const RpcServer&) = delete;
+    RpcServer& operator=(const RpcServer&) = delete;
+
+    /**
+     * @brief Bind an endpoint; call before start()
+     * @throws std::runtime_error if the endpoint cannot be bound
+     */
+    void listen(const std::string& endpoint);
+
+    /**
+     * @brief Start accepting on every bound endpoint
+     */
+    void start();
+
+    /**
+     * @brief Close the listeners and all connections, and join their
+     *        threads (idempotent)
+     */
+    void stop();
+
+    std::size_t connections() const { return open_.load(std::memory_order_relaxed); }
+    const std::vector<std::string>& endpoints() const { return endpoints_; }
+
+    /**
+     * @brief The backend in use: Off, Epoll or IoUring
+     */
+    IoBackend backend() const { return loop_ ? loop_->backend() : IoBackend::Off; }
+
+    /**
+     * @brief Syscalls and operations of the I/O loop (zero without one)
+     */
+    IoLoopStats io_stats() const { return loop_ ? loop_->stats() : IoLoopStats{}; }
+
+private:
+    struct Connection {
+        RpcConnection socket;
+        std::thread thread;
+        bool done{false};
+        std::string peer;
+    };
+
+    // A connection on the I/O loop; only the loop thread touches it
+    struct LoopConnection;
+
+    // A payload registered with the ring for zero-copy sends
+    struct FixedBuffer {
+        const void* data{nullptr};
+        std::size_t bytes{0};
+        std::shared_ptr<const void> owner;   // Keeps the memory alive while registered
+        int index{-1};
+        std::size_t sends{0};                // In flight
+        std::uint64_t used{0};               // For least-recently-used replacement
+    };
+
+    // A shared payload in one encoding, encoded by the first reply that
+    // needs it while later ones wait for the result
+    using EncodedStream = std::shared_ptr<const std::vector<std::byte>>;
+    struct EncodedPayload {
+        const void* data{nullptr};
+        std::size_t bytes{0};
+        ContentEncoding encoding{};
+        std::shared_ptr<const void> source;   // Keeps data from being reused by another payload
+        std::shared_future<EncodedStream> stream;
+        std::uint64_t used{0};
+    };
+
+    // A reply as it goes on the wire
+    struct Outgoing {
+        RpcReply reply;
+        ContentEncoding encoding{ContentEncoding::Identity};
+        ContentEncoding accept{ContentEncoding::Identity};
+        EncodedStream stream;                 // The payload, unless identity
+    };
+
+    Handler handler_;
+    RpcServerOptions options_;
+    std::vector<std::string> endpoints_;
+    std::vector<int> listeners_;
+    std::vector<std::thread> acceptors_;
+
+    std::mutex connections_mutex_;
+    std::list<Connection> connections_;        // Stable addresses for the threads
+    bool stopping_{false};
+    std::atomic<std::size_t> open_{0};
+
+    // I/O loop mode
+    std::unique_ptr<IoLoop> loop_;
+    std::thread loop_thread_;
+    std::unordered_map<int, std::unique_ptr<LoopConnection>> loop_connections_;
+    std::size_t accepting_{0};                 // Listeners with an accept in flight
+    bool draining_{false};                     // Stop once everything is closed
+    std::vector<FixedBuffer> fixed_;
+    std::uint64_t fixed_clock_{0};
+    std::unique_ptr<Scheduler> scheduler_;     // Resumes handlers on the loop thread
+    std::unique_ptr<Executor> pool_;           // Decodes and encodes payloads
+
+    std::mutex encoded_mutex_;
+    std::vector<EncodedPayload> encoded_;
+    std::uint64_t encoded_clock_{0};
+
+    void accept_loop(int listener);
+    void serve(Connection& connection);
+    void reap();
+
+    Outgoing prepare(RpcReply reply, ContentEncoding accept);
+    EncodedStream encode(const RpcReply& reply, ContentEncoding encoding);
+
+    void stop_loop();
+    void stop_if_drained();
+    void accept_next(int listener);
+    void receive_next(LoopConnection& connection);
+    void receive_block(LoopConnection& connection);
+    void receive(LoopConnection& connection, void* data, std::size_t size, std::function<void(int)> next);
+    void received(LoopConnection& connection);
+    void dispatch(LoopConnection& connection);
+    Async<Outgoing> handle(RpcMessage& message, std::vector<std::byte>& stream);
+    void reply(LoopConnection& connection, Outgoing outgoing);
+    void close(LoopConnection& connection);
+    void release(LoopConnection& connection);
+    int fixed_buffer(std::span<const std::byte> payload, const std::shared_ptr<const void>& owner);
+};
+
+} // namespace hydra
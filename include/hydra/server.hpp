@@ -0,0 +1,285 @@
+/**
+ * @file server.hpp
+ * @brief Native coordinator server for HydraAI
+ *
+ * Serves the same HTTP API as coordinator.py (/health, /register,
+ * /get_task, /submit_result, /get_balance, /query_model) so the Python
+ * worker and query clients work against it unchanged. When a corpus is
+ * configured, tasks reference shard ranges and workers download the
+ * shards from /corpus/manifest and /corpus/shard/<id>. When a token
+ * dataset is configured, tasks reference token ranges instead and workers
+ * fetch the packed tokens from /dataset/tokens.
+ *
+ * /get_task accepts an optional "wait" (seconds): with no task available
+ * the request is held open until one is enqueued or the wait runs out,
+ * instead of answering 404 straight away.
+ *
+ * /query_model runs the model natively: queries are batched dynamically
+ * and answered from the current snapshot (see inference.hpp). Reproducible
+ * answers are kept in a response cache until the next model version.
+ *
+ * Requests pass per-client rate limits, and submit_result/query_model a
+ * concurrency limit, before reaching their handler; rejected requests get
+ * 429 with Retry-After.
+ *
+ * With ServerConfig::cluster set, several coordinators split users and
+ * tasks between them (see cluster_sync.hpp).
+ *
+ * Relays (see relay.hpp) reserve their batches' completions with
+ * /relay/reserve, then deliver the aggregate of the accepted ones to
+ * /relay/submit, and learn the parameter layout from /model/config. Both
+ * relay routes require ServerConfig::relay_secret (X-Relay-Secret).
+ *
+ * With ServerConfig::rpc_endpoints set, the worker operations are also
+ * served over the binary RPC transport (see rpc.hpp), which moves
+ * parameters as raw floats over persistent connections. Both front ends
+ * share the same operations, limits and database. ServerConfig::io_loop
+ * moves the RPC connections from a thread each onto one io_uring (or
+ * epoll) loop.
+ *
+ * get_task and submit_result are coroutines (see coro.hpp) that hand
+ * database work to one storage thread and aggregation to a compute pool.
+ * On the I/O loop, a request that waits on either, or on a long-poll,
+ * holds no thread; HTTP handlers run the same coroutines with sync_wait().
+ */
+
+#pragma once
+
+#include "hydra/admission.hpp"
+#include "hydra/checkpointer.hpp"
+#include "hydra/cluster_sync.hpp"
+#include "hydra/compression.hpp"
+#include "hydra/coro.hpp"
+#include "hydra/corpus.hpp"
+#include "hydra/database.hpp"
+#include "hydra/hash_ring.hpp"
+#include "hydra/heartbeat.hpp"
+#include "hydra/inference.hpp"
+#include "hydra/metrics.hpp"
+#include "hydra/model_state.hpp"
+#include "hydra/relay.hpp"
+#include "hydra/response_cache.hpp"
+#include "hydra/round_aggregator.hpp"
+#include "hydra/rpc_server.hpp"
+#include "hydra/speculator.hpp"
+#include "hydra/task_refiller.hpp"
+#include "hydra/task_sizer.hpp"
+#include "hydra/task_waiters.hpp"
+#include "hydra/token_dataset.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Forward declare cpp-httplib types to avoid including httplib.h in header
+namespace httplib {
+class Server;
+struct Request;
+struct Response;
+}
+
+namespace hydra {
+
+/**
+ * @struct ServerConfig
+ * @brief Coordinator settings (mirrors config.py)
+ */
+struct ServerConfig {
+    std::string host{"0.0.0.0"};       // Address to listen on
+    int port{5000};                    // Port to listen on
+    std::string db_path{"hydra.db"};   // SQLite database file
+    ModelConfig model;                 // Global model architecture
+
+    double tokens_per_task{1.0};       // Reward per completed base-size task
+    double query_cost{0.5};            // Tokens charged per query
+    std::size_t examples_per_task{3};  // Sentences sampled into each task
+    std::vector<std::string> training_data;   // Empty = built-in examples
+    std::string corpus_dir;            // Corpus shards (empty = inline training_data)
+    std::string token_path;            // Token dataset (.htk, overrides corpus_dir)
+    std::size_t task_tokens{1024};     // Tokens referenced by each task
+    std::uint32_t sequence_length{128};   // Training window length
+    TaskSizingOptions task_sizing;     // Tasks sized to each worker's throughput
+    SpeculationOptions speculation;    // Copies of straggling tasks at the end of a round
+
+    RoundOptions rounds;               // Aggregation engine settings
+    RefillOptions refill;              // Task queue watermarks
+    HeartbeatOptions heartbeat;        // Worker liveness (silent workers lose their tasks)
+
+    std::chrono::milliseconds max_task_wait{30000};   // Longest /get_task long-poll
+    std::size_t max_task_waiters{256}; // Parked /get_task requests (each HTTP one holds a thread)
+
+    RateLimitOptions rate_limit;       // Per-client token buckets
+    std::size_t max_concurrent_submits{8};   // submit_result requests in flight (0 = no limit)
+    std::size_t max_concurrent_queries{64};  // query_model requests in flight (0 = no limit)
+    InferenceOptions inference;        // Dynamic batching of queries
+    ResponseCacheOptions response_cache;   // Repeated prompts skip generation
+    std::vector<std::string> rpc_endpoints;   // Binary RPC listeners ("host:port", "unix:/path")
+    IoBackend io_loop{IoBackend::Off};   // Drives RPC connections (Off = a blocking thread each)
+
+    ClusterOptions cluster;            // Peers when running as one of several coordinators
+    std::string relay_secret;          // Shared with relays (empty = /relay routes refused)
+    CheckpointOptions checkpoint;      // Periodic model checkpoints (restored at startup)
+};
+
+/**
+ * @struct WorkerReply
+ * @brief Status and JSON body of a worker operation, whichever transport
+ *        carried the request
+ */
+struct WorkerReply {
+    int status{200};
+    std::string body;
+};
+
+/**
+ * @class CoordinatorServer
+ * @brief HTTP front end tying together the database, task queue and model
+ *
+ * Example usage:
+ * @code
+ * hydra::ServerConfig config;
+ * config.port = 5000;
+ * hydra::CoordinatorServer server(config);
+ * server.run();   // Blocks until stop() is called
+ * @endcode
+ */
+class CoordinatorServer {
+public:
+    /**
+     * @brief Constructor - opens the database and creates the model
+     * @param config Server settings
+     * @throws std::runtime_error if the database cannot be opened
+     */
+    explicit CoordinatorServer(ServerConfig config);
+
+    ~CoordinatorServer();
+
+    CoordinatorServer(const CoordinatorServer&) = delete;
+    CoordinatorServer& operator=(const CoordinatorServer&) = delete;
+
+    /**
+     * @brief Start background stages and serve requests (blocking)
+     * @return false if the server could not bind to the port
+     */
+    bool run();
+
+    /**
+     * @brief Stop serving; run() returns shortly afterwards
+     */
+    void stop();
+
+private:
+    std::chrono::steady_clock::time_point started_{std::chrono::steady_clock::now()};   // Recovery clock
+    ServerConfig config_;
+
+    Database db_;
+    std::mutex db_mutex_;              // Database is not thread-safe
+
+    std::unique_ptr<CorpusStore> corpus_;   // Null when training_data is used
+    std::unique_ptr<TokenDataset> tokens_;  // Null unless token_path is set
+
+    RoundAggregator aggregator_;
+    std::unique_ptr<HashRing> ring_;            // Null unless running as a cluster
+    std::unique_ptr<ClusterSync> cluster_;
+    std::unique_ptr<Checkpointer> checkpointer_;   // Null unless checkpoint.dir is set
+    TaskWaiters waiters_;
+    TaskRefiller refiller_;
+    RateLimiter limiter_;
+    ConcurrencyLimit submit_limit_;
+    ConcurrencyLimit query_limit_;
+    HeartbeatRegistry heartbeats_;
+    TaskSizer sizer_;
+    Speculator speculator_;
+    Executor storage_;                 // Database work of coroutine handlers (one writer)
+    Executor compute_;                 // Their aggregation and payload checks
+    std::unique_ptr<InferenceService> inference_;   // Answers /query_model
+    ResponseCache responses_;          // ...unless the answer is already known
+    std::unique_ptr<httplib::Server> http_;
+    std::unique_ptr<RpcServer> rpc_;   // Null unless rpc_endpoints are set
+
+    std::mutex rng_mutex_;
+    std::mt19937_64 rng_;
+    std::vector<std::size_t> sentence_order_;   // Shuffled in place to sample training_data
+
+    // get_trainable_parameters() JSON of the current snapshot, rebuilt
+    // once per model version instead of once per request
+    std::mutex model_json_mutex_;
+    std::shared_ptr<const std::string> model_json_;
+    std::uint64_t model_json_version_{0};
+
+    // The same, deflated once per version for gzip responses
+    std::mutex model_gzip_mutex_;
+    std::shared_ptr<const DeflateSegment> model_gzip_;
+    std::uint64_t model_gzip_version_{0};
+
+    // Relay batches whose completions /relay/reserve accepted, by batch
+    // token, until /relay/submit brings their aggregate
+    struct RelayReservation {
+        std::string relay_id;
+        std::size_t accepted{0};
+        std::chrono::steady_clock::time_point expires;
+    };
+    std::mutex relay_mutex_;
+    std::unordered_map<std::string, RelayReservation> relay_batches_;
+
+    void setup_routes();
+    void register_metrics();
+    bool admit(const httplib::Request& req, httplib::Response& res);
+
+    void handle_health(const httplib::Request& req, httplib::Response& res);
+    void handle_metrics(const httplib::Request& req, httplib::Response& res);
+    void handle_heartbeat(const httplib::Request& req, httplib::Response& res);
+    void handle_workers(const httplib::Request& req, httplib::Response& res);
+    void handle_register(const httplib::Request& req, httplib::Response& res);
+    void handle_get_task(const httplib::Request& req, httplib::Response& res);
+    void handle_submit_result(const httplib::Request& req, httplib::Response& res);
+    void handle_get_balance(const httplib::Request& req, httplib::Response& res);
+    void handle_query_model(const httplib::Request& req, httplib::Response& res);
+    void handle_corpus_manifest(const httplib::Request& req, httplib::Response& res);
+    void handle_corpus_shard(const httplib::Request& req, httplib::Response& res);
+    void handle_dataset_manifest(const httplib::Request& req, httplib::Response& res);
+    void handle_dataset_tokens(const httplib::Request& req, httplib::Response& res);
+    void handle_dataset_vocab(const httplib::Request& req, httplib::Response& res);
+    void handle_cluster_model_get(const httplib::Request& req, httplib::Response& res);
+    void handle_cluster_model_post(const httplib::Request& req, httplib::Response& res);
+    void handle_model_config(const httplib::Request& req, httplib::Response& res);
+    void handle_relay_reserve(const httplib::Request& req, httplib::Response& res);
+    void handle_relay_submit(const httplib::Request& req, httplib::Response& res);
+
+    // Worker operations behind both the HTTP handlers and handle_rpc().
+    // Coroutines suspend instead of blocking; HTTP handlers sync_wait()
+    WorkerReply register_worker(const std::string& user_id);
+    WorkerReply worker_heartbeat(const std::string& user_id);
+    WorkerReply worker_balance(const std::string& user_id);
+    Async<WorkerReply> lease_task(std::string user_id, double wait_seconds, std::optional<Task>& task);
+    Async<WorkerReply> complete_task(std::string user_id, std::string task_id,
+                                     std::uint64_t base_version, std::vector<float> update);
+    WorkerReply reserve_relay_batch(std::string_view header_text);
+    WorkerReply submit_relay_batch(std::string_view header_text, std::vector<float> update);
+    WorkerReply model_config() const;
+
+    Async<RpcReply> handle_rpc(RpcMessage& request);
+
+    std::string owner_node(std::string_view key) const;
+    bool redirect_to_owner(std::string_view key, const httplib::Request& req, httplib::Response& res);
+    std::string next_task_id();
+    void on_worker_state(const std::string& user_id, bool online);
+    std::optional<Task> claim_task(const std::string& user_id);
+    std::optional<Task> claim_copy(const std::string& user_id);
+    bool task_completed(const std::string& task_id);
+    int check_submitter(const std::string& task_id, const std::string& user_id, double& tokens_earned);
+    std::vector<Task> make_tasks(std::size_t count);
+    std::string sample_batch(std::size_t& units);
+    double task_reward(std::size_t units) const;
+    Tokenizer make_query_tokenizer() const;
+    std::shared_ptr<const std::string> model_json(const ModelState& model);
+    std::shared_ptr<const DeflateSegment> model_gzip(const ModelState& model);
+};
+
+} // namespace hydra
@@ -0,0 +1,136 @@
+/**
+ * @file speculator.hpp
+ * @brief Speculative copies of straggling tasks near the end of a round
+ *
+ * A round closes only when enough submissions arrive, so its last few
+ * tasks, leased to the slowest workers, set its pace. Once the round is
+ * mostly submitted, a worker asking for work may be handed a copy of a
+ * task that has been out for a while instead of a fresh one, if it is
+ * faster than the task's holder. Whichever result arrives first
+ * completes the task (Database::complete_task refuses a second
+ * completion); the other is dropped without a reward or an aggregation.
+ * The coordinator accepts a result only from the task's assignee or a
+ * holder recorded here.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct SpeculationOptions
+ * @brief When copies are offered and how many
+ */
+struct SpeculationOptions {
+    bool enabled{true};                          // Offer copies at all
+    double round_progress{0.8};                  // Fraction of a round submitted before copies are offered
+    std::chrono::milliseconds min_age{10000};    // Leases younger than this are not copied
+    std::size_t max_copies{1};                   // Extra workers per task (0 = never)
+};
+
+/**
+ * @class Speculator
+ * @brief Tracks outstanding leases and picks stragglers to copy
+ *
+ * Thread Safety: all methods may be called from any thread.
+ */
+class Speculator {
+public:
+    /// Whether a worker would likely beat a task's current holder
+    using FasterThan = std::function<bool(const std::string& holder)>;
+
+    explicit Speculator(SpeculationOptions options);
+
+    bool enabled() const { return options_.enabled && options_.max_copies > 0; }
+
+    /**
+     * @brief Record that a task was leased to a worker
+     */
+    void leased(const std::string& task_id, const std::string& user_id);
+
+    /**
+     * @brief Pick an outstanding task for a worker to run as well
+     *
+     * Oldest leases first. A task qualifies if it is at least min_age old,
+     * has fewer than max_copies copies, isn't already held by user_id and
+     * faster(first holder) is true. The worker is recorded as a holder.
+     *
+     * @param progress Fraction of the current round already submitted
+     * @return Task id, or std::nullopt if nothing should be copied
+     */
+    std::optional<std::string> offer(const std::string& user_id, double progress, const FasterThan& faster);
+
+    /**
+     * @brief Whether user_id holds a lease or copy of an outstanding task
+     */
+    bool holds(const std::string& task_id, const std::string& user_id) const;
+
+    /**
+     * @brief Forget a completed task's leases
+     *
+     * The other holders are remembered (for a while) as the losers of the
+     * race, for lost().
+     *
+     * @return true if user_id was a copy's holder (the copy won)
+     */
+    bool completed(const std::string& task_id, const std::string& user_id);
+
+    /**
+     * @brief Count a result dropped because its task was already completed,
+     *        if user_id held it alongside the winner
+     * @return true if it was counted (a losing copy)
+     */
+    bool lost(const std::string& task_id, const std::string& user_id);
+
+    /**
+     * @brief Forget a task that turned out to be completed already
+     */
+    void forget(const std::string& task_id);
+
+    /**
+     * @brief Drop a worker from every task it holds
+     */
+    void released(const std::string& user_id);
+
+    std::size_t outstanding() const;
+    std::uint64_t copies() const { return copies_.load(std::memory_order_relaxed); }
+    std::uint64_t wins() const { return wins_.load(std::memory_order_relaxed); }
+    std::uint64_t discards() const { return discarded_.load(std::memory_order_relaxed); }
+
+private:
+    struct Lease {
+        std::uint64_t sequence{0};
+        std::chrono::steady_clock::time_point start;
+        std::vector<std::string> holders;      // First lease, then copies
+    };
+
+    SpeculationOptions options_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Lease> leases_;      // By task id
+    std::map<std::uint64_t, std::string> order_;         // Task ids, oldest lease first
+    std::uint64_t next_sequence_{0};
+    std::unordered_map<std::string, std::vector<std::string>> losers_;   // Completed tasks' other holders
+    std::deque<std::string> settled_;                    // Their task ids, oldest first
+
+    std::atomic<std::uint64_t> copies_{0};
+    std::atomic<std::uint64_t> wins_{0};
+    std::atomic<std::uint64_t> discarded_{0};
+
+    void erase(std::unordered_map<std::string, Lease>::iterator it);
+};
+
+} // namespace hydra
@@ -0,0 +1,156 @@
+/**
+ * @file task_refiller.hpp
+ * @brief Watermark-driven task generation for the coordinator
+ *
+ * Replaces the "sleep 60 s, generate 10 tasks if the queue is empty" loop
+ * of coordinator.py. The refiller tracks the number of pending tasks and
+ * the rate at which workers claim them, and tops the queue up with bulk
+ * inserts before it runs dry:
+ *
+ *   target = clamp(claim_rate * lead_time, low_watermark, high_watermark)
+ *
+ * A refill is triggered as soon as the pending count falls below
+ * max(low_watermark, target / 2), so a busy fleet never waits for work and
+ * an idle one never accumulates thousands of stale tasks.
+ */
+
+#pragma once
+
+#include "hydra/database.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct RefillOptions
+ * @brief Watermarks and timing of the refill stage
+ */
+struct RefillOptions {
+    std::size_t low_watermark{20};     // Never let the queue drop below this
+    std::size_t high_watermark{1000};  // Never grow the queue beyond this
+    std::size_t max_batch{500};        // Tasks per insert transaction
+    std::chrono::milliseconds lead_time{30000};    // Demand to keep queued
+    std::chrono::milliseconds tick{1000};          // Rate sampling interval
+    std::chrono::milliseconds resync_interval{10000}; // Re-count pending tasks in the DB
+    double rate_smoothing{0.3};        // EWMA factor for the claim rate
+};
+
+/**
+ * @brief Produces count new tasks (task_id, data_batch, tokens_reward)
+ */
+using TaskFactory = std::function<std::vector<Task>(std::size_t count)>;
+
+/**
+ * @brief Called after count tasks became pending (inserted or requeued)
+ */
+using EnqueueListener = std::function<void(std::size_t count)>;
+
+/**
+ * @class TaskRefiller
+ * @brief Background stage that keeps the pending-task queue between watermarks
+ *
+ * Thread Safety: notify_claimed() and the accessors may be called from any
+ * thread. All database access happens under the mutex passed to the
+ * constructor, which the coordinator also holds for its own queries.
+ */
+class TaskRefiller {
+public:
+    /**
+     * @brief Constructor
+     * @param db Database to insert tasks into
+     * @param db_mutex Mutex guarding db
+     * @param factory Generator for new tasks
+     * @param options Watermarks and timing
+     * @param on_enqueued Optional listener for new pending tasks
+     */
+    TaskRefiller(Database& db, std::mutex& db_mutex, TaskFactory factory,
+                 RefillOptions options = {}, EnqueueListener on_enqueued = {});
+
+    ~TaskRefiller();
+
+    TaskRefiller(const TaskRefiller&) = delete;
+    TaskRefiller& operator=(const TaskRefiller&) = delete;
+
+    /**
+     * @brief Count pending tasks, fill up to the target and start the thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the background thread (idempotent)
+     */
+    void stop();
+
+    /**
+     * @brief Record that a worker claimed a task
+     *
+     * Cheap enough to call on every get_task: one atomic update, and a
+     * wake-up only when the queue crosses the refill threshold.
+     */
+    void notify_claimed(std::size_t count = 1);
+
+    /**
+     * @brief Record tasks returned to the pending state (e.g. expired leases)
+     */
+    void notify_requeued(std::size_t count = 1);
+
+    /**
+     * @brief Refill now rather than at the next tick (e.g. a claim found
+     *        the queue empty)
+     */
+    void request_refill();
+
+    /**
+     * @brief Estimated number of pending tasks
+     */
+    std::size_t pending() const;
+
+    /**
+     * @brief Smoothed claim rate in tasks per second
+     */
+    double claim_rate() const;
+
+    /**
+     * @brief Queue level the refiller is currently aiming for
+     */
+    std::size_t target() const;
+
+    /**
+     * @brief Total tasks generated since start()
+     */
+    std::size_t generated() const { return generated_.load(std::memory_order_relaxed); }
+
+private:
+    Database& db_;
+    std::mutex& db_mutex_;
+    TaskFactory factory_;
+    RefillOptions options_;
+    EnqueueListener on_enqueued_;
+
+    std::atomic<std::int64_t> pending_{0};
+    std::atomic<std::size_t> claims_{0};        // Claims since the last tick
+    std::atomic<std::size_t> threshold_{0};     // Refill when pending drops below
+    std::atomic<std::size_t> target_{0};
+    std::atomic<double> claim_rate_{0.0};
+    std::atomic<std::size_t> generated_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool wake_requested_{false};
+    bool stopping_{false};
+    std::thread thread_;
+
+    void run();
+    void update_target(double rate);
+    void refill();
+    void resync();
+};
+
+} // namespace hydra
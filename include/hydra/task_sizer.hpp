@@ -0,0 +1,108 @@
+/**
+ * @file task_sizer.hpp
+ * @brief Per-worker throughput estimates and task sizes that follow them
+ *
+ * Tasks have a base size: task_tokens tokens with a token dataset,
+ * examples_per_task records otherwise. Each completion gives one sample
+ * of the worker's throughput, the task's size over the time from lease to
+ * submission (download, training and upload, as the worker experiences
+ * them). Samples feed a per-worker exponentially weighted moving average,
+ * and each task a worker leases is sized to take about the target time at
+ * that rate. Rewards scale with the size, so a unit of work earns the
+ * same on a desktop as on a Raspberry Pi.
+ *
+ * Workers without an estimate get base-size tasks.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct TaskSizingOptions
+ * @brief How far and how fast task sizes adapt
+ */
+struct TaskSizingOptions {
+    std::chrono::milliseconds target{60000};   // Time a task should take (0 = every task has the base size)
+    double min_scale{0.25};            // Smallest task, relative to the base size
+    double max_scale{16.0};            // Largest task, relative to the base size
+    double smoothing{0.3};             // Weight of the newest sample in the average
+};
+
+/**
+ * @class TaskSizer
+ * @brief Times leases and turns completions into task sizes
+ *
+ * Thread Safety: all methods may be called from any thread.
+ */
+class TaskSizer {
+public:
+    /**
+     * @brief Constructor
+     * @param base_units Size of a task for a worker without an estimate
+     */
+    TaskSizer(TaskSizingOptions options, std::size_t base_units);
+
+    bool enabled() const { return options_.target.count() > 0; }
+    std::size_t base_units() const { return base_units_; }
+
+    /**
+     * @brief Size of the next task for a worker
+     * @return base_units() if sizing is off or the worker has no estimate
+     */
+    std::size_t units_for(const std::string& user_id) const;
+
+    /**
+     * @brief Start timing a lease of units (a task may be leased to
+     *        several workers at once, see Speculator)
+     */
+    void leased(const std::string& task_id, const std::string& user_id, std::size_t units);
+
+    /**
+     * @brief End a task with a worker's submission and update that worker's
+     *        estimate; other workers' leases of the task are dropped
+     * @return false if the lease is unknown (made before a restart or by
+     *         another coordinator, or already completed)
+     */
+    bool completed(const std::string& task_id, const std::string& user_id);
+
+    /**
+     * @brief Forget a worker's leases (its tasks went back to the queue);
+     *        its estimate is kept
+     */
+    void released(const std::string& user_id);
+
+    /**
+     * @brief A worker's estimated throughput in units per second
+     */
+    std::optional<double> throughput(const std::string& user_id) const;
+
+    /**
+     * @brief Workers with an estimate
+     */
+    std::size_t estimated() const;
+
+private:
+    struct Lease {
+        std::string user_id;
+        std::size_t units{0};
+        std::chrono::steady_clock::time_point start;
+    };
+
+    TaskSizingOptions options_;
+    std::size_t base_units_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<Lease>> leases_;   // By task id
+    std::unordered_map<std::string, double> rates_;    // Units per second, by user id
+};
+
+} // namespace hydra
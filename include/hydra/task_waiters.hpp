@@ -0,0 +1,150 @@
+/**
+ * @file task_waiters.hpp
+ * @brief Parking lot for /get_task requests that found no work
+ *
+ * Instead of answering 404 and letting the worker sleep 5 seconds, a
+ * long-polling get_task parks here until tasks are enqueued. Waiters form
+ * a FIFO list, so enqueueing n tasks wakes exactly n waiters (oldest
+ * first) instead of the whole herd.
+ *
+ * A request reads sequence() before it tries to claim a task and hands
+ * the value to wait(). If tasks were enqueued in between (after its claim
+ * failed but before it parked) the sequence has moved and wait() returns
+ * at once, so that notification is not lost.
+ *
+ * Waiters are suspended coroutines (see coro.hpp): a parked request holds
+ * no thread, and is resumed on its scheduler when woken. One timer thread
+ * resumes the waiters whose deadline passes.
+ */
+
+#pragma once
+
+#include "hydra/coro.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace hydra {
+
+/**
+ * @class TaskWaiters
+ * @brief FIFO waiter list woken by task enqueues
+ *
+ * Thread Safety: all methods may be called from any thread.
+ */
+class TaskWaiters {
+    struct Waiter;
+    using Deadlines = std::multimap<std::chrono::steady_clock::time_point, Waiter*>;
+
+    // Lives in the waiting coroutine's frame while it is linked into the list
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        Scheduler* scheduler{nullptr};
+        bool woken{false};
+        Waiter* prev{nullptr};
+        Waiter* next{nullptr};
+        Deadlines::iterator deadline;
+    };
+
+public:
+    /**
+     * @brief Constructor
+     * @param max_waiters Requests allowed to park at once
+     */
+    explicit TaskWaiters(std::size_t max_waiters = 256);
+
+    ~TaskWaiters();
+
+    TaskWaiters(const TaskWaiters&) = delete;
+    TaskWaiters& operator=(const TaskWaiters&) = delete;
+
+    /**
+     * @brief Awaitable returned by wait()
+     */
+    class [[nodiscard]] Wait {
+    public:
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> awaiting) {
+            self_.handle = awaiting;
+            self_.scheduler = awaiting.promise().scheduler;
+            return owner_.park(self_, deadline_, seen_);
+        }
+
+        bool await_resume() noexcept { return self_.woken; }
+
+    private:
+        friend class TaskWaiters;
+        Wait(TaskWaiters& owner, std::chrono::steady_clock::time_point deadline, std::uint64_t seen)
+            : owner_(owner), deadline_(deadline), seen_(seen) {}
+
+        TaskWaiters& owner_;
+        std::chrono::steady_clock::time_point deadline_;
+        std::uint64_t seen_;
+        Waiter self_;
+    };
+
+    /**
+     * @brief Number of notify() calls so far; read it before claiming
+     */
+    std::uint64_t sequence() const;
+
+    /**
+     * @brief Park the awaiting coroutine until woken by notify(), the
+     *        deadline or shutdown()
+     *
+     * @param seen sequence() as read before the caller's failed claim
+     *
+     * co_await yields true if woken by notify() or if notify() ran since
+     * seen (the caller should retry its claim either way), false on
+     * timeout, shutdown or when the list is full.
+     */
+    Wait wait(std::chrono::steady_clock::time_point deadline, std::uint64_t seen) {
+        return Wait(*this, deadline, seen);
+    }
+
+    /**
+     * @brief Wake up to count waiters, oldest first
+     */
+    void notify(std::size_t count = 1);
+
+    /**
+     * @brief Wake everyone and refuse new waiters (idempotent)
+     */
+    void shutdown();
+
+    /**
+     * @brief Number of parked requests
+     */
+    std::size_t waiting() const;
+
+    std::size_t max_waiters() const { return max_waiters_; }
+
+private:
+    std::size_t max_waiters_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable timer_wake_;
+    Waiter* head_{nullptr};
+    Waiter* tail_{nullptr};
+    Deadlines deadlines_;
+    std::size_t count_{0};
+    std::uint64_t sequence_{0};
+    bool shutdown_{false};
+    std::thread timer_;
+
+    /**
+     * @return true if parked, false if the caller should continue at once
+     */
+    bool park(Waiter& waiter, std::chrono::steady_clock::time_point deadline, std::uint64_t seen);
+    void unlink(Waiter& waiter);
+    void run_timer();
+};
+
+} // namespace hydra
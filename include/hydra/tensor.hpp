@@ -0,0 +1,227 @@
+/**
+ * @file tensor.hpp
+ * @brief Strided fp32 tensors for the native worker
+ *
+ * A Tensor is a view: a data pointer, up to four dimensions and a stride
+ * (in elements) per dimension. It never owns memory. Step-local tensors
+ * live in an Arena and die with its reset(); tensors over the model's
+ * parameters wrap the ModelState buffer directly.
+ *
+ * Reshaping, slicing, transposing and broadcasting only make new views.
+ * Operations write in place into a destination view, so a training step
+ * runs without allocating beyond its arena. Every operation takes any
+ * strides; contiguous operands (the usual case) take a flat loop the
+ * compiler vectorizes.
+ *
+ * @code
+ * hydra::Arena arena;
+ * auto x = hydra::Tensor::empty(arena, {batch, embed});
+ * auto bias = hydra::Tensor::wrap(model.values().data() + info.offset, {embed});
+ * hydra::add(x, bias.broadcast_to(x.shape()));   // x += bias, row by row
+ * hydra::relu(x);
+ * arena.reset();                                 // x is gone
+ * @endcode
+ */
+
+#pragma once
+
+#include "hydra/arena.hpp"
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <span>
+#include <string>
+
+namespace hydra {
+
+/**
+ * @struct Shape
+ * @brief Sizes of up to Shape::kMaxRank dimensions
+ */
+struct Shape {
+    static constexpr std::size_t kMaxRank = 4;
+
+    std::array<std::size_t, kMaxRank> dims{};
+    std::size_t rank{0};
+
+    Shape() = default;
+
+    /**
+     * @throws std::invalid_argument with more than kMaxRank dimensions
+     */
+    Shape(std::initializer_list<std::size_t> sizes);
+    explicit Shape(std::span<const std::size_t> sizes);
+
+    std::size_t operator[](std::size_t dim) const { return dims[dim]; }
+    std::size_t numel() const;
+
+    bool operator==(const Shape& other) const;
+
+    /**
+     * @brief "[2, 3, 4]", for error messages
+     */
+    std::string to_string() const;
+};
+
+/**
+ * @class Tensor
+ * @brief Non-owning strided view of fp32 values
+ */
+class Tensor {
+public:
+    Tensor() = default;
+
+    /**
+     * @brief Uninitialized contiguous tensor in arena (64-byte aligned)
+     */
+    static Tensor empty(Arena& arena, const Shape& shape);
+
+    /**
+     * @brief Contiguous tensor in arena, every element value
+     */
+    static Tensor full(Arena& arena, const Shape& shape, float value);
+    static Tensor zeros(Arena& arena, const Shape& shape) { return full(arena, shape, 0.0f); }
+
+    /**
+     * @brief Contiguous view of memory owned elsewhere
+     */
+    static Tensor wrap(float* data, const Shape& shape);
+
+    float* data() const { return data_; }
+    const Shape& shape() const { return shape_; }
+    std::size_t rank() const { return shape_.rank; }
+    std::size_t size(std::size_t dim) const { return shape_.dims[dim]; }
+    std::size_t stride(std::size_t dim) const { return strides_[dim]; }
+    std::size_t numel() const { return shape_.numel(); }
+    bool empty() const { return numel() == 0; }
+
+    /**
+     * @brief Whether the elements are packed in row-major order
+     */
+    bool contiguous() const;
+
+    /**
+     * @brief Element at an index of rank() coordinates (unchecked)
+     */
+    template <typename... Index>
+    float& operator()(Index... index) const {
+        static_assert(sizeof...(Index) <= Shape::kMaxRank);
+        std::size_t offset = 0;
+        std::size_t dim = 0;
+        ((offset += static_cast<std::size_t>(index) * strides_[dim++]), ...);
+        return data_[offset];
+    }
+
+    // -------------------------------------------------------------------------
+    // Views (no copies)
+    // -------------------------------------------------------------------------
+
+    /**
+     * @brief Same elements with another shape of the same size
+     * @throws std::invalid_argument if not contiguous or the sizes differ
+     */
+    Tensor view(const Shape& shape) const;
+
+    /**
+     * @brief Elements begin..end-1 along dim
+     * @throws std::out_of_range if the range is outside the dimension
+     */
+    Tensor slice(std::size_t dim, std::size_t begin, std::size_t end) const;
+
+    /**
+     * @brief The sub-tensor at index along dim, one rank lower
+     * @throws std::out_of_range if index is outside the dimension
+     */
+    Tensor select(std::size_t dim, std::size_t index) const;
+
+    /**
+     * @brief Row i of the first dimension (select(0, i))
+     */
+    Tensor operator[](std::size_t i) const { return select(0, i); }
+
+    /**
+     * @brief Swap two dimensions
+     */
+    Tensor transpose(std::size_t dim0, std::size_t dim1) const;
+
+    /**
+     * @brief Repeat along new leading dimensions and dimensions of size 1,
+     *        with stride 0 (read-only use: writes alias)
+     * @throws std::invalid_argument if the shapes are not compatible
+     */
+    Tensor broadcast_to(const Shape& shape) const;
+
+private:
+    float* data_{nullptr};
+    Shape shape_;
+    std::array<std::size_t, Shape::kMaxRank> strides_{};
+
+    Tensor(float* data, const Shape& shape);   // Contiguous strides
+};
+
+// =============================================================================
+// In-place operations
+//
+// dst and every source must have the same shape (broadcast_to() a smaller
+// source first) or std::invalid_argument is thrown. dst must not overlap
+// a source except by being the very same view.
+// =============================================================================
+
+void fill(const Tensor& dst, float value);
+
+/**
+ * @brief dst = src
+ */
+void copy(const Tensor& dst, const Tensor& src);
+
+/**
+ * @brief Contiguous copy of src in arena
+ */
+Tensor contiguous_copy(Arena& arena, const Tensor& src);
+
+/**
+ * @brief dst += src
+ */
+void add(const Tensor& dst, const Tensor& src);
+
+/**
+ * @brief dst -= src
+ */
+void sub(const Tensor& dst, const Tensor& src);
+
+/**
+ * @brief dst *= src, element by element
+ */
+void mul(const Tensor& dst, const Tensor& src);
+
+/**
+ * @brief dst *= factor
+ */
+void scale(const Tensor& dst, float factor);
+
+/**
+ * @brief dst += alpha * src (gradient steps, accumulation)
+ */
+void axpy(const Tensor& dst, float alpha, const Tensor& src);
+
+/**
+ * @brief dst = max(dst, 0)
+ */
+void relu(const Tensor& dst);
+
+/**
+ * @brief Softmax over the last dimension of every row, in place
+ */
+void softmax_rows(const Tensor& dst);
+
+/**
+ * @brief Sum of all elements (accumulated in double)
+ */
+double sum(const Tensor& src);
+
+/**
+ * @brief Sum of src * other (accumulated in double)
+ */
+double dot(const Tensor& src, const Tensor& other);
+
+} // namespace hydra
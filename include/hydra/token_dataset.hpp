@@ -0,0 +1,162 @@
+/**
+ * @file token_dataset.hpp
+ * @brief Pre-tokenized, memory-mapped training data
+ *
+ * A token dataset is the whole corpus tokenized once, offline, into a
+ * single packed file (plus the vocabulary it was built with):
+ *
+ *   [TokenFileHeader, 64 bytes]
+ *   [tokens: uint16 or uint32 each, documents back to back]
+ *   [padding to 8 bytes]
+ *   [uint64 doc_offsets[num_docs + 1], in tokens]
+ *
+ * Each document is stored as <START> words... <END>, so fixed-length
+ * windows can be cut anywhere without padding. Tasks reference a token
+ * range and workers train on it directly; tokenization never happens in
+ * the training loop.
+ */
+
+#pragma once
+
+#include "hydra/mapped_file.hpp"
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct TokenFileHeader
+ * @brief Fixed 64-byte header at the start of a token dataset
+ */
+struct TokenFileHeader {
+    char magic[8];                 // "HYDRATK1"
+    std::uint32_t version;         // Format version (1)
+    std::uint32_t token_bytes;     // 2 (uint16) or 4 (uint32)
+    std::uint64_t vocab_size;      // Vocabulary the ids index into
+    std::uint64_t num_docs;        // Number of documents
+    std::uint64_t num_tokens;      // Total tokens
+    std::uint64_t tokens_offset;   // File offset of the first token
+    std::uint64_t docs_offset;     // File offset of the document offsets
+    std::uint64_t reserved;
+};
+static_assert(sizeof(TokenFileHeader) == 64, "TokenFileHeader must be 64 bytes");
+
+/**
+ * @struct TokenRange
+ * @brief A task's reference to a range of the token dataset
+ */
+struct TokenRange {
+    std::uint64_t start{0};        // First token
+    std::uint64_t count{0};        // Number of tokens
+    std::uint32_t seq_len{128};    // Training window length
+
+    /**
+     * @brief Serialize as a task data_batch:
+     *        {"token_start": 4096, "token_count": 1024, "seq_len": 128}
+     */
+    std::string to_json() const;
+
+    /**
+     * @brief Parse a data_batch written by to_json()
+     * @return std::nullopt if the text is not a token range
+     */
+    static std::optional<TokenRange> from_json(std::string_view text);
+};
+
+/**
+ * @class TokenDataset
+ * @brief Read-only view of a mapped token file
+ */
+class TokenDataset {
+public:
+    /**
+     * @brief Map and validate a token file
+     * @throws std::runtime_error if the file is missing or corrupt
+     */
+    explicit TokenDataset(const std::string& path);
+
+    std::uint64_t num_tokens() const { return header_->num_tokens; }
+    std::uint64_t num_docs() const { return header_->num_docs; }
+    std::uint32_t token_bytes() const { return header_->token_bytes; }
+    std::uint64_t vocab_size() const { return header_->vocab_size; }
+
+    /**
+     * @brief Token i, widened to 32 bits
+     */
+    std::uint32_t token(std::uint64_t i) const;
+
+    /**
+     * @brief Copy count tokens starting at start into out (widened)
+     * @throws std::out_of_range if the range is outside the dataset
+     */
+    void copy(std::uint64_t start, std::uint64_t count, std::uint32_t* out) const;
+
+    /**
+     * @brief Packed little-endian bytes of a token range (no copy)
+     * @throws std::out_of_range if the range is outside the dataset
+     */
+    std::span<const std::byte> raw(std::uint64_t start, std::uint64_t count) const;
+
+    /**
+     * @brief First token and token count of document d
+     */
+    std::pair<std::uint64_t, std::uint64_t> document(std::uint64_t d) const;
+
+    /**
+     * @brief Pick a random range of count tokens
+     * @param random A uniformly distributed 64-bit random number
+     */
+    TokenRange sample(std::uint64_t random, std::uint64_t count, std::uint32_t seq_len) const;
+
+private:
+    MappedFile file_;
+    const TokenFileHeader* header_{nullptr};
+    const std::byte* tokens_{nullptr};
+    const std::uint64_t* docs_{nullptr};
+};
+
+/**
+ * @class TokenDatasetWriter
+ * @brief Streams documents into a token file
+ */
+class TokenDatasetWriter {
+public:
+    /**
+     * @brief Constructor
+     * @param path Output file
+     * @param vocab_size Vocabulary size (selects 16- or 32-bit tokens)
+     * @throws std::runtime_error if the file cannot be created
+     */
+    TokenDatasetWriter(const std::string& path, std::uint64_t vocab_size);
+
+    ~TokenDatasetWriter();
+
+    TokenDatasetWriter(const TokenDatasetWriter&) = delete;
+    TokenDatasetWriter& operator=(const TokenDatasetWriter&) = delete;
+
+    /**
+     * @brief Append one tokenized document
+     */
+    void add_document(std::span<const std::uint32_t> tokens);
+
+    /**
+     * @brief Write the document table and header
+     * @return Total number of tokens written
+     */
+    std::uint64_t finish();
+
+private:
+    std::string path_;
+    std::ofstream out_;
+    TokenFileHeader header_{};
+    std::vector<std::uint64_t> doc_offsets_;
+    std::vector<std::uint16_t> narrow_;   // Conversion buffer for 16-bit files
+    bool finished_{false};
+};
+
+} // namespace hydra
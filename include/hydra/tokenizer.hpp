@@ -0,0 +1,105 @@
+/**
+ * @file tokenizer.hpp
+ * @brief Word-level tokenizer compatible with SimpleTokenizer (model.py)
+ *
+ * SimpleTokenizer grows its vocabulary as it sees new words, so two
+ * processes only agree on token ids if they see text in the same order.
+ * The native tokenizer is built once offline, saved as a vocabulary file
+ * and then used read-only, which makes token ids stable across the fleet.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @class Tokenizer
+ * @brief Lowercase, whitespace-split tokenizer with special tokens
+ *
+ * Special ids match SimpleTokenizer: 0 = <PAD>, 1 = <UNK>, 2 = <START>,
+ * 3 = <END>. Lowercasing is ASCII-only.
+ */
+class Tokenizer {
+public:
+    static constexpr std::uint32_t kPad = 0;
+    static constexpr std::uint32_t kUnk = 1;
+    static constexpr std::uint32_t kStart = 2;
+    static constexpr std::uint32_t kEnd = 3;
+
+    /**
+     * @brief Create a tokenizer holding only the special tokens
+     * @param vocab_size Maximum number of tokens (including special ones)
+     */
+    explicit Tokenizer(std::size_t vocab_size = 10000);
+
+    /**
+     * @brief Load a vocabulary file written by save()
+     * @throws std::runtime_error if the file cannot be read
+     */
+    static Tokenizer load(const std::string& path, std::size_t vocab_size = 10000);
+
+    /**
+     * @brief Write one token per line (line number = token id)
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Append <START> tokens... <END> for text to out
+     * @param text Input text
+     * @param out Token ids are appended here
+     * @param grow Add unseen words to the vocabulary while there is room
+     *             (otherwise they become <UNK>)
+     */
+    void encode(std::string_view text, std::vector<std::uint32_t>& out, bool grow = false);
+
+    /**
+     * @brief Add a token to the vocabulary
+     * @return The token's id (existing id if already present, <UNK> if full)
+     */
+    std::uint32_t add_token(std::string token);
+
+    /**
+     * @brief Split text into lowercase words exactly as encode() does
+     */
+    static void split_words(std::string_view text, std::vector<std::string>& words);
+
+    /**
+     * @brief Join tokens with spaces, skipping <PAD>, <START> and <END>
+     */
+    std::string decode(std::span<const std::uint32_t> ids) const;
+
+    std::size_t vocab_size() const { return vocab_size_; }
+    std::size_t size() const { return tokens_.size(); }
+
+    /**
+     * @brief Id of a token, if it is in the vocabulary
+     */
+    std::optional<std::uint32_t> id(std::string_view token) const;
+
+    /**
+     * @brief Text of a token id ("<UNK>" for ids outside the vocabulary)
+     */
+    const std::string& token(std::uint32_t id) const;
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    std::size_t vocab_size_;
+    std::unordered_map<std::string, std::uint32_t, Hash, std::equal_to<>> ids_;
+    std::vector<std::string> tokens_;
+};
+
+} // namespace hydra
@@ -0,0 +1,90 @@
+/**
+ * @file transformer.hpp
+ * @brief Native forward pass of SimpleTransformer for inference
+ *
+ * Computes the same function as SimpleTransformer.forward() in eval mode
+ * (model.py: embedding + positional encoding, post-norm
+ * TransformerEncoderLayers with ReLU, output projection), reading weights
+ * straight from a ModelState snapshot.
+ *
+ * Sequences of different lengths are packed back to back instead of
+ * padded: every row-wise step (projections, feed-forward, LayerNorm) runs
+ * over the real tokens only, and attention stays within each sequence,
+ * which is what src_key_padding_mask achieves in PyTorch. Attention runs
+ * the fused kernel of attention.hpp once per sequence and head, so no
+ * [seq x seq] score matrix is ever materialized. The weights are
+ * streamed once per batch rather than once per sequence, which is why
+ * batching queries pays off.
+ *
+ * For generation, forward_last_logits() can also fill a KvCache per
+ * sequence (prefill), after which decode_step() extends the sequences one
+ * token at a time. A decoded token attends to the cached prefix and
+ * itself; the cached prefix is not revisited. SimpleTransformer is trained
+ * without a causal mask, so this is prefix-LM decoding: the prompt is
+ * encoded bidirectionally (the first generated token is exactly what a
+ * full forward pass predicts) and generated tokens are appended causally.
+ */
+
+#pragma once
+
+#include "hydra/kv_cache.hpp"
+#include "hydra/model_state.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace hydra {
+
+/**
+ * @struct ForwardWorkspace
+ * @brief Scratch buffers reused across forward passes (one per thread)
+ */
+struct ForwardWorkspace {
+    std::vector<float> x;          // Activations of the rows still needed
+    std::vector<float> qkv;        // Packed query/key/value projections
+    std::vector<float> attn;       // Attention output, heads concatenated
+    std::vector<float> hidden;     // Feed-forward hidden layer
+    std::vector<float> scores;     // Softmax row
+    std::vector<float> residual;
+};
+
+/**
+ * @brief Next-token logits after the last token of every sequence
+ *
+ * @param model Parameters (any published snapshot)
+ * @param sequences Token ids, each non-empty and at most max_seq_length
+ *                  long; ids outside the vocabulary are read as <UNK>
+ * @param logits Resized to sequences.size() x vocab_size
+ * @param workspace Scratch buffers
+ * @param caches Optional, one empty cache per sequence with room for it
+ *               (KvCache::reserve); receives every layer's keys and values
+ * @throws std::invalid_argument if a sequence is empty or too long
+ */
+void forward_last_logits(const ModelState& model,
+                         std::span<const std::vector<std::uint32_t>> sequences,
+                         std::vector<float>& logits,
+                         ForwardWorkspace& workspace,
+                         std::span<KvCache* const> caches = {});
+
+/**
+ * @brief Append one token to each cached sequence
+ *
+ * Costs O(length) per layer and sequence, against O(length^2) for
+ * running forward_last_logits() over the whole prefix again.
+ *
+ * @param model Parameters the caches were filled with
+ * @param tokens Next token of each sequence
+ * @param caches One per token, each with room for one more position
+ *               (KvCache::reserve) and shorter than max_seq_length;
+ *               their lengths grow by one
+ * @param logits Resized to tokens.size() x vocab_size
+ * @param workspace Scratch buffers
+ * @throws std::invalid_argument if a cache is full
+ */
+void decode_step(const ModelState& model,
+                 std::span<const std::uint32_t> tokens,
+                 std::span<KvCache* const> caches,
+                 std::vector<float>& logits,
+                 ForwardWorkspace& workspace);
+
+} // namespace hydra
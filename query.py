@@ -94,6 +94,12 @@ class HydraQuery:
                 print(f"\n💡 Tip: Run the worker to earn more tokens!")
                 return None
 
+            elif response.status_code == 429:
+                # Too many requests - the coordinator says when to come back
+                retry_after = response.headers.get('Retry-After', '1')
+                print(f"\n⏳ The coordinator is busy. Try again in {retry_after} seconds.")
+                return None
+
             else:
                 print(f"Error: {response.json()}")
                 return None
@@ -0,0 +1,147 @@
+/**
+ * @file admission.cpp
+ * @brief Implementation of RateLimiter and ConcurrencyLimit
+ */
+
+#include "hydra/admission.hpp"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace hydra {
+
+// =============================================================================
+// RateLimiter
+// =============================================================================
+
+RateLimiter::RateLimiter(RateLimitOptions options)
+    : options_(options), epoch_(clock::now()) {
+    if (options_.rate <= 0.0 || options_.burst < 1.0 || options_.shards == 0) {
+        throw std::invalid_argument("RateLimiter: need rate > 0, burst >= 1 and shards > 0");
+    }
+    interval_ = std::max<std::int64_t>(1, static_cast<std::int64_t>(1e9 / options_.rate));
+    tolerance_ = static_cast<std::int64_t>(options_.burst * static_cast<double>(interval_));
+    shards_ = std::make_unique<Shard[]>(options_.shards);
+}
+
+std::chrono::nanoseconds RateLimiter::acquire(std::string_view client, clock::time_point now) {
+    const std::int64_t t = std::chrono::duration_cast<std::chrono::nanoseconds>(now - epoch_).count();
+    Shard& shard = shards_[Hash{}(client) % options_.shards];
+
+    // Known client: shared lock plus one CAS loop on its bucket
+    {
+        std::shared_lock lock(shard.mutex);
+        if (auto it = shard.buckets.find(client); it != shard.buckets.end()) {
+            return std::chrono::nanoseconds(take(it->second, t));
+        }
+    }
+
+    std::unique_lock lock(shard.mutex);
+    if (shard.buckets.size() >= options_.max_clients_per_shard) {
+        // A bucket whose arrival time has passed is full; forgetting it is
+        // the same as keeping it
+        std::erase_if(shard.buckets, [t](const auto& entry) {
+            return entry.second.load(std::memory_order_relaxed) <= t;
+        });
+        if (shard.buckets.size() >= options_.max_clients_per_shard) {
+            return std::chrono::nanoseconds(0);   // Fail open rather than lock out new users
+        }
+    }
+
+    auto [it, inserted] = shard.buckets.try_emplace(std::string(client), t);
+    return std::chrono::nanoseconds(take(it->second, t));
+}
+
+std::size_t RateLimiter::clients() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < options_.shards; ++i) {
+        std::shared_lock lock(shards_[i].mutex);
+        total += shards_[i].buckets.size();
+    }
+    return total;
+}
+
+std::int64_t RateLimiter::take(std::atomic<std::int64_t>& tat, std::int64_t now) const {
+    std::int64_t current = tat.load(std::memory_order_relaxed);
+    while (true) {
+        std::int64_t next = std::max(current, now) + interval_;
+        if (next - now > tolerance_) {
+            return next - now - tolerance_;
+        }
+        if (tat.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+            return 0;
+        }
+    }
+}
+
+// =============================================================================
+// ConcurrencyLimit
+// =============================================================================
+
+ConcurrencyLimit::Permit& ConcurrencyLimit::Permit::operator=(Permit&& other) noexcept {
+    if (this != &other) {
+        release();
+        owner_ = other.owner_;
+        other.owner_ = nullptr;
+    }
+    return *this;
+}
+
+void ConcurrencyLimit::Permit::release() {
+    if (owner_) {
+        owner_->in_flight_.fetch_sub(1, std::memory_order_release);
+        owner_ = nullptr;
+    }
+}
+
+ConcurrencyLimit::Permit ConcurrencyLimit::try_acquire() {
+    if (max_ == 0) {
+        in_flight_.fetch_add(1, std::memory_order_acquire);   // Unlimited, but still counted
+        return Permit(this);
+    }
+
+    std::size_t current = in_flight_.load(std::memory_order_relaxed);
+    while (current < max_) {
+        if (in_flight_.compare_exchange_weak(current, current + 1, std::memory_order_acquire)) {
+            return Permit(this);
+        }
+    }
+    return Permit();
+}
+
+// =============================================================================
+// Credentials
+// =============================================================================
+
+bool credentials_match(std::string_view expected, std::string_view presented) {
+    if (expected.empty()) {
+        return false;
+    }
+    // Every byte of expected is visited whatever presented holds
+    unsigned char difference = expected.size() != presented.size();
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        unsigned char other = i < presented.size() ? static_cast<unsigned char>(presented[i]) : 0;
+        difference |= static_cast<unsigned char>(expected[i]) ^ other;
+    }
+    return difference == 0;
+}
+
+std::string read_secret_file(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::invalid_argument("cannot read " + path);
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    std::string secret = text.str();
+    secret.erase(0, secret.find_first_not_of(" \t\r\n"));
+    secret.erase(secret.find_last_not_of(" \t\r\n") + 1);
+    if (secret.empty()) {
+        throw std::invalid_argument(path + " is empty");
+    }
+    return secret;
+}
+
+} // namespace hydra
@@ -0,0 +1,260 @@
+/**
+ * @file checkpointer.cpp
+ * @brief Implementation of Checkpointer
+ */
+
+#include "hydra/checkpointer.hpp"
+#include "hydra/metrics.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace hydra {
+
+namespace {
+
+Histogram& checkpoint_seconds() {
+    static Histogram& histogram = metrics().histogram("hydra_checkpoint_seconds", "Time to write a checkpoint");
+    return histogram;
+}
+
+Counter& checkpoint_bytes() {
+    static Counter& counter = metrics().counter("hydra_checkpoint_bytes_total", "Bytes written to checkpoints");
+    return counter;
+}
+
+Counter& model_log_bytes() {
+    static Counter& counter = metrics().counter("hydra_model_log_bytes_total", "Bytes appended to model logs");
+    return counter;
+}
+
+} // namespace
+
+Checkpointer::Checkpointer(CheckpointOptions options, SnapshotSource snapshot)
+    : options_(std::move(options)), snapshot_(std::move(snapshot)) {
+    if (!options_.enabled()) {
+        throw std::invalid_argument("Checkpointer: a checkpoint directory is required");
+    }
+    if (options_.full_every == 0 || options_.keep_full == 0) {
+        throw std::invalid_argument("Checkpointer: full_every and keep_full must be positive");
+    }
+    if (options_.io != IoBackend::Off) {
+        io_ = IoLoop::create(options_.io, 64);
+    }
+}
+
+Checkpointer::~Checkpointer() {
+    stop();
+}
+
+void Checkpointer::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = false;
+        published_ = false;
+    }
+    thread_ = std::thread(&Checkpointer::run, this);
+}
+
+void Checkpointer::notify() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        published_ = true;
+    }
+    wake_.notify_one();
+}
+
+void Checkpointer::stop() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (!thread_.joinable()) {
+        return;
+    }
+    thread_.join();
+
+    // Whatever was aggregated since the last tick
+    try {
+        checkpoint_now();
+    } catch (const std::exception& e) {
+        std::cerr << "✗ Final checkpoint failed: " << e.what() << std::endl;
+    }
+}
+
+bool Checkpointer::checkpoint_now() {
+    std::lock_guard lock(write_mutex_);
+    auto model = snapshot_();
+    if (last_ && model->version() == last_->version()) {
+        return false;
+    }
+
+    // The snapshot is immutable, so it is written without holding anything
+    // the aggregator needs
+    bool full = !last_ || since_full_ + 1 >= options_.full_every;
+    CheckpointStats stats;
+    {
+        ScopedTimer timer(checkpoint_seconds());
+        stats = write_checkpoint(options_.dir, *model, full ? nullptr : last_.get(), io_.get());
+    }
+    checkpoint_bytes().add(stats.bytes);
+
+    since_full_ = full ? 0 : since_full_ + 1;
+    last_ = std::move(model);
+    last_version_.store(last_->version(), std::memory_order_relaxed);
+    written_.fetch_add(1, std::memory_order_relaxed);
+    open_log();
+    if (full) {
+        prune();
+    }
+    return true;
+}
+
+// =============================================================================
+// Background Thread
+// =============================================================================
+
+void Checkpointer::run() {
+    try {
+        resume();
+    } catch (const std::exception& e) {
+        std::cerr << "✗ Checkpoint failed: " << e.what() << std::endl;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + options_.interval;
+    while (true) {
+        bool tick = false;
+        {
+            std::unique_lock lock(wake_mutex_);
+            wake_.wait_until(lock, deadline, [this] { return stopping_ || published_; });
+            if (stopping_) {
+                return;
+            }
+            tick = std::chrono::steady_clock::now() >= deadline;
+            published_ = false;
+        }
+
+        if (!tick) {
+            log_latest();
+            continue;
+        }
+        deadline = std::chrono::steady_clock::now() + options_.interval;
+        try {
+            checkpoint_now();
+        } catch (const std::exception& e) {
+            // Keep training; the next tick tries again with a full checkpoint
+            std::cerr << "✗ Checkpoint failed: " << e.what() << std::endl;
+            std::lock_guard lock(write_mutex_);
+            last_.reset();
+            log_.reset();
+        }
+    }
+}
+
+void Checkpointer::resume() {
+    {
+        std::lock_guard lock(write_mutex_);
+        auto model = snapshot_();
+        auto versions = list_checkpoints(options_.dir);
+        if (!versions.empty() && versions.back() == model->version()) {
+            // Restored from this checkpoint (and possibly its log, which is
+            // started over: the versions it held are in the snapshot now).
+            // The chain behind it is unknown, so the next checkpoint is full.
+            last_ = std::move(model);
+            since_full_ = options_.full_every;
+            last_version_.store(last_->version(), std::memory_order_relaxed);
+            open_log();
+            return;
+        }
+    }
+    checkpoint_now();
+}
+
+void Checkpointer::log_latest() {
+    std::lock_guard lock(write_mutex_);
+    if (!log_) {
+        return;
+    }
+    auto model = snapshot_();
+    if (model->version() == logged_->version()) {
+        return;
+    }
+    try {
+        model_log_bytes().add(log_->append(*model, *logged_));
+        logged_ = std::move(model);
+        logged_version_.store(logged_->version(), std::memory_order_relaxed);
+    } catch (const std::exception& e) {
+        // Stop logging until the next checkpoint starts a fresh log
+        std::cerr << "✗ Model log failed: " << e.what() << std::endl;
+        log_.reset();
+    }
+}
+
+void Checkpointer::open_log() {
+    // Called with write_mutex_ held, right after last_ changed
+    log_.reset();
+    logged_ = last_;
+    logged_version_.store(last_->version(), std::memory_order_relaxed);
+    if (!options_.log_versions) {
+        return;
+    }
+
+    std::string path = model_log_path(options_.dir, last_->version());
+    try {
+        log_ = std::make_unique<ModelLogWriter>(path, io_.get());
+    } catch (const std::exception& e) {
+        std::cerr << "✗ Model log failed: " << e.what() << std::endl;
+        return;
+    }
+
+    // Older logs continue checkpoints that are no longer the newest
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(options_.dir, ec)) {
+        if (entry.path().extension() == ".hlog" && entry.path() != fs::path(path)) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
+
+void Checkpointer::prune() {
+    // Keep the newest keep_full full checkpoints and everything after the
+    // oldest of them; older files (and leftovers of failed writes) go
+    auto versions = list_checkpoints(options_.dir);
+    std::size_t fulls = 0;
+    std::uint64_t oldest_kept = 0;
+    for (auto it = versions.rbegin(); it != versions.rend(); ++it) {
+        try {
+            if (CheckpointFile(checkpoint_path(options_.dir, *it)).full() && ++fulls == options_.keep_full) {
+                oldest_kept = *it;
+                break;
+            }
+        } catch (const std::exception&) {
+            // Unreadable files are left for an operator to look at
+        }
+    }
+    if (fulls < options_.keep_full) {
+        return;
+    }
+
+    std::error_code ec;
+    for (auto version : versions) {
+        if (version < oldest_kept) {
+            fs::remove(checkpoint_path(options_.dir, version), ec);
+        }
+    }
+    for (const auto& entry : fs::directory_iterator(options_.dir, ec)) {
+        if (entry.path().extension() == ".tmp") {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
+
+} // namespace hydra
@@ -0,0 +1,172 @@
+/**
+ * @file cluster_sync.cpp
+ * @brief Implementation of ClusterSync
+ */
+
+#include "hydra/cluster_sync.hpp"
+#include "hydra/admission.hpp"
+#include "hydra/aggregation.hpp"
+#include <httplib.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace hydra {
+
+ClusterSync::ClusterSync(ClusterOptions options, RoundAggregator& aggregator)
+    : options_(std::move(options)), aggregator_(aggregator), last_rounds_(options_.peers.size(), 0) {
+    if (options_.self >= options_.peers.size()) {
+        throw std::invalid_argument("ClusterSync: self is not a valid peer index");
+    }
+    if (options_.secret.empty()) {
+        throw std::invalid_argument("ClusterSync: peers need a shared secret");
+    }
+}
+
+ClusterSync::~ClusterSync() {
+    stop();
+}
+
+void ClusterSync::start() {
+    if (!leader() || thread_.joinable()) {
+        return;
+    }
+    thread_ = std::thread(&ClusterSync::run, this);
+}
+
+void ClusterSync::stop() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool ClusterSync::authorized(std::string_view presented) const {
+    return credentials_match(options_.secret, presented);
+}
+
+bool ClusterSync::install(std::string_view body, std::uint64_t version) {
+    auto current = aggregator_.snapshot();
+    if (body.size() != current->values().size() * sizeof(float)) {
+        return false;
+    }
+
+    auto next = std::make_shared<ModelState>(*current);
+    std::memcpy(next->values().data(), body.data(), body.size());
+    next->set_version(version);
+    aggregator_.publish(std::move(next));
+    return true;
+}
+
+// =============================================================================
+// Leader
+// =============================================================================
+
+void ClusterSync::run() {
+    while (true) {
+        {
+            std::unique_lock lock(wake_mutex_);
+            if (wake_.wait_for(lock, options_.sync_interval, [this] { return stopping_; })) {
+                return;
+            }
+        }
+        sync_once();
+    }
+}
+
+void ClusterSync::sync_once() {
+    auto own = aggregator_.snapshot();
+    std::uint64_t own_rounds = aggregator_.rounds();
+
+    // Weight each model by the rounds it absorbed since the previous sync;
+    // a peer with no new rounds still holds the last average
+    std::vector<PeerModel> pulled;
+    std::vector<UpdateView> views;
+    std::uint64_t version = own->version();
+    pulled.reserve(options_.peers.size());
+
+    auto weight_of = [this](std::size_t peer, std::uint64_t rounds) {
+        std::uint64_t last = last_rounds_[peer];
+        last_rounds_[peer] = rounds;
+        return rounds >= last ? rounds - last : rounds;   // Counter reset: peer restarted
+    };
+
+    if (auto weight = weight_of(0, own_rounds); weight > 0) {
+        views.push_back({own->values().data(), static_cast<double>(weight)});
+    }
+    for (std::size_t i = 1; i < options_.peers.size(); ++i) {
+        auto model = pull(options_.peers[i]);
+        if (!model || model->values.size() != own->values().size()) {
+            std::cerr << "ClusterSync: could not pull the model from " << options_.peers[i] << std::endl;
+            continue;
+        }
+        version = std::max(version, model->version);
+        if (auto weight = weight_of(i, model->rounds); weight > 0) {
+            pulled.push_back(std::move(*model));
+            views.push_back({pulled.back().values.data(), static_cast<double>(weight)});
+        }
+    }
+
+    if (views.empty()) {
+        return;   // Nobody trained since the last sync
+    }
+
+    auto next = std::make_shared<ModelState>(*own);
+    AggregationOptions mean;
+    mean.rule = AggregationRule::Mean;
+    aggregate_updates(views, next->values(), mean);
+    next->set_version(version + 1);
+
+    // Rounds that close on a peer while a sync is in flight are overwritten
+    // by the average; the window is one pull/push, not the whole interval
+    aggregator_.publish(next);   // May raise next's version past rounds closed meanwhile
+    for (std::size_t i = 1; i < options_.peers.size(); ++i) {
+        if (!push(options_.peers[i], *next)) {
+            std::cerr << "ClusterSync: could not push the model to " << options_.peers[i] << std::endl;
+        }
+    }
+    syncs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::optional<ClusterSync::PeerModel> ClusterSync::pull(const std::string& peer) const {
+    httplib::Client client(peer);
+    client.set_connection_timeout(5);
+    client.set_read_timeout(60);
+
+    auto response = client.Get("/cluster/model", {{kClusterSecretHeader, options_.secret}});
+    if (!response || response->status != 200 || response->body.size() % sizeof(float) != 0) {
+        return std::nullopt;
+    }
+
+    PeerModel model;
+    try {
+        model.version = std::stoull(response->get_header_value("X-Model-Version"));
+        model.rounds = std::stoull(response->get_header_value("X-Model-Rounds"));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    model.values.resize(response->body.size() / sizeof(float));
+    std::memcpy(model.values.data(), response->body.data(), response->body.size());
+    return model;
+}
+
+bool ClusterSync::push(const std::string& peer, const ModelState& model) const {
+    httplib::Client client(peer);
+    client.set_connection_timeout(5);
+    client.set_write_timeout(60);
+
+    auto values = model.values();
+    std::string body(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+    httplib::Headers headers = {{"X-Model-Version", std::to_string(model.version())},
+                                {kClusterSecretHeader, options_.secret}};
+
+    auto response = client.Post("/cluster/model", headers, body, "application/octet-stream");
+    return response && response->status == 200;
+}
+
+} // namespace hydra
@@ -0,0 +1,204 @@
+/**
+ * @file heartbeat.cpp
+ * @brief Implementation of HeartbeatRegistry
+ */
+
+#include "hydra/heartbeat.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace hydra {
+
+HeartbeatRegistry::HeartbeatRegistry(HeartbeatOptions options, WorkerStateCallback on_change)
+    : options_(options),
+      on_change_(std::move(on_change)),
+      epoch_(std::chrono::steady_clock::now()) {
+    if (options_.tick.count() <= 0 || options_.timeout.count() <= 0) {
+        throw std::invalid_argument("HeartbeatRegistry: tick and timeout must be positive");
+    }
+    timeout_ticks_ = std::max<std::uint64_t>(1, (options_.timeout + options_.tick - std::chrono::milliseconds(1)) /
+                                                    options_.tick);
+    for (auto& level : slots_) {
+        std::fill(std::begin(level), std::end(level), kNil);
+    }
+}
+
+HeartbeatRegistry::~HeartbeatRegistry() {
+    stop();
+}
+
+void HeartbeatRegistry::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    thread_ = std::thread(&HeartbeatRegistry::run, this);
+}
+
+void HeartbeatRegistry::stop() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool HeartbeatRegistry::beat(const std::string& worker_id) {
+    std::uint64_t deadline = tick_of(std::chrono::steady_clock::now()) + timeout_ticks_;
+
+    std::unique_lock lock(mutex_);
+    if (auto it = index_.find(worker_id); it != index_.end()) {
+        // The entry stays in its slot; advance() re-files it when it comes due
+        entries_[it->second].deadline = deadline;
+        return false;
+    }
+
+    std::uint32_t e;
+    if (!free_.empty()) {
+        e = free_.back();
+        free_.pop_back();
+    } else {
+        e = static_cast<std::uint32_t>(entries_.size());
+        entries_.emplace_back();
+    }
+    entries_[e].worker_id = worker_id;
+    entries_[e].deadline = deadline;
+    index_.emplace(worker_id, e);
+    link(e);
+
+    std::lock_guard notify(notify_mutex_);
+    lock.unlock();
+    if (on_change_) {
+        on_change_(worker_id, true);
+    }
+    return true;
+}
+
+std::size_t HeartbeatRegistry::advance(std::chrono::steady_clock::time_point now) {
+    std::uint64_t target = tick_of(now);
+    std::vector<std::string> expired;
+
+    std::unique_lock lock(mutex_);
+    while (current_ < target) {
+        ++current_;
+
+        // Cascade: a higher-level slot comes due when the ticks below it wrap
+        for (std::size_t level = kLevels - 1; level > 0; --level) {
+            std::uint64_t span = std::uint64_t{1} << (kSlotBits * level);
+            if ((current_ & (span - 1)) != 0) {
+                continue;
+            }
+            std::uint32_t& head = slots_[level][(current_ >> (kSlotBits * level)) & (kSlots - 1)];
+            std::uint32_t e = head;
+            head = kNil;
+            while (e != kNil) {
+                std::uint32_t next = entries_[e].next;
+                link(e);
+                e = next;
+            }
+        }
+
+        std::uint32_t& head = slots_[0][current_ & (kSlots - 1)];
+        std::uint32_t e = head;
+        head = kNil;
+        while (e != kNil) {
+            std::uint32_t next = entries_[e].next;
+            Entry& entry = entries_[e];
+            if (entry.deadline > current_) {
+                link(e);   // Heartbeat arrived since it was filed
+            } else {
+                index_.erase(entry.worker_id);
+                expired.push_back(std::move(entry.worker_id));
+                entry.worker_id.clear();
+                free_.push_back(e);
+            }
+            e = next;
+        }
+    }
+
+    if (expired.empty()) {
+        return 0;
+    }
+
+    std::lock_guard notify(notify_mutex_);
+    lock.unlock();
+    if (on_change_) {
+        for (const auto& worker_id : expired) {
+            on_change_(worker_id, false);
+        }
+    }
+    return expired.size();
+}
+
+std::size_t HeartbeatRegistry::online() const {
+    std::lock_guard lock(mutex_);
+    return index_.size();
+}
+
+bool HeartbeatRegistry::is_online(const std::string& worker_id) const {
+    std::lock_guard lock(mutex_);
+    return index_.contains(worker_id);
+}
+
+std::vector<std::string> HeartbeatRegistry::online_workers(std::size_t limit) const {
+    std::lock_guard lock(mutex_);
+    std::vector<std::string> workers;
+    workers.reserve(std::min(limit, index_.size()));
+    for (const auto& [worker_id, e] : index_) {
+        if (workers.size() >= limit) {
+            break;
+        }
+        workers.push_back(worker_id);
+    }
+    return workers;
+}
+
+// =============================================================================
+// Wheel
+// =============================================================================
+
+std::uint64_t HeartbeatRegistry::tick_of(std::chrono::steady_clock::time_point t) const {
+    if (t <= epoch_) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>((t - epoch_) / options_.tick);
+}
+
+void HeartbeatRegistry::link(std::uint32_t e) {
+    // Never file into the slot being processed (or one already passed)
+    std::uint64_t deadline = std::max(entries_[e].deadline, current_ + 1);
+    std::uint64_t delta = deadline - current_;
+
+    std::size_t level = 0;
+    while (level + 1 < kLevels && delta >= (std::uint64_t{1} << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+
+    // Beyond the top level: park in the furthest slot and re-file from there
+    std::uint64_t horizon = std::uint64_t{1} << (kSlotBits * kLevels);
+    if (delta >= horizon) {
+        deadline = current_ + horizon - 1;
+    }
+
+    std::uint32_t& head = slots_[level][(deadline >> (kSlotBits * level)) & (kSlots - 1)];
+    entries_[e].next = head;
+    head = e;
+}
+
+void HeartbeatRegistry::run() {
+    auto next = std::chrono::steady_clock::now();
+    while (true) {
+        next += options_.tick;
+        {
+            std::unique_lock lock(wake_mutex_);
+            if (wake_.wait_until(lock, next, [this] { return stopping_; })) {
+                return;
+            }
+        }
+        advance(std::chrono::steady_clock::now());
+    }
+}
+
+} // namespace hydra
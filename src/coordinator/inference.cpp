@@ -0,0 +1,186 @@
+/**
+ * @file inference.cpp
+ * @brief Implementation of InferenceService
+ */
+
+#include "hydra/inference.hpp"
+#include "hydra/metrics.hpp"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace {
+
+Histogram& batch_seconds() {
+    static Histogram& histogram = metrics().histogram("hydra_inference_batch_seconds",
+                                                      "Time to generate the answers of one batch");
+    return histogram;
+}
+
+Histogram& batch_sizes() {
+    static Histogram& histogram = metrics().histogram("hydra_inference_batch_size", "Queries per inference batch",
+                                                      {}, {1, 2, 4, 8, 16, 32, 64, 128});
+    return histogram;
+}
+
+} // namespace
+
+InferenceService::InferenceService(SnapshotSource snapshot, Tokenizer tokenizer, InferenceOptions options)
+    : snapshot_(std::move(snapshot)),
+      tokenizer_(std::move(tokenizer)),
+      options_(options),
+      max_tokens_(static_cast<std::size_t>(snapshot_()->config().max_seq_length)),
+      kv_pool_(snapshot_()->config(), options.kv_cache_bytes) {
+    if (options_.max_batch == 0 || options_.max_queued == 0) {
+        throw std::invalid_argument("InferenceService: max_batch and max_queued must be positive");
+    }
+    if (options_.threads == 0) {
+        options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+InferenceService::~InferenceService() {
+    stop();
+}
+
+void InferenceService::start() {
+    std::lock_guard lock(queue_mutex_);
+    if (!threads_.empty()) {
+        return;
+    }
+    stopping_ = false;
+    for (std::size_t i = 0; i < options_.threads; ++i) {
+        threads_.emplace_back(&InferenceService::run, this);
+    }
+}
+
+void InferenceService::stop() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard lock(queue_mutex_);
+        stopping_ = true;
+        threads.swap(threads_);
+    }
+    queue_ready_.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+std::optional<std::future<InferenceResult>> InferenceService::submit(std::string_view prompt,
+                                                                     GenerationOptions options) {
+    // Read-only lookups, so request threads can encode concurrently
+    thread_local std::vector<std::string> words;
+    words.clear();
+    Tokenizer::split_words(prompt, words);
+
+    Query query;
+    query.tokens.reserve(words.size() + 1);
+    query.tokens.push_back(Tokenizer::kStart);
+    for (const auto& word : words) {
+        query.tokens.push_back(tokenizer_.id(word).value_or(Tokenizer::kUnk));
+    }
+    if (query.tokens.size() > max_tokens_) {
+        // Keep the end of the prompt; that is what the continuation depends on
+        query.tokens.erase(query.tokens.begin(), query.tokens.end() - static_cast<std::ptrdiff_t>(max_tokens_));
+    }
+    query.options = options;
+    query.options.token_end = static_cast<std::uint32_t>(tokenizer_.size());
+    query.received = std::chrono::steady_clock::now();
+    auto done = query.done.get_future();
+
+    {
+        std::lock_guard lock(queue_mutex_);
+        if (stopping_ || threads_.empty() || queue_.size() >= options_.max_queued) {
+            return std::nullopt;
+        }
+        queue_.push_back(std::move(query));
+    }
+    queue_ready_.notify_one();
+    return done;
+}
+
+std::size_t InferenceService::queued() const {
+    std::lock_guard lock(queue_mutex_);
+    return queue_.size();
+}
+
+// =============================================================================
+// Inference Threads
+// =============================================================================
+
+void InferenceService::run() {
+    ForwardWorkspace workspace;
+    std::vector<Query> batch;
+
+    std::unique_lock lock(queue_mutex_);
+    while (true) {
+        queue_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;   // Stopping and drained
+        }
+
+        // Give the oldest query max_wait to collect company
+        auto deadline = queue_.front().received + options_.max_wait;
+        queue_ready_.wait_until(lock, deadline, [this] {
+            return stopping_ || queue_.size() >= options_.max_batch;
+        });
+        if (queue_.empty()) {
+            continue;   // Another thread took them meanwhile
+        }
+
+        std::size_t count = std::min(queue_.size(), options_.max_batch);
+        batch.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        if (!queue_.empty()) {
+            queue_ready_.notify_one();   // Leftovers start their own batch
+        }
+
+        lock.unlock();
+        answer(batch, workspace);
+        lock.lock();
+    }
+}
+
+void InferenceService::answer(std::vector<Query>& batch, ForwardWorkspace& workspace) {
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    queries_.fetch_add(batch.size(), std::memory_order_relaxed);
+    batch_sizes().observe(static_cast<double>(batch.size()));
+    ScopedTimer timer(batch_seconds());
+
+    auto model = snapshot_();
+    std::vector<Generation> generations;
+    try {
+        std::vector<std::vector<std::uint32_t>> prompts;
+        std::vector<GenerationOptions> options;
+        prompts.reserve(batch.size());
+        options.reserve(batch.size());
+        for (auto& query : batch) {
+            prompts.push_back(std::move(query.tokens));
+            options.push_back(query.options);
+        }
+        generations = generate(*model, kv_pool_, prompts, options, workspace);
+    } catch (...) {
+        for (auto& query : batch) {
+            query.done.set_exception(std::current_exception());
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        InferenceResult result;
+        result.text = tokenizer_.decode(generations[i].tokens);
+        result.tokens = generations[i].tokens.size();
+        result.finish = generations[i].finish;
+        result.model_version = model->version();
+        result.batch_size = batch.size();
+        batch[i].done.set_value(std::move(result));
+    }
+}
+
+} // namespace hydra
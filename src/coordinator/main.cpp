@@ -0,0 +1,278 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of hydra_coordinator
+ */
+
+#include "hydra/server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// Self-pipe: the signal handler and the serving thread each write one
+// byte, main() reads it. write() is async-signal-safe; stop() is not, so
+// it runs on the main thread.
+int g_wake_pipe[2] = {-1, -1};
+constexpr char kSignalled = 's';
+constexpr char kServerDone = 'd';
+
+void wake_main(char byte) {
+    int saved = errno;
+    [[maybe_unused]] auto written = ::write(g_wake_pipe[1], &byte, 1);
+    errno = saved;
+}
+
+void handle_signal(int) {
+    wake_main(kSignalled);
+}
+
+void print_usage() {
+    std::cout << "Usage: hydra_coordinator [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --port PORT            Server port (default: 5000)\n"
+              << "  --host HOST            Server host (default: 0.0.0.0)\n"
+              << "  --db PATH              Database path (default: hydra.db)\n"
+              << "  --corpus DIR           Corpus shard directory (see hydra_corpus)\n"
+              << "  --tokens FILE          Pre-tokenized dataset (.htk, see hydra_corpus tokenize)\n"
+              << "  --task-tokens N        Tokens per task with --tokens (default: 1024)\n"
+              << "  --seq-len N            Training window with --tokens (default: 128)\n"
+              << "  --task-target SECS     Size tasks to take this long per worker, 0 = fixed (default: 60)\n"
+              << "  --task-scale MIN,MAX   Task size bounds relative to the base (default: 0.25,16)\n"
+              << "  --speculate FRACTION   Copy straggling tasks once a round is this full, 0 = off (default: 0.8)\n"
+              << "  --speculate-after SECS Age before a lease may be copied (default: 10)\n"
+              << "  --aggregation RULE     mean, trimmed_mean or median (default: trimmed_mean)\n"
+              << "  --round-size N         Submissions per aggregation round (default: 10)\n"
+              << "  --trim FRACTION        Fraction trimmed from each end (default: 0.1)\n"
+              << "  --learning-rate LR     Blend factor per round (default: 0.5)\n"
+              << "  --low-watermark N      Minimum pending tasks (default: 20)\n"
+              << "  --high-watermark N     Maximum pending tasks (default: 1000)\n"
+              << "  --worker-timeout SECS  Silence before a worker's tasks are requeued (default: 60)\n"
+              << "  --rate-limit RPS       Requests per second per client address (default: 10)\n"
+              << "  --burst N              Requests an address may send back to back (default: 20)\n"
+              << "  --max-submits N        Concurrent submit_result requests (default: 8)\n"
+              << "  --max-queries N        Concurrent query_model requests (default: 64)\n"
+              << "  --query-batch N        Queries answered per forward pass (default: 16)\n"
+              << "  --query-wait MS        Longest a query waits for a batch (default: 5)\n"
+              << "  --query-threads N      Inference threads (default: all cores)\n"
+              << "  --kv-cache-mb N        Memory for generation KV caches (default: 256)\n"
+              << "  --response-cache-mb N  Memory for cached query answers (default: 64, 0 = off)\n"
+              << "  --response-spill PATH  Spill evicted answers to this mmap'd file\n"
+              << "  --response-spill-mb N  Size of the spill file (default: 256)\n"
+              << "  --rpc ENDPOINT         Also serve binary RPC on host:port or unix:/path (repeatable)\n"
+              << "  --io-loop MODE         Drive RPC and checkpoint I/O with off|auto|io_uring|epoll (default: off)\n"
+              << "  --peers URL,URL,...    All coordinators of a cluster, same order on each\n"
+              << "  --node-index N         This coordinator's position in --peers (0 = leader)\n"
+              << "  --sync-interval SECS   Cluster model averaging period (default: 10)\n"
+              << "  --cluster-secret-file FILE  Secret shared by all --peers (required with --peers)\n"
+              << "  --relay-secret-file FILE    Secret relays must present (no relays without it)\n"
+              << "  --checkpoint-dir DIR   Checkpoint the model here and resume from it\n"
+              << "  --checkpoint-interval SECS  Time between checkpoints (default: 60)\n"
+              << "  --checkpoint-full-every N   Every N-th checkpoint is full (default: 10)\n"
+              << "  --checkpoint-keep N    Full checkpoints kept with their increments (default: 2)\n"
+              << "  --checkpoint-no-log    Do not log model versions between checkpoints\n"
+              << "  --vocab-size N         Model vocabulary (default: 10000)\n"
+              << "  --embed-dim N          Model embedding size (default: 256)\n"
+              << "  --num-heads N          Attention heads (default: 4)\n"
+              << "  --num-layers N         Transformer layers (default: 2)\n"
+              << "  --help                 Show this help message\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    hydra::ServerConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--help") {
+                print_usage();
+                return 0;
+            } else if (arg == "--port") {
+                config.port = std::stoi(next());
+            } else if (arg == "--host") {
+                config.host = next();
+            } else if (arg == "--db") {
+                config.db_path = next();
+            } else if (arg == "--corpus") {
+                config.corpus_dir = next();
+            } else if (arg == "--tokens") {
+                config.token_path = next();
+            } else if (arg == "--task-tokens") {
+                config.task_tokens = std::stoul(next());
+            } else if (arg == "--seq-len") {
+                config.sequence_length = static_cast<std::uint32_t>(std::stoul(next()));
+            } else if (arg == "--task-target") {
+                config.task_sizing.target = std::chrono::milliseconds(std::llround(std::stod(next()) * 1000));
+            } else if (arg == "--speculate") {
+                double fraction = std::stod(next());
+                if (fraction < 0.0 || fraction > 1.0) {
+                    throw std::invalid_argument("expected a fraction between 0 and 1");
+                }
+                config.speculation.enabled = fraction > 0.0;
+                if (config.speculation.enabled) {
+                    config.speculation.round_progress = fraction;
+                }
+            } else if (arg == "--speculate-after") {
+                config.speculation.min_age = std::chrono::milliseconds(std::llround(std::stod(next()) * 1000));
+            } else if (arg == "--task-scale") {
+                std::string bounds = next();
+                auto comma = bounds.find(',');
+                if (comma == std::string::npos) {
+                    throw std::invalid_argument("expected MIN,MAX");
+                }
+                config.task_sizing.min_scale = std::stod(bounds.substr(0, comma));
+                config.task_sizing.max_scale = std::stod(bounds.substr(comma + 1));
+            } else if (arg == "--aggregation") {
+                config.rounds.aggregation.rule = hydra::parse_aggregation_rule(next());
+            } else if (arg == "--round-size") {
+                config.rounds.round_size = std::stoul(next());
+            } else if (arg == "--trim") {
+                config.rounds.aggregation.trim_fraction = std::stod(next());
+            } else if (arg == "--learning-rate") {
+                config.rounds.learning_rate = std::stod(next());
+            } else if (arg == "--low-watermark") {
+                config.refill.low_watermark = std::stoul(next());
+            } else if (arg == "--high-watermark") {
+                config.refill.high_watermark = std::stoul(next());
+            } else if (arg == "--rate-limit") {
+                config.rate_limit.rate = std::stod(next());
+            } else if (arg == "--burst") {
+                config.rate_limit.burst = std::stod(next());
+            } else if (arg == "--max-submits") {
+                config.max_concurrent_submits = std::stoul(next());
+            } else if (arg == "--max-queries") {
+                config.max_concurrent_queries = std::stoul(next());
+            } else if (arg == "--query-batch") {
+                config.inference.max_batch = std::stoul(next());
+            } else if (arg == "--query-wait") {
+                config.inference.max_wait = std::chrono::milliseconds(std::stol(next()));
+            } else if (arg == "--query-threads") {
+                config.inference.threads = std::stoul(next());
+            } else if (arg == "--kv-cache-mb") {
+                config.inference.kv_cache_bytes = std::stoul(next()) << 20;
+            } else if (arg == "--response-cache-mb") {
+                config.response_cache.max_bytes = std::stoul(next()) << 20;
+            } else if (arg == "--response-spill") {
+                config.response_cache.spill_path = next();
+            } else if (arg == "--response-spill-mb") {
+                config.response_cache.spill_bytes = std::stoul(next()) << 20;
+            } else if (arg == "--rpc") {
+                config.rpc_endpoints.push_back(next());
+            } else if (arg == "--io-loop") {
+                auto backend = hydra::parse_io_backend(next());
+                if (!backend) {
+                    throw std::invalid_argument("expected off, auto, io_uring or epoll");
+                }
+                config.io_loop = *backend;
+                config.checkpoint.io = *backend;
+            } else if (arg == "--peers") {
+                std::string peers = next();
+                for (std::size_t start = 0; start <= peers.size();) {
+                    std::size_t end = std::min(peers.find(',', start), peers.size());
+                    if (end > start) {
+                        config.cluster.peers.push_back(peers.substr(start, end - start));
+                    }
+                    start = end + 1;
+                }
+            } else if (arg == "--node-index") {
+                config.cluster.self = std::stoul(next());
+            } else if (arg == "--cluster-secret-file") {
+                config.cluster.secret = hydra::read_secret_file(next());
+            } else if (arg == "--relay-secret-file") {
+                config.relay_secret = hydra::read_secret_file(next());
+            } else if (arg == "--sync-interval") {
+                config.cluster.sync_interval = std::chrono::milliseconds(
+                    static_cast<long long>(std::stod(next()) * 1000));
+            } else if (arg == "--checkpoint-dir") {
+                config.checkpoint.dir = next();
+            } else if (arg == "--checkpoint-interval") {
+                config.checkpoint.interval = std::chrono::milliseconds(
+                    static_cast<long long>(std::stod(next()) * 1000));
+            } else if (arg == "--checkpoint-full-every") {
+                config.checkpoint.full_every = std::stoul(next());
+            } else if (arg == "--checkpoint-keep") {
+                config.checkpoint.keep_full = std::stoul(next());
+            } else if (arg == "--checkpoint-no-log") {
+                config.checkpoint.log_versions = false;
+            } else if (arg == "--vocab-size") {
+                config.model.vocab_size = std::stoi(next());
+            } else if (arg == "--embed-dim") {
+                config.model.embed_dim = std::stoi(next());
+            } else if (arg == "--num-heads") {
+                config.model.num_heads = std::stoi(next());
+            } else if (arg == "--num-layers") {
+                config.model.num_layers = std::stoi(next());
+            } else if (arg == "--worker-timeout") {
+                config.heartbeat.timeout = std::chrono::milliseconds(
+                    static_cast<long long>(std::stod(next()) * 1000));
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n\n";
+                print_usage();
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        // Non-blocking writes: a burst of signals must never block the handler
+        if (::pipe(g_wake_pipe) != 0 || ::fcntl(g_wake_pipe[1], F_SETFL, O_NONBLOCK) != 0) {
+            throw std::runtime_error("cannot create the signal pipe");
+        }
+        hydra::CoordinatorServer server(config);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+
+        auto serving = std::async(std::launch::async, [&server] {
+            try {
+                bool ok = server.run();
+                wake_main(kServerDone);
+                return ok;
+            } catch (...) {
+                wake_main(kServerDone);
+                throw;
+            }
+        });
+
+        char byte = 0;
+        while (::read(g_wake_pipe[0], &byte, 1) < 0 && errno == EINTR) {
+        }
+        if (byte == kSignalled) {
+            // A signal during startup can arrive before the listener is up,
+            // when stop() has nothing to stop yet; repeat until run() returns
+            do {
+                server.stop();
+            } while (serving.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready);
+        }
+
+        if (!serving.get()) {
+            std::cerr << "Failed to listen on " << config.host << ":" << config.port << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,419 @@
+/**
+ * @file relay.cpp
+ * @brief Implementation of RelayServer
+ */
+
+#include "hydra/relay.hpp"
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace hydra {
+
+using json = nlohmann::json;
+
+namespace {
+
+void send_json(httplib::Response& res, int status, const json& body) {
+    res.status = status;
+    res.set_content(body.dump(), "application/json");
+}
+
+} // namespace
+
+// =============================================================================
+// Wire Format
+// =============================================================================
+
+std::string frame_relay_batch(std::string_view header, std::span<const float> values) {
+    std::string body;
+    body.reserve(4 + header.size() + values.size_bytes());
+    auto length = static_cast<std::uint32_t>(header.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        body.push_back(static_cast<char>((length >> shift) & 0xff));
+    }
+    body.append(header);
+    body.append(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+    return body;
+}
+
+bool split_relay_batch(std::string_view body, std::string_view& header, std::string_view& values) {
+    if (body.size() < 4) {
+        return false;
+    }
+    std::uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) {
+        length |= static_cast<std::uint32_t>(static_cast<unsigned char>(body[i])) << (8 * i);
+    }
+    if (length > body.size() - 4 || (body.size() - 4 - length) % sizeof(float) != 0) {
+        return false;
+    }
+    header = body.substr(4, length);
+    values = body.substr(4 + length);
+    return true;
+}
+
+// =============================================================================
+// Constructor and Destructor
+// =============================================================================
+
+RelayServer::RelayServer(RelayOptions options)
+    : options_(std::move(options)), http_(std::make_unique<httplib::Server>()) {
+    if (options_.batch_size == 0 || options_.max_queued == 0) {
+        throw std::invalid_argument("RelayServer: batch_size and max_queued must be positive");
+    }
+    if (options_.secret.empty()) {
+        throw std::invalid_argument("RelayServer: the coordinator's relay secret is required");
+    }
+    if (options_.relay_id.empty()) {
+        options_.relay_id = options_.host + ":" + std::to_string(options_.port);
+    }
+
+    // Every buffered submission and every forwarded long-poll holds a thread
+    std::size_t threads = std::max(8u, std::thread::hardware_concurrency()) + options_.max_queued + 256;
+    http_->new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+    setup_routes();
+}
+
+RelayServer::~RelayServer() {
+    stop();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
+
+bool RelayServer::run() {
+    if (!fetch_layout()) {
+        std::cerr << "Could not fetch the model layout from " << options_.upstream << std::endl;
+        return false;
+    }
+
+    std::cout << "\n==================================================\n"
+              << "🔀 HydraAI Relay Starting\n"
+              << "==================================================\n"
+              << "Relay: http://" << options_.host << ":" << options_.port << "\n"
+              << "Upstream: " << options_.upstream << "\n"
+              << "Model: " << layout_->values().size() << " parameters\n"
+              << "Batches: " << aggregation_rule_name(options_.aggregation.rule) << " of up to "
+              << options_.batch_size << " submissions, at most "
+              << options_.max_delay.count() << " ms apart\n"
+              << "==================================================\n" << std::endl;
+
+    {
+        std::lock_guard lock(queue_mutex_);
+        stopping_ = false;
+    }
+    flusher_ = std::thread(&RelayServer::run_flusher, this);
+
+    bool ok = http_->listen(options_.host, options_.port);
+    stop();
+    flusher_.join();
+    return ok;
+}
+
+void RelayServer::stop() {
+    {
+        std::lock_guard lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_ready_.notify_all();
+    if (http_) {
+        http_->stop();
+    }
+}
+
+bool RelayServer::fetch_layout() {
+    httplib::Client client(options_.upstream);
+    client.set_connection_timeout(5);
+
+    // The coordinator may still be starting; give it a few seconds
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        if (auto response = client.Get("/model/config"); response && response->status == 200) {
+            json body = json::parse(response->body, nullptr, false);
+            if (body.is_discarded() || !body.is_object()) {
+                return false;
+            }
+            ModelConfig config;
+            config.vocab_size = body.value("vocab_size", config.vocab_size);
+            config.embed_dim = body.value("embed_dim", config.embed_dim);
+            config.num_heads = body.value("num_heads", config.num_heads);
+            config.num_layers = body.value("num_layers", config.num_layers);
+            config.max_seq_length = body.value("max_seq_length", config.max_seq_length);
+            layout_ = std::make_unique<ModelState>(ModelState::create(config));
+            return layout_->values().size() == body.value("parameters", std::size_t{0});
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return false;
+}
+
+// =============================================================================
+// Routes
+// =============================================================================
+
+void RelayServer::setup_routes() {
+    http_->Post("/submit_result", [this](const httplib::Request& req, httplib::Response& res) {
+        handle_submit_result(req, res);
+    });
+
+    // Everything else goes upstream as it is
+    auto proxy = [this](const httplib::Request& req, httplib::Response& res) {
+        this->proxy(req, res);
+    };
+    http_->Get(".*", proxy);
+    http_->Post(".*", proxy);
+}
+
+void RelayServer::handle_submit_result(const httplib::Request& req, httplib::Response& res) {
+    std::string_view body = req.body;
+    std::string user_id = json_string_value(find_json_member(body, "user_id"));
+    std::string task_id = json_string_value(find_json_member(body, "task_id"));
+    std::string_view parameters = find_json_member(body, "updated_parameters");
+
+    if (user_id.empty() || task_id.empty() || parameters.empty()) {
+        send_json(res, 400, {{"error", "Missing required fields"}});
+        return;
+    }
+
+    // Unlike the coordinator, the relay has no global model to fill gaps
+    // from, so a submission must carry every tensor
+    Submission submission;
+    submission.update.resize(layout_->values().size());
+    try {
+        if (layout_->parse_json(parameters, submission.update) != layout_->tensors().size()) {
+            send_json(res, 400, {{"error", "Relayed submissions must include every parameter"}});
+            return;
+        }
+    } catch (const std::runtime_error& e) {
+        send_json(res, 400, {{"error", std::string("Invalid parameters: ") + e.what()}});
+        return;
+    }
+
+    submission.user_id = std::move(user_id);
+    submission.task_id = std::move(task_id);
+    submission.received = std::chrono::steady_clock::now();
+    auto done = submission.done.get_future();
+    {
+        std::lock_guard lock(queue_mutex_);
+        if (stopping_) {
+            send_json(res, 503, {{"error", "Relay is shutting down"}});
+            return;
+        }
+        if (queue_.size() >= options_.max_queued) {
+            res.set_header("Retry-After", "1");
+            send_json(res, 429, {{"error", "Relay busy, try again shortly"}, {"retry_after", 1}});
+            return;
+        }
+        queue_.push_back(std::move(submission));
+    }
+    queue_ready_.notify_one();
+
+    // The flusher answers every submission it takes, even on failure
+    Outcome outcome = done.get();
+    if (!outcome.retry_after.empty()) {
+        res.set_header("Retry-After", outcome.retry_after);
+    }
+    res.status = outcome.status;
+    res.set_content(std::move(outcome.body), "application/json");
+}
+
+void RelayServer::proxy(const httplib::Request& req, httplib::Response& res) {
+    httplib::Client client(options_.upstream);
+    client.set_connection_timeout(5);
+    client.set_read_timeout(60);   // Covers the coordinator's longest long-poll
+    client.set_decompress(false);  // Encoded bodies pass through as they are
+
+    httplib::Headers headers;
+    for (const char* name : {"Accept", "Accept-Encoding"}) {
+        if (req.has_header(name)) {
+            headers.emplace(name, req.get_header_value(name));
+        }
+    }
+    if (!req.has_header("Accept-Encoding")) {
+        headers.emplace("Accept-Encoding", "identity");   // Not the client library's default
+    }
+
+    auto response = req.method == "GET"
+        ? client.Get(req.target, headers)
+        : client.Post(req.target, headers, req.body, req.get_header_value("Content-Type"));
+    if (!response) {
+        send_json(res, 502, {{"error", "Coordinator unreachable"}});
+        return;
+    }
+
+    res.status = response->status;
+    for (const char* name : {"Retry-After", "Location", "Content-Encoding", "Accept-Encoding", "Vary"}) {
+        if (response->has_header(name)) {
+            res.set_header(name, response->get_header_value(name));
+        }
+    }
+    std::string type = response->get_header_value("Content-Type");
+    if (type.empty()) {
+        type = "application/json";
+    }
+    if (!response->has_header("Content-Encoding")) {
+        res.set_content(std::move(response->body), type);
+        return;
+    }
+    // Through a content provider, which the server never compresses again
+    auto body = std::make_shared<const std::string>(std::move(response->body));
+    res.set_content_provider(
+        body->size(), type,
+        [body](std::size_t offset, std::size_t length, httplib::DataSink& sink) {
+            constexpr std::size_t kChunk = 1 << 20;
+            return sink.write(body->data() + offset, std::min(length, kChunk));
+        });
+}
+
+// =============================================================================
+// Batching
+// =============================================================================
+
+void RelayServer::run_flusher() {
+    std::unique_lock lock(queue_mutex_);
+    while (true) {
+        queue_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;   // Stopping with nothing left to forward
+        }
+
+        // Wait for a full batch, but never hold the oldest submission longer
+        // than max_delay
+        auto deadline = queue_.front().received + options_.max_delay;
+        queue_ready_.wait_until(lock, deadline, [this] {
+            return stopping_ || queue_.size() >= options_.batch_size;
+        });
+
+        std::size_t count = std::min(queue_.size(), options_.batch_size);
+        std::vector<Submission> batch;
+        batch.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+
+        lock.unlock();
+        forward(std::move(batch));
+        lock.lock();
+    }
+}
+
+void RelayServer::forward(std::vector<Submission> batch) {
+    // Phase 1: the coordinator completes and rewards the tasks, and says
+    // which of them the aggregate may include
+    json completions = json::array();
+    for (const auto& submission : batch) {
+        completions.push_back({{"user_id", submission.user_id}, {"task_id", submission.task_id}});
+    }
+    json header = {{"relay_id", options_.relay_id}, {"completions", std::move(completions)}};
+    Outcome reserved = call_upstream(RpcMethod::RelayReserve, "/relay/reserve", header.dump(), {});
+
+    // One result per completion, in order
+    json reply = reserved.status == 200 ? json::parse(reserved.body, nullptr, false) : json();
+    if (reserved.status == 200 &&
+        (!reply.is_object() || !reply.contains("results") || !reply["results"].is_array() ||
+         reply["results"].size() != batch.size())) {
+        reserved = {502, json{{"error", "Malformed reply from coordinator"}}.dump(), ""};
+    }
+    if (reserved.status != 200) {
+        std::cerr << "Relay: batch of " << batch.size() << " failed upstream (" << reserved.status << ")"
+                  << std::endl;
+        for (auto& submission : batch) {
+            submission.done.set_value(reserved);
+        }
+        return;
+    }
+
+    // Workers are answered now: their tasks are rewarded whatever happens
+    // to the aggregate
+    std::vector<UpdateView> views;
+    views.reserve(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        json result = reply["results"][i];
+        Outcome outcome;
+        outcome.status = result.is_object() ? result.value("status", 502) : 502;
+        if (outcome.status == 200) {
+            views.push_back({batch[i].update.data(), 1.0});
+        }
+        if (result.is_object()) {
+            result.erase("status");
+            result.erase("task_id");
+        }
+        outcome.body = result.dump();
+        batch[i].done.set_value(std::move(outcome));
+    }
+    if (views.empty()) {
+        return;
+    }
+
+    // Phase 2: the aggregate of exactly the accepted submissions
+    std::string reservation = reply.value("batch", "");
+    std::vector<float> combined(layout_->values().size());
+    try {
+        aggregate_updates(views, combined, options_.aggregation);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Relay: could not aggregate batch " << reservation << ": " << e.what() << std::endl;
+        return;
+    }
+
+    // The reservation is held for expires_in seconds; a busy coordinator is
+    // retried until then
+    header = {{"relay_id", options_.relay_id}, {"batch", reservation}};
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(reply.value("expires_in", 0));
+    Outcome delivered = call_upstream(RpcMethod::RelaySubmit, "/relay/submit", header.dump(), combined);
+    while ((delivered.status == 429 || delivered.status == 502 || delivered.status == 503) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        delivered = call_upstream(RpcMethod::RelaySubmit, "/relay/submit", header.dump(), combined);
+    }
+    if (delivered.status != 200) {
+        std::cerr << "Relay: the aggregate of " << views.size() << " rewarded submissions was lost ("
+                  << delivered.status << " " << delivered.body << ")" << std::endl;
+        return;
+    }
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    std::cout << "✓ Forwarded " << views.size() << " submissions as one update" << std::endl;
+}
+
+RelayServer::Outcome RelayServer::call_upstream(RpcMethod method, const char* path, const std::string& header,
+                                                std::span<const float> values) {
+    if (!options_.upstream_rpc.empty()) {
+        // The values go out from the aggregate buffer, without a framed copy
+        try {
+            if (!rpc_) {
+                rpc_ = std::make_unique<RpcClient>(options_.upstream_rpc, options_.upstream_encoding);
+            }
+            json meta = json::parse(header);
+            meta["relay_secret"] = options_.secret;
+            RpcMessage reply = rpc_->call(method, meta.dump(), values);
+            json body = json::parse(reply.meta, nullptr, false);
+            std::string retry_after;
+            if (reply.status == 429 && body.is_object() && body.contains("retry_after")) {
+                retry_after = body["retry_after"].dump();
+            }
+            return {reply.status, std::move(reply.meta), std::move(retry_after)};
+        } catch (const std::exception& e) {
+            std::cerr << "Relay: " << e.what() << std::endl;
+            rpc_.reset();   // Reconnect for the next call
+            return {502, json{{"error", "Coordinator unreachable"}}.dump(), ""};
+        }
+    }
+
+    httplib::Client client(options_.upstream);
+    client.set_connection_timeout(5);
+    client.set_write_timeout(60);
+    client.set_read_timeout(60);
+    httplib::Headers headers = {{kRelaySecretHeader, options_.secret}};
+    auto response = method == RpcMethod::RelaySubmit
+        ? client.Post(path, headers, frame_relay_batch(header, values), "application/octet-stream")
+        : client.Post(path, headers, header, "application/json");
+    if (!response) {
+        return {502, json{{"error", "Coordinator unreachable"}}.dump(), ""};
+    }
+    return {response->status, response->body, response->get_header_value("Retry-After")};
+}
+
+} // namespace hydra
@@ -0,0 +1,391 @@
+/**
+ * @file response_cache.cpp
+ * @brief Implementation of ResponseCache
+ */
+
+#include "hydra/response_cache.hpp"
+#include "hydra/hash_ring.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace hydra {
+
+namespace {
+
+// Rough per-entry cost of the list node, the index slot and the strings' headers
+constexpr std::size_t kEntryOverhead = sizeof(std::uint64_t) * 16;
+
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+template <typename T>
+void append_raw(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+} // namespace
+
+// =============================================================================
+// Frequency Sketch (TinyLFU admission)
+// =============================================================================
+
+/**
+ * Count-min sketch of 4-bit-ish counters. Counts are halved once the
+ * sketch has seen ten increments per counter, so popularity fades and a
+ * prompt that was hot yesterday does not keep its slot forever. Updates
+ * are relaxed and may lose increments under contention; the counts are
+ * estimates anyway.
+ */
+class ResponseCache::FrequencySketch {
+public:
+    explicit FrequencySketch(std::size_t width)
+        : width_(std::bit_ceil(std::max<std::size_t>(width, 1024))),
+          counters_(new std::atomic<std::uint8_t>[width_ * kRows]) {
+        for (std::size_t i = 0; i < width_ * kRows; ++i) {
+            counters_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void increment(std::uint64_t hash) {
+        for (std::size_t row = 0; row < kRows; ++row) {
+            auto& counter = counters_[slot(hash, row)];
+            std::uint8_t count = counter.load(std::memory_order_relaxed);
+            if (count < kMaxCount) {
+                counter.store(count + 1, std::memory_order_relaxed);
+            }
+        }
+        if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 == width_ * 10) {
+            additions_.store(0, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < width_ * kRows; ++i) {
+                counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::uint8_t estimate(std::uint64_t hash) const {
+        std::uint8_t count = kMaxCount;
+        for (std::size_t row = 0; row < kRows; ++row) {
+            count = std::min(count, counters_[slot(hash, row)].load(std::memory_order_relaxed));
+        }
+        return count;
+    }
+
+private:
+    static constexpr std::size_t kRows = 4;
+    static constexpr std::uint8_t kMaxCount = 15;
+
+    std::size_t width_;
+    std::unique_ptr<std::atomic<std::uint8_t>[]> counters_;
+    std::atomic<std::size_t> additions_{0};
+
+    std::size_t slot(std::uint64_t hash, std::size_t row) const {
+        return row * width_ + (mix(hash + row * 0x9e3779b97f4a7c15ull) & (width_ - 1));
+    }
+};
+
+// =============================================================================
+// Spill Ring (mmap'd second tier)
+// =============================================================================
+
+/**
+ * Records are appended at a logical offset that only grows; the physical
+ * position is the offset modulo the file size, and a record never
+ * straddles the end (the tail is skipped instead). A record is valid
+ * until the writer has gone a full lap past its start, so staleness is
+ * one comparison and nothing has to be erased when the ring wraps.
+ */
+class ResponseCache::SpillRing {
+public:
+    SpillRing(const std::string& path, std::size_t bytes) : size_(bytes & ~std::size_t{7}) {
+        if (size_ < 4096) {
+            throw std::invalid_argument("ResponseCache: spill file must be at least 4 KB");
+        }
+#ifdef _WIN32
+        throw std::runtime_error("ResponseCache: spill files are not supported on Windows");
+#else
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to size " + path);
+        }
+        void* addr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);   // The mapping keeps the file alive
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("Failed to map " + path);
+        }
+        data_ = static_cast<std::byte*>(addr);
+#endif
+    }
+
+    ~SpillRing() {
+#ifndef _WIN32
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+#endif
+    }
+
+    SpillRing(const SpillRing&) = delete;
+    SpillRing& operator=(const SpillRing&) = delete;
+
+    void append(const Entry& entry) {
+        std::size_t bytes = (sizeof(Header) + entry.key.size() + entry.answer.text.size() + 7) & ~std::size_t{7};
+        if (bytes > size_ / 4) {
+            return;   // Would evict a large part of the ring for one answer
+        }
+
+        std::lock_guard lock(mutex_);
+        if (head_ % size_ + bytes > size_) {
+            head_ += size_ - head_ % size_;   // Skip the tail; start the next lap
+            std::erase_if(index_, [this](const auto& slot) { return !live(slot.second); });
+        }
+
+        Header header{entry.hash, head_, static_cast<std::uint32_t>(entry.key.size()),
+                      static_cast<std::uint32_t>(entry.answer.text.size()),
+                      static_cast<std::uint32_t>(entry.answer.tokens),
+                      static_cast<std::uint32_t>(entry.answer.finish)};
+        std::byte* out = data_ + head_ % size_;
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + sizeof(header), entry.key.data(), entry.key.size());
+        std::memcpy(out + sizeof(header) + entry.key.size(), entry.answer.text.data(), entry.answer.text.size());
+
+        index_[entry.hash] = head_;
+        head_ += bytes;
+    }
+
+    std::optional<CachedAnswer> find(std::uint64_t hash, std::string_view key) {
+        std::lock_guard lock(mutex_);
+        auto it = index_.find(hash);
+        if (it == index_.end()) {
+            return std::nullopt;
+        }
+        if (!live(it->second)) {
+            index_.erase(it);
+            return std::nullopt;
+        }
+
+        const std::byte* in = data_ + it->second % size_;
+        Header header;
+        std::memcpy(&header, in, sizeof(header));
+        const char* stored_key = reinterpret_cast<const char*>(in + sizeof(header));
+        if (header.hash != hash || header.offset != it->second ||
+            std::string_view(stored_key, header.key_bytes) != key) {
+            return std::nullopt;   // Hash collision with a different key
+        }
+
+        CachedAnswer answer;
+        answer.text.assign(stored_key + header.key_bytes, header.text_bytes);
+        answer.tokens = header.tokens;
+        answer.finish = static_cast<FinishReason>(header.finish);
+        return answer;
+    }
+
+    void clear() {
+        std::lock_guard lock(mutex_);
+        index_.clear();
+    }
+
+private:
+    struct Header {
+        std::uint64_t hash;
+        std::uint64_t offset;          // Logical offset, guards against stale index slots
+        std::uint32_t key_bytes;
+        std::uint32_t text_bytes;
+        std::uint32_t tokens;
+        std::uint32_t finish;
+    };
+
+    std::size_t size_;
+    std::byte* data_{nullptr};
+
+    std::mutex mutex_;
+    std::uint64_t head_{0};            // Logical write offset
+    std::unordered_map<std::uint64_t, std::uint64_t> index_;   // Hash -> logical offset
+
+    bool live(std::uint64_t offset) const { return head_ <= offset + size_; }
+};
+
+// =============================================================================
+// Response Cache
+// =============================================================================
+
+ResponseCache::ResponseCache(ResponseCacheOptions options) : options_(std::move(options)) {
+    if (options_.max_bytes == 0) {
+        return;   // Disabled
+    }
+    options_.shards = std::max<std::size_t>(options_.shards, 1);
+    for (std::size_t i = 0; i < options_.shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+    // About one counter per 256 bytes of cache, i.e. several per entry
+    sketch_ = std::make_unique<FrequencySketch>(options_.max_bytes / 256);
+    if (!options_.spill_path.empty()) {
+        spill_ = std::make_unique<SpillRing>(options_.spill_path, options_.spill_bytes);
+    }
+}
+
+ResponseCache::~ResponseCache() = default;
+
+bool ResponseCache::cacheable(const GenerationOptions& options) {
+    return options.sampling.temperature <= 0.0f || options.sampling.top_k == 1 || options.sampling.seed != 0;
+}
+
+std::string ResponseCache::make_key(std::string_view prompt, const GenerationOptions& options,
+                                    std::uint64_t version) {
+    // Greedy decoding ignores the sampling knobs, so they don't split the key
+    SamplingOptions sampling = options.sampling;
+    if (sampling.temperature <= 0.0f || sampling.top_k == 1) {
+        sampling = SamplingOptions{};
+    }
+
+    std::string key;
+    key.reserve(48 + prompt.size());
+    append_raw(key, version);
+    append_raw(key, static_cast<std::uint64_t>(options.max_new_tokens));
+    append_raw(key, options.token_end);
+    append_raw(key, sampling.temperature);
+    append_raw(key, static_cast<std::uint64_t>(sampling.top_k));
+    append_raw(key, sampling.top_p);
+    append_raw(key, sampling.seed);
+    key.append(prompt);
+    return key;
+}
+
+bool ResponseCache::advance_version(std::uint64_t version) {
+    std::uint64_t current = version_.load(std::memory_order_acquire);
+    while (version > current) {
+        if (version_.compare_exchange_weak(current, version, std::memory_order_acq_rel)) {
+            // Every key names the old version, so none of them can hit again
+            for (auto& shard : shards_) {
+                std::lock_guard lock(shard->mutex);
+                shard->lru.clear();
+                shard->index.clear();
+                shard->bytes = 0;
+            }
+            if (spill_) {
+                spill_->clear();
+            }
+            return true;
+        }
+    }
+    return version == current;
+}
+
+std::optional<CachedAnswer> ResponseCache::lookup(std::string_view prompt, const GenerationOptions& options,
+                                                  std::uint64_t version) {
+    if (!enabled() || !cacheable(options) || !advance_version(version)) {
+        return std::nullopt;
+    }
+
+    std::string key = make_key(prompt, options, version);
+    std::uint64_t hash = HashRing::hash(key);
+    sketch_->increment(hash);
+
+    Shard& shard = *shards_[hash % shards_.size()];
+    {
+        std::lock_guard lock(shard.mutex);
+        auto it = shard.index.find(hash);
+        if (it != shard.index.end() && it->second->key == key) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second->answer;
+        }
+    }
+
+    if (spill_) {
+        if (auto answer = spill_->find(hash, key)) {
+            spill_hits_.fetch_add(1, std::memory_order_relaxed);
+            admit(shard, Entry{hash, std::move(key), *answer, 0});
+            return answer;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+void ResponseCache::insert(std::string_view prompt, const GenerationOptions& options,
+                           std::uint64_t version, const CachedAnswer& answer) {
+    if (!enabled() || !cacheable(options) || !advance_version(version)) {
+        return;
+    }
+
+    std::string key = make_key(prompt, options, version);
+    std::uint64_t hash = HashRing::hash(key);
+    admit(*shards_[hash % shards_.size()], Entry{hash, std::move(key), answer, 0});
+}
+
+void ResponseCache::admit(Shard& shard, Entry entry) {
+    const std::size_t capacity = options_.max_bytes / shards_.size();
+    entry.bytes = entry.key.size() + entry.answer.text.size() + kEntryOverhead;
+
+    // Whatever leaves memory goes to the spill ring, written after unlocking
+    std::vector<Entry> spilled;
+    {
+        std::lock_guard lock(shard.mutex);
+        if (auto it = shard.index.find(entry.hash); it != shard.index.end()) {
+            shard.bytes -= it->second->bytes;
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+
+        // TinyLFU: the newcomer only displaces victims it is more popular than
+        bool admitted = entry.bytes <= capacity;
+        std::uint8_t frequency = sketch_->estimate(entry.hash);
+        while (admitted && shard.bytes + entry.bytes > capacity) {
+            Entry& victim = shard.lru.back();
+            if (frequency <= sketch_->estimate(victim.hash)) {
+                admitted = false;
+                break;
+            }
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+            shard.bytes -= victim.bytes;
+            shard.index.erase(victim.hash);
+            spilled.push_back(std::move(victim));
+            shard.lru.pop_back();
+        }
+
+        if (admitted) {
+            shard.bytes += entry.bytes;
+            shard.lru.push_front(std::move(entry));
+            shard.index[shard.lru.front().hash] = shard.lru.begin();
+        } else {
+            rejections_.fetch_add(1, std::memory_order_relaxed);
+            spilled.push_back(std::move(entry));
+        }
+    }
+
+    if (spill_) {
+        for (const auto& victim : spilled) {
+            spill_->append(victim);
+        }
+    }
+}
+
+std::size_t ResponseCache::bytes() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        total += shard->bytes;
+    }
+    return total;
+}
+
+} // namespace hydra
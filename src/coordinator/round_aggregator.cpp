@@ -0,0 +1,124 @@
+/**
+ * @file round_aggregator.cpp
+ * @brief Implementation of RoundAggregator
+ */
+
+#include "hydra/round_aggregator.hpp"
+#include "hydra/metrics.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace hydra {
+
+namespace {
+
+Histogram& aggregation_seconds() {
+    static Histogram& histogram = metrics().histogram("hydra_aggregation_seconds",
+                                                      "Time to aggregate a round into the next model version");
+    return histogram;
+}
+
+} // namespace
+
+RoundAggregator::RoundAggregator(std::shared_ptr<const ModelState> initial, RoundOptions options,
+                                 PublishListener on_publish)
+    : options_(options), on_publish_(std::move(on_publish)), current_(std::move(initial)) {
+    if (!current_.load()) {
+        throw std::invalid_argument("RoundAggregator: initial model is required");
+    }
+    if (options_.round_size == 0) {
+        throw std::invalid_argument("RoundAggregator: round_size must be positive");
+    }
+    pending_.reserve(options_.round_size);
+    counts_.reserve(options_.round_size);
+}
+
+std::shared_ptr<const ModelState> RoundAggregator::snapshot() const {
+    return current_.load(std::memory_order_acquire);
+}
+
+bool RoundAggregator::submit(std::vector<float> update, std::size_t count) {
+    if (update.size() != snapshot()->values().size()) {
+        throw std::invalid_argument("RoundAggregator: update has the wrong number of parameters");
+    }
+    if (count == 0) {
+        throw std::invalid_argument("RoundAggregator: an update stands for at least one worker");
+    }
+
+    std::vector<std::vector<float>> round;
+    std::vector<std::size_t> round_counts;
+    {
+        std::lock_guard lock(pending_mutex_);
+        pending_.push_back(std::move(update));
+        counts_.push_back(count);
+        buffered_ += count;
+        if (buffered_ < options_.round_size) {
+            return false;
+        }
+        round.swap(pending_);
+        round_counts.swap(counts_);
+        buffered_ = 0;
+        pending_.reserve(options_.round_size);
+        counts_.reserve(options_.round_size);
+    }
+
+    // Aggregate outside the pending lock so submissions keep flowing
+    aggregate_round(std::move(round), std::move(round_counts));
+    return true;
+}
+
+void RoundAggregator::publish(std::shared_ptr<ModelState> model) {
+    if (!model || model->values().size() != snapshot()->values().size()) {
+        throw std::invalid_argument("RoundAggregator: published model has the wrong layout");
+    }
+
+    std::lock_guard lock(aggregate_mutex_);
+    model->set_version(std::max(model->version(), snapshot()->version() + 1));
+    std::uint64_t version = model->version();
+    current_.store(std::move(model), std::memory_order_release);
+    if (on_publish_) {
+        on_publish_(version);
+    }
+}
+
+std::size_t RoundAggregator::buffered() const {
+    std::lock_guard lock(pending_mutex_);
+    return buffered_;
+}
+
+void RoundAggregator::aggregate_round(std::vector<std::vector<float>> updates,
+                                      std::vector<std::size_t> counts) {
+    std::lock_guard lock(aggregate_mutex_);
+    ScopedTimer timer(aggregation_seconds());
+
+    // The robust rules ignore weights, so an update standing for several
+    // workers is repeated instead (views only; the values are not copied)
+    auto base = snapshot();
+    const bool weighted = options_.aggregation.rule == AggregationRule::Mean;
+    std::vector<UpdateView> views;
+    views.reserve(updates.size());
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+        if (weighted) {
+            views.push_back({updates[i].data(), static_cast<double>(counts[i])});
+        } else {
+            views.insert(views.end(), counts[i], UpdateView{updates[i].data(), 1.0});
+        }
+    }
+
+    std::vector<float> aggregate(base->values().size());
+    aggregate_updates(views, aggregate, options_.aggregation);
+
+    auto next = std::make_shared<ModelState>(*base);
+    blend_into(next->values(), aggregate, options_.learning_rate);
+    next->set_version(base->version() + 1);
+
+    std::uint64_t version = next->version();
+    current_.store(std::move(next), std::memory_order_release);
+    rounds_.fetch_add(1, std::memory_order_relaxed);
+    if (on_publish_) {
+        on_publish_(version);
+    }
+}
+
+} // namespace hydra
@@ -0,0 +1,725 @@
+/**
+ * @file rpc_server.cpp
+ * @brief Implementation of RpcServer
+ */
+
+#include "hydra/rpc_server.hpp"
+#include "hydra/metrics.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace hydra {
+
+using json = nlohmann::json;
+
+namespace {
+
+constexpr std::size_t kMaxQueued = 64;                // Pipelined requests read ahead of the handler
+constexpr std::size_t kFixedMinBytes = 1 << 20;       // Smaller payloads are not worth registering
+constexpr std::size_t kFixedBuffers = 2;              // The current model version and the one before
+constexpr std::size_t kEncodedPayloads = 4;           // Two versions in both encodings
+
+bool x_hydra(ContentEncoding encoding) {
+    return encoding == ContentEncoding::Lz || encoding == ContentEncoding::Deflate;
+}
+
+// Zero-copy only pays when the bytes leave the machine: loopback and Unix
+// sockets copy on delivery anyway, on top of the notification
+bool remote_peer(int fd) {
+    sockaddr_storage peer{};
+    socklen_t length = sizeof(peer);
+    if (::getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &length) != 0) {
+        return false;
+    }
+    if (peer.ss_family == AF_INET) {
+        auto address = ntohl(reinterpret_cast<const sockaddr_in&>(peer).sin_addr.s_addr);
+        return (address >> 24) != 127;
+    }
+    if (peer.ss_family == AF_INET6) {
+        const in6_addr& address = reinterpret_cast<const sockaddr_in6&>(peer).sin6_addr;
+        return !IN6_IS_ADDR_LOOPBACK(&address) &&
+               !(IN6_IS_ADDR_V4MAPPED(&address) && address.s6_addr[12] == 127);
+    }
+    return false;
+}
+
+// The peer's IP address as text, empty for Unix sockets
+std::string peer_address(int fd) {
+    sockaddr_storage peer{};
+    socklen_t length = sizeof(peer);
+    if (::getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &length) != 0) {
+        return {};
+    }
+    char text[INET6_ADDRSTRLEN] = {};
+    if (peer.ss_family == AF_INET) {
+        ::inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in&>(peer).sin_addr, text, sizeof(text));
+    } else if (peer.ss_family == AF_INET6) {
+        ::inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6&>(peer).sin6_addr, text, sizeof(text));
+    }
+    return text;
+}
+
+// Per-method latency, looked up once instead of on every frame
+Histogram& rpc_seconds(RpcMethod method) {
+    static const auto histograms = [] {
+        std::array<Histogram*, 9> all{};
+        for (std::uint16_t m = 0; m < all.size(); ++m) {
+            all[m] = &metrics().histogram("hydra_rpc_seconds", "RPC handling time by method",
+                                          {{"method", rpc_method_name(static_cast<RpcMethod>(m))}});
+        }
+        return all;
+    }();
+    auto index = static_cast<std::size_t>(method);
+    return *histograms[index < histograms.size() ? index : 0];
+}
+
+// Handlers suspended on other threads continue on the loop thread
+class LoopScheduler : public Scheduler {
+public:
+    explicit LoopScheduler(IoLoop& loop) : loop_(loop) {}
+
+    void schedule(std::coroutine_handle<> handle) override {
+        loop_.post([handle] { handle.resume(); });
+    }
+
+private:
+    IoLoop& loop_;
+};
+
+} // namespace
+
+struct RpcServer::LoopConnection {
+    // A request and its payload as it came, decoded on the pool
+    struct Received {
+        RpcMessage message;
+        std::vector<std::byte> stream;
+    };
+
+    int fd{-1};
+    RpcFrameHeader header{};               // Of the frame being received
+    EncodedBlockHeader block{};            // Of the payload block being received
+    std::size_t decoded{0};                // Payload bytes the received blocks decode to
+    Received reading;
+    std::deque<Received> queued;           // Received, waiting for the handler
+    bool receiving{false};                 // Operations in flight
+    bool handling{false};
+    bool sending{false};
+    bool closed{false};
+    bool zero_copy{false};                 // Remote TCP peer (loopback copies anyway)
+    std::string peer;                      // Address, copied into every request
+
+    // The request with the handler, and then its reply
+    RpcMethod method{};
+    std::uint64_t request_id{0};
+    std::chrono::steady_clock::time_point started;
+    RpcFrameHeader reply_header{};
+    Outgoing reply;
+    std::array<iovec, 3> parts{};
+    int buffer{-1};                        // Registered buffer the payload is sent from
+};
+
+RpcServer::RpcServer(Handler handler, RpcServerOptions options)
+    : handler_(std::move(handler)), options_(options) {
+    if (options_.io != IoBackend::Off) {
+        loop_ = IoLoop::create(options_.io);
+        scheduler_ = std::make_unique<LoopScheduler>(*loop_);
+        fixed_.resize(std::min(kFixedBuffers, loop_->buffer_slots()));
+    }
+}
+
+RpcServer::~RpcServer() {
+    stop();
+}
+
+void RpcServer::listen(const std::string& endpoint) {
+    listeners_.push_back(rpc_listen(endpoint));
+    endpoints_.push_back(endpoint);
+}
+
+void RpcServer::start() {
+    if (loop_) {
+        if (loop_thread_.joinable()) {
+            return;
+        }
+        draining_ = false;
+        pool_ = std::make_unique<Executor>(options_.codec_threads);
+        loop_->post([this] {
+            for (int listener : listeners_) {
+                accept_next(listener);
+            }
+        });
+        loop_thread_ = std::thread([this] { loop_->run(); });
+        return;
+    }
+    {
+        std::lock_guard lock(connections_mutex_);
+        stopping_ = false;
+    }
+    for (int listener : listeners_) {
+        acceptors_.emplace_back(&RpcServer::accept_loop, this, listener);
+    }
+}
+
+void RpcServer::stop() {
+    if (loop_) {
+        stop_loop();
+    } else {
+        {
+            std::lock_guard lock(connections_mutex_);
+            stopping_ = true;
+            for (auto& connection : connections_) {
+                connection.socket.shutdown();
+            }
+        }
+        for (int listener : listeners_) {
+            ::shutdown(listener, SHUT_RDWR);   // Wakes accept()
+        }
+        for (auto& acceptor : acceptors_) {
+            acceptor.join();
+        }
+        acceptors_.clear();
+
+        // Nothing adds or removes connections any more
+        for (auto& connection : connections_) {
+            connection.thread.join();
+        }
+        connections_.clear();
+    }
+
+    for (int listener : listeners_) {
+        ::close(listener);
+    }
+    listeners_.clear();
+    for (const auto& endpoint : endpoints_) {
+        if (endpoint.starts_with("unix:")) {
+            ::unlink(endpoint.c_str() + 5);
+        }
+    }
+    endpoints_.clear();
+}
+
+void RpcServer::accept_loop(int listener) {
+    while (true) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            {
+                std::lock_guard lock(connections_mutex_);
+                if (stopping_) {
+                    return;
+                }
+            }
+            // Out of descriptors or similar: back off instead of spinning
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   // Fails harmlessly on Unix sockets
+
+        std::lock_guard lock(connections_mutex_);
+        if (stopping_) {
+            ::close(fd);
+            return;
+        }
+        reap();
+        if (connections_.size() >= options_.max_connections) {
+            ::close(fd);   // A thread each: refuse rather than run out
+            continue;
+        }
+        auto& connection = connections_.emplace_back(Connection{RpcConnection(fd), {}, false, peer_address(fd)});
+        connection.thread = std::thread(&RpcServer::serve, this, std::ref(connection));
+    }
+}
+
+void RpcServer::serve(Connection& connection) {
+    open_.fetch_add(1, std::memory_order_relaxed);
+    RpcMessage request;
+    while (true) {
+        try {
+            if (!connection.socket.receive(request, options_.payload_bytes)) {
+                break;
+            }
+            request.peer = connection.peer;
+        } catch (const std::exception&) {
+            break;   // A broken or foreign client; drop the connection
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        RpcReply reply;
+        try {
+            reply = sync_wait(handler_(request));
+        } catch (const std::exception& e) {
+            reply = RpcReply{500, json{{"error", e.what()}}.dump(), {}, nullptr};
+        }
+
+        try {
+            Outgoing out = prepare(std::move(reply), request.accept);
+            if (out.stream) {
+                connection.socket.send_encoded(request.method, out.reply.status, request.request_id, out.reply.meta,
+                                               out.reply.payload.size_bytes(), out.encoding, *out.stream, out.accept);
+            } else {
+                connection.socket.send(request.method, out.reply.status, request.request_id, out.reply.meta,
+                                       out.reply.payload, ContentEncoding::Identity, out.accept);
+            }
+        } catch (const std::exception&) {
+            break;
+        }
+        rpc_seconds(request.method).observe(std::chrono::steady_clock::now() - start);
+    }
+    open_.fetch_sub(1, std::memory_order_relaxed);
+
+    std::lock_guard lock(connections_mutex_);
+    connection.done = true;
+}
+
+void RpcServer::reap() {
+    // Caller holds connections_mutex_; finished threads only have to return
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->done) {
+            it->thread.join();
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// =============================================================================
+// Encoded replies
+// =============================================================================
+
+RpcServer::Outgoing RpcServer::prepare(RpcReply reply, ContentEncoding accept) {
+    Outgoing out;
+    if (x_hydra(accept)) {
+        out.accept = accept;   // Decoding costs less than encoding: take what the client sends
+        if (!reply.payload.empty()) {
+            out.encoding = accept;
+            out.stream = encode(reply, accept);
+        }
+    }
+    out.reply = std::move(reply);
+    return out;
+}
+
+RpcServer::EncodedStream RpcServer::encode(const RpcReply& reply, ContentEncoding encoding) {
+    auto bytes = std::as_bytes(reply.payload);
+    auto run = [&] { return std::make_shared<const std::vector<std::byte>>(compress(encoding, bytes)); };
+    if (!reply.keep_alive) {
+        return run();   // Not shared: nothing to reuse
+    }
+
+    std::promise<EncodedStream> promise;
+    std::shared_future<EncodedStream> stream;
+    bool first = false;
+    {
+        std::lock_guard lock(encoded_mutex_);
+        ++encoded_clock_;
+        for (auto& entry : encoded_) {
+            if (entry.data == bytes.data() && entry.bytes == bytes.size() && entry.encoding == encoding) {
+                entry.used = encoded_clock_;
+                stream = entry.stream;
+                break;
+            }
+        }
+        if (!stream.valid()) {
+            // A new model version: it replaces the least recently sent payload
+            first = true;
+            stream = promise.get_future().share();
+            EncodedPayload entry{bytes.data(), bytes.size(), encoding, reply.keep_alive, stream, encoded_clock_};
+            if (encoded_.size() < kEncodedPayloads) {
+                encoded_.push_back(std::move(entry));
+            } else {
+                *std::min_element(encoded_.begin(), encoded_.end(), [](const auto& a, const auto& b) {
+                    return a.used < b.used;
+                }) = std::move(entry);
+            }
+        }
+    }
+    // Encoded outside the lock; replies for the same payload wait on the future
+    if (first) {
+        try {
+            promise.set_value(run());
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            std::lock_guard lock(encoded_mutex_);   // Let the next reply try again
+            std::erase_if(encoded_, [&](const EncodedPayload& entry) {
+                return entry.data == bytes.data() && entry.bytes == bytes.size() && entry.encoding == encoding;
+            });
+        }
+    }
+    return stream.get();
+}
+
+// =============================================================================
+// I/O loop mode
+// =============================================================================
+
+void RpcServer::stop_loop() {
+    if (!loop_thread_.joinable()) {
+        return;
+    }
+    // Stop accepting and reading; requests already with a handler finish
+    loop_->post([this] {
+        draining_ = true;
+        for (int listener : listeners_) {
+            loop_->cancel(listener);
+        }
+        std::vector<LoopConnection*> open;
+        for (auto& [fd, connection] : loop_connections_) {
+            open.push_back(connection.get());
+        }
+        for (LoopConnection* connection : open) {
+            close(*connection);
+        }
+        stop_if_drained();
+    });
+
+    // The loop returns once the last handler has replied and the last
+    // connection is released; only then is the pool idle
+    loop_thread_.join();
+    pool_.reset();
+    for (auto& buffer : fixed_) {
+        loop_->unregister_buffer(buffer.index);
+        buffer = FixedBuffer{};
+    }
+}
+
+void RpcServer::stop_if_drained() {
+    if (draining_ && accepting_ == 0 && loop_connections_.empty()) {
+        loop_->stop();
+    }
+}
+
+void RpcServer::accept_next(int listener) {
+    ++accepting_;
+    loop_->accept(listener, [this, listener](int fd) {
+        --accepting_;
+        if (draining_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            stop_if_drained();
+            return;
+        }
+        if (fd < 0) {
+            if (fd == -EINTR || fd == -EAGAIN || fd == -ECONNABORTED) {
+                accept_next(listener);
+                return;
+            }
+            // Out of descriptors or similar: back off instead of spinning,
+            // without holding up the loop
+            pool_->post([this, listener] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                loop_->post([this, listener] {
+                    if (!draining_) {
+                        accept_next(listener);
+                    }
+                });
+            });
+            return;
+        }
+        if (loop_connections_.size() >= options_.max_connections) {
+            ::close(fd);
+            accept_next(listener);
+            return;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));   // Fails harmlessly on Unix sockets
+
+        auto connection = std::make_unique<LoopConnection>();
+        connection->fd = fd;
+        connection->zero_copy = !fixed_.empty() && remote_peer(fd);
+        connection->peer = peer_address(fd);
+        LoopConnection& accepted = *connection;
+        loop_connections_[fd] = std::move(connection);
+        open_.fetch_add(1, std::memory_order_relaxed);
+        receive_next(accepted);
+        accept_next(listener);
+    });
+}
+
+void RpcServer::receive(LoopConnection& connection, void* data, std::size_t size, std::function<void(int)> next) {
+    connection.receiving = true;
+    loop_->recv(connection.fd, data, size, [this, &connection, size, next = std::move(next)](int received) {
+        connection.receiving = false;
+        if (connection.closed) {
+            release(connection);
+            return;
+        }
+        if (received < 0 || static_cast<std::size_t>(received) != size) {
+            close(connection);   // Gone, between frames or in the middle of one
+            return;
+        }
+        next(received);
+    });
+}
+
+void RpcServer::receive_next(LoopConnection& connection) {
+    receive(connection, &connection.header, sizeof(connection.header), [this, &connection](int) {
+        try {
+            rpc_check_header(connection.header);
+        } catch (const std::exception&) {
+            close(connection);   // A broken or foreign client
+            return;
+        }
+        if (options_.payload_bytes &&
+            connection.header.payload_bytes != options_.payload_bytes(static_cast<RpcMethod>(connection.header.method))) {
+            close(connection);   // Refused before anything is allocated for it
+            return;
+        }
+        RpcMessage& message = connection.reading.message;
+        message.method = static_cast<RpcMethod>(connection.header.method);
+        message.status = connection.header.status;
+        message.request_id = connection.header.request_id;
+        message.encoding = static_cast<ContentEncoding>(connection.header.encoding);
+        message.accept = static_cast<ContentEncoding>(connection.header.accept_encoding);
+        message.peer = connection.peer;
+        message.meta.resize(connection.header.meta_bytes);
+        // Straight into the buffer the parameters are used from
+        message.payload.resize(connection.header.payload_bytes / sizeof(float));
+
+        auto payload = [this, &connection](int) {
+            auto& values = connection.reading.message.payload;
+            if (values.empty()) {
+                received(connection);
+                return;
+            }
+            if (connection.reading.message.encoding != ContentEncoding::Identity) {
+                connection.decoded = 0;
+                receive_block(connection);
+                return;
+            }
+            receive(connection, values.data(), values.size() * sizeof(float),
+                    [this, &connection](int) { received(connection); });
+        };
+        if (message.meta.empty()) {
+            payload(0);
+        } else {
+            receive(connection, message.meta.data(), message.meta.size(), payload);
+        }
+    });
+}
+
+void RpcServer::receive_block(LoopConnection& connection) {
+    // Blocks are gathered as they come and decoded on the pool, keeping
+    // the loop thread free for I/O
+    std::size_t total = connection.reading.message.payload.size() * sizeof(float);
+    if (connection.decoded == total) {
+        received(connection);
+        return;
+    }
+    receive(connection, &connection.block, sizeof(connection.block), [this, &connection, total](int) {
+        try {
+            Decompressor::check(connection.block, total - connection.decoded);
+        } catch (const std::exception&) {
+            close(connection);
+            return;
+        }
+        auto& stream = connection.reading.stream;
+        std::size_t at = stream.size();
+        stream.resize(at + sizeof(connection.block) + connection.block.packed_bytes());
+        std::memcpy(stream.data() + at, &connection.block, sizeof(connection.block));
+        connection.decoded += connection.block.raw_bytes;
+        receive(connection, stream.data() + at + sizeof(connection.block), connection.block.packed_bytes(),
+                [this, &connection](int) { receive_block(connection); });
+    });
+}
+
+void RpcServer::received(LoopConnection& connection) {
+    connection.queued.push_back(std::move(connection.reading));
+    connection.reading = LoopConnection::Received{};
+    dispatch(connection);
+    // Read ahead while the handler works, up to a bound
+    if (connection.queued.size() < kMaxQueued) {
+        receive_next(connection);
+    }
+}
+
+void RpcServer::dispatch(LoopConnection& connection) {
+    // One request at a time per connection, so replies stay in order
+    if (connection.handling || connection.sending || connection.closed || connection.queued.empty()) {
+        return;
+    }
+    auto request = std::make_shared<LoopConnection::Received>(std::move(connection.queued.front()));
+    connection.queued.pop_front();
+    connection.handling = true;
+    connection.method = request->message.method;
+    connection.request_id = request->message.request_id;
+    connection.started = std::chrono::steady_clock::now();
+
+    // The handler starts right here on the loop thread; done runs there too
+    auto& received = *request;
+    spawn(handle(received.message, received.stream), *scheduler_,
+          [this, &connection, request = std::move(request)](Outgoing outgoing) {
+              reply(connection, std::move(outgoing));
+          });
+}
+
+Async<RpcServer::Outgoing> RpcServer::handle(RpcMessage& message, std::vector<std::byte>& stream) {
+    // Decoding and encoding cost milliseconds per megabyte: not on the loop
+    std::string failure;
+    if (!stream.empty()) {
+        try {
+            co_await offload(*pool_, [&] {
+                rpc_decode_payload(message.encoding, stream, std::as_writable_bytes(std::span(message.payload)));
+            });
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+        stream = {};
+        if (!failure.empty()) {
+            co_return prepare(RpcReply{400, json{{"error", failure}}.dump(), {}, nullptr}, message.accept);
+        }
+    }
+
+    RpcReply result;
+    try {
+        result = co_await handler_(message);
+    } catch (const std::exception& e) {
+        result = RpcReply{500, json{{"error", e.what()}}.dump(), {}, nullptr};
+    }
+
+    if (x_hydra(message.accept) && !result.payload.empty()) {
+        try {
+            co_return co_await offload(*pool_, [&] { return prepare(std::move(result), message.accept); });
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+        co_return prepare(RpcReply{500, json{{"error", failure}}.dump(), {}, nullptr}, message.accept);
+    }
+    co_return prepare(std::move(result), message.accept);
+}
+
+void RpcServer::reply(LoopConnection& connection, Outgoing outgoing) {
+    connection.handling = false;
+    if (connection.closed) {
+        release(connection);
+        return;
+    }
+    const RpcReply& reply = outgoing.reply;
+    try {
+        connection.reply_header = rpc_frame_header(connection.method, reply.status, connection.request_id,
+                                                   reply.meta.size(), reply.payload.size_bytes(),
+                                                   outgoing.encoding, outgoing.accept);
+    } catch (const std::exception&) {
+        close(connection);
+        return;
+    }
+    connection.reply = std::move(outgoing);
+    // An encoded payload goes out from the shared stream, and is registered
+    // in its place
+    std::span<const std::byte> payload = std::as_bytes(connection.reply.reply.payload);
+    std::shared_ptr<const void> owner = connection.reply.reply.keep_alive;
+    if (connection.reply.stream) {
+        payload = *connection.reply.stream;
+        owner = connection.reply.stream;
+    }
+    connection.parts = {{
+        {&connection.reply_header, sizeof(RpcFrameHeader)},
+        {connection.reply.reply.meta.data(), connection.reply.reply.meta.size()},
+        {const_cast<std::byte*>(payload.data()), payload.size()},
+    }};
+    connection.buffer = connection.zero_copy ? fixed_buffer(payload, owner) : -1;
+    connection.sending = true;
+
+    loop_->send(connection.fd, connection.parts, [this, &connection](int result) {
+        connection.sending = false;
+        if (connection.buffer >= 0) {
+            for (auto& buffer : fixed_) {
+                if (buffer.index == connection.buffer) {
+                    --buffer.sends;
+                    break;
+                }
+            }
+            connection.buffer = -1;
+        }
+        connection.reply = Outgoing{};   // Drops keep_alive
+        if (connection.closed) {
+            release(connection);
+            return;
+        }
+        if (result < 0) {
+            close(connection);
+            return;
+        }
+        rpc_seconds(connection.method).observe(std::chrono::steady_clock::now() - connection.started);
+        dispatch(connection);
+        if (!connection.receiving && connection.queued.size() < kMaxQueued) {
+            receive_next(connection);   // Reading had paused at the bound
+        }
+    }, connection.buffer);
+}
+
+void RpcServer::close(LoopConnection& connection) {
+    if (!connection.closed) {
+        connection.closed = true;
+        ::shutdown(connection.fd, SHUT_RDWR);   // Ends the receive and send in flight
+        if (connection.receiving || connection.sending) {
+            loop_->cancel(connection.fd);
+        }
+    }
+    release(connection);
+}
+
+void RpcServer::release(LoopConnection& connection) {
+    // Callers return right after: this may destroy the connection
+    if (connection.receiving || connection.handling || connection.sending) {
+        return;
+    }
+    int fd = connection.fd;
+    loop_->close(fd);
+    loop_connections_.erase(fd);
+    open_.fetch_sub(1, std::memory_order_relaxed);
+    stop_if_drained();
+}
+
+int RpcServer::fixed_buffer(std::span<const std::byte> payload, const std::shared_ptr<const void>& owner) {
+    if (fixed_.empty() || !owner || payload.size() < kFixedMinBytes) {
+        return -1;
+    }
+    ++fixed_clock_;
+    FixedBuffer* victim = nullptr;
+    for (auto& buffer : fixed_) {
+        if (buffer.data == payload.data() && buffer.bytes == payload.size()) {
+            ++buffer.sends;
+            buffer.used = fixed_clock_;
+            return buffer.index;
+        }
+        if (buffer.sends == 0 && (!victim || buffer.used < victim->used)) {
+            victim = &buffer;
+        }
+    }
+    if (!victim) {
+        return -1;   // Every slot is busy sending another payload
+    }
+
+    // A new model version: it replaces the least recently sent one
+    loop_->unregister_buffer(victim->index);
+    *victim = FixedBuffer{};
+    int index = loop_->register_buffer(payload);
+    if (index < 0) {
+        // Over RLIMIT_MEMLOCK or too large for the ring; give up the slot
+        fixed_.erase(fixed_.begin() + (victim - fixed_.data()));
+        if (fixed_.empty()) {
+            std::cerr << "⚠ RPC: cannot register " << payload.size()
+                      << "-byte payloads with io_uring; sending them with copies" << std::endl;
+        }
+        return -1;
+    }
+    *victim = FixedBuffer{payload.data(), payload.size(), owner, index, 1, fixed_clock_};
+    return index;
+}
+
+} // namespace hydra
@@ -0,0 +1,1568 @@
+/**
+ * @file server.cpp
+ * @brief Implementation of CoordinatorServer
+ */
+
+#include "hydra/server.hpp"
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+namespace hydra {
+
+using json = nlohmann::json;
+
+namespace {
+
+// Same examples as TRAINING_DATA in config.py
+const std::vector<std::string> kDefaultTrainingData = {
+    "The quick brown fox jumps over the lazy dog",
+    "Python is a great programming language for beginners",
+    "Machine learning models learn patterns from data",
+    "Neural networks are inspired by the human brain",
+    "Distributed computing allows many computers to work together",
+    "Blockchain technology enables decentralized systems",
+    "Deep learning has revolutionized artificial intelligence",
+    "Natural language processing helps computers understand text",
+    "Computer vision allows machines to interpret images",
+    "Reinforcement learning trains agents through rewards",
+    "Data science combines statistics and programming",
+    "Cloud computing provides scalable infrastructure",
+    "Artificial intelligence is transforming many industries",
+    "Open source software encourages collaboration",
+    "Version control systems help manage code changes",
+};
+
+// How long a relay has from /relay/reserve to deliver the aggregate
+constexpr std::chrono::seconds kRelayBatchTtl{60};
+
+void send_json(httplib::Response& res, int status, const json& body) {
+    res.status = status;
+    res.set_content(body.dump(), "application/json");
+}
+
+void send_reply(httplib::Response& res, WorkerReply reply) {
+    res.status = reply.status;
+    res.set_content(std::move(reply.body), "application/json");
+}
+
+WorkerReply json_reply(int status, const json& body) {
+    return WorkerReply{status, body.dump()};
+}
+
+// Why CoordinatorServer::check_submitter() refused a completion
+const char* submit_error(int status) {
+    switch (status) {
+        case 403: return "Task is not leased to this worker";
+        case 404: return "Task not found";
+        default:  return "Task already completed";
+    }
+}
+
+// Parse a small JSON request body; returns a discarded value on error
+json parse_body(const httplib::Request& req) {
+    json body = json::parse(req.body, nullptr, false);
+    if (!body.is_discarded() && !body.is_object()) {
+        return json::parse("", nullptr, false);
+    }
+    return body;
+}
+
+// A string member of a JSON object, empty if absent or not a string
+std::string json_member_string(const json& object, const char* key) {
+    auto it = object.is_object() ? object.find(key) : object.end();
+    return it != object.end() && it->is_string() ? it->get<std::string>() : std::string();
+}
+
+// 128 random bits as hex, for handles a client must not be able to guess
+std::string random_token() {
+    std::random_device device;
+    std::ostringstream token;
+    token << std::hex << std::setfill('0');
+    for (int i = 0; i < 4; ++i) {
+        token << std::setw(8) << device();
+    }
+    return token.str();
+}
+
+// 429 with Retry-After in whole seconds (at least 1)
+void send_too_many(httplib::Response& res, std::chrono::nanoseconds wait, const std::string& message) {
+    auto seconds = std::max<long long>(1, std::chrono::ceil<std::chrono::seconds>(wait).count());
+    res.set_header("Retry-After", std::to_string(seconds));
+    send_json(res, 429, {{"error", message}, {"retry_after", seconds}});
+}
+
+// Responses by status class, latency and bytes of one route
+struct RouteMetrics {
+    std::array<Counter*, 5> responses;   // 1xx .. 5xx
+    Histogram* seconds;
+    Counter* received;
+    Counter* sent;
+
+    explicit RouteMetrics(const std::string& route) {
+        auto& registry = metrics();
+        for (std::size_t i = 0; i < responses.size(); ++i) {
+            responses[i] = &registry.counter("hydra_http_requests_total", "HTTP requests by route and status class",
+                                             {{"route", route}, {"code", std::to_string(i + 1) + "xx"}});
+        }
+        seconds = &registry.histogram("hydra_http_request_seconds", "HTTP request latency by route",
+                                      {{"route", route}});
+        received = &registry.counter("hydra_http_received_bytes_total", "HTTP request body bytes by route",
+                                     {{"route", route}});
+        sent = &registry.counter("hydra_http_sent_bytes_total", "HTTP response body bytes by route",
+                                 {{"route", route}});
+    }
+};
+
+httplib::Server::Handler instrumented(const std::string& route, httplib::Server::Handler handler) {
+    auto stats = std::make_shared<RouteMetrics>(route);
+    return [stats, handler = std::move(handler)](const httplib::Request& req, httplib::Response& res) {
+        auto start = std::chrono::steady_clock::now();
+        handler(req, res);
+        stats->seconds->observe(std::chrono::steady_clock::now() - start);
+        stats->responses[static_cast<std::size_t>(std::clamp(res.status / 100, 1, 5) - 1)]->add();
+        stats->received->add(req.body.size());
+        stats->sent->add(res.body.empty() ? res.content_length_ : res.body.size());   // Streamed bodies
+    };
+}
+
+// The newest checkpoint plus the versions logged after it, if there is
+// one, else a freshly initialized model
+std::shared_ptr<ModelState> initial_model(const ServerConfig& config) {
+    if (config.checkpoint.enabled()) {
+        if (auto restored = load_latest_checkpoint(config.checkpoint.dir, config.model)) {
+            std::uint64_t checkpointed = restored->version();
+            std::size_t records = replay_model_log(model_log_path(config.checkpoint.dir, checkpointed), *restored);
+            std::cout << "✓ Restored model version " << restored->version() << " from "
+                      << config.checkpoint.dir << " (checkpoint " << checkpointed << " + "
+                      << records << " logged versions)" << std::endl;
+            return std::make_shared<ModelState>(std::move(*restored));
+        }
+    }
+    return std::make_shared<ModelState>(ModelState::create(config.model));
+}
+
+std::string iso_timestamp() {
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    std::ostringstream oss;
+    oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%SZ");
+    return oss.str();
+}
+
+} // namespace
+
+// =============================================================================
+// Constructor and Destructor
+// =============================================================================
+
+CoordinatorServer::CoordinatorServer(ServerConfig config)
+    : config_(std::move(config)),
+      db_(config_.db_path),
+      corpus_(config_.corpus_dir.empty() ? nullptr : std::make_unique<CorpusStore>(config_.corpus_dir)),
+      tokens_(config_.token_path.empty() ? nullptr : std::make_unique<TokenDataset>(config_.token_path)),
+      aggregator_(initial_model(config_), config_.rounds,
+                  [this](std::uint64_t) {
+                      if (checkpointer_) {
+                          checkpointer_->notify();
+                      }
+                  }),
+      ring_(config_.cluster.enabled() ? std::make_unique<HashRing>(config_.cluster.peers) : nullptr),
+      cluster_(config_.cluster.enabled() ? std::make_unique<ClusterSync>(config_.cluster, aggregator_) : nullptr),
+      checkpointer_(config_.checkpoint.enabled()
+                        ? std::make_unique<Checkpointer>(config_.checkpoint, [this] { return aggregator_.snapshot(); })
+                        : nullptr),
+      waiters_(config_.max_task_waiters),
+      refiller_(db_, db_mutex_, [this](std::size_t count) { return make_tasks(count); },
+                config_.refill, [this](std::size_t count) { waiters_.notify(count); }),
+      limiter_(config_.rate_limit),
+      submit_limit_(config_.max_concurrent_submits),
+      query_limit_(config_.max_concurrent_queries),
+      heartbeats_(config_.heartbeat,
+                  [this](const std::string& user_id, bool online) { on_worker_state(user_id, online); }),
+      sizer_(config_.task_sizing, config_.token_path.empty() ? config_.examples_per_task : config_.task_tokens),
+      speculator_(config_.speculation),
+      storage_(1),
+      compute_(std::max(2u, std::thread::hardware_concurrency())),
+      responses_(config_.response_cache),
+      http_(std::make_unique<httplib::Server>()),
+      rng_(std::random_device{}()) {
+    if (config_.training_data.empty()) {
+        config_.training_data = kDefaultTrainingData;
+    }
+    if (tokens_ && tokens_->vocab_size() > static_cast<std::uint64_t>(config_.model.vocab_size)) {
+        throw std::runtime_error("Token dataset vocabulary is larger than the model's");
+    }
+    inference_ = std::make_unique<InferenceService>([this] { return aggregator_.snapshot(); },
+                                                    make_query_tokenizer(), config_.inference);
+    if (!config_.rpc_endpoints.empty()) {
+        RpcServerOptions rpc_options;
+        rpc_options.io = config_.io_loop;
+        rpc_options.codec_threads = std::max(2u, std::thread::hardware_concurrency() / 2);
+        // Only uploads carry parameters, and exactly the model's; any other
+        // size is refused before the payload is read, let alone authenticated
+        rpc_options.payload_bytes = [this](RpcMethod method) -> std::uint64_t {
+            if (method != RpcMethod::SubmitResult && method != RpcMethod::RelaySubmit) {
+                return 0;
+            }
+            return aggregator_.snapshot()->values().size_bytes();
+        };
+        rpc_ = std::make_unique<RpcServer>([this](RpcMessage& request) { return handle_rpc(request); },
+                                           rpc_options);
+        for (const auto& endpoint : config_.rpc_endpoints) {
+            rpc_->listen(endpoint);
+        }
+    }
+    register_metrics();
+
+    // Parked long-polls and queries waiting for their batch hold a thread
+    // each; keep the usual pool on top of them
+    std::size_t threads = std::max(8u, std::thread::hardware_concurrency()) +
+                          config_.max_task_waiters + config_.max_concurrent_queries;
+    http_->new_task_queue = [threads] { return new httplib::ThreadPool(threads); };
+    setup_routes();
+}
+
+CoordinatorServer::~CoordinatorServer() {
+    metrics().remove_callbacks(this);
+    stop();
+    if (rpc_) {
+        rpc_->stop();
+    }
+    if (cluster_) {
+        cluster_->stop();
+    }
+    if (checkpointer_) {
+        checkpointer_->stop();
+    }
+    inference_->stop();
+    heartbeats_.stop();
+    refiller_.stop();
+}
+
+bool CoordinatorServer::run() {
+    auto model = aggregator_.snapshot();
+
+    std::cout << "\n==================================================\n"
+              << "🚀 HydraAI Coordinator Server Starting\n"
+              << "==================================================\n"
+              << "Server: http://" << config_.host << ":" << config_.port << "\n"
+              << "Model: " << model->values().size() << " parameters\n"
+              << "Training data: " << (tokens_
+                     ? std::to_string(tokens_->num_tokens()) + " tokens in " +
+                       std::to_string(tokens_->num_docs()) + " documents"
+                     : corpus_
+                     ? std::to_string(corpus_->total_records()) + " records in " +
+                       std::to_string(corpus_->shards().size()) + " corpus shards"
+                     : std::to_string(config_.training_data.size()) + " built-in examples") << "\n"
+              << "Aggregation: " << aggregation_rule_name(config_.rounds.aggregation.rule)
+              << " over rounds of " << config_.rounds.round_size << "\n"
+              << "Queries: batches of up to " << config_.inference.max_batch << ", "
+              << config_.inference.max_wait.count() << " ms max wait\n"
+              << "==================================================\n" << std::endl;
+
+    // Leases held by workers that were already offline when the previous
+    // process stopped have nobody left to time them out
+    int orphaned;
+    {
+        std::lock_guard lock(db_mutex_);
+        orphaned = db_.requeue_orphaned_tasks();
+    }
+    if (orphaned > 0) {
+        std::cout << "✓ Requeued " << orphaned << " orphaned tasks" << std::endl;
+    }
+
+    refiller_.start();
+    std::cout << "✓ Task queue at " << refiller_.pending() << " pending tasks" << std::endl;
+
+    // Workers that were online before a restart get one timeout to check in
+    // before their tasks are requeued
+    std::vector<std::string> known;
+    {
+        std::lock_guard lock(db_mutex_);
+        known = db_.get_workers("online");
+    }
+    for (const auto& user_id : known) {
+        heartbeats_.beat(user_id);
+    }
+    heartbeats_.start();
+    inference_->start();
+
+    if (cluster_) {
+        std::cout << "✓ Cluster node " << config_.cluster.self << " of " << config_.cluster.peers.size()
+                  << (cluster_->leader() ? " (leader, averaging every " +
+                          std::to_string(config_.cluster.sync_interval.count() / 1000) + " s)" : "")
+                  << std::endl;
+        cluster_->start();
+    }
+
+    if (checkpointer_) {
+        std::cout << "✓ Checkpointing to " << config_.checkpoint.dir << " every "
+                  << config_.checkpoint.interval.count() / 1000 << " s" << std::endl;
+        checkpointer_->start();
+    }
+
+    if (rpc_) {
+        rpc_->start();
+        for (const auto& endpoint : rpc_->endpoints()) {
+            std::cout << "✓ Binary RPC on " << endpoint;
+            if (rpc_->backend() != IoBackend::Off) {
+                std::cout << " (" << io_backend_name(rpc_->backend()) << ")";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    std::chrono::duration<double> recovery = std::chrono::steady_clock::now() - started_;
+    metrics().gauge("hydra_recovery_seconds", "Time from process start until requests are served").set(recovery.count());
+    std::cout << "✓ Ready in " << static_cast<long long>(recovery.count() * 1000) << " ms" << std::endl;
+
+    bool ok = http_->listen(config_.host, config_.port);
+    if (rpc_) {
+        rpc_->stop();
+    }
+    if (cluster_) {
+        cluster_->stop();
+    }
+    if (checkpointer_) {
+        checkpointer_->stop();   // Writes the last aggregated version
+    }
+    inference_->stop();
+    heartbeats_.stop();
+    refiller_.stop();
+    return ok;
+}
+
+void CoordinatorServer::stop() {
+    waiters_.shutdown();
+    if (http_) {
+        http_->stop();
+    }
+}
+
+void CoordinatorServer::register_metrics() {
+    // Read at scrape time; nothing on the request path mirrors these
+    auto& registry = metrics();
+    auto gauge = [&](const std::string& name, const std::string& help, std::function<double()> read,
+                     const MetricLabels& labels = {}) {
+        registry.callback(name, help, MetricType::Gauge, std::move(read), labels, this);
+    };
+    auto counter = [&](const std::string& name, const std::string& help, std::function<double()> read,
+                       const MetricLabels& labels = {}) {
+        registry.callback(name, help, MetricType::Counter, std::move(read), labels, this);
+    };
+
+    gauge("hydra_model_version", "Version of the current model snapshot",
+          [this] { return static_cast<double>(aggregator_.snapshot()->version()); });
+    counter("hydra_aggregation_rounds_total", "Rounds aggregated into a new model version",
+            [this] { return static_cast<double>(aggregator_.rounds()); });
+    if (checkpointer_) {
+        gauge("hydra_checkpoint_version", "Model version of the newest checkpoint",
+              [this] { return static_cast<double>(checkpointer_->last_version()); });
+        gauge("hydra_model_log_version", "Newest model version in the model log",
+              [this] { return static_cast<double>(checkpointer_->logged_version()); });
+    }
+    if (rpc_) {
+        gauge("hydra_rpc_connections", "Open binary RPC connections",
+              [this] { return static_cast<double>(rpc_->connections()); });
+        if (rpc_->backend() != IoBackend::Off) {
+            counter("hydra_io_syscalls_total", "Syscalls made by the RPC I/O loop",
+                    [this] { return static_cast<double>(rpc_->io_stats().syscalls); });
+        }
+    }
+    gauge("hydra_updates_buffered", "Worker updates waiting for their round to fill",
+          [this] { return static_cast<double>(aggregator_.buffered()); });
+    gauge("hydra_tasks_pending", "Pending tasks in the queue (refiller's estimate)",
+          [this] { return static_cast<double>(refiller_.pending()); });
+    gauge("hydra_task_waiters", "get_task long-polls parked for a task",
+          [this] { return static_cast<double>(waiters_.waiting()); });
+    gauge("hydra_workers_online", "Workers with a recent heartbeat",
+          [this] { return static_cast<double>(heartbeats_.online()); });
+    gauge("hydra_workers_sized", "Workers whose tasks are sized to their measured throughput",
+          [this] { return static_cast<double>(sizer_.estimated()); });
+    if (speculator_.enabled()) {
+        counter("hydra_speculative_copies_total", "Straggling tasks also leased to a faster worker",
+                [this] { return static_cast<double>(speculator_.copies()); });
+        counter("hydra_speculative_wins_total", "Tasks completed by a speculative copy first",
+                [this] { return static_cast<double>(speculator_.wins()); });
+    }
+    counter("hydra_duplicate_results_total", "Results dropped because their task was already completed",
+            [this] { return static_cast<double>(speculator_.discards()); });
+    gauge("hydra_inference_queue_depth", "Queries waiting for an inference batch",
+          [this] { return static_cast<double>(inference_->queued()); });
+    counter("hydra_inference_batches_total", "Inference batches run",
+            [this] { return static_cast<double>(inference_->batches()); });
+    counter("hydra_inference_queries_total", "Queries answered by the model",
+            [this] { return static_cast<double>(inference_->queries()); });
+    counter("hydra_response_cache_hits_total", "Queries answered from the response cache",
+            [this] { return static_cast<double>(responses_.hits()); }, {{"tier", "memory"}});
+    counter("hydra_response_cache_hits_total", "Queries answered from the response cache",
+            [this] { return static_cast<double>(responses_.spill_hits()); }, {{"tier", "spill"}});
+    counter("hydra_response_cache_misses_total", "Cacheable queries that had to be generated",
+            [this] { return static_cast<double>(responses_.misses()); });
+    counter("hydra_response_cache_evictions_total", "Cached answers pushed out of memory",
+            [this] { return static_cast<double>(responses_.evictions()); });
+    gauge("hydra_response_cache_bytes", "Memory held by cached answers",
+          [this] { return static_cast<double>(responses_.bytes()); });
+}
+
+// =============================================================================
+// Routes
+// =============================================================================
+
+void CoordinatorServer::setup_routes() {
+    // The rate limit runs before routing, when only the headers have been
+    // read, so a client over its limit never gets to upload a body
+    http_->set_pre_routing_handler([this](const httplib::Request& req, httplib::Response& res) {
+        return admit(req, res) ? httplib::Server::HandlerResponse::Unhandled
+                               : httplib::Server::HandlerResponse::Handled;
+    });
+
+    // Expensive routes also need a free concurrency slot
+    using Handler = void (CoordinatorServer::*)(const httplib::Request&, httplib::Response&);
+    auto route = [this](Handler handler, ConcurrencyLimit* limit = nullptr) {
+        return [this, handler, limit](const httplib::Request& req, httplib::Response& res) {
+            ConcurrencyLimit::Permit permit;
+            if (limit && !(permit = limit->try_acquire())) {
+                send_too_many(res, std::chrono::seconds(1), "Server busy, try again shortly");
+                return;
+            }
+            (this->*handler)(req, res);
+        };
+    };
+
+    // Every route is counted and timed under its pattern
+    auto get = [this](const std::string& pattern, httplib::Server::Handler handler) {
+        http_->Get(pattern, instrumented(pattern, std::move(handler)));
+    };
+    auto post = [this](const std::string& pattern, httplib::Server::Handler handler) {
+        http_->Post(pattern, instrumented(pattern, std::move(handler)));
+    };
+
+    get("/health", [this](const httplib::Request& req, httplib::Response& res) {
+        handle_health(req, res);
+    });
+    get("/metrics", [this](const httplib::Request& req, httplib::Response& res) {
+        handle_metrics(req, res);
+    });
+    post("/heartbeat", route(&CoordinatorServer::handle_heartbeat));
+    get("/workers", route(&CoordinatorServer::handle_workers));
+    post("/register", route(&CoordinatorServer::handle_register));
+    post("/get_task", route(&CoordinatorServer::handle_get_task));
+    post("/submit_result", route(&CoordinatorServer::handle_submit_result, &submit_limit_));
+    post("/get_balance", route(&CoordinatorServer::handle_get_balance));
+    post("/query_model", route(&CoordinatorServer::handle_query_model, &query_limit_));
+    get("/corpus/manifest", route(&CoordinatorServer::handle_corpus_manifest));
+    get(R"(/corpus/shard/(\d+))", route(&CoordinatorServer::handle_corpus_shard));
+    get("/dataset/manifest", route(&CoordinatorServer::handle_dataset_manifest));
+    get("/dataset/tokens", route(&CoordinatorServer::handle_dataset_tokens));
+    get("/dataset/vocab", route(&CoordinatorServer::handle_dataset_vocab));
+    get("/model/config", route(&CoordinatorServer::handle_model_config));
+
+    // A relay speaks for many users, so it is not rate limited per client,
+    // but its aggregates share the submit concurrency limit
+    post("/relay/reserve", [this](const httplib::Request& req, httplib::Response& res) {
+        handle_relay_reserve(req, res);
+    });
+    post("/relay/submit", [this](const httplib::Request& req, httplib::Response& res) {
+        auto permit = submit_limit_.try_acquire();
+        if (!permit) {
+            send_too_many(res, std::chrono::seconds(1), "Server busy, try again shortly");
+            return;
+        }
+        handle_relay_submit(req, res);
+    });
+
+    // Peer-to-peer model averaging; not subject to per-client limits
+    if (cluster_) {
+        get("/cluster/model", [this](const httplib::Request& req, httplib::Response& res) {
+            handle_cluster_model_get(req, res);
+        });
+        post("/cluster/model", [this](const httplib::Request& req, httplib::Response& res) {
+            handle_cluster_model_post(req, res);
+        });
+    }
+}
+
+bool CoordinatorServer::admit(const httplib::Request& req, httplib::Response& res) {
+    // A relay rewards tasks for any user: it is checked before its batch
+    // is read, then exempt from the per-client limit like probes and
+    // cluster peers
+    if (req.path.starts_with("/relay/")) {
+        if (!credentials_match(config_.relay_secret, req.get_header_value(kRelaySecretHeader))) {
+            send_json(res, 403, {{"error", "Relay secret missing or wrong"}});
+            return false;
+        }
+        return true;
+    }
+    if (req.path == "/health" || req.path == "/metrics" || req.path == "/cluster/model") {
+        return true;
+    }
+
+    // Keyed on the connection's address: the user_id in the body is
+    // whatever the client chooses to write there, and is not read yet
+    auto wait = limiter_.acquire(req.remote_addr);
+    if (wait.count() == 0) {
+        return true;
+    }
+    static Counter& rejected = metrics().counter("hydra_http_rate_limited_total",
+                                                 "HTTP requests rejected by the per-address rate limit");
+    rejected.add();
+    send_too_many(res, wait, "Rate limit exceeded");
+    return false;
+}
+
+void CoordinatorServer::handle_health(const httplib::Request&, httplib::Response& res) {
+    send_json(res, 200, {{"status", "healthy"},
+                         {"timestamp", iso_timestamp()},
+                         {"workers_online", heartbeats_.online()}});
+}
+
+void CoordinatorServer::handle_metrics(const httplib::Request&, httplib::Response& res) {
+    res.status = 200;
+    res.set_content(metrics().render(), "text/plain; version=0.0.4; charset=utf-8");
+}
+
+void CoordinatorServer::handle_heartbeat(const httplib::Request& req, httplib::Response& res) {
+    json body = parse_body(req);
+    std::string user_id = body.is_discarded() ? "" : body.value("user_id", "");
+    if (user_id.empty()) {
+        send_json(res, 400, {{"error", "user_id is required"}});
+        return;
+    }
+    if (redirect_to_owner(user_id, req, res)) {
+        return;
+    }
+    send_reply(res, worker_heartbeat(user_id));
+}
+
+void CoordinatorServer::handle_workers(const httplib::Request&, httplib::Response& res) {
+    send_json(res, 200, {{"online", heartbeats_.online()},
+                         {"workers", heartbeats_.online_workers(100)}});
+}
+
+void CoordinatorServer::handle_register(const httplib::Request& req, httplib::Response& res) {
+    json body = parse_body(req);
+    std::string user_id = body.is_discarded() ? "" : body.value("user_id", "");
+    if (user_id.empty()) {
+        send_json(res, 400, {{"error", "user_id is required"}});
+        return;
+    }
+    if (redirect_to_owner(user_id, req, res)) {
+        return;
+    }
+    send_reply(res, register_worker(user_id));
+}
+
+void CoordinatorServer::handle_get_task(const httplib::Request& req, httplib::Response& res) {
+    json body = parse_body(req);
+    std::string user_id = body.is_discarded() ? "" : body.value("user_id", "");
+    if (user_id.empty()) {
+        send_json(res, 400, {{"error", "user_id is required"}});
+        return;
+    }
+    if (redirect_to_owner(user_id, req, res)) {
+        return;
+    }
+
+    double wait_seconds = body.contains("wait") && body["wait"].is_number() ? body["wait"].get<double>() : 0.0;
+    std::optional<Task> task;
+    WorkerReply reply = sync_wait(lease_task(user_id, wait_seconds, task));
+    if (!task) {
+        send_reply(res, std::move(reply));
+        return;
+    }
+
+    // Splice the cached parameter JSON into the response instead of
+    // building a JSON tree with millions of numbers
+    auto model = aggregator_.snapshot();
+    auto parameters = model_json(*model);
+    json head = {
+        {"task_id", task->task_id},
+        {"data_batch", task->data_batch},
+        {"tokens_reward", task->tokens_reward},
+        {"model_version", model->version()},
+        {"instructions", "Train the model on this data batch and return the updated parameters"},
+    };
+
+    std::string response = head.dump();
+    response.pop_back();   // Drop the closing brace
+    response += ",\"model_parameters\":";
+
+    res.status = 200;
+    res.set_header("Accept-Encoding", "gzip");   // Uploads may be gzipped (RFC 7694)
+    res.set_header("Vary", "Accept-Encoding");
+    const ContentEncoding offered[] = {ContentEncoding::Gzip};
+    if (negotiate_encoding(req.get_header_value("Accept-Encoding"), offered) != ContentEncoding::Gzip) {
+        response.reserve(response.size() + parameters->size() + 1);
+        response += *parameters;
+        response += '}';
+        res.set_content(std::move(response), "application/json");
+        return;
+    }
+
+    // The parameters are deflated once per version; only the few hundred
+    // bytes around them are compressed per request
+    auto packed = model_gzip(*model);
+    DeflateSegment head_segment = deflate_segment(response);
+    DeflateSegment tail_segment = deflate_segment("}");
+    auto prefix = std::make_shared<const std::string>(gzip_header() + head_segment.data);
+    auto suffix = std::make_shared<const std::string>(
+        tail_segment.data + gzip_trailer({&head_segment, packed.get(), &tail_segment}));
+    res.set_header("Content-Encoding", "gzip");
+    res.set_content_provider(
+        prefix->size() + packed->data.size() + suffix->size(), "application/json",
+        [prefix, packed, suffix](std::size_t offset, std::size_t length, httplib::DataSink& sink) {
+            constexpr std::size_t kChunk = 1 << 20;
+            for (const std::string* part : {prefix.get(), &packed->data, suffix.get()}) {
+                if (offset < part->size()) {
+                    return sink.write(part->data() + offset, std::min({length, kChunk, part->size() - offset}));
+                }
+                offset -= part->size();
+            }
+            return false;
+        });
+}
+
+void CoordinatorServer::handle_submit_result(const httplib::Request& req, httplib::Response& res) {
+    // Parameter uploads are tens of megabytes, so only the members we need
+    // are located and the parameters are parsed straight into a float buffer
+    std::string_view body = req.body;
+    std::string user_id = json_string_value(find_json_member(body, "user_id"));
+    std::string task_id = json_string_value(find_json_member(body, "task_id"));
+    std::string_view parameters = find_json_member(body, "updated_parameters");
+
+    if (user_id.empty() || task_id.empty() || parameters.empty()) {
+        send_json(res, 400, {{"error", "Missing required fields"}});
+        return;
+    }
+    if (redirect_to_owner(task_id, req, res)) {
+        return;
+    }
+    if (task_completed(task_id)) {
+        // Already done (by the other copy, if it was speculated): drop it
+        // before parsing
+        speculator_.lost(task_id, user_id);
+        send_json(res, 409, {{"error", "Task already completed"}, {"tokens_earned", 0.0}});
+        return;
+    }
+
+    auto base = aggregator_.snapshot();
+    std::vector<float> update(base->values().begin(), base->values().end());
+    try {
+        base->parse_json(parameters, update);
+    } catch (const std::runtime_error& e) {
+        send_json(res, 400, {{"error", std::string("Invalid parameters: ") + e.what()}});
+        return;
+    }
+    send_reply(res, sync_wait(complete_task(user_id, task_id, base->version(), std::move(update))));
+}
+
+void CoordinatorServer::handle_get_balance(const httplib::Request& req, httplib::Response& res) {
+    json body = parse_body(req);
+    std::string user_id = body.is_discarded() ? "" : body.value("user_id", "");
+    if (user_id.empty()) {
+        send_json(res, 400, {{"error", "user_id is required"}});
+        return;
+    }
+    if (redirect_to_owner(user_id, req, res)) {
+        return;
+    }
+    send_reply(res, worker_balance(user_id));
+}
+
+void CoordinatorServer::handle_query_model(const httplib::Request& req, httplib::Response& res) {
+    json body = parse_body(req);
+    std::string user_id = body.is_discarded() ? "" : body.value("user_id", "");
+    std::string prompt = body.is_discarded() ? "" : body.value("prompt", "");
+    if (user_id.empty() || prompt.empty()) {
+        send_json(res, 400, {{"error", "user_id and prompt are required"}});
+        return;
+    }
+    if (redirect_to_owner(user_id, req, res)) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(db_mutex_);
+        auto user = db_.get_user(user_id);
+        if (!user) {
+            send_json(res, 404, {{"error", "User not registered"}});
+            return;
+        }
+        if (user->total_tokens < config_.query_cost) {
+            send_json(res, 402, {{"error", "Insufficient tokens"},
+                                 {"required", config_.query_cost},
+                                 {"balance", user->total_tokens}});
+            return;
+        }
+    }
+
+    // Optional decoding controls; absent means 20 greedy tokens
+    GenerationOptions generation;
+    auto number = [&body](const char* key, double fallback) {
+        return body.contains(key) && body[key].is_number() ? body[key].get<double>() : fallback;
+    };
+    generation.max_new_tokens = static_cast<std::size_t>(std::clamp(number("max_tokens", 20.0), 0.0, 256.0));
+    generation.sampling.temperature = static_cast<float>(std::max(number("temperature", 0.0), 0.0));
+    generation.sampling.top_k = static_cast<std::size_t>(std::max(number("top_k", 0.0), 0.0));
+    generation.sampling.top_p = static_cast<float>(std::clamp(number("top_p", 1.0), 0.0, 1.0));
+    generation.sampling.seed = static_cast<std::uint64_t>(std::max(number("seed", 0.0), 0.0));
+
+    // Repeated prompts are answered from the cache, keyed on the version
+    // that is current now; a miss is generated and remembered under the
+    // version that actually produced it
+    std::uint64_t version = aggregator_.snapshot()->version();
+    InferenceResult answer;
+    bool cached = false;
+    if (auto hit = responses_.lookup(prompt, generation, version)) {
+        answer.text = std::move(hit->text);
+        answer.tokens = hit->tokens;
+        answer.finish = hit->finish;
+        answer.model_version = version;
+        cached = true;
+    } else {
+        // Runs on an inference thread, batched with concurrent queries; the
+        // database is not held meanwhile
+        auto pending = inference_->submit(prompt, generation);
+        if (!pending) {
+            send_too_many(res, std::chrono::seconds(1), "Inference queue full, try again shortly");
+            return;
+        }
+        try {
+            answer = pending->get();
+        } catch (const std::exception& e) {
+            send_json(res, 500, {{"error", std::string("Inference failed: ") + e.what()}});
+            return;
+        }
+        responses_.insert(prompt, generation, answer.model_version,
+                          {answer.text, answer.tokens, answer.finish});
+    }
+
+    // Charge only for an answer; the balance is checked again because it
+    // may have been spent while the query ran
+    double new_balance = 0.0;
+    {
+        std::lock_guard lock(db_mutex_);
+        auto user = db_.get_user(user_id);
+        if (!user || user->total_tokens < config_.query_cost) {
+            send_json(res, 402, {{"error", "Insufficient tokens"},
+                                 {"required", config_.query_cost},
+                                 {"balance", user ? user->total_tokens : 0.0}});
+            return;
+        }
+        db_.add_tokens(user_id, -config_.query_cost, "query", "Model query");
+        new_balance = user->total_tokens - config_.query_cost;
+    }
+
+    send_json(res, 200, {{"response", answer.text},
+                         {"tokens_generated", answer.tokens},
+                         {"finish_reason", finish_reason_name(answer.finish)},
+                         {"model_version", answer.model_version},
+                         {"batch_size", answer.batch_size},
+                         {"cached", cached},
+                         {"tokens_spent", config_.query_cost},
+                         {"new_balance", new_balance}});
+}
+
+void CoordinatorServer::handle_corpus_manifest(const httplib::Request&, httplib::Response& res) {
+    if (!corpus_) {
+        send_json(res, 404, {{"error", "No corpus configured"}});
+        return;
+    }
+
+    json shards = json::array();
+    for (const auto& shard : corpus_->shards()) {
+        shards.push_back({{"id", shard.id()},
+                          {"records", shard.num_records()},
+                          {"bytes", shard.file_bytes().size()}});
+    }
+    send_json(res, 200, {{"total_records", corpus_->total_records()}, {"shards", shards}});
+}
+
+void CoordinatorServer::handle_corpus_shard(const httplib::Request& req, httplib::Response& res) {
+    // An id too long for 64 bits names no shard either, rather than a 500
+    const CorpusShard* shard = nullptr;
+    std::string text = req.matches[1].str();
+    std::uint64_t id = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), id);
+    if (corpus_ && error == std::errc() && end == text.data() + text.size()) {
+        shard = corpus_->shard(id);
+    }
+    if (!shard) {
+        send_json(res, 404, {{"error", "Unknown corpus shard"}});
+        return;
+    }
+
+    // Stream straight out of the mapping; shards can be hundreds of MB
+    auto bytes = shard->file_bytes();
+    res.set_content_provider(
+        bytes.size(), "application/octet-stream",
+        [bytes](std::size_t offset, std::size_t length, httplib::DataSink& sink) {
+            constexpr std::size_t kChunk = 1 << 20;
+            return sink.write(reinterpret_cast<const char*>(bytes.data()) + offset,
+                              std::min(length, kChunk));
+        });
+}
+
+void CoordinatorServer::handle_dataset_manifest(const httplib::Request&, httplib::Response& res) {
+    if (!tokens_) {
+        send_json(res, 404, {{"error", "No token dataset configured"}});
+        return;
+    }
+
+    send_json(res, 200, {{"num_tokens", tokens_->num_tokens()},
+                         {"num_docs", tokens_->num_docs()},
+                         {"token_bytes", tokens_->token_bytes()},
+                         {"vocab_size", tokens_->vocab_size()}});
+}
+
+void CoordinatorServer::handle_dataset_tokens(const httplib::Request& req, httplib::Response& res) {
+    if (!tokens_) {
+        send_json(res, 404, {{"error", "No token dataset configured"}});
+        return;
+    }
+
+    std::span<const std::byte> bytes;
+    try {
+        bytes = tokens_->raw(std::stoull(req.get_param_value("start")),
+                             std::stoull(req.get_param_value("count")));
+    } catch (const std::exception&) {
+        send_json(res, 400, {{"error", "start and count must name a range inside the dataset"}});
+        return;
+    }
+
+    // Packed little-endian tokens, token_bytes each, straight from the mapping
+    res.set_content(reinterpret_cast<const char*>(bytes.data()), bytes.size(), "application/octet-stream");
+    res.set_header("X-Token-Bytes", std::to_string(tokens_->token_bytes()));
+}
+
+void CoordinatorServer::handle_dataset_vocab(const httplib::Request&, httplib::Response& res) {
+    std::filesystem::path vocab_path(config_.token_path);
+    vocab_path.replace_extension(".vocab");
+
+    std::ifstream in(vocab_path, std::ios::binary);
+    if (!tokens_ || !in) {
+        send_json(res, 404, {{"error", "No vocabulary available"}});
+        return;
+    }
+
+    std::ostringstream vocab;
+    vocab << in.rdbuf();
+    res.set_content(vocab.str(), "text/plain; charset=utf-8");
+}
+
+void CoordinatorServer::handle_cluster_model_get(const httplib::Request& req, httplib::Response& res) {
+    if (!cluster_->authorized(req.get_header_value(kClusterSecretHeader))) {
+        send_json(res, 403, {{"error", "Cluster secret missing or wrong"}});
+        return;
+    }
+    auto model = aggregator_.snapshot();
+    auto values = model->values();
+
+    res.set_header("X-Model-Version", std::to_string(model->version()));
+    res.set_header("X-Model-Rounds", std::to_string(aggregator_.rounds()));
+
+    // Stream from the snapshot itself; the lambda keeps it alive
+    res.set_content_provider(
+        values.size_bytes(), "application/octet-stream",
+        [model, values](std::size_t offset, std::size_t length, httplib::DataSink& sink) {
+            constexpr std::size_t kChunk = 1 << 20;
+            return sink.write(reinterpret_cast<const char*>(values.data()) + offset,
+                              std::min(length, kChunk));
+        });
+}
+
+void CoordinatorServer::handle_cluster_model_post(const httplib::Request& req, httplib::Response& res) {
+    if (!cluster_->authorized(req.get_header_value(kClusterSecretHeader))) {
+        send_json(res, 403, {{"error", "Cluster secret missing or wrong"}});
+        return;
+    }
+    if (cluster_->leader()) {
+        send_json(res, 403, {{"error", "Only the cluster leader may push models"}});
+        return;
+    }
+
+    std::uint64_t version = 0;
+    try {
+        version = std::stoull(req.get_header_value("X-Model-Version"));
+    } catch (const std::exception&) {
+        send_json(res, 400, {{"error", "X-Model-Version is required"}});
+        return;
+    }
+    if (!cluster_->install(req.body, version)) {
+        send_json(res, 400, {{"error", "Parameter count does not match the model"}});
+        return;
+    }
+    send_json(res, 200, {{"model_version", version}});
+}
+
+void CoordinatorServer::handle_model_config(const httplib::Request&, httplib::Response& res) {
+    send_reply(res, model_config());
+}
+
+void CoordinatorServer::handle_relay_reserve(const httplib::Request& req, httplib::Response& res) {
+    send_reply(res, reserve_relay_batch(req.body));
+}
+
+void CoordinatorServer::handle_relay_submit(const httplib::Request& req, httplib::Response& res) {
+    std::string_view header_text, values;
+    if (!split_relay_batch(req.body, header_text, values)) {
+        send_json(res, 400, {{"error", "Malformed relay batch"}});
+        return;
+    }
+    if (values.size() != aggregator_.snapshot()->values().size() * sizeof(float)) {
+        send_json(res, 400, {{"error", "Parameter count does not match the model"}});
+        return;
+    }
+    std::vector<float> update(values.size() / sizeof(float));
+    std::memcpy(update.data(), values.data(), values.size());
+    send_reply(res, submit_relay_batch(header_text, std::move(update)));
+}
+
+// =============================================================================
+// Worker Operations
+// =============================================================================
+
+WorkerReply CoordinatorServer::register_worker(const std::string& user_id) {
+    std::lock_guard lock(db_mutex_);
+    if (db_.create_user(user_id)) {
+        return json_reply(200, {{"message", "Worker registered successfully"},
+                                {"user_id", user_id},
+                                {"initial_tokens", 0}});
+    }
+
+    // User already exists - that's okay, just log them in
+    auto user = db_.get_user(user_id);
+    return json_reply(200, {{"message", "Worker already registered"},
+                            {"user_id", user_id},
+                            {"current_tokens", user ? user->total_tokens : 0.0}});
+}
+
+WorkerReply CoordinatorServer::worker_heartbeat(const std::string& user_id) {
+    // Memory only; the database is touched when the worker's state changes
+    if (!heartbeats_.is_online(user_id)) {
+        std::lock_guard lock(db_mutex_);
+        if (!db_.get_user(user_id)) {
+            return json_reply(404, {{"error", "User not registered"}});
+        }
+    }
+    heartbeats_.beat(user_id);
+    return json_reply(200, {{"status", "ok"}});
+}
+
+WorkerReply CoordinatorServer::worker_balance(const std::string& user_id) {
+    std::lock_guard lock(db_mutex_);
+    auto user = db_.get_user(user_id);
+    if (!user) {
+        return json_reply(404, {{"error", "User not found"}});
+    }
+    return json_reply(200, {{"user_id", user_id},
+                            {"total_tokens", user->total_tokens},
+                            {"tasks_completed", std::max(0, db_.count_tasks("completed", user_id))},
+                            {"member_since", user->created_at}});
+}
+
+Async<WorkerReply> CoordinatorServer::lease_task(std::string user_id, double wait_seconds,
+                                                 std::optional<Task>& task) {
+    bool registered = co_await offload(storage_, [&] {
+        std::lock_guard lock(db_mutex_);
+        return db_.get_user(user_id).has_value();
+    });
+    if (!registered) {
+        co_return json_reply(404, {{"error", "User not registered"}});
+    }
+    heartbeats_.beat(user_id);
+
+    // Long-poll: park until a task is enqueued rather than answering 404
+    using clock = std::chrono::steady_clock;
+    auto wait = std::min(std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::duration<double>(std::max(wait_seconds, 0.0))),
+                         config_.max_task_wait);
+    auto start = clock::now();
+    auto deadline = start + wait;
+
+    // The sequence is read before each claim so an enqueue that lands
+    // between a failed claim and parking makes wait() return at once
+    std::uint64_t seen = waiters_.sequence();
+    task = co_await offload(storage_, [&] { return claim_task(user_id); });
+    while (!task && clock::now() < deadline) {
+        refiller_.request_refill();
+        if (!co_await waiters_.wait(deadline, seen)) {
+            break;
+        }
+        seen = waiters_.sequence();
+        task = co_await offload(storage_, [&] { return claim_task(user_id); });
+    }
+
+    if (!task) {
+        double waited = std::chrono::duration<double>(clock::now() - start).count();
+        co_return json_reply(404, {{"message", "No tasks available"}, {"waited", waited}});
+    }
+    co_return WorkerReply{};
+}
+
+Async<WorkerReply> CoordinatorServer::complete_task(std::string user_id, std::string task_id,
+                                                    std::uint64_t base_version, std::vector<float> update) {
+    heartbeats_.beat(user_id);
+
+    // Rewarded in one trip to the storage thread; a duplicate gets no reward
+    struct Outcome {
+        int status{200};
+        double tokens_earned{0.0};
+        double new_balance{0.0};
+        const char* error{""};
+    };
+    Outcome outcome = co_await offload(storage_, [&] {
+        Outcome result{200, config_.tokens_per_task, 0.0};
+        std::lock_guard lock(db_mutex_);
+        if (!db_.get_user(user_id)) {
+            return Outcome{404, 0.0, 0.0, "User not registered"};
+        }
+        result.status = check_submitter(task_id, user_id, result.tokens_earned);
+        json record = {{"base_version", base_version}};
+        if (result.status == 200 && !db_.complete_task(task_id, record.dump())) {
+            result.status = 409;   // Another copy got there first
+        }
+        if (result.status != 200) {
+            result.error = submit_error(result.status);
+            return result;
+        }
+        db_.add_tokens(user_id, result.tokens_earned, "reward", "Completed training task " + task_id);
+        if (auto user = db_.get_user(user_id)) {
+            result.new_balance = user->total_tokens;
+        }
+        return result;
+    });
+    if (outcome.status == 409) {
+        speculator_.lost(task_id, user_id);
+        co_return json_reply(409, {{"error", outcome.error}, {"tokens_earned", 0.0}});
+    }
+    if (outcome.status != 200) {
+        co_return json_reply(outcome.status, {{"error", outcome.error}});
+    }
+
+    sizer_.completed(task_id, user_id);
+    if (speculator_.completed(task_id, user_id)) {
+        std::cout << "  ⚡ Speculative copy of " << task_id << " finished first" << std::endl;
+    }
+    // The submission that fills a round aggregates it
+    bool published = co_await offload(compute_, [&] { return aggregator_.submit(std::move(update)); });
+    if (published) {
+        std::cout << "  ↻ Model updated to version " << aggregator_.snapshot()->version() << std::endl;
+    }
+
+    std::cout << "✓ Worker " << user_id << " completed task " << task_id
+              << ", earned " << outcome.tokens_earned << " tokens" << std::endl;
+
+    co_return json_reply(200, {{"message", "Task completed successfully"},
+                               {"tokens_earned", outcome.tokens_earned},
+                               {"new_balance", outcome.new_balance}});
+}
+
+WorkerReply CoordinatorServer::reserve_relay_batch(std::string_view header_text) {
+    json header = json::parse(header_text, nullptr, false);
+    if (header.is_discarded() || !header.is_object() ||
+        !header.contains("completions") || !header["completions"].is_array()) {
+        return json_reply(400, {{"error", "Relay batch header needs a completions array"}});
+    }
+    std::string relay_id = json_member_string(header, "relay_id");
+    auto base = aggregator_.snapshot();
+
+    // Each completion is rewarded as if it had been submitted directly.
+    // The relay then aggregates exactly the accepted ones, and their number
+    // is what the aggregate counts for in submit_relay_batch()
+    json results = json::array();
+    std::vector<std::string> rewarded;
+    {
+        std::lock_guard lock(db_mutex_);
+        json result = {{"base_version", base->version()}, {"relay", relay_id}};
+        for (const auto& completion : header["completions"]) {
+            std::string user_id = json_member_string(completion, "user_id");
+            std::string task_id = json_member_string(completion, "task_id");
+            if (user_id.empty() || task_id.empty()) {
+                results.push_back({{"task_id", task_id}, {"status", 400}, {"error", "Missing required fields"}});
+                continue;
+            }
+            if (ring_ && ring_->owner(task_id) != config_.cluster.self) {
+                results.push_back({{"task_id", task_id}, {"status", 409},
+                                   {"error", "Task belongs to another coordinator"}});
+                continue;
+            }
+            if (!db_.get_user(user_id)) {
+                results.push_back({{"task_id", task_id}, {"status", 404}, {"error", "User not registered"}});
+                continue;
+            }
+
+            double tokens_earned = config_.tokens_per_task;
+            int status = check_submitter(task_id, user_id, tokens_earned);
+            if (status == 200 && !db_.complete_task(task_id, result.dump())) {
+                status = 409;
+            }
+            if (status != 200) {
+                if (status == 409) {
+                    speculator_.lost(task_id, user_id);
+                }
+                results.push_back({{"task_id", task_id}, {"status", status}, {"error", submit_error(status)}});
+                continue;
+            }
+            db_.add_tokens(user_id, tokens_earned, "reward", "Completed training task " + task_id);
+            auto user = db_.get_user(user_id);
+            results.push_back({{"task_id", task_id},
+                               {"status", 200},
+                               {"message", "Task completed successfully"},
+                               {"tokens_earned", tokens_earned},
+                               {"new_balance", user ? user->total_tokens : 0.0}});
+            sizer_.completed(task_id, user_id);   // The time includes the relay's batching delay
+            speculator_.completed(task_id, user_id);
+            rewarded.push_back(std::move(user_id));
+        }
+    }
+    for (const auto& user_id : rewarded) {
+        heartbeats_.beat(user_id);
+    }
+
+    json reply = {{"results", std::move(results)}, {"accepted", rewarded.size()}};
+    if (!rewarded.empty()) {
+        std::string batch = random_token();
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard lock(relay_mutex_);
+        std::erase_if(relay_batches_, [now](const auto& entry) {
+            if (entry.second.expires > now) {
+                return false;
+            }
+            std::cerr << "Relay " << entry.second.relay_id << " never sent the aggregate of "
+                      << entry.second.accepted << " completed tasks" << std::endl;
+            return true;
+        });
+        relay_batches_.emplace(batch, RelayReservation{relay_id, rewarded.size(), now + kRelayBatchTtl});
+        reply["batch"] = batch;
+        reply["expires_in"] = kRelayBatchTtl.count();
+    }
+    std::cout << "✓ Relay " << relay_id << " reserved " << rewarded.size() << " completed tasks" << std::endl;
+    return json_reply(200, reply);
+}
+
+WorkerReply CoordinatorServer::submit_relay_batch(std::string_view header_text, std::vector<float> update) {
+    json header = json::parse(header_text, nullptr, false);
+    std::string batch = header.is_discarded() ? std::string() : json_member_string(header, "batch");
+    if (batch.empty()) {
+        return json_reply(400, {{"error", "Relay batch header needs the batch from /relay/reserve"}});
+    }
+    if (update.size() != aggregator_.snapshot()->values().size()) {
+        return json_reply(400, {{"error", "Parameter count does not match the model"}});
+    }
+    if (!std::all_of(update.begin(), update.end(), [](float v) { return std::isfinite(v); })) {
+        return json_reply(400, {{"error", "Invalid parameters: non-finite value"}});
+    }
+
+    // Single use: the aggregate counts for what was reserved, not what the
+    // relay claims now
+    RelayReservation reservation;
+    {
+        std::lock_guard lock(relay_mutex_);
+        auto it = relay_batches_.find(batch);
+        if (it == relay_batches_.end() || it->second.expires <= std::chrono::steady_clock::now()) {
+            return json_reply(404, {{"error", "Unknown or expired relay batch"}});
+        }
+        reservation = std::move(it->second);
+        relay_batches_.erase(it);
+    }
+
+    if (aggregator_.submit(std::move(update), reservation.accepted)) {
+        std::cout << "  ↻ Model updated to version " << aggregator_.snapshot()->version() << std::endl;
+    }
+    std::cout << "✓ Relay " << reservation.relay_id << " delivered " << reservation.accepted
+              << " completed tasks" << std::endl;
+    return json_reply(200, {{"accepted", reservation.accepted}});
+}
+
+WorkerReply CoordinatorServer::model_config() const {
+    auto model = aggregator_.snapshot();
+    const auto& config = model->config();
+    return json_reply(200, {{"vocab_size", config.vocab_size},
+                            {"embed_dim", config.embed_dim},
+                            {"num_heads", config.num_heads},
+                            {"num_layers", config.num_layers},
+                            {"max_seq_length", config.max_seq_length},
+                            {"parameters", model->values().size()},
+                            {"model_version", model->version()}});
+}
+
+// =============================================================================
+// Binary RPC
+// =============================================================================
+
+Async<RpcReply> CoordinatorServer::handle_rpc(RpcMessage& request) {
+    // Runs on the I/O loop thread: anything that blocks is offloaded
+    auto reply = [](WorkerReply result) { return RpcReply{result.status, std::move(result.body), {}, nullptr}; };
+    auto error = [&reply](int status, const std::string& message) { return reply(json_reply(status, {{"error", message}})); };
+
+    json meta = request.meta.empty() ? json::object() : json::parse(request.meta, nullptr, false);
+    if (meta.is_discarded() || !meta.is_object()) {
+        co_return error(400, "Malformed meta");
+    }
+
+    if (request.method == RpcMethod::ModelConfig) {
+        co_return reply(model_config());
+    }
+    if ((request.method == RpcMethod::RelaySubmit || request.method == RpcMethod::RelayReserve) &&
+        !credentials_match(config_.relay_secret, json_member_string(meta, "relay_secret"))) {
+        co_return error(403, "Relay secret missing or wrong");
+    }
+    if (request.method == RpcMethod::RelaySubmit) {
+        auto permit = submit_limit_.try_acquire();
+        if (!permit) {
+            co_return reply(json_reply(429, {{"error", "Server busy, try again shortly"}, {"retry_after", 1}}));
+        }
+        co_return reply(co_await offload(compute_, [&] {
+            return submit_relay_batch(request.meta, std::move(request.payload));
+        }));
+    }
+    if (request.method == RpcMethod::RelayReserve) {
+        co_return reply(co_await offload(storage_, [&] { return reserve_relay_batch(request.meta); }));
+    }
+
+    // Worker operations: the same checks, in the same order, as over HTTP
+    std::string user_id = meta.value("user_id", "");
+    if (user_id.empty()) {
+        co_return error(400, "user_id is required");
+    }
+    if (auto wait = limiter_.acquire(request.peer.empty() ? user_id : request.peer); wait.count() > 0) {
+        auto seconds = std::max<long long>(1, std::chrono::ceil<std::chrono::seconds>(wait).count());
+        co_return reply(json_reply(429, {{"error", "Rate limit exceeded"}, {"retry_after", seconds}}));
+    }
+    std::string task_id = meta.value("task_id", "");
+    std::string owner = owner_node(request.method == RpcMethod::SubmitResult ? task_id : user_id);
+    if (!owner.empty()) {
+        co_return reply(json_reply(307, {{"redirect", owner}}));
+    }
+
+    switch (request.method) {
+        case RpcMethod::Register:
+            co_return reply(co_await offload(storage_, [&] { return register_worker(user_id); }));
+        case RpcMethod::Heartbeat:
+            if (heartbeats_.is_online(user_id)) {
+                co_return reply(worker_heartbeat(user_id));   // Memory only
+            }
+            co_return reply(co_await offload(storage_, [&] { return worker_heartbeat(user_id); }));
+        case RpcMethod::GetBalance:
+            co_return reply(co_await offload(storage_, [&] { return worker_balance(user_id); }));
+
+        case RpcMethod::GetTask: {
+            double wait_seconds = meta.contains("wait") && meta["wait"].is_number() ? meta["wait"].get<double>() : 0.0;
+            std::optional<Task> task;
+            WorkerReply result = co_await lease_task(user_id, wait_seconds, task);
+            if (!task) {
+                co_return reply(std::move(result));
+            }
+            // The parameters go out straight from the snapshot
+            auto model = aggregator_.snapshot();
+            json head = {
+                {"task_id", task->task_id},
+                {"data_batch", task->data_batch},
+                {"tokens_reward", task->tokens_reward},
+                {"model_version", model->version()},
+            };
+            co_return RpcReply{200, head.dump(), model->values(), model};
+        }
+
+        case RpcMethod::SubmitResult: {
+            if (task_id.empty()) {
+                co_return error(400, "Missing required fields");
+            }
+            auto permit = submit_limit_.try_acquire();
+            if (!permit) {
+                co_return reply(json_reply(429, {{"error", "Server busy, try again shortly"}, {"retry_after", 1}}));
+            }
+            if (co_await offload(storage_, [&] { return task_completed(task_id); })) {
+                speculator_.lost(task_id, user_id);
+                co_return reply(json_reply(409, {{"error", "Task already completed"}, {"tokens_earned", 0.0}}));
+            }
+            // Raw floats: every parameter, in the model's layout
+            auto base = aggregator_.snapshot();
+            if (request.payload.size() != base->values().size()) {
+                co_return error(400, "Parameter count does not match the model");
+            }
+            bool finite = co_await offload(compute_, [&] {
+                return std::all_of(request.payload.begin(), request.payload.end(),
+                                   [](float v) { return std::isfinite(v); });
+            });
+            if (!finite) {
+                co_return error(400, "Invalid parameters: non-finite value");
+            }
+            co_return reply(co_await complete_task(user_id, task_id, base->version(), std::move(request.payload)));
+        }
+
+        default:
+            co_return error(404, std::string("Unknown method ") + std::to_string(static_cast<int>(request.method)));
+    }
+}
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+void CoordinatorServer::on_worker_state(const std::string& user_id, bool online) {
+    int requeued = 0;
+    {
+        std::lock_guard lock(db_mutex_);
+        db_.set_worker_status(user_id, online ? "online" : "offline");
+        if (!online) {
+            requeued = db_.requeue_tasks(user_id);
+        }
+    }
+    if (!online) {
+        sizer_.released(user_id);
+        speculator_.released(user_id);
+    }
+
+    if (requeued > 0) {
+        refiller_.notify_requeued(static_cast<std::size_t>(requeued));
+        std::cout << "⚠ Worker " << user_id << " went silent, requeued " << requeued << " tasks" << std::endl;
+    }
+}
+
+// Base URL of the coordinator owning key, or empty if that is this one
+std::string CoordinatorServer::owner_node(std::string_view key) const {
+    if (!ring_) {
+        return "";
+    }
+    std::size_t owner = ring_->owner(key);
+    return owner == config_.cluster.self ? "" : ring_->node(owner);
+}
+
+bool CoordinatorServer::redirect_to_owner(std::string_view key, const httplib::Request& req,
+                                          httplib::Response& res) {
+    std::string node = owner_node(key);
+    if (node.empty()) {
+        return false;
+    }
+
+    // 307 keeps the method and body; workers then talk to the owner directly
+    std::string location = node + req.path;
+    res.set_header("Location", location);
+    send_json(res, 307, {{"redirect", location}});
+    return true;
+}
+
+std::string CoordinatorServer::next_task_id() {
+    // In a cluster, only hand out ids this coordinator owns, so a
+    // submission for the task can be routed by its id alone.
+    // Caller holds rng_mutex_.
+    while (true) {
+        std::ostringstream id;
+        id << "task-" << std::hex << std::setw(16) << std::setfill('0') << rng_();
+        if (!ring_ || ring_->owner(id.str()) == config_.cluster.self) {
+            return id.str();
+        }
+    }
+}
+
+std::optional<Task> CoordinatorServer::claim_task(const std::string& user_id) {
+    if (auto copy = claim_copy(user_id)) {
+        return copy;
+    }
+
+    // A worker with a throughput estimate gets a batch cut to its size;
+    // the pre-generated one in the queue is replaced when the task is assigned
+    std::optional<std::pair<std::string, std::size_t>> sized;
+    std::size_t units = sizer_.units_for(user_id);
+    if (units != sizer_.base_units()) {
+        std::lock_guard lock(rng_mutex_);
+        std::string batch = sample_batch(units);
+        sized.emplace(std::move(batch), units);
+    }
+
+    std::optional<Task> task;
+    {
+        std::lock_guard lock(db_mutex_);
+        task = db_.get_pending_task();
+        if (task) {
+            bool assigned = false;
+            if (sized) {
+                double reward = task_reward(sized->second);
+                assigned = db_.assign_task(task->task_id, user_id, sized->first, reward, sized->second);
+                if (assigned) {
+                    task->data_batch = std::move(sized->first);
+                    task->tokens_reward = reward;
+                    task->size_units = sized->second;
+                }
+            } else {
+                assigned = db_.assign_task(task->task_id, user_id);
+            }
+            if (!assigned) {
+                task.reset();
+            }
+        }
+    }
+    if (task) {
+        sizer_.leased(task->task_id, user_id, sized ? sized->second : sizer_.base_units());
+        speculator_.leased(task->task_id, user_id);
+        refiller_.notify_claimed();
+    }
+    return task;
+}
+
+std::optional<Task> CoordinatorServer::claim_copy(const std::string& user_id) {
+    if (!speculator_.enabled()) {
+        return std::nullopt;
+    }
+    // A copy only helps if this worker would beat the holder; without
+    // throughput estimates every idle worker counts as faster
+    double progress = static_cast<double>(aggregator_.buffered()) /
+                      static_cast<double>(std::max<std::size_t>(aggregator_.options().round_size, 1));
+    auto mine = sizer_.throughput(user_id);
+    auto task_id = speculator_.offer(user_id, progress, [&](const std::string& holder) {
+        auto theirs = sizer_.throughput(holder);
+        return !theirs || (mine && *mine > *theirs);
+    });
+    if (!task_id) {
+        return std::nullopt;
+    }
+
+    std::optional<Task> task;
+    {
+        std::lock_guard lock(db_mutex_);
+        task = db_.get_task(*task_id);
+    }
+    if (!task || task->status == "completed") {
+        speculator_.forget(*task_id);
+        return std::nullopt;
+    }
+    // The task stays assigned to its first holder; the copy is tracked in
+    // memory, sized as the task was cut
+    sizer_.leased(task->task_id, user_id, task->size_units ? task->size_units : sizer_.base_units());
+    return task;
+}
+
+bool CoordinatorServer::task_completed(const std::string& task_id) {
+    std::lock_guard lock(db_mutex_);
+    auto task = db_.get_task(task_id);
+    return task && task->status == "completed";
+}
+
+int CoordinatorServer::check_submitter(const std::string& task_id, const std::string& user_id,
+                                       double& tokens_earned) {
+    // Caller holds db_mutex_. Only the task's assignee or a worker given a
+    // speculative copy may complete it; anyone else would be paid for a
+    // task id they guessed
+    auto task = db_.get_task(task_id);
+    if (!task) {
+        return 404;
+    }
+    if (task->status == "completed") {
+        return 409;
+    }
+    if (task->assigned_to != user_id && !speculator_.holds(task_id, user_id)) {
+        return 403;
+    }
+    tokens_earned = task->tokens_reward;   // Scaled to the task's size
+    return 200;
+}
+
+std::vector<Task> CoordinatorServer::make_tasks(std::size_t count) {
+    std::vector<Task> tasks(count);
+    std::lock_guard lock(rng_mutex_);
+    for (auto& task : tasks) {
+        std::size_t units = sizer_.base_units();
+        task.task_id = next_task_id();
+        task.data_batch = sample_batch(units);
+        task.tokens_reward = config_.tokens_per_task;
+        task.size_units = units;
+    }
+    return tasks;
+}
+
+std::string CoordinatorServer::sample_batch(std::size_t& units) {
+    if (tokens_) {
+        // Tasks reference already-tokenized ranges; nothing to tokenize per task
+        auto range = tokens_->sample(rng_(), units, config_.sequence_length);
+        units = static_cast<std::size_t>(range.count);
+        return range.to_json();
+    }
+
+    if (corpus_) {
+        // Tasks carry only a reference to a range of corpus records
+        auto ref = corpus_->sample(rng_(), units);
+        units = static_cast<std::size_t>(ref.count);
+        return ref.to_json();
+    }
+
+    const auto& data = config_.training_data;
+    units = std::min(units, data.size());
+    if (sentence_order_.size() != data.size()) {
+        sentence_order_.resize(data.size());
+        std::iota(sentence_order_.begin(), sentence_order_.end(), 0);
+    }
+
+    // Partial Fisher-Yates: the first units indices are the sample
+    json batch = json::array();
+    for (std::size_t j = 0; j < units; ++j) {
+        std::uniform_int_distribution<std::size_t> pick(j, sentence_order_.size() - 1);
+        std::swap(sentence_order_[j], sentence_order_[pick(rng_)]);
+        batch.push_back(data[sentence_order_[j]]);
+    }
+    return batch.dump();
+}
+
+double CoordinatorServer::task_reward(std::size_t units) const {
+    return config_.tokens_per_task * static_cast<double>(units) / static_cast<double>(sizer_.base_units());
+}
+
+Tokenizer CoordinatorServer::make_query_tokenizer() const {
+    auto vocab_size = static_cast<std::size_t>(config_.model.vocab_size);
+
+    // The vocabulary the token dataset was built with, if there is one
+    if (tokens_) {
+        std::filesystem::path vocab_path(config_.token_path);
+        vocab_path.replace_extension(".vocab");
+        if (std::filesystem::exists(vocab_path)) {
+            return Tokenizer::load(vocab_path.string(), vocab_size);
+        }
+    }
+
+    // Otherwise grow one over the inline examples, in order, as
+    // SimpleTokenizer does (corpus text is only seen by workers)
+    Tokenizer tokenizer(vocab_size);
+    std::vector<std::uint32_t> ids;
+    for (const auto& text : config_.training_data) {
+        ids.clear();
+        tokenizer.encode(text, ids, true);
+    }
+    return tokenizer;
+}
+
+std::shared_ptr<const std::string> CoordinatorServer::model_json(const ModelState& model) {
+    std::lock_guard lock(model_json_mutex_);
+    if (!model_json_ || model_json_version_ != model.version()) {
+        model_json_ = std::make_shared<const std::string>(model.to_json());
+        model_json_version_ = model.version();
+    }
+    return model_json_;
+}
+
+std::shared_ptr<const DeflateSegment> CoordinatorServer::model_gzip(const ModelState& model) {
+    std::lock_guard lock(model_gzip_mutex_);
+    if (!model_gzip_ || model_gzip_version_ != model.version()) {
+        // Level 1: 15% larger than the default level in a quarter of the
+        // time, which every new version waits for
+        model_gzip_ = std::make_shared<const DeflateSegment>(deflate_segment(*model_json(model), 1));
+        model_gzip_version_ = model.version();
+    }
+    return model_gzip_;
+}
+
+} // namespace hydra
@@ -0,0 +1,150 @@
+/**
+ * @file speculator.cpp
+ * @brief Implementation of Speculator
+ */
+
+#include "hydra/speculator.hpp"
+#include <algorithm>
+
+namespace hydra {
+
+namespace {
+
+// Leases looked at per offer; keeps a claim cheap when most of the oldest
+// tasks are already copied or held by faster workers
+constexpr std::size_t kMaxScan = 64;
+
+// Completed tasks whose losing holders are remembered; a loser that has
+// not submitted by then is no longer counted
+constexpr std::size_t kMaxSettled = 4096;
+
+} // namespace
+
+Speculator::Speculator(SpeculationOptions options) : options_(options) {}
+
+void Speculator::leased(const std::string& task_id, const std::string& user_id) {
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard lock(mutex_);
+    auto [it, fresh] = leases_.try_emplace(task_id);
+    auto& lease = it->second;
+    if (fresh) {
+        lease.sequence = next_sequence_++;
+        lease.start = std::chrono::steady_clock::now();
+        order_.emplace(lease.sequence, task_id);
+    }
+    if (std::find(lease.holders.begin(), lease.holders.end(), user_id) == lease.holders.end()) {
+        lease.holders.push_back(user_id);
+    }
+}
+
+std::optional<std::string> Speculator::offer(const std::string& user_id, double progress,
+                                             const FasterThan& faster) {
+    if (!enabled() || progress < options_.round_progress) {
+        return std::nullopt;
+    }
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(mutex_);
+
+    std::size_t scanned = 0;
+    for (const auto& [sequence, task_id] : order_) {
+        auto& lease = leases_.at(task_id);
+        if (now - lease.start < options_.min_age || ++scanned > kMaxScan) {
+            break;   // Everything after it is younger
+        }
+        if (lease.holders.empty() || lease.holders.size() > options_.max_copies ||
+            std::find(lease.holders.begin(), lease.holders.end(), user_id) != lease.holders.end() ||
+            !faster(lease.holders.front())) {
+            continue;
+        }
+        lease.holders.push_back(user_id);
+        copies_.fetch_add(1, std::memory_order_relaxed);
+        return task_id;
+    }
+    return std::nullopt;
+}
+
+bool Speculator::holds(const std::string& task_id, const std::string& user_id) const {
+    std::lock_guard lock(mutex_);
+    auto it = leases_.find(task_id);
+    return it != leases_.end() &&
+           std::find(it->second.holders.begin(), it->second.holders.end(), user_id) != it->second.holders.end();
+}
+
+bool Speculator::completed(const std::string& task_id, const std::string& user_id) {
+    std::lock_guard lock(mutex_);
+    auto it = leases_.find(task_id);
+    if (it == leases_.end()) {
+        return false;
+    }
+    auto& holders = it->second.holders;
+    bool copy_won = !holders.empty() && holders.front() != user_id &&
+                    std::find(holders.begin(), holders.end(), user_id) != holders.end();
+    if (copy_won) {
+        wins_.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::erase(holders, user_id);
+    if (!holders.empty()) {
+        if (settled_.size() == kMaxSettled) {
+            losers_.erase(settled_.front());
+            settled_.pop_front();
+        }
+        losers_[task_id] = std::move(holders);
+        settled_.push_back(task_id);
+    }
+    erase(it);
+    return copy_won;
+}
+
+bool Speculator::lost(const std::string& task_id, const std::string& user_id) {
+    std::lock_guard lock(mutex_);
+    auto it = losers_.find(task_id);
+    if (it == losers_.end() || std::erase(it->second, user_id) == 0) {
+        return false;
+    }
+    if (it->second.empty()) {
+        losers_.erase(it);   // Its settled_ entry goes when it ages out
+    }
+    discarded_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void Speculator::forget(const std::string& task_id) {
+    std::lock_guard lock(mutex_);
+    if (auto it = leases_.find(task_id); it != leases_.end()) {
+        erase(it);
+    }
+}
+
+void Speculator::released(const std::string& user_id) {
+    std::lock_guard lock(mutex_);
+    for (auto it = losers_.begin(); it != losers_.end();) {
+        std::erase(it->second, user_id);
+        it = it->second.empty() ? losers_.erase(it) : std::next(it);
+    }
+    for (auto it = leases_.begin(); it != leases_.end();) {
+        auto& holders = it->second.holders;
+        std::erase(holders, user_id);
+        if (holders.empty()) {
+            auto next = std::next(it);
+            erase(it);
+            it = next;
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::size_t Speculator::outstanding() const {
+    std::lock_guard lock(mutex_);
+    return leases_.size();
+}
+
+void Speculator::erase(std::unordered_map<std::string, Lease>::iterator it) {
+    // Caller holds mutex_
+    order_.erase(it->second.sequence);
+    leases_.erase(it);
+}
+
+} // namespace hydra
@@ -0,0 +1,185 @@
+/**
+ * @file task_refiller.cpp
+ * @brief Implementation of TaskRefiller
+ */
+
+#include "hydra/task_refiller.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace hydra {
+
+TaskRefiller::TaskRefiller(Database& db, std::mutex& db_mutex, TaskFactory factory,
+                           RefillOptions options, EnqueueListener on_enqueued)
+    : db_(db), db_mutex_(db_mutex), factory_(std::move(factory)), options_(options),
+      on_enqueued_(std::move(on_enqueued)) {
+    if (options_.low_watermark == 0 || options_.high_watermark < options_.low_watermark) {
+        throw std::invalid_argument("TaskRefiller: need 0 < low_watermark <= high_watermark");
+    }
+    if (options_.max_batch == 0) {
+        throw std::invalid_argument("TaskRefiller: max_batch must be positive");
+    }
+    update_target(0.0);
+}
+
+TaskRefiller::~TaskRefiller() {
+    stop();
+}
+
+void TaskRefiller::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+    resync();
+    refill();
+    thread_ = std::thread(&TaskRefiller::run, this);
+}
+
+void TaskRefiller::stop() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void TaskRefiller::notify_claimed(std::size_t count) {
+    claims_.fetch_add(count, std::memory_order_relaxed);
+    auto remaining = pending_.fetch_sub(static_cast<std::int64_t>(count), std::memory_order_relaxed)
+                     - static_cast<std::int64_t>(count);
+
+    if (remaining < static_cast<std::int64_t>(threshold_.load(std::memory_order_relaxed))) {
+        request_refill();
+    }
+}
+
+void TaskRefiller::notify_requeued(std::size_t count) {
+    pending_.fetch_add(static_cast<std::int64_t>(count), std::memory_order_relaxed);
+    if (on_enqueued_) {
+        on_enqueued_(count);
+    }
+}
+
+void TaskRefiller::request_refill() {
+    {
+        std::lock_guard lock(wake_mutex_);
+        wake_requested_ = true;
+    }
+    wake_.notify_one();
+}
+
+std::size_t TaskRefiller::pending() const {
+    return static_cast<std::size_t>(std::max<std::int64_t>(0, pending_.load(std::memory_order_relaxed)));
+}
+
+double TaskRefiller::claim_rate() const {
+    return claim_rate_.load(std::memory_order_relaxed);
+}
+
+std::size_t TaskRefiller::target() const {
+    return target_.load(std::memory_order_relaxed);
+}
+
+// =============================================================================
+// Background Thread
+// =============================================================================
+
+void TaskRefiller::run() {
+    using clock = std::chrono::steady_clock;
+    auto last_tick = clock::now();
+    auto last_resync = last_tick;
+
+    while (true) {
+        {
+            std::unique_lock lock(wake_mutex_);
+            wake_.wait_until(lock, last_tick + options_.tick,
+                             [this] { return stopping_ || wake_requested_; });
+            if (stopping_) {
+                return;
+            }
+            wake_requested_ = false;
+        }
+
+        auto now = clock::now();
+        if (now - last_tick >= options_.tick) {
+            // Sample the claim rate once per tick and smooth it
+            double seconds = std::chrono::duration<double>(now - last_tick).count();
+            double sample = static_cast<double>(claims_.exchange(0, std::memory_order_relaxed)) / seconds;
+            double rate = claim_rate_.load(std::memory_order_relaxed);
+            rate += options_.rate_smoothing * (sample - rate);
+            claim_rate_.store(rate, std::memory_order_relaxed);
+            update_target(rate);
+            last_tick = now;
+        }
+
+        if (now - last_resync >= options_.resync_interval) {
+            resync();
+            last_resync = now;
+        }
+
+        if (pending() < threshold_.load(std::memory_order_relaxed)) {
+            refill();
+        }
+    }
+}
+
+void TaskRefiller::update_target(double rate) {
+    double lead_seconds = std::chrono::duration<double>(options_.lead_time).count();
+    auto demand = static_cast<std::size_t>(rate * lead_seconds);
+    std::size_t target = std::clamp(demand, options_.low_watermark, options_.high_watermark);
+
+    target_.store(target, std::memory_order_relaxed);
+    threshold_.store(std::max(options_.low_watermark, target / 2), std::memory_order_relaxed);
+}
+
+void TaskRefiller::refill() {
+    std::size_t level = pending();
+    std::size_t target = target_.load(std::memory_order_relaxed);
+
+    while (level < target) {
+        std::size_t count = std::min(options_.max_batch, target - level);
+        std::vector<Task> tasks = factory_(count);
+        if (tasks.empty()) {
+            return;
+        }
+
+        int inserted = 0;
+        {
+            std::lock_guard lock(db_mutex_);
+            inserted = db_.create_tasks(tasks);
+        }
+        if (inserted <= 0) {
+            std::cerr << "TaskRefiller: failed to insert " << tasks.size() << " tasks" << std::endl;
+            return;
+        }
+
+        pending_.fetch_add(inserted, std::memory_order_relaxed);
+        generated_.fetch_add(static_cast<std::size_t>(inserted), std::memory_order_relaxed);
+        level += static_cast<std::size_t>(inserted);
+        if (on_enqueued_) {
+            on_enqueued_(static_cast<std::size_t>(inserted));
+        }
+    }
+}
+
+void TaskRefiller::resync() {
+    // Correct drift from tasks that change state outside this process's
+    // notifications (other tools, lease expiry, manual edits)
+    int count;
+    {
+        std::lock_guard lock(db_mutex_);
+        count = db_.count_tasks("pending");
+    }
+    if (count >= 0) {
+        pending_.store(count, std::memory_order_relaxed);
+        if (count > 0 && on_enqueued_) {
+            on_enqueued_(static_cast<std::size_t>(count));   // Includes tasks inserted elsewhere
+        }
+    }
+}
+
+} // namespace hydra
@@ -0,0 +1,97 @@
+/**
+ * @file task_sizer.cpp
+ * @brief Implementation of TaskSizer
+ */
+
+#include "hydra/task_sizer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hydra {
+
+TaskSizer::TaskSizer(TaskSizingOptions options, std::size_t base_units)
+    : options_(options), base_units_(std::max<std::size_t>(base_units, 1)) {
+    options_.min_scale = std::max(options_.min_scale, 0.0);
+    options_.max_scale = std::max(options_.max_scale, options_.min_scale);
+    options_.smoothing = std::clamp(options_.smoothing, 0.01, 1.0);
+}
+
+std::size_t TaskSizer::units_for(const std::string& user_id) const {
+    if (!enabled()) {
+        return base_units_;
+    }
+    double rate;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = rates_.find(user_id);
+        if (it == rates_.end()) {
+            return base_units_;
+        }
+        rate = it->second;
+    }
+    double target = std::chrono::duration<double>(options_.target).count();
+    double units = std::clamp(rate * target, options_.min_scale * static_cast<double>(base_units_),
+                              options_.max_scale * static_cast<double>(base_units_));
+    return std::max<std::size_t>(1, static_cast<std::size_t>(std::llround(units)));
+}
+
+void TaskSizer::leased(const std::string& task_id, const std::string& user_id, std::size_t units) {
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard lock(mutex_);
+    auto& leases = leases_[task_id];
+    std::erase_if(leases, [&](const Lease& lease) { return lease.user_id == user_id; });
+    leases.push_back(Lease{user_id, units, std::chrono::steady_clock::now()});
+}
+
+bool TaskSizer::completed(const std::string& task_id, const std::string& user_id) {
+    if (!enabled()) {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(mutex_);
+    auto it = leases_.find(task_id);
+    if (it == leases_.end()) {
+        return false;
+    }
+    // Only the winner's time is a sample; the others never finish
+    auto lease = std::find_if(it->second.begin(), it->second.end(),
+                              [&](const Lease& l) { return l.user_id == user_id; });
+    bool found = lease != it->second.end();
+    if (found) {
+        double seconds = std::max(std::chrono::duration<double>(now - lease->start).count(), 1e-3);
+        double sample = static_cast<double>(lease->units) / seconds;
+
+        auto [rate, first] = rates_.try_emplace(user_id, sample);
+        if (!first) {
+            rate->second += options_.smoothing * (sample - rate->second);
+        }
+    }
+    leases_.erase(it);
+    return found;
+}
+
+void TaskSizer::released(const std::string& user_id) {
+    std::lock_guard lock(mutex_);
+    for (auto it = leases_.begin(); it != leases_.end();) {
+        std::erase_if(it->second, [&](const Lease& lease) { return lease.user_id == user_id; });
+        it = it->second.empty() ? leases_.erase(it) : std::next(it);
+    }
+}
+
+std::optional<double> TaskSizer::throughput(const std::string& user_id) const {
+    std::lock_guard lock(mutex_);
+    auto it = rates_.find(user_id);
+    if (it == rates_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::size_t TaskSizer::estimated() const {
+    std::lock_guard lock(mutex_);
+    return rates_.size();
+}
+
+} // namespace hydra
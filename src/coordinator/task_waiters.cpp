@@ -0,0 +1,127 @@
+/**
+ * @file task_waiters.cpp
+ * @brief Implementation of TaskWaiters
+ */
+
+#include "hydra/task_waiters.hpp"
+#include <vector>
+
+namespace hydra {
+
+TaskWaiters::TaskWaiters(std::size_t max_waiters)
+    : max_waiters_(max_waiters), timer_(&TaskWaiters::run_timer, this) {}
+
+TaskWaiters::~TaskWaiters() {
+    shutdown();
+    timer_.join();
+}
+
+bool TaskWaiters::park(Waiter& waiter, std::chrono::steady_clock::time_point deadline, std::uint64_t seen) {
+    std::lock_guard lock(mutex_);
+    if (sequence_ != seen) {
+        waiter.woken = true;   // Tasks arrived since the caller's claim failed
+        return false;
+    }
+    if (shutdown_ || count_ >= max_waiters_ || deadline <= std::chrono::steady_clock::now()) {
+        return false;
+    }
+
+    waiter.prev = tail_;
+    if (tail_) {
+        tail_->next = &waiter;
+    } else {
+        head_ = &waiter;
+    }
+    tail_ = &waiter;
+    ++count_;
+
+    waiter.deadline = deadlines_.emplace(deadline, &waiter);
+    if (waiter.deadline == deadlines_.begin()) {
+        timer_wake_.notify_one();   // Sooner than what the timer sleeps for
+    }
+    return true;
+}
+
+void TaskWaiters::notify(std::size_t count) {
+    // Resumed outside the lock: a waiter without a scheduler runs right here
+    std::vector<Waiter*> woken;
+    {
+        std::lock_guard lock(mutex_);
+        ++sequence_;
+        while (count > 0 && head_) {
+            Waiter* waiter = head_;
+            unlink(*waiter);
+            waiter->woken = true;
+            woken.push_back(waiter);
+            --count;
+        }
+    }
+    for (Waiter* waiter : woken) {
+        resume_on(waiter->scheduler, waiter->handle);
+    }
+}
+
+void TaskWaiters::shutdown() {
+    std::vector<Waiter*> parked;
+    {
+        std::lock_guard lock(mutex_);
+        shutdown_ = true;
+        while (head_) {
+            parked.push_back(head_);
+            unlink(*head_);
+        }
+    }
+    timer_wake_.notify_one();
+    for (Waiter* waiter : parked) {
+        resume_on(waiter->scheduler, waiter->handle);
+    }
+}
+
+std::uint64_t TaskWaiters::sequence() const {
+    std::lock_guard lock(mutex_);
+    return sequence_;
+}
+
+std::size_t TaskWaiters::waiting() const {
+    std::lock_guard lock(mutex_);
+    return count_;
+}
+
+void TaskWaiters::unlink(Waiter& waiter) {
+    // Caller holds mutex_
+    (waiter.prev ? waiter.prev->next : head_) = waiter.next;
+    (waiter.next ? waiter.next->prev : tail_) = waiter.prev;
+    waiter.prev = waiter.next = nullptr;
+    deadlines_.erase(waiter.deadline);
+    --count_;
+}
+
+void TaskWaiters::run_timer() {
+    std::unique_lock lock(mutex_);
+    while (!shutdown_) {
+        if (deadlines_.empty()) {
+            timer_wake_.wait(lock);
+            continue;
+        }
+        auto next = deadlines_.begin()->first;
+        if (std::chrono::steady_clock::now() < next) {
+            timer_wake_.wait_until(lock, next);
+            continue;
+        }
+
+        std::vector<Waiter*> expired;
+        auto now = std::chrono::steady_clock::now();
+        while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+            Waiter* waiter = deadlines_.begin()->second;
+            unlink(*waiter);
+            expired.push_back(waiter);
+        }
+        lock.unlock();
+        for (Waiter* waiter : expired) {
+            resume_on(waiter->scheduler, waiter->handle);
+        }
+        lock.lock();
+    }
+}
+
+} // namespace hydra
@@ -0,0 +1,322 @@
+/**
+ * @file aggregation.cpp
+ * @brief Implementation of the robust aggregation kernels
+ */
+
+#include "hydra/aggregation.hpp"
+#include "hydra/cpu_features.hpp"
+#include "aggregation_kernels.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace hydra {
+
+namespace {
+
+using detail::Comparator;
+using detail::kMaxNetworkSize;
+
+// =============================================================================
+// SIMD Vector Abstraction
+// =============================================================================
+
+// Portable lanes written so the compiler can auto-vectorize them with
+// whatever SIMD the target baseline offers (the AVX2 Vec is in
+// aggregation_avx2.cpp)
+struct Vec {
+    static constexpr std::size_t width = 8;
+    float v[width];
+
+    static Vec load(const float* p) { Vec r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    static Vec broadcast(float x) { Vec r; for (auto& e : r.v) e = x; return r; }
+    static Vec zero() { return broadcast(0.0f); }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+
+    friend Vec min(Vec a, Vec b) { for (std::size_t i = 0; i < width; ++i) a.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i]; return a; }
+    friend Vec max(Vec a, Vec b) { for (std::size_t i = 0; i < width; ++i) a.v[i] = a.v[i] < b.v[i] ? b.v[i] : a.v[i]; return a; }
+    friend Vec operator+(Vec a, Vec b) { for (std::size_t i = 0; i < width; ++i) a.v[i] += b.v[i]; return a; }
+    friend Vec operator*(Vec a, Vec b) { for (std::size_t i = 0; i < width; ++i) a.v[i] *= b.v[i]; return a; }
+    friend Vec fma(Vec a, Vec b, Vec c) { for (std::size_t i = 0; i < width; ++i) c.v[i] += a.v[i] * b.v[i]; return c; }
+};
+
+/**
+ * @brief Build a Batcher odd-even merge sorting network for n inputs
+ *
+ * The network is generated for the next power of two and comparators
+ * touching the (virtual, +infinity) padding inputs are dropped, which
+ * leaves a valid network for exactly n inputs.
+ */
+std::vector<Comparator> build_sorting_network(std::size_t n) {
+    std::size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+
+    std::vector<Comparator> network;
+    for (std::size_t p = 1; p < size; p <<= 1) {
+        for (std::size_t k = p; k >= 1; k >>= 1) {
+            for (std::size_t j = k % p; j + k < size; j += 2 * k) {
+                for (std::size_t i = 0; i < std::min(k, size - j - k); ++i) {
+                    std::size_t a = i + j;
+                    std::size_t b = i + j + k;
+                    if (a / (2 * p) == b / (2 * p) && b < n) {
+                        network.push_back({static_cast<std::uint16_t>(a), static_cast<std::uint16_t>(b)});
+                    }
+                }
+            }
+        }
+    }
+    return network;
+}
+
+/**
+ * @brief Per-call constants shared by every shard
+ */
+struct Plan {
+    const detail::AggregationKernels* kernels;
+    std::span<const UpdateView> updates;
+    std::vector<float> weights;            // Normalized weights (Mean only)
+    std::vector<Comparator> network;       // Empty when selection is used
+    AggregationRule rule;
+    std::size_t trim{0};                   // Values dropped from each end
+    std::size_t block_size;
+};
+
+// Reduce sorted (or partially ordered, see below) values to one output.
+// For the selection path the values in [trim, K - trim) are guaranteed to
+// be the middle ones, just not sorted among themselves.
+float reduce_sorted(const float* values, std::size_t k, const Plan& plan) {
+    if (plan.rule == AggregationRule::Median) {
+        if (k % 2 == 1) {
+            return values[k / 2];
+        }
+        return 0.5f * (values[k / 2 - 1] + values[k / 2]);
+    }
+
+    float sum = 0.0f;
+    for (std::size_t i = plan.trim; i < k - plan.trim; ++i) {
+        sum += values[i];
+    }
+    return sum / static_cast<float>(k - 2 * plan.trim);
+}
+
+// =============================================================================
+// Block Kernels
+// =============================================================================
+
+// Weighted mean straight from the update buffers; the output block stays
+// in L1 while each update streams through it once.
+void mean_block(const Plan& plan, std::size_t begin, std::size_t len, float* out) {
+    std::fill(out, out + len, 0.0f);
+    for (std::size_t u = 0; u < plan.updates.size(); ++u) {
+        plan.kernels->accumulate(out, plan.updates[u].data + begin, plan.weights[u], len);
+    }
+}
+
+// Sorting-network kernel: the block's K rows are gathered into scratch
+// (row-major, K x len) and each group of Vec::width coordinates is sorted
+// across the K rows with vertical min/max operations.
+void network_block(const Plan& plan, std::size_t begin, std::size_t len,
+                   float* scratch, float* out) {
+    const std::size_t k = plan.updates.size();
+    const std::size_t stride = plan.block_size;
+
+    for (std::size_t u = 0; u < k; ++u) {
+        std::memcpy(scratch + u * stride, plan.updates[u].data + begin, len * sizeof(float));
+    }
+
+    std::size_t j = plan.kernels->network(scratch, stride, k, len, plan.network.data(), plan.network.size(),
+                                          plan.rule == AggregationRule::Median, plan.trim, out);
+
+    // Tail coordinates that don't fill a whole vector
+    float column[kMaxNetworkSize];
+    for (; j < len; ++j) {
+        for (std::size_t u = 0; u < k; ++u) {
+            column[u] = scratch[u * stride + j];
+        }
+        std::sort(column, column + k);
+        out[j] = reduce_sorted(column, k, plan);
+    }
+}
+
+// Selection kernel for large rounds: the block is gathered column-major
+// (len x K) so each coordinate's K values are contiguous for nth_element.
+void select_block(const Plan& plan, std::size_t begin, std::size_t len,
+                  float* scratch, float* out) {
+    const std::size_t k = plan.updates.size();
+
+    for (std::size_t u = 0; u < k; ++u) {
+        const float* src = plan.updates[u].data + begin;
+        for (std::size_t j = 0; j < len; ++j) {
+            scratch[j * k + u] = src[j];
+        }
+    }
+
+    for (std::size_t j = 0; j < len; ++j) {
+        float* column = scratch + j * k;
+
+        if (plan.rule == AggregationRule::Median) {
+            std::nth_element(column, column + k / 2, column + k);
+            if (k % 2 == 0) {
+                // Lower middle is the largest value left of the pivot
+                column[k / 2 - 1] = *std::max_element(column, column + k / 2);
+            }
+        } else if (plan.trim > 0) {
+            std::nth_element(column, column + plan.trim, column + k);
+            std::nth_element(column + plan.trim, column + (k - plan.trim), column + k);
+        }
+        out[j] = reduce_sorted(column, k, plan);
+    }
+}
+
+void aggregate_shard(const Plan& plan, std::size_t begin, std::size_t end,
+                     float* scratch, float* out) {
+    for (std::size_t pos = begin; pos < end; pos += plan.block_size) {
+        std::size_t len = std::min(plan.block_size, end - pos);
+
+        if (plan.rule == AggregationRule::Mean) {
+            mean_block(plan, pos, len, out + pos);
+        } else if (!plan.network.empty() || plan.updates.size() == 1) {
+            network_block(plan, pos, len, scratch, out + pos);
+        } else {
+            select_block(plan, pos, len, scratch, out + pos);
+        }
+    }
+}
+
+} // namespace
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+void aggregate_updates(std::span<const UpdateView> updates,
+                       std::span<float> out,
+                       const AggregationOptions& options) {
+    if (updates.empty()) {
+        throw std::invalid_argument("aggregate_updates: no updates to aggregate");
+    }
+    if (options.block_size == 0 || options.block_size % 16 != 0) {
+        throw std::invalid_argument("aggregate_updates: block_size must be a positive multiple of 16");
+    }
+    if (options.trim_fraction < 0.0 || options.trim_fraction >= 0.5) {
+        throw std::invalid_argument("aggregate_updates: trim_fraction must be in [0, 0.5)");
+    }
+    for (const auto& update : updates) {
+        if (update.data == nullptr) {
+            throw std::invalid_argument("aggregate_updates: null update buffer");
+        }
+    }
+
+    const std::size_t k = updates.size();
+    const std::size_t n = out.size();
+
+    Plan plan{&detail::aggregation_kernels(), updates, {}, {}, options.rule, 0, options.block_size};
+
+    if (options.rule == AggregationRule::Mean) {
+        double total = 0.0;
+        for (const auto& update : updates) {
+            total += update.weight;
+        }
+        if (total <= 0.0) {
+            throw std::invalid_argument("aggregate_updates: total weight must be positive");
+        }
+        plan.weights.reserve(k);
+        for (const auto& update : updates) {
+            plan.weights.push_back(static_cast<float>(update.weight / total));
+        }
+    } else {
+        if (options.rule == AggregationRule::TrimmedMean) {
+            plan.trim = static_cast<std::size_t>(options.trim_fraction * static_cast<double>(k));
+        }
+        if (k <= kMaxNetworkSize) {
+            plan.network = build_sorting_network(k);
+        }
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    // Shard on block boundaries so every thread works on whole blocks
+    const std::size_t blocks = (n + plan.block_size - 1) / plan.block_size;
+    std::size_t threads = options.num_threads != 0
+        ? options.num_threads
+        : std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    threads = std::min(threads, blocks);
+
+    const std::size_t blocks_per_shard = (blocks + threads - 1) / threads;
+    const std::size_t shard_size = blocks_per_shard * plan.block_size;
+    const std::size_t scratch_size = options.rule == AggregationRule::Mean
+        ? 0 : k * plan.block_size;
+
+    // Allocate all scratch up front so worker threads never throw
+    std::vector<float> scratch(scratch_size * threads);
+
+    if (threads == 1) {
+        aggregate_shard(plan, 0, n, scratch.data(), out.data());
+        return;
+    }
+
+    std::vector<std::jthread> pool;
+    pool.reserve(threads);
+    for (std::size_t t = 0; t < threads; ++t) {
+        std::size_t begin = t * shard_size;
+        std::size_t end = std::min(n, begin + shard_size);
+        if (begin >= end) {
+            break;
+        }
+        pool.emplace_back(aggregate_shard, std::cref(plan), begin, end,
+                          scratch.data() + t * scratch_size, out.data());
+    }
+}
+
+void blend_into(std::span<float> global, std::span<const float> update,
+                double learning_rate) {
+    if (global.size() != update.size()) {
+        throw std::invalid_argument("blend_into: size mismatch");
+    }
+
+    const float lr = static_cast<float>(learning_rate);
+    for (std::size_t i = 0; i < global.size(); ++i) {
+        global[i] += lr * (update[i] - global[i]);
+    }
+}
+
+const detail::AggregationKernels& detail::aggregation_kernels_portable() {
+    static const AggregationKernels kernels = make_aggregation_kernels<Vec>("portable");
+    return kernels;
+}
+
+const detail::AggregationKernels& detail::aggregation_kernels() {
+#if defined(HYDRA_AGGREGATION_X86)
+    static const AggregationKernels& kernels =
+        cpu_has_avx2_fma() ? aggregation_kernels_avx2() : aggregation_kernels_portable();
+    return kernels;
+#else
+    return aggregation_kernels_portable();
+#endif
+}
+
+AggregationRule parse_aggregation_rule(const std::string& name) {
+    if (name == "mean") return AggregationRule::Mean;
+    if (name == "trimmed_mean") return AggregationRule::TrimmedMean;
+    if (name == "median") return AggregationRule::Median;
+    throw std::invalid_argument("Unknown aggregation rule: " + name);
+}
+
+const char* aggregation_rule_name(AggregationRule rule) {
+    switch (rule) {
+        case AggregationRule::Mean: return "mean";
+        case AggregationRule::TrimmedMean: return "trimmed_mean";
+        case AggregationRule::Median: return "median";
+    }
+    return "unknown";
+}
+
+} // namespace hydra
@@ -0,0 +1,36 @@
+/**
+ * @file aggregation_avx2.cpp
+ * @brief AVX2/FMA aggregation loops (built with -mavx2 -mfma)
+ */
+
+#include "aggregation_kernels.hpp"
+#include <immintrin.h>
+
+namespace hydra {
+
+namespace {
+
+struct Vec {
+    static constexpr std::size_t width = 8;
+    __m256 v;
+
+    static Vec load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    static Vec broadcast(float x) { return {_mm256_set1_ps(x)}; }
+    static Vec zero() { return {_mm256_setzero_ps()}; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Vec min(Vec a, Vec b) { return {_mm256_min_ps(a.v, b.v)}; }
+    friend Vec max(Vec a, Vec b) { return {_mm256_max_ps(a.v, b.v)}; }
+    friend Vec operator+(Vec a, Vec b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend Vec operator*(Vec a, Vec b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend Vec fma(Vec a, Vec b, Vec c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+};
+
+} // namespace
+
+const detail::AggregationKernels& detail::aggregation_kernels_avx2() {
+    static const AggregationKernels kernels = make_aggregation_kernels<Vec>("avx2");
+    return kernels;
+}
+
+} // namespace hydra
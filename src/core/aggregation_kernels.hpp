@@ -0,0 +1,70 @@
+/**
+ * @file aggregation_kernels.hpp
+ * @brief Vector loops of the aggregation kernels, written once over Vec
+ *
+ * Private to the aggregation translation units: aggregation.cpp
+ * instantiates these with its portable Vec, aggregation_avx2.cpp (built
+ * with -mavx2 -mfma) with an AVX2 one. Each Vec lives in its own
+ * anonymous namespace, so the instantiations never merge. Nothing here
+ * may call a standard algorithm: an instantiation made in the AVX2 unit
+ * could be the one the linker keeps for every caller.
+ */
+
+#pragma once
+
+#include "hydra/aggregation.hpp"
+
+namespace hydra::detail {
+
+template <typename Vec>
+void accumulate_lanes(float* out, const float* src, float weight, std::size_t len) {
+    const Vec w = Vec::broadcast(weight);
+    std::size_t j = 0;
+    for (; j + Vec::width <= len; j += Vec::width) {
+        fma(w, Vec::load(src + j), Vec::load(out + j)).store(out + j);
+    }
+    for (; j < len; ++j) {
+        out[j] += weight * src[j];
+    }
+}
+
+template <typename Vec>
+std::size_t network_lanes(const float* rows, std::size_t stride, std::size_t k, std::size_t len,
+                          const Comparator* network, std::size_t comparators,
+                          bool median, std::size_t trim, float* out) {
+    Vec lanes[kMaxNetworkSize];
+    std::size_t j = 0;
+    for (; j + Vec::width <= len; j += Vec::width) {
+        for (std::size_t u = 0; u < k; ++u) {
+            lanes[u] = Vec::load(rows + u * stride + j);
+        }
+        for (std::size_t c = 0; c < comparators; ++c) {
+            const auto [a, b] = network[c];
+            Vec lo = min(lanes[a], lanes[b]);
+            lanes[b] = max(lanes[a], lanes[b]);
+            lanes[a] = lo;
+        }
+
+        Vec result;
+        if (median) {
+            result = (k % 2 == 1)
+                ? lanes[k / 2]
+                : (lanes[k / 2 - 1] + lanes[k / 2]) * Vec::broadcast(0.5f);
+        } else {
+            result = Vec::zero();
+            for (std::size_t u = trim; u < k - trim; ++u) {
+                result = result + lanes[u];
+            }
+            result = result * Vec::broadcast(1.0f / static_cast<float>(k - 2 * trim));
+        }
+        result.store(out + j);
+    }
+    return j;
+}
+
+template <typename Vec>
+AggregationKernels make_aggregation_kernels(const char* name) {
+    return {name, accumulate_lanes<Vec>, network_lanes<Vec>};
+}
+
+} // namespace hydra::detail
@@ -0,0 +1,83 @@
+/**
+ * @file arena.cpp
+ * @brief Implementation of Arena
+ */
+
+#include "hydra/arena.hpp"
+#include <algorithm>
+#include <new>
+
+namespace hydra {
+
+namespace {
+
+std::size_t round_up(std::size_t bytes) {
+    return (bytes + Arena::kAlignment - 1) & ~(Arena::kAlignment - 1);
+}
+
+} // namespace
+
+void Arena::Free::operator()(std::byte* block) const {
+    ::operator delete[](block, std::align_val_t{kAlignment});
+}
+
+Arena::Block Arena::make_block(std::size_t bytes) {
+    bytes = round_up(std::max<std::size_t>(bytes, kAlignment));
+    auto* data = static_cast<std::byte*>(::operator new[](bytes, std::align_val_t{kAlignment}));
+    return Block{std::unique_ptr<std::byte[], Free>(data), bytes};
+}
+
+Arena::Arena(std::size_t block_bytes) {
+    blocks_.push_back(make_block(block_bytes));
+}
+
+void* Arena::allocate(std::size_t bytes) {
+    bytes = round_up(std::max<std::size_t>(bytes, 1));
+    // Blocks kept by rewind() are reused before new ones are made
+    while (used_ + bytes > blocks_[current_].bytes) {
+        if (current_ + 1 == blocks_.size()) {
+            blocks_.push_back(make_block(std::max(bytes, blocks_[current_].bytes)));
+        }
+        ++current_;
+        used_ = 0;
+    }
+    void* result = blocks_[current_].data.get() + used_;
+    used_ += bytes;
+    peak_ = std::max(peak_, used());
+    return result;
+}
+
+void Arena::rewind(Mark mark) {
+    current_ = mark.block;
+    used_ = mark.used;
+}
+
+void Arena::reset() {
+    if (blocks_.size() > 1) {
+        // One block as large as this step needed: the next step of the same
+        // shape fits without asking the system for memory
+        std::size_t total = capacity();
+        blocks_.clear();
+        blocks_.push_back(make_block(std::max(total, peak_)));
+    }
+    current_ = 0;
+    used_ = 0;
+}
+
+std::size_t Arena::used() const {
+    std::size_t total = used_;
+    for (std::size_t i = 0; i < current_; ++i) {
+        total += blocks_[i].bytes;
+    }
+    return total;
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t total = 0;
+    for (const auto& block : blocks_) {
+        total += block.bytes;
+    }
+    return total;
+}
+
+} // namespace hydra
@@ -0,0 +1,176 @@
+/**
+ * @file attention.cpp
+ * @brief Implementation of the fused attention kernels
+ */
+
+#include "hydra/attention.hpp"
+#include "hydra/arena.hpp"
+#include "hydra/gemm.hpp"
+#include "vector_ops.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hydra {
+
+namespace {
+
+// Scores of padding keys become -infinity (probability 0)
+void mask_padding(const AttentionHead& head, std::size_t k0, std::size_t nq, std::size_t nk, float* scores) {
+    if (!head.key_padding) {
+        return;
+    }
+    for (std::size_t j = 0; j < nk; ++j) {
+        if (head.key_padding[k0 + j]) {
+            for (std::size_t i = 0; i < nq; ++i) {
+                scores[i * kAttentionKeyBlock + j] = -INFINITY;
+            }
+        }
+    }
+}
+
+void zero_rows(float* x, std::size_t ld, std::size_t rows, std::size_t cols) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        std::fill_n(x + r * ld, cols, 0.0f);
+    }
+}
+
+Arena& scratch() {
+    thread_local Arena arena(std::size_t{64} << 10);
+    return arena;
+}
+
+} // namespace
+
+void attention_forward(const AttentionHead& head, float* out, std::size_t ldo, float* lse) {
+    const std::size_t dim = head.head_dim;
+    Arena::Scope scope(scratch());
+    float* acc = scratch().allocate_floats(kAttentionQueryBlock * dim);
+    float* scores = scratch().allocate_floats(kAttentionQueryBlock * kAttentionKeyBlock);
+    float row_max[kAttentionQueryBlock];
+    float row_sum[kAttentionQueryBlock];
+
+    for (std::size_t q0 = 0; q0 < head.queries; q0 += kAttentionQueryBlock) {
+        const std::size_t nq = std::min(kAttentionQueryBlock, head.queries - q0);
+        const float* q = head.q + q0 * head.ldq;
+        std::fill_n(acc, nq * dim, 0.0f);
+        std::fill_n(row_max, nq, -INFINITY);
+        std::fill_n(row_sum, nq, 0.0f);
+
+        // This block of queries meets every block of keys and values while
+        // both are in cache
+        for (std::size_t k0 = 0; k0 < head.keys; k0 += kAttentionKeyBlock) {
+            const std::size_t nk = std::min(kAttentionKeyBlock, head.keys - k0);
+            sgemm(Transpose::No, Transpose::Yes, nq, nk, dim, head.scale, q, head.ldq,
+                  head.k + k0 * head.ldk, head.ldk, 0.0f, scores, kAttentionKeyBlock);
+            mask_padding(head, k0, nq, nk, scores);
+
+            // Online softmax: rescale what was summed under the old maximum,
+            // then turn the scores into unnormalized probabilities in place
+            for (std::size_t i = 0; i < nq; ++i) {
+                float* s = scores + i * kAttentionKeyBlock;
+                float tile_max = *std::max_element(s, s + nk);
+                if (tile_max == -INFINITY) {
+                    std::fill_n(s, nk, 0.0f);   // Every key of the tile is padding
+                    continue;
+                }
+                float new_max = std::max(row_max[i], tile_max);
+                float correction = std::exp(row_max[i] - new_max);
+                if (correction != 1.0f) {
+                    row_sum[i] *= correction;
+                    std::for_each(acc + i * dim, acc + (i + 1) * dim, [correction](float& x) { x *= correction; });
+                }
+                for (std::size_t j = 0; j < nk; ++j) {
+                    s[j] = std::exp(s[j] - new_max);
+                    row_sum[i] += s[j];
+                }
+                row_max[i] = new_max;
+            }
+            sgemm(Transpose::No, Transpose::No, nq, dim, nk, 1.0f, scores, kAttentionKeyBlock,
+                  head.v + k0 * head.ldv, head.ldv, 1.0f, acc, dim);
+        }
+
+        for (std::size_t i = 0; i < nq; ++i) {
+            float* out_i = out + (q0 + i) * ldo;
+            if (row_sum[i] == 0.0f) {
+                std::fill_n(out_i, dim, 0.0f);
+            } else {
+                float inverse = 1.0f / row_sum[i];
+                for (std::size_t d = 0; d < dim; ++d) {
+                    out_i[d] = acc[i * dim + d] * inverse;
+                }
+            }
+            if (lse) {
+                lse[q0 + i] = row_sum[i] == 0.0f ? -INFINITY : row_max[i] + std::log(row_sum[i]);
+            }
+        }
+    }
+}
+
+void attention_backward(const AttentionHead& head,
+                        const float* out, std::size_t ldo, const float* lse,
+                        const float* d_out, std::size_t ldd,
+                        const AttentionGradients& grads) {
+    const std::size_t dim = head.head_dim;
+    zero_rows(grads.dq, grads.lddq, head.queries, dim);
+    zero_rows(grads.dk, grads.lddk, head.keys, dim);
+    zero_rows(grads.dv, grads.lddv, head.keys, dim);
+
+    // delta_i = dO_i . O_i, the softmax Jacobian's correction per query
+    Arena::Scope scope(scratch());
+    float* delta = scratch().allocate_floats(head.queries);
+    float* probs = scratch().allocate_floats(kAttentionQueryBlock * kAttentionKeyBlock);
+    float* d_scores = scratch().allocate_floats(kAttentionQueryBlock * kAttentionKeyBlock);
+    for (std::size_t i = 0; i < head.queries; ++i) {
+        delta[i] = detail::dot(d_out + i * ldd, out + i * ldo, dim);
+    }
+
+    // Keys outside so a block of dK and dV accumulates in cache; the
+    // probabilities are recomputed from the saved log-sum-exp
+    for (std::size_t k0 = 0; k0 < head.keys; k0 += kAttentionKeyBlock) {
+        const std::size_t nk = std::min(kAttentionKeyBlock, head.keys - k0);
+        const float* k = head.k + k0 * head.ldk;
+        const float* v = head.v + k0 * head.ldv;
+        float* dk = grads.dk + k0 * grads.lddk;
+        float* dv = grads.dv + k0 * grads.lddv;
+        for (std::size_t q0 = 0; q0 < head.queries; q0 += kAttentionQueryBlock) {
+            const std::size_t nq = std::min(kAttentionQueryBlock, head.queries - q0);
+            const float* q = head.q + q0 * head.ldq;
+            const float* d_o = d_out + q0 * ldd;
+
+            // P = exp(scale * Q K^T - lse)
+            sgemm(Transpose::No, Transpose::Yes, nq, nk, dim, head.scale, q, head.ldq, k, head.ldk,
+                  0.0f, probs, kAttentionKeyBlock);
+            mask_padding(head, k0, nq, nk, probs);
+            for (std::size_t i = 0; i < nq; ++i) {
+                float* p = probs + i * kAttentionKeyBlock;
+                float offset = lse[q0 + i];
+                for (std::size_t j = 0; j < nk; ++j) {
+                    p[j] = offset == -INFINITY ? 0.0f : std::exp(p[j] - offset);
+                }
+            }
+
+            // dV += P^T dO;  dP = dO V^T
+            sgemm(Transpose::Yes, Transpose::No, nk, dim, nq, 1.0f, probs, kAttentionKeyBlock, d_o, ldd,
+                  1.0f, dv, grads.lddv);
+            sgemm(Transpose::No, Transpose::Yes, nq, nk, dim, 1.0f, d_o, ldd, v, head.ldv,
+                  0.0f, d_scores, kAttentionKeyBlock);
+
+            // dS = P * (dP - delta), times scale for the chain through S
+            for (std::size_t i = 0; i < nq; ++i) {
+                const float* p = probs + i * kAttentionKeyBlock;
+                float* ds = d_scores + i * kAttentionKeyBlock;
+                for (std::size_t j = 0; j < nk; ++j) {
+                    ds[j] = p[j] * (ds[j] - delta[q0 + i]) * head.scale;
+                }
+            }
+
+            // dQ += dS K;  dK += dS^T Q
+            sgemm(Transpose::No, Transpose::No, nq, dim, nk, 1.0f, d_scores, kAttentionKeyBlock, k, head.ldk,
+                  1.0f, grads.dq + q0 * grads.lddq, grads.lddq);
+            sgemm(Transpose::Yes, Transpose::No, nk, dim, nq, 1.0f, d_scores, kAttentionKeyBlock, q, head.ldq,
+                  1.0f, dk, grads.lddk);
+        }
+    }
+}
+
+} // namespace hydra
@@ -0,0 +1,507 @@
+/**
+ * @file checkpoint.cpp
+ * @brief Implementation of native model checkpoints
+ */
+
+#include "hydra/checkpoint.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include "hydra/io_loop.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace hydra {
+
+namespace {
+
+constexpr char kCheckpointMagic[8] = {'H', 'Y', 'D', 'R', 'A', 'C', 'K', '1'};
+constexpr std::uint32_t kCheckpointVersion = 1;
+constexpr std::uint64_t kAlignment = 64;
+constexpr std::string_view kPrefix = "model-";
+constexpr std::string_view kSuffix = ".hck";
+constexpr char kLogMagic[4] = {'H', 'L', 'R', '1'};
+
+std::uint64_t align_up(std::uint64_t offset) {
+    return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+std::uint64_t fnv1a(std::span<const std::byte> bytes, std::uint64_t hash = 0xcbf29ce484222325ull) {
+    for (std::byte b : bytes) {
+        hash ^= static_cast<std::uint64_t>(b);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::uint64_t fnv1a(std::span<const float> values) {
+    return fnv1a(std::as_bytes(values));
+}
+
+const char kZeros[kAlignment] = {};
+
+/**
+ * Pieces of a file, written in order by one gathered write and fsync'd.
+ * On Windows, through a stream.
+ */
+class Gather {
+public:
+    void add(const void* data, std::size_t size) {
+        if (size > 0) {
+            pieces_.push_back({const_cast<void*>(data), size});
+        }
+    }
+
+    std::uint64_t bytes() const {
+        std::uint64_t total = 0;
+        for (const auto& piece : pieces_) {
+            total += piece.iov_len;
+        }
+        return total;
+    }
+
+#ifndef _WIN32
+    void write(int fd, std::uint64_t offset, IoLoop* io) const {
+        write_file(fd, pieces_, offset, true, io);
+    }
+#else
+    void write(std::ofstream& out) const {
+        for (const auto& piece : pieces_) {
+            out.write(static_cast<const char*>(piece.iov_base), static_cast<std::streamsize>(piece.iov_len));
+        }
+    }
+#endif
+
+private:
+#ifndef _WIN32
+    std::vector<iovec> pieces_;
+#else
+    struct Piece {
+        void* iov_base;
+        std::size_t iov_len;
+    };
+    std::vector<Piece> pieces_;
+#endif
+};
+
+std::optional<std::uint64_t> parse_version(const std::string& filename) {
+    if (filename.size() <= kPrefix.size() + kSuffix.size() || !filename.starts_with(kPrefix) ||
+        !filename.ends_with(kSuffix)) {
+        return std::nullopt;
+    }
+    const char* first = filename.data() + kPrefix.size();
+    const char* last = filename.data() + filename.size() - kSuffix.size();
+    std::uint64_t version = 0;
+    auto [ptr, ec] = std::from_chars(first, last, version);
+    if (ec != std::errc() || ptr != last) {
+        return std::nullopt;
+    }
+    return version;
+}
+
+// Zero-padded so the names sort by version
+std::string versioned_path(const std::string& dir, std::uint64_t version, std::string_view suffix) {
+    char digits[21];
+    std::snprintf(digits, sizeof(digits), "%020llu", static_cast<unsigned long long>(version));
+    return (fs::path(dir) / (std::string(kPrefix) + digits + std::string(suffix))).string();
+}
+
+} // namespace
+
+std::string checkpoint_path(const std::string& dir, std::uint64_t version) {
+    return versioned_path(dir, version, kSuffix);
+}
+
+std::string model_log_path(const std::string& dir, std::uint64_t checkpoint_version) {
+    return versioned_path(dir, checkpoint_version, ".hlog");
+}
+
+// =============================================================================
+// Writing
+// =============================================================================
+
+CheckpointStats write_checkpoint(const std::string& dir, const ModelState& model, const ModelState* base,
+                                 IoLoop* io) {
+    const auto& tensors = model.tensors();
+    if (base && base->values().size() != model.values().size()) {
+        throw std::invalid_argument("write_checkpoint: base has a different layout");
+    }
+    fs::create_directories(dir);
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+    header.version = kCheckpointVersion;
+    header.flags = (base ? 0 : kCheckpointFull) |
+                   (std::endian::native == std::endian::little ? kCheckpointLittleEndian : 0);
+    header.model_version = model.version();
+    header.base_version = base ? base->version() : 0;
+    header.vocab_size = model.config().vocab_size;
+    header.embed_dim = model.config().embed_dim;
+    header.num_heads = model.config().num_heads;
+    header.num_layers = model.config().num_layers;
+    header.max_seq_length = model.config().max_seq_length;
+    header.num_tensors = static_cast<std::uint32_t>(tensors.size());
+    header.names_offset = sizeof(CheckpointHeader) + tensors.size() * sizeof(CheckpointTensor);
+
+    // Lay out the table first: names, then each stored tensor on a 64-byte boundary
+    CheckpointStats stats;
+    stats.full = base == nullptr;
+    stats.tensors_total = tensors.size();
+    std::vector<CheckpointTensor> table(tensors.size());
+    std::string names;
+    for (std::size_t i = 0; i < tensors.size(); ++i) {
+        const TensorInfo& info = tensors[i];
+        if (info.shape.size() > 4) {
+            throw std::invalid_argument("write_checkpoint: tensor " + info.name + " has more than 4 dimensions");
+        }
+        auto& entry = table[i];
+        entry.elements = info.size;
+        entry.name_offset = static_cast<std::uint32_t>(names.size());
+        entry.name_bytes = static_cast<std::uint32_t>(info.name.size());
+        entry.rank = static_cast<std::uint32_t>(info.shape.size());
+        for (std::size_t d = 0; d < info.shape.size(); ++d) {
+            entry.shape[d] = static_cast<std::uint32_t>(info.shape[d]);
+        }
+        entry.checksum = fnv1a(model.values().subspan(info.offset, info.size));
+        names += info.name;
+    }
+
+    std::uint64_t offset = align_up(header.names_offset + names.size());
+    for (std::size_t i = 0; i < tensors.size(); ++i) {
+        const TensorInfo& info = tensors[i];
+        bool changed = !base || std::memcmp(model.values().data() + info.offset, base->values().data() + info.offset,
+                                            info.size * sizeof(float)) != 0;
+        if (changed) {
+            table[i].data_offset = offset;
+            offset = align_up(offset + info.size * sizeof(float));
+            ++stats.tensors_written;
+        }
+    }
+
+    stats.path = checkpoint_path(dir, model.version());
+    const std::string temp = stats.path + ".tmp";
+
+    // Straight from the model's memory, padding from a shared block of zeros
+    Gather file;
+    file.add(&header, sizeof(header));
+    file.add(table.data(), table.size() * sizeof(CheckpointTensor));
+    file.add(names.data(), names.size());
+    std::uint64_t position = header.names_offset + names.size();
+    for (std::size_t i = 0; i < tensors.size(); ++i) {
+        if (table[i].data_offset == 0) {
+            continue;
+        }
+        file.add(kZeros, table[i].data_offset - position);
+        file.add(model.values().data() + tensors[i].offset, tensors[i].size * sizeof(float));
+        position = table[i].data_offset + tensors[i].size * sizeof(float);
+    }
+    file.add(kZeros, align_up(position) - position);
+    stats.bytes = align_up(position);
+
+#ifndef _WIN32
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create checkpoint " + temp);
+    }
+    try {
+        file.write(fd, 0, io);   // Flushed to disk before the rename
+    } catch (const std::exception& e) {
+        ::close(fd);
+        std::error_code ignored;
+        fs::remove(temp, ignored);
+        throw std::runtime_error("Failed to write checkpoint " + temp + ": " + e.what());
+    }
+    ::close(fd);
+#else
+    (void)io;
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Failed to create checkpoint " + temp);
+        }
+        file.write(out);
+        out.close();
+        if (out.fail()) {
+            std::error_code ignored;
+            fs::remove(temp, ignored);
+            throw std::runtime_error("Failed to write checkpoint " + temp);
+        }
+    }
+#endif
+    fs::rename(temp, stats.path);
+    return stats;
+}
+
+// =============================================================================
+// Reading
+// =============================================================================
+
+CheckpointFile::CheckpointFile(const std::string& path) : file_(path) {
+    if (file_.size() < sizeof(CheckpointHeader)) {
+        throw std::runtime_error("Checkpoint too small: " + path);
+    }
+    header_ = reinterpret_cast<const CheckpointHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0 ||
+        header_->version != kCheckpointVersion) {
+        throw std::runtime_error("Not a version " + std::to_string(kCheckpointVersion) + " checkpoint: " + path);
+    }
+    bool little = (header_->flags & kCheckpointLittleEndian) != 0;
+    if (little != (std::endian::native == std::endian::little)) {
+        throw std::runtime_error("Checkpoint was written with a different byte order: " + path);
+    }
+
+    const std::uint64_t table_end = sizeof(CheckpointHeader) +
+                                    std::uint64_t{header_->num_tensors} * sizeof(CheckpointTensor);
+    if (header_->names_offset < table_end || header_->names_offset > file_.size()) {
+        throw std::runtime_error("Corrupt checkpoint table: " + path);
+    }
+    table_ = reinterpret_cast<const CheckpointTensor*>(file_.data() + sizeof(CheckpointHeader));
+
+    for (std::size_t i = 0; i < num_tensors(); ++i) {
+        const auto& entry = table_[i];
+        bool name_ok = header_->names_offset + entry.name_offset + entry.name_bytes <= file_.size();
+        bool data_ok = entry.data_offset == 0 ||
+                       (entry.data_offset % kAlignment == 0 && entry.data_offset >= header_->names_offset &&
+                        entry.data_offset + entry.elements * sizeof(float) <= file_.size());
+        if (!name_ok || !data_ok || entry.rank > 4) {
+            throw std::runtime_error("Corrupt checkpoint tensor " + std::to_string(i) + ": " + path);
+        }
+        if (full() && entry.data_offset == 0 && entry.elements > 0) {
+            throw std::runtime_error("Full checkpoint is missing tensor data: " + path);
+        }
+    }
+}
+
+std::string_view CheckpointFile::name(std::size_t i) const {
+    const auto& entry = table_[i];
+    return {reinterpret_cast<const char*>(file_.data() + header_->names_offset + entry.name_offset),
+            entry.name_bytes};
+}
+
+std::span<const float> CheckpointFile::data(std::size_t i) const {
+    const auto& entry = table_[i];
+    if (entry.data_offset == 0) {
+        return {};
+    }
+    return {reinterpret_cast<const float*>(file_.data() + entry.data_offset), entry.elements};
+}
+
+bool CheckpointFile::verify(std::size_t i) const {
+    return fnv1a(data(i)) == table_[i].checksum;
+}
+
+ModelConfig CheckpointFile::config() const {
+    ModelConfig config;
+    config.vocab_size = header_->vocab_size;
+    config.embed_dim = header_->embed_dim;
+    config.num_heads = header_->num_heads;
+    config.num_layers = header_->num_layers;
+    config.max_seq_length = header_->max_seq_length;
+    return config;
+}
+
+std::vector<std::uint64_t> list_checkpoints(const std::string& dir) {
+    std::vector<std::uint64_t> versions;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (auto version = parse_version(entry.path().filename().string())) {
+            versions.push_back(*version);
+        }
+    }
+    std::sort(versions.begin(), versions.end());
+    return versions;
+}
+
+std::optional<ModelState> load_latest_checkpoint(const std::string& dir, const ModelConfig& config) {
+    auto versions = list_checkpoints(dir);
+    if (versions.empty()) {
+        return std::nullopt;
+    }
+
+    // Newest first back to the full checkpoint, then replayed oldest first
+    std::vector<CheckpointFile> chain;
+    chain.emplace_back(checkpoint_path(dir, versions.back()));
+    while (!chain.back().full()) {
+        std::uint64_t base = chain.back().header().base_version;
+        if (!std::binary_search(versions.begin(), versions.end(), base) ||
+            base >= chain.back().header().model_version) {
+            throw std::runtime_error("Checkpoint " + std::to_string(chain.back().header().model_version) +
+                                     " needs missing base version " + std::to_string(base));
+        }
+        chain.emplace_back(checkpoint_path(dir, base));
+    }
+
+    ModelState model = ModelState::layout(config);
+    const auto& tensors = model.tensors();
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const CheckpointFile& file = *it;
+        ModelConfig stored = file.config();
+        if (stored.vocab_size != config.vocab_size || stored.embed_dim != config.embed_dim ||
+            stored.num_heads != config.num_heads || stored.num_layers != config.num_layers ||
+            stored.max_seq_length != config.max_seq_length || file.num_tensors() != tensors.size()) {
+            throw std::runtime_error("Checkpoint " + std::to_string(file.header().model_version) +
+                                     " was written for a different model architecture");
+        }
+
+        for (std::size_t i = 0; i < tensors.size(); ++i) {
+            if (file.name(i) != tensors[i].name || file.tensor(i).elements != tensors[i].size) {
+                throw std::runtime_error("Checkpoint tensor " + std::string(file.name(i)) +
+                                         " does not match " + tensors[i].name);
+            }
+            auto data = file.data(i);
+            if (data.empty()) {
+                continue;
+            }
+            if (!file.verify(i)) {
+                throw std::runtime_error("Checksum mismatch in tensor " + tensors[i].name + " of checkpoint " +
+                                         std::to_string(file.header().model_version));
+            }
+            std::copy(data.begin(), data.end(), model.values().begin() + static_cast<std::ptrdiff_t>(tensors[i].offset));
+        }
+        model.set_version(file.header().model_version);
+    }
+    return model;
+}
+
+// =============================================================================
+// Model Log
+// =============================================================================
+
+ModelLogWriter::ModelLogWriter(std::string path, IoLoop* io) : path_(std::move(path)), io_(io) {
+#ifndef _WIN32
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to create model log " + path_);
+    }
+#else
+    out_.open(path_, std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        throw std::runtime_error("Failed to create model log " + path_);
+    }
+#endif
+}
+
+ModelLogWriter::~ModelLogWriter() {
+#ifndef _WIN32
+    ::close(fd_);
+#endif
+}
+
+std::uint64_t ModelLogWriter::append(const ModelState& model, const ModelState& previous) {
+    const auto& tensors = model.tensors();
+    if (previous.values().size() != model.values().size()) {
+        throw std::invalid_argument("ModelLogWriter: models have different layouts");
+    }
+
+    std::vector<std::uint32_t> changed;
+    std::uint64_t data_bytes = 0;
+    for (std::size_t i = 0; i < tensors.size(); ++i) {
+        const TensorInfo& info = tensors[i];
+        if (std::memcmp(model.values().data() + info.offset, previous.values().data() + info.offset,
+                        info.size * sizeof(float)) != 0) {
+            changed.push_back(static_cast<std::uint32_t>(i));
+            data_bytes += info.size * sizeof(float);
+        }
+    }
+    const auto count = static_cast<std::uint32_t>(changed.size());
+    changed.resize((changed.size() + 1) & ~std::size_t{1}, 0);   // Pad the indices to 8 bytes
+    const std::uint64_t index_bytes = changed.size() * sizeof(std::uint32_t);
+
+    ModelLogRecord record{};
+    std::memcpy(record.magic, kLogMagic, sizeof(kLogMagic));
+    record.tensors = count;
+    record.base_version = previous.version();
+    record.model_version = model.version();
+    record.payload_bytes = index_bytes + data_bytes;
+
+    std::uint64_t hash = fnv1a(std::as_bytes(std::span(changed)));
+    for (std::uint32_t k = 0; k < count; ++k) {
+        const TensorInfo& info = tensors[changed[k]];
+        hash = fnv1a(std::as_bytes(model.values().subspan(info.offset, info.size)), hash);
+    }
+    record.checksum = hash;
+
+    // One gathered write and an fsync: with io_uring, a single syscall
+    Gather append;
+    append.add(&record, sizeof(record));
+    append.add(changed.data(), index_bytes);
+    for (std::uint32_t k = 0; k < count; ++k) {
+        const TensorInfo& info = tensors[changed[k]];
+        append.add(model.values().data() + info.offset, info.size * sizeof(float));
+    }
+#ifndef _WIN32
+    try {
+        append.write(fd_, size_, io_);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to append to model log " + path_ + ": " + e.what());
+    }
+    size_ += append.bytes();
+#else
+    append.write(out_);
+    out_.flush();
+    if (!out_) {
+        throw std::runtime_error("Failed to append to model log " + path_);
+    }
+#endif
+    return sizeof(record) + record.payload_bytes;
+}
+
+std::size_t replay_model_log(const std::string& path, ModelState& model) {
+    if (!fs::exists(path)) {
+        return 0;
+    }
+    MappedFile file(path);
+    const auto& tensors = model.tensors();
+    std::size_t applied = 0;
+    std::uint64_t position = 0;
+
+    while (position + sizeof(ModelLogRecord) <= file.size()) {
+        ModelLogRecord record;
+        std::memcpy(&record, file.data() + position, sizeof(record));
+        const std::uint64_t index_bytes = (std::uint64_t{record.tensors} * sizeof(std::uint32_t) + 7) & ~std::uint64_t{7};
+        if (std::memcmp(record.magic, kLogMagic, sizeof(kLogMagic)) != 0 ||
+            record.base_version != model.version() || record.tensors > tensors.size() ||
+            record.payload_bytes < index_bytes ||
+            record.payload_bytes > file.size() - position - sizeof(record)) {
+            break;
+        }
+
+        const std::byte* payload = file.data() + position + sizeof(record);
+        std::vector<std::uint32_t> indices(index_bytes / sizeof(std::uint32_t));
+        std::memcpy(indices.data(), payload, index_bytes);
+
+        std::uint64_t data_bytes = 0;
+        bool valid = true;
+        for (std::uint32_t k = 0; k < record.tensors && valid; ++k) {
+            valid = indices[k] < tensors.size();
+            data_bytes += valid ? tensors[indices[k]].size * sizeof(float) : 0;
+        }
+        if (!valid || index_bytes + data_bytes != record.payload_bytes ||
+            fnv1a(std::span(payload, record.payload_bytes)) != record.checksum) {
+            break;   // Torn or corrupt: everything after it is unusable too
+        }
+
+        const std::byte* data = payload + index_bytes;
+        for (std::uint32_t k = 0; k < record.tensors; ++k) {
+            const TensorInfo& info = tensors[indices[k]];
+            std::memcpy(model.values().data() + info.offset, data, info.size * sizeof(float));
+            data += info.size * sizeof(float);
+        }
+        model.set_version(record.model_version);
+        position += sizeof(record) + record.payload_bytes;
+        ++applied;
+    }
+    return applied;
+}
+
+} // namespace hydra
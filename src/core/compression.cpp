@@ -0,0 +1,614 @@
+/**
+ * @file compression.cpp
+ * @brief Implementation of the content encodings
+ */
+
+#include "hydra/compression.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace hydra {
+
+namespace {
+
+// =============================================================================
+// Byte shuffle
+// =============================================================================
+
+// Byte b of float i goes to plane b; a tail that is not a whole float
+// stays where it is
+void shuffle(const std::byte* in, std::size_t size, std::byte* out) {
+    std::size_t count = size / sizeof(float);
+    std::byte* planes[4] = {out, out + count, out + 2 * count, out + 3 * count};
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // 16 floats at a time: four rounds of byte interleaving transpose the
+    // 16x4 byte matrix (registers are numbered so the planes come out in
+    // 0, 2, 1, 3 order)
+    for (; i + 16 <= count; i += 16) {
+        const auto* source = reinterpret_cast<const __m128i*>(in + i * sizeof(float));
+        __m128i r0 = _mm_loadu_si128(source);
+        __m128i r2 = _mm_loadu_si128(source + 1);
+        __m128i r1 = _mm_loadu_si128(source + 2);
+        __m128i r3 = _mm_loadu_si128(source + 3);
+        for (int round = 0; round < 2; ++round) {
+            __m128i t0 = _mm_unpacklo_epi8(r0, r1), t1 = _mm_unpackhi_epi8(r0, r1);
+            __m128i t2 = _mm_unpacklo_epi8(r2, r3), t3 = _mm_unpackhi_epi8(r2, r3);
+            r0 = _mm_unpacklo_epi8(t0, t2);
+            r2 = _mm_unpackhi_epi8(t0, t2);
+            r1 = _mm_unpacklo_epi8(t1, t3);
+            r3 = _mm_unpackhi_epi8(t1, t3);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(planes[0] + i), r0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(planes[1] + i), r2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(planes[2] + i), r1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(planes[3] + i), r3);
+    }
+#endif
+    for (; i < count; ++i) {
+        const std::byte* value = in + i * sizeof(float);
+        planes[0][i] = value[0];
+        planes[1][i] = value[1];
+        planes[2][i] = value[2];
+        planes[3][i] = value[3];
+    }
+    std::memcpy(out + count * sizeof(float), in + count * sizeof(float), size - count * sizeof(float));
+}
+
+void unshuffle(const std::byte* in, std::size_t size, std::byte* out) {
+    std::size_t count = size / sizeof(float);
+    const std::byte* planes[4] = {in, in + count, in + 2 * count, in + 3 * count};
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // The inverse transpose takes two rounds
+    for (; i + 16 <= count; i += 16) {
+        __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[0] + i));
+        __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[1] + i));
+        __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[2] + i));
+        __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes[3] + i));
+        __m128i t0 = _mm_unpacklo_epi8(r0, r1), t1 = _mm_unpackhi_epi8(r0, r1);
+        __m128i t2 = _mm_unpacklo_epi8(r2, r3), t3 = _mm_unpackhi_epi8(r2, r3);
+        auto* target = reinterpret_cast<__m128i*>(out + i * sizeof(float));
+        _mm_storeu_si128(target, _mm_unpacklo_epi8(t0, t2));
+        _mm_storeu_si128(target + 1, _mm_unpackhi_epi8(t0, t2));
+        _mm_storeu_si128(target + 2, _mm_unpacklo_epi8(t1, t3));
+        _mm_storeu_si128(target + 3, _mm_unpackhi_epi8(t1, t3));
+    }
+#endif
+    for (; i < count; ++i) {
+        std::byte* value = out + i * sizeof(float);
+        value[0] = planes[0][i];
+        value[1] = planes[1][i];
+        value[2] = planes[2][i];
+        value[3] = planes[3][i];
+    }
+    std::memcpy(out + count * sizeof(float), in + count * sizeof(float), size - count * sizeof(float));
+}
+
+// =============================================================================
+// LZ
+// =============================================================================
+//
+// Sequences in the LZ4 block layout: a token (literal count in the high
+// nibble, match length - 4 in the low one; 15 means more length bytes
+// follow, each adding up to 255), the literals, a 2-byte match offset and
+// the extra match length bytes. The last sequence has literals only.
+// Matches are found greedily through a hash of the next 4 bytes; after a
+// run of misses the search skips ahead faster, so incompressible data
+// costs little time.
+
+constexpr std::size_t kMinMatch = 4;
+constexpr int kHashBits = 14;
+
+std::uint32_t load32(const std::uint8_t* p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::uint32_t hash4(std::uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+// Bytes from pos that repeat those from candidate, given the first 4 do
+std::size_t match_length(const std::uint8_t* in, std::size_t candidate, std::size_t pos, std::size_t size) {
+    std::size_t length = kMinMatch;
+    while (pos + length + 8 <= size) {
+        std::uint64_t a, b;
+        std::memcpy(&a, in + candidate + length, 8);
+        std::memcpy(&b, in + pos + length, 8);
+        if (a != b) {
+            auto differ = std::endian::native == std::endian::little ? std::countr_zero(a ^ b)
+                                                                     : std::countl_zero(a ^ b);
+            return length + static_cast<std::size_t>(differ) / 8;
+        }
+        length += 8;
+    }
+    while (pos + length < size && in[candidate + length] == in[pos + length]) {
+        ++length;
+    }
+    return length;
+}
+
+std::uint8_t* put_length(std::uint8_t* out, std::size_t length) {
+    for (; length >= 255; length -= 255) {
+        *out++ = 255;
+    }
+    *out++ = static_cast<std::uint8_t>(length);
+    return out;
+}
+
+// Worst-case bytes for a sequence with these lengths
+std::size_t sequence_bound(std::size_t literals, std::size_t match) {
+    return 1 + (literals / 255 + 1) + literals + 2 + (match / 255 + 1);
+}
+
+// Packed size, or 0 if the sequences would not fit in capacity
+std::size_t lz_compress(const std::uint8_t* in, std::size_t size, std::uint8_t* out, std::size_t capacity) {
+    std::array<std::uint16_t, 1 << kHashBits> table{};   // Positions fit: blocks are at most 64 KiB
+    std::uint8_t* op = out;
+    std::uint8_t* const end = out + capacity;
+    std::size_t anchor = 0;
+
+    if (size > kMinMatch) {
+        const std::size_t limit = size - kMinMatch;   // Last position a 4-byte load fits at
+        std::size_t pos = 0;
+        std::size_t misses = 0;
+        while (pos <= limit) {
+            std::uint32_t sequence = load32(in + pos);
+            std::uint32_t slot = hash4(sequence);
+            std::size_t candidate = table[slot];
+            table[slot] = static_cast<std::uint16_t>(pos);
+            if (candidate >= pos || load32(in + candidate) != sequence) {
+                pos += 1 + (misses++ >> 5);
+                continue;
+            }
+            misses = 0;
+
+            while (pos > anchor && candidate > 0 && in[pos - 1] == in[candidate - 1]) {
+                --pos;
+                --candidate;
+            }
+            std::size_t length = match_length(in, candidate, pos, size);
+            std::size_t literals = pos - anchor;
+            if (sequence_bound(literals, length - kMinMatch) > static_cast<std::size_t>(end - op)) {
+                return 0;
+            }
+            std::uint8_t* token = op++;
+            *token = static_cast<std::uint8_t>((std::min<std::size_t>(literals, 15) << 4) |
+                                               std::min<std::size_t>(length - kMinMatch, 15));
+            if (literals >= 15) {
+                op = put_length(op, literals - 15);
+            }
+            std::memcpy(op, in + anchor, literals);
+            op += literals;
+            auto offset = static_cast<std::uint16_t>(pos - candidate);
+            std::memcpy(op, &offset, sizeof(offset));
+            op += sizeof(offset);
+            if (length - kMinMatch >= 15) {
+                op = put_length(op, length - kMinMatch - 15);
+            }
+
+            pos += length;
+            anchor = pos;
+            if (pos - 2 <= limit) {
+                table[hash4(load32(in + pos - 2))] = static_cast<std::uint16_t>(pos - 2);
+            }
+        }
+    }
+
+    std::size_t literals = size - anchor;
+    if (sequence_bound(literals, 0) > static_cast<std::size_t>(end - op)) {
+        return 0;
+    }
+    *op++ = static_cast<std::uint8_t>(std::min<std::size_t>(literals, 15) << 4);
+    if (literals >= 15) {
+        op = put_length(op, literals - 15);
+    }
+    std::memcpy(op, in + anchor, literals);
+    op += literals;
+    return static_cast<std::size_t>(op - out);
+}
+
+bool read_length(const std::uint8_t*& ip, const std::uint8_t* end, std::size_t& length) {
+    std::uint8_t byte;
+    do {
+        if (ip == end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Decodes exactly size bytes; false on any malformed or out-of-range sequence
+bool lz_decompress(const std::uint8_t* in, std::size_t packed, std::uint8_t* out, std::size_t size) {
+    const std::uint8_t* ip = in;
+    const std::uint8_t* const in_end = in + packed;
+    std::uint8_t* op = out;
+    std::uint8_t* const out_end = out + size;
+
+    while (ip < in_end) {
+        std::uint8_t token = *ip++;
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(ip, in_end, literals)) {
+            return false;
+        }
+        if (literals > static_cast<std::size_t>(in_end - ip) || literals > static_cast<std::size_t>(out_end - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == in_end) {
+            break;   // The last sequence
+        }
+
+        if (in_end - ip < 2) {
+            return false;
+        }
+        std::uint16_t offset;
+        std::memcpy(&offset, ip, sizeof(offset));
+        ip += sizeof(offset);
+        std::size_t length = token & 15;
+        if (length == 15 && !read_length(ip, in_end, length)) {
+            return false;
+        }
+        length += kMinMatch;
+        if (offset == 0 || offset > op - out || length > static_cast<std::size_t>(out_end - op)) {
+            return false;
+        }
+        const std::uint8_t* match = op - offset;
+        if (offset >= length) {
+            std::memcpy(op, match, length);
+        } else {
+            for (std::size_t i = 0; i < length; ++i) {   // Overlapping: a repeating pattern
+                op[i] = match[i];
+            }
+        }
+        op += length;
+    }
+    return op == out_end;
+}
+
+} // namespace
+
+// =============================================================================
+// Names and negotiation
+// =============================================================================
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// q-value the header gives coding (or "*"), -1 if it names neither
+double accepted(std::string_view header, std::string_view coding) {
+    double exact = -1.0;
+    double wildcard = -1.0;
+    while (!header.empty()) {
+        std::size_t comma = std::min(header.find(','), header.size());
+        std::string_view item = header.substr(0, comma);
+        header.remove_prefix(std::min(comma + 1, header.size()));
+
+        std::size_t semicolon = std::min(item.find(';'), item.size());
+        std::string_view name = trim(item.substr(0, semicolon));
+        double q = 1.0;
+        for (std::string_view params = item.substr(semicolon); !params.empty();) {
+            params.remove_prefix(1);   // The ';'
+            std::size_t next = std::min(params.find(';'), params.size());
+            std::string_view param = trim(params.substr(0, next));
+            params.remove_prefix(next);
+            if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                std::from_chars(param.data() + 2, param.data() + param.size(), q);
+            }
+        }
+        if (iequals(name, coding) || (coding == "gzip" && iequals(name, "x-gzip"))) {
+            exact = q;
+        } else if (name == "*") {
+            wildcard = q;
+        }
+    }
+    return exact >= 0.0 ? exact : wildcard;
+}
+
+} // namespace
+
+std::optional<ContentEncoding> parse_content_encoding(std::string_view name) {
+    for (auto encoding : {ContentEncoding::Identity, ContentEncoding::Lz, ContentEncoding::Deflate,
+                          ContentEncoding::Gzip}) {
+        if (iequals(name, content_encoding_name(encoding))) {
+            return encoding;
+        }
+    }
+    if (iequals(name, "lz")) {
+        return ContentEncoding::Lz;
+    }
+    if (iequals(name, "deflate")) {
+        return ContentEncoding::Deflate;
+    }
+    return std::nullopt;
+}
+
+const char* content_encoding_name(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Identity: return "identity";
+        case ContentEncoding::Lz:       return "x-hydra-lz";
+        case ContentEncoding::Deflate:  return "x-hydra-deflate";
+        case ContentEncoding::Gzip:     return "gzip";
+    }
+    return "unknown";
+}
+
+ContentEncoding negotiate_encoding(std::string_view accept_encoding, std::span<const ContentEncoding> offered) {
+    ContentEncoding best = ContentEncoding::Identity;
+    double best_q = 0.0;
+    for (ContentEncoding encoding : offered) {
+        double q = accepted(accept_encoding, content_encoding_name(encoding));
+        if (q > best_q) {
+            best = encoding;
+            best_q = q;
+        }
+    }
+    return best;
+}
+
+// =============================================================================
+// Compressor
+// =============================================================================
+
+struct Compressor::Deflater {
+    z_stream stream{};
+
+    explicit Deflater(int level) {
+        if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Compressor: deflateInit2 failed");
+        }
+    }
+    ~Deflater() { deflateEnd(&stream); }
+
+    // Packed size, or 0 if it would not fit in capacity
+    std::size_t pack(const std::byte* in, std::size_t size, std::byte* out, std::size_t capacity) {
+        deflateReset(&stream);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(in));
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = reinterpret_cast<Bytef*>(out);
+        stream.avail_out = static_cast<uInt>(capacity);
+        if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+            return 0;
+        }
+        return capacity - stream.avail_out;
+    }
+};
+
+Compressor::Compressor(ContentEncoding encoding, bool shuffle, int level)
+    : encoding_(encoding), shuffle_(shuffle) {
+    if (encoding == ContentEncoding::Deflate) {
+        deflater_ = std::make_unique<Deflater>(level);
+    } else if (encoding != ContentEncoding::Lz) {
+        throw std::invalid_argument(std::string("Compressor: cannot produce ") + content_encoding_name(encoding));
+    }
+    pending_.reserve(kEncodedBlockBytes);
+    out_.resize(sizeof(EncodedBlockHeader) + kEncodedBlockBytes);
+}
+
+Compressor::~Compressor() = default;
+
+std::span<const std::byte> Compressor::encode_block(std::span<const std::byte> raw) {
+    if (raw.empty() || raw.size() > kEncodedBlockBytes) {
+        throw std::invalid_argument("Compressor: blocks hold 1 to 64 KiB");
+    }
+    std::uint32_t flags = 0;
+    const std::byte* source = raw.data();
+    if (shuffle_ && raw.size() >= 2 * sizeof(float)) {
+        shuffled_.resize(raw.size());
+        shuffle(raw.data(), raw.size(), shuffled_.data());
+        source = shuffled_.data();
+        flags = EncodedBlockHeader::kBlockShuffled;
+    }
+
+    // Only a block that shrinks is packed
+    std::byte* packed = out_.data() + sizeof(EncodedBlockHeader);
+    std::size_t capacity = raw.size() - 1;
+    std::size_t size = encoding_ == ContentEncoding::Lz
+        ? lz_compress(reinterpret_cast<const std::uint8_t*>(source), raw.size(),
+                      reinterpret_cast<std::uint8_t*>(packed), capacity)
+        : deflater_->pack(source, raw.size(), packed, capacity);
+    if (size == 0) {
+        std::memcpy(packed, raw.data(), raw.size());
+        size = raw.size();
+        flags = EncodedBlockHeader::kBlockStored;
+    }
+
+    EncodedBlockHeader header{static_cast<std::uint32_t>(raw.size()), static_cast<std::uint32_t>(size) | flags};
+    std::memcpy(out_.data(), &header, sizeof(header));
+    return {out_.data(), sizeof(header) + size};
+}
+
+void Compressor::write(std::span<const std::byte> data, const Sink& sink) {
+    while (!data.empty()) {
+        if (pending_.empty() && data.size() >= kEncodedBlockBytes) {
+            sink(encode_block(data.first(kEncodedBlockBytes)));   // Straight from the caller's buffer
+            data = data.subspan(kEncodedBlockBytes);
+            continue;
+        }
+        std::size_t take = std::min(kEncodedBlockBytes - pending_.size(), data.size());
+        pending_.insert(pending_.end(), data.begin(), data.begin() + static_cast<std::ptrdiff_t>(take));
+        data = data.subspan(take);
+        if (pending_.size() == kEncodedBlockBytes) {
+            sink(encode_block(pending_));
+            pending_.clear();
+        }
+    }
+}
+
+void Compressor::finish(const Sink& sink) {
+    if (!pending_.empty()) {
+        sink(encode_block(pending_));
+        pending_.clear();
+    }
+}
+
+std::vector<std::byte> compress(ContentEncoding encoding, std::span<const std::byte> data, bool shuffle, int level) {
+    Compressor compressor(encoding, shuffle, level);
+    std::vector<std::byte> encoded;
+    auto append = [&](std::span<const std::byte> block) { encoded.insert(encoded.end(), block.begin(), block.end()); };
+    compressor.write(data, append);
+    compressor.finish(append);
+    return encoded;
+}
+
+// =============================================================================
+// Decompressor
+// =============================================================================
+
+struct Decompressor::Inflater {
+    z_stream stream{};
+
+    Inflater() {
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("Decompressor: inflateInit2 failed");
+        }
+    }
+    ~Inflater() { inflateEnd(&stream); }
+
+    bool unpack(const std::byte* in, std::size_t packed, std::byte* out, std::size_t size) {
+        inflateReset(&stream);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(in));
+        stream.avail_in = static_cast<uInt>(packed);
+        stream.next_out = reinterpret_cast<Bytef*>(out);
+        stream.avail_out = static_cast<uInt>(size);
+        return inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.avail_out == 0 && stream.avail_in == 0;
+    }
+};
+
+Decompressor::Decompressor() = default;
+Decompressor::~Decompressor() = default;
+
+void Decompressor::check(const EncodedBlockHeader& header, std::size_t remaining) {
+    constexpr std::uint32_t kKnown = EncodedBlockHeader::kBlockStored | EncodedBlockHeader::kBlockShuffled | 0xFFFFFF;
+    bool stored = header.packed & EncodedBlockHeader::kBlockStored;
+    if (header.raw_bytes == 0 || header.raw_bytes > kEncodedBlockBytes || header.raw_bytes > remaining ||
+        (header.packed & ~kKnown) != 0 || header.packed_bytes() == 0 ||
+        (stored ? header.packed_bytes() != header.raw_bytes : header.packed_bytes() >= header.raw_bytes)) {
+        throw std::runtime_error("Decompressor: malformed block header");
+    }
+}
+
+void Decompressor::decode_block(ContentEncoding encoding, const EncodedBlockHeader& header,
+                                std::span<const std::byte> packed, std::span<std::byte> out) {
+    if (packed.size() != header.packed_bytes() || out.size() != header.raw_bytes) {
+        throw std::invalid_argument("Decompressor: buffers do not match the block header");
+    }
+    if (header.packed & EncodedBlockHeader::kBlockStored) {
+        std::memcpy(out.data(), packed.data(), packed.size());
+        return;
+    }
+
+    bool shuffled = header.packed & EncodedBlockHeader::kBlockShuffled;
+    std::byte* target = out.data();
+    if (shuffled) {
+        shuffled_.resize(out.size());
+        target = shuffled_.data();
+    }
+    bool ok = false;
+    if (encoding == ContentEncoding::Lz) {
+        ok = lz_decompress(reinterpret_cast<const std::uint8_t*>(packed.data()), packed.size(),
+                           reinterpret_cast<std::uint8_t*>(target), out.size());
+    } else if (encoding == ContentEncoding::Deflate) {
+        if (!inflater_) {
+            inflater_ = std::make_unique<Inflater>();
+        }
+        ok = inflater_->unpack(packed.data(), packed.size(), target, out.size());
+    }
+    if (!ok) {
+        throw std::runtime_error(std::string("Decompressor: corrupt ") + content_encoding_name(encoding) + " block");
+    }
+    if (shuffled) {
+        unshuffle(shuffled_.data(), out.size(), out.data());
+    }
+}
+
+// =============================================================================
+// gzip splicing
+// =============================================================================
+
+DeflateSegment deflate_segment(std::string_view text, int level) {
+    z_stream stream{};
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflate_segment: deflateInit2 failed");
+    }
+
+    DeflateSegment segment;
+    segment.size = text.size();
+    segment.crc = static_cast<std::uint32_t>(crc32_z(0, reinterpret_cast<const Bytef*>(text.data()), text.size()));
+
+    // A sync flush at the end leaves the segment byte-aligned and open
+    constexpr std::size_t kChunk = 1 << 20;
+    std::array<Bytef, 64 << 10> buffer;
+    std::size_t offset = 0;
+    do {
+        std::size_t take = std::min(kChunk, text.size() - offset);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data() + offset));
+        stream.avail_in = static_cast<uInt>(take);
+        offset += take;
+        int flush = offset == text.size() ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        do {
+            stream.next_out = buffer.data();
+            stream.avail_out = static_cast<uInt>(buffer.size());
+            deflate(&stream, flush);
+            segment.data.append(reinterpret_cast<const char*>(buffer.data()), buffer.size() - stream.avail_out);
+        } while (stream.avail_out == 0);
+    } while (offset < text.size());
+
+    deflateEnd(&stream);
+    return segment;
+}
+
+std::string gzip_header() {
+    // Magic, deflate, no flags, no time, no extra flags, unknown OS
+    return std::string("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+}
+
+std::string gzip_trailer(std::initializer_list<const DeflateSegment*> segments) {
+    uLong crc = crc32(0, nullptr, 0);
+    std::uint64_t size = 0;
+    for (const DeflateSegment* segment : segments) {
+        crc = crc32_combine(crc, segment->crc, static_cast<z_off_t>(segment->size));
+        size += segment->size;
+    }
+
+    std::string trailer("\x03\x00", 2);   // Empty final block (fixed Huffman)
+    for (std::uint32_t word : {static_cast<std::uint32_t>(crc), static_cast<std::uint32_t>(size)}) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            trailer.push_back(static_cast<char>((word >> shift) & 0xFF));
+        }
+    }
+    return trailer;
+}
+
+} // namespace hydra
@@ -0,0 +1,101 @@
+/**
+ * @file coro.cpp
+ * @brief Implementation of Executor and RunLoop
+ */
+
+#include "hydra/coro.hpp"
+#include <algorithm>
+
+namespace hydra {
+
+// =============================================================================
+// Executor
+// =============================================================================
+
+Executor::Executor(std::size_t threads) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(threads, 1); ++i) {
+        threads_.emplace_back(&Executor::run, this);
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void Executor::post(std::function<void()> work) {
+    // One wake-up per burst: the thread that takes work wakes the next one
+    // if more is queued, instead of every post waking a thread
+    bool wake;
+    {
+        std::lock_guard lock(mutex_);
+        wake = queue_.empty();
+        queue_.push_back(std::move(work));
+    }
+    if (wake) {
+        wake_.notify_one();
+    }
+}
+
+void Executor::run() {
+    while (true) {
+        std::function<void()> work;
+        bool more;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            work = std::move(queue_.front());
+            queue_.pop_front();
+            more = !queue_.empty();
+        }
+        if (more) {
+            wake_.notify_one();   // Hand the rest on
+        }
+        work();
+    }
+}
+
+// =============================================================================
+// RunLoop
+// =============================================================================
+
+void RunLoop::schedule(std::coroutine_handle<> handle) {
+    // Notified under the lock: once it is released, the loop may finish
+    // and sync_wait() destroy this RunLoop, condition variable included
+    std::lock_guard lock(mutex_);
+    ready_.push_back(handle);
+    wake_.notify_one();
+}
+
+void RunLoop::run() {
+    while (true) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return finished_ || !ready_.empty(); });
+            if (ready_.empty()) {
+                return;
+            }
+            handle = ready_.front();
+            ready_.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+void RunLoop::finish() {
+    std::lock_guard lock(mutex_);   // As in schedule()
+    finished_ = true;
+    wake_.notify_one();
+}
+
+} // namespace hydra
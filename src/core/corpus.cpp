@@ -0,0 +1,275 @@
+/**
+ * @file corpus.cpp
+ * @brief Implementation of the corpus shard store
+ */
+
+#include "hydra/corpus.hpp"
+#include "hydra/model_state.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace {
+
+constexpr char kShardMagic[8] = {'H', 'Y', 'D', 'R', 'A', 'C', 'S', '1'};
+constexpr std::uint32_t kShardVersion = 1;
+constexpr const char* kManifestName = "corpus.manifest";
+
+std::uint64_t parse_uint(std::string_view raw) {
+    std::uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(raw.data(), raw.data() + raw.size(), value);
+    if (ec != std::errc() || ptr != raw.data() + raw.size()) {
+        throw std::invalid_argument("not an unsigned integer");
+    }
+    return value;
+}
+
+} // namespace
+
+// =============================================================================
+// ShardRef
+// =============================================================================
+
+std::string ShardRef::to_json() const {
+    return "{\"shard\": " + std::to_string(shard) +
+           ", \"offset\": " + std::to_string(offset) +
+           ", \"count\": " + std::to_string(count) + "}";
+}
+
+std::optional<ShardRef> ShardRef::from_json(std::string_view text) {
+    std::string_view shard = find_json_member(text, "shard");
+    std::string_view offset = find_json_member(text, "offset");
+    std::string_view count = find_json_member(text, "count");
+    if (shard.empty() || offset.empty() || count.empty()) {
+        return std::nullopt;
+    }
+
+    try {
+        return ShardRef{parse_uint(shard), parse_uint(offset), parse_uint(count)};
+    } catch (const std::invalid_argument&) {
+        return std::nullopt;
+    }
+}
+
+// =============================================================================
+// CorpusShard
+// =============================================================================
+
+CorpusShard::CorpusShard(const std::string& path) : path_(path), file_(path) {
+    if (file_.size() < sizeof(ShardHeader)) {
+        throw std::runtime_error("Corpus shard too small: " + path);
+    }
+
+    header_ = reinterpret_cast<const ShardHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kShardMagic, sizeof(kShardMagic)) != 0 ||
+        header_->version != kShardVersion) {
+        throw std::runtime_error("Not a corpus shard: " + path);
+    }
+
+    const std::uint64_t index_bytes = (header_->num_records + 1) * sizeof(std::uint64_t);
+    if (header_->index_offset % alignof(std::uint64_t) != 0 ||
+        header_->index_offset > file_.size() ||
+        file_.size() - header_->index_offset < index_bytes ||
+        header_->data_offset > header_->index_offset) {
+        throw std::runtime_error("Corrupt corpus shard index: " + path);
+    }
+
+    index_ = reinterpret_cast<const std::uint64_t*>(file_.data() + header_->index_offset);
+    records_ = reinterpret_cast<const char*>(file_.data() + header_->data_offset);
+
+    // Offsets must be monotonic and stay inside the data region
+    const std::uint64_t data_size = header_->index_offset - header_->data_offset;
+    for (std::uint64_t i = 0; i < header_->num_records; ++i) {
+        if (index_[i] > index_[i + 1]) {
+            throw std::runtime_error("Corrupt corpus shard offsets: " + path);
+        }
+    }
+    if (index_[header_->num_records] > data_size) {
+        throw std::runtime_error("Corrupt corpus shard offsets: " + path);
+    }
+}
+
+std::string_view CorpusShard::record(std::uint64_t i) const {
+    return {records_ + index_[i], static_cast<std::size_t>(index_[i + 1] - index_[i])};
+}
+
+// =============================================================================
+// CorpusStore
+// =============================================================================
+
+CorpusStore::CorpusStore(const std::string& dir) {
+    const std::filesystem::path root(dir);
+    std::ifstream manifest(root / kManifestName);
+    if (!manifest) {
+        throw std::runtime_error("Missing corpus manifest in " + dir);
+    }
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::uint64_t id = 0;
+        std::string file;
+        if (!(fields >> id >> file)) {
+            throw std::runtime_error("Malformed corpus manifest line: " + line);
+        }
+
+        CorpusShard shard((root / file).string());
+        if (shard.id() != id) {
+            throw std::runtime_error("Corpus shard id mismatch: " + file);
+        }
+
+        first_record_.push_back(total_records_);
+        total_records_ += shard.num_records();
+        shards_.push_back(std::move(shard));
+    }
+
+    if (shards_.empty()) {
+        throw std::runtime_error("Corpus has no shards: " + dir);
+    }
+}
+
+const CorpusShard* CorpusStore::shard(std::uint64_t id) const {
+    // Shards are written with consecutive ids, so try the direct slot first
+    if (id < shards_.size() && shards_[id].id() == id) {
+        return &shards_[id];
+    }
+    for (const auto& shard : shards_) {
+        if (shard.id() == id) {
+            return &shard;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::string_view> CorpusStore::read(const ShardRef& ref) const {
+    const CorpusShard* target = shard(ref.shard);
+    if (!target || ref.offset > target->num_records() ||
+        ref.count > target->num_records() - ref.offset) {
+        throw std::out_of_range("Shard reference outside the corpus");
+    }
+
+    std::vector<std::string_view> records;
+    records.reserve(ref.count);
+    for (std::uint64_t i = 0; i < ref.count; ++i) {
+        records.push_back(target->record(ref.offset + i));
+    }
+    return records;
+}
+
+ShardRef CorpusStore::sample(std::uint64_t random, std::uint64_t count) const {
+    // Pick a global record, then clamp the range to its shard
+    std::uint64_t global = total_records_ == 0 ? 0 : random % total_records_;
+    auto it = std::upper_bound(first_record_.begin(), first_record_.end(), global);
+    std::size_t index = static_cast<std::size_t>(it - first_record_.begin()) - 1;
+
+    const CorpusShard& target = shards_[index];
+    count = std::min(count, target.num_records());
+    std::uint64_t offset = std::min(global - first_record_[index], target.num_records() - count);
+    return ShardRef{target.id(), offset, count};
+}
+
+// =============================================================================
+// CorpusWriter
+// =============================================================================
+
+CorpusWriter::CorpusWriter(std::string dir, std::uint64_t max_shard_bytes)
+    : dir_(std::move(dir)), max_shard_bytes_(max_shard_bytes) {
+    std::filesystem::create_directories(dir_);
+}
+
+CorpusWriter::~CorpusWriter() {
+    if (!finished_) {
+        try {
+            finish();
+        } catch (...) {
+            // Destructors must not throw; call finish() to see errors
+        }
+    }
+}
+
+void CorpusWriter::add(std::string_view record) {
+    if (!out_.is_open()) {
+        open_shard();
+    }
+
+    out_.write(record.data(), static_cast<std::streamsize>(record.size()));
+    offsets_.push_back(offsets_.back() + record.size());
+
+    if (offsets_.back() >= max_shard_bytes_) {
+        close_shard();
+    }
+}
+
+std::size_t CorpusWriter::finish() {
+    if (out_.is_open()) {
+        close_shard();
+    }
+    finished_ = true;
+
+    std::ofstream manifest(std::filesystem::path(dir_) / kManifestName, std::ios::trunc);
+    manifest << "# id file records bytes\n";
+    for (const auto& entry : written_) {
+        manifest << entry.id << ' ' << entry.file << ' ' << entry.records << ' ' << entry.bytes << '\n';
+    }
+    if (!manifest) {
+        throw std::runtime_error("Failed to write corpus manifest in " + dir_);
+    }
+    return written_.size();
+}
+
+void CorpusWriter::open_shard() {
+    std::ostringstream name;
+    name << "shard-" << std::setw(6) << std::setfill('0') << written_.size() << ".hcs";
+
+    out_.open(std::filesystem::path(dir_) / name.str(), std::ios::binary | std::ios::trunc);
+    if (!out_) {
+        throw std::runtime_error("Failed to create corpus shard " + name.str());
+    }
+
+    written_.push_back({written_.size(), name.str(), 0, 0});
+    offsets_.assign(1, 0);
+
+    // Placeholder header, rewritten by close_shard()
+    ShardHeader header{};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void CorpusWriter::close_shard() {
+    const std::uint64_t data_bytes = offsets_.back();
+    const std::uint64_t padding = (8 - data_bytes % 8) % 8;
+    const char zeros[8] = {};
+    out_.write(zeros, static_cast<std::streamsize>(padding));
+    out_.write(reinterpret_cast<const char*>(offsets_.data()),
+               static_cast<std::streamsize>(offsets_.size() * sizeof(std::uint64_t)));
+
+    ShardEntry& entry = written_.back();
+    entry.records = offsets_.size() - 1;
+
+    ShardHeader header{};
+    std::memcpy(header.magic, kShardMagic, sizeof(kShardMagic));
+    header.version = kShardVersion;
+    header.shard_id = entry.id;
+    header.num_records = entry.records;
+    header.data_offset = sizeof(ShardHeader);
+    header.index_offset = sizeof(ShardHeader) + data_bytes + padding;
+    entry.bytes = header.index_offset + offsets_.size() * sizeof(std::uint64_t);
+
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    if (out_.fail()) {
+        throw std::runtime_error("Failed to write corpus shard " + entry.file);
+    }
+}
+
+} // namespace hydra
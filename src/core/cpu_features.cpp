@@ -0,0 +1,86 @@
+/**
+ * @file cpu_features.cpp
+ * @brief CPUID checks behind cpu_features.hpp
+ */
+
+#include "hydra/cpu_features.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define HYDRA_CPU_X86 1
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace hydra {
+
+#if defined(HYDRA_CPU_X86) && defined(_MSC_VER)
+
+namespace {
+
+struct Features {
+    bool avx2_fma{false};
+    bool avx512f{false};
+};
+
+Features detect() {
+    Features features;
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool fma = info[2] & (1 << 12);
+    bool osxsave = info[2] & (1 << 27);
+    if (!osxsave || max_leaf < 7) {
+        return features;
+    }
+    // The OS must save the registers across context switches
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    features.avx2_fma = (xcr0 & 0x6) == 0x6 && fma && (info[1] & (1 << 5));
+    features.avx512f = (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16));
+    return features;
+}
+
+const Features& features() {
+    static const Features detected = detect();
+    return detected;
+}
+
+} // namespace
+
+bool cpu_has_avx2_fma() {
+    return features().avx2_fma;
+}
+
+bool cpu_has_avx512f() {
+    return features().avx512f;
+}
+
+#elif defined(HYDRA_CPU_X86)
+
+// libgcc's checks include the XCR0 test for OS support
+bool cpu_has_avx2_fma() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool cpu_has_avx512f() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+
+#else
+
+bool cpu_has_avx2_fma() {
+    return false;
+}
+
+bool cpu_has_avx512f() {
+    return false;
+}
+
+#endif
+
+} // namespace hydra
@@ -4,6 +4,7 @@
  */
 
 #include "hydra/database.hpp"
+#include "hydra/metrics.hpp"
 #include <sqlite3.h>
 #include <stdexcept>
 #include <sstream>
@@ -12,6 +13,34 @@
 
 namespace hydra {
 
+namespace {
+
+// Registered on each method's first call; timing costs two clock reads
+Histogram& method_latency(const char* method) {
+    return metrics().histogram("hydra_db_seconds", "Database call latency by method", {{"method", method}});
+}
+
+// The current row of a SELECT * FROM tasks
+Task read_task(sqlite3_stmt* stmt) {
+    auto text = [stmt](int column) {
+        const unsigned char* value = sqlite3_column_text(stmt, column);
+        return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+    };
+    Task task;
+    task.task_id = text(0);
+    task.created_at = text(1);
+    task.assigned_to = text(2);
+    task.status = text(3);
+    task.data_batch = text(4);
+    task.result = text(5);
+    task.tokens_reward = sqlite3_column_double(stmt, 6);
+    task.completed_at = text(7);
+    task.size_units = static_cast<std::size_t>(sqlite3_column_int64(stmt, 8));
+    return task;
+}
+
+} // namespace
+
 // =============================================================================
 // Constructor and Destructor
 // =============================================================================
@@ -85,7 +114,8 @@ void Database::create_tables() {
             data_batch TEXT NOT NULL,
             result TEXT,
             tokens_reward REAL NOT NULL,
-            completed_at TEXT
+            completed_at TEXT,
+            size_units INTEGER NOT NULL DEFAULT 0
         )
     )";
 
@@ -100,14 +130,28 @@ void Database::create_tables() {
         )
     )";
 
+    const char* workers_table = R"(
+        CREATE TABLE IF NOT EXISTS workers (
+            user_id TEXT PRIMARY KEY,
+            status TEXT NOT NULL,
+            changed_at TEXT NOT NULL
+        )
+    )";
+
     // Execute table creation
     execute(users_table);
     execute(tasks_table);
     execute(transactions_table);
+    execute(workers_table);
+
+    // Databases created before tasks recorded their size (fails harmlessly
+    // once the column exists)
+    execute("ALTER TABLE tasks ADD COLUMN size_units INTEGER NOT NULL DEFAULT 0");
 
     // Create indices for better performance
     execute("CREATE INDEX IF NOT EXISTS idx_tasks_status ON tasks(status)");
     execute("CREATE INDEX IF NOT EXISTS idx_transactions_user ON transactions(user_id)");
+    execute("CREATE INDEX IF NOT EXISTS idx_tasks_assigned ON tasks(assigned_to)");
 }
 
 bool Database::execute(const std::string& sql) {
@@ -138,6 +182,9 @@ std::string Database::current_timestamp() {
 // =============================================================================
 
 bool Database::create_user(const std::string& user_id) {
+    static Histogram& latency = method_latency("create_user");
+    ScopedTimer timer(latency);
+
     const char* sql = "INSERT INTO users (user_id, created_at, total_tokens, total_work_done) "
                      "VALUES (?, ?, ?, ?)";
 
@@ -160,6 +207,9 @@ bool Database::create_user(const std::string& user_id) {
 }
 
 std::optional<User> Database::get_user(const std::string& user_id) {
+    static Histogram& latency = method_latency("get_user");
+    ScopedTimer timer(latency);
+
     const char* sql = "SELECT * FROM users WHERE user_id = ?";
 
     sqlite3_stmt* stmt;
@@ -187,6 +237,9 @@ std::optional<User> Database::get_user(const std::string& user_id) {
 bool Database::add_tokens(const std::string& user_id, double amount,
                          const std::string& transaction_type,
                          const std::string& description) {
+    static Histogram& latency = method_latency("add_tokens");
+    ScopedTimer timer(latency);
+
     // Start transaction
     execute("BEGIN TRANSACTION");
 
@@ -243,6 +296,9 @@ bool Database::add_tokens(const std::string& user_id, double amount,
 bool Database::create_task(const std::string& task_id,
                           const std::string& data_batch,
                           double tokens_reward) {
+    static Histogram& latency = method_latency("create_task");
+    ScopedTimer timer(latency);
+
     const char* sql = "INSERT INTO tasks (task_id, created_at, status, data_batch, tokens_reward) "
                      "VALUES (?, ?, ?, ?, ?)";
 
@@ -263,36 +319,97 @@ bool Database::create_task(const std::string& task_id,
     return rc == SQLITE_DONE;
 }
 
-std::optional<Task> Database::get_pending_task() {
-    const char* sql = "SELECT * FROM tasks WHERE status = 'pending' LIMIT 1";
+int Database::create_tasks(const std::vector<Task>& tasks) {
+    static Histogram& latency = method_latency("create_tasks");
+    ScopedTimer timer(latency);
+
+    if (tasks.empty()) {
+        return 0;
+    }
+
+    const char* sql = "INSERT INTO tasks (task_id, created_at, status, data_batch, tokens_reward, size_units) "
+                     "VALUES (?, ?, ?, ?, ?, ?)";
+
+    // One transaction and one prepared statement for the whole batch:
+    // per-row autocommit would cost a journal sync for every task
+    if (!execute("BEGIN TRANSACTION")) {
+        return 0;
+    }
 
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        return std::nullopt;
+        execute("ROLLBACK");
+        return 0;
     }
 
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        Task task;
-        task.task_id = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        task.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-
-        if (sqlite3_column_text(stmt, 2)) {
-            task.assigned_to = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    const std::string timestamp = current_timestamp();
+    for (const auto& task : tasks) {
+        sqlite3_bind_text(stmt, 1, task.task_id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, timestamp.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, "pending", -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, task.data_batch.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(stmt, 5, task.tokens_reward);
+        sqlite3_bind_int64(stmt, 6, static_cast<sqlite3_int64>(task.size_units));
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            sqlite3_finalize(stmt);
+            execute("ROLLBACK");
+            return 0;
         }
+        sqlite3_reset(stmt);
+    }
 
-        task.status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        task.data_batch = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    sqlite3_finalize(stmt);
+    // A failed COMMIT (e.g. SQLITE_BUSY or a full disk) leaves the
+    // transaction open; none of the rows are durable, so report none
+    if (!execute("COMMIT")) {
+        execute("ROLLBACK");
+        return 0;
+    }
+    return static_cast<int>(tasks.size());
+}
 
-        if (sqlite3_column_text(stmt, 5)) {
-            task.result = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        }
+int Database::count_tasks(const std::string& status, const std::string& assigned_to) {
+    static Histogram& latency = method_latency("count_tasks");
+    ScopedTimer timer(latency);
 
-        task.tokens_reward = sqlite3_column_double(stmt, 6);
+    std::string sql = "SELECT COUNT(*) FROM tasks WHERE status = ?";
+    if (!assigned_to.empty()) {
+        sql += " AND assigned_to = ?";
+    }
 
-        if (sqlite3_column_text(stmt, 7)) {
-            task.completed_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-        }
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+
+    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+    if (!assigned_to.empty()) {
+        sqlite3_bind_text(stmt, 2, assigned_to.c_str(), -1, SQLITE_TRANSIENT);
+    }
+
+    int count = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        count = sqlite3_column_int(stmt, 0);
+    }
+
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+std::optional<Task> Database::get_pending_task() {
+    static Histogram& latency = method_latency("get_pending_task");
+    ScopedTimer timer(latency);
+
+    const char* sql = "SELECT * FROM tasks WHERE status = 'pending' LIMIT 1";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return std::nullopt;
+    }
 
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        Task task = read_task(stmt);
         sqlite3_finalize(stmt);
         return task;
     }
@@ -302,6 +419,9 @@ std::optional<Task> Database::get_pending_task() {
 }
 
 bool Database::assign_task(const std::string& task_id, const std::string& user_id) {
+    static Histogram& latency = method_latency("assign_task");
+    ScopedTimer timer(latency);
+
     const char* sql = "UPDATE tasks SET status = 'assigned', assigned_to = ? WHERE task_id = ?";
 
     sqlite3_stmt* stmt;
@@ -318,9 +438,58 @@ bool Database::assign_task(const std::string& task_id, const std::string& user_i
     return rc == SQLITE_DONE;
 }
 
+bool Database::assign_task(const std::string& task_id, const std::string& user_id,
+                           const std::string& data_batch, double tokens_reward, std::size_t size_units) {
+    static Histogram& latency = method_latency("assign_task");
+    ScopedTimer timer(latency);
+
+    const char* sql = "UPDATE tasks SET status = 'assigned', assigned_to = ?, data_batch = ?, tokens_reward = ?, "
+                      "size_units = ? WHERE task_id = ?";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, user_id.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, data_batch.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_double(stmt, 3, tokens_reward);
+    sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(size_units));
+    sqlite3_bind_text(stmt, 5, task_id.c_str(), -1, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    return rc == SQLITE_DONE;
+}
+
+std::optional<Task> Database::get_task(const std::string& task_id) {
+    static Histogram& latency = method_latency("get_task");
+    ScopedTimer timer(latency);
+
+    const char* sql = "SELECT * FROM tasks WHERE task_id = ?";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return std::nullopt;
+    }
+
+    sqlite3_bind_text(stmt, 1, task_id.c_str(), -1, SQLITE_TRANSIENT);
+
+    std::optional<Task> task;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        task = read_task(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return task;
+}
+
 bool Database::complete_task(const std::string& task_id, const std::string& result) {
+    static Histogram& latency = method_latency("complete_task");
+    ScopedTimer timer(latency);
+
     const char* sql = "UPDATE tasks SET status = 'completed', result = ?, completed_at = ? "
-                     "WHERE task_id = ?";
+                     "WHERE task_id = ? AND status != 'completed'";
 
     sqlite3_stmt* stmt;
     if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -334,11 +503,14 @@ bool Database::complete_task(const std::string& task_id, const std::string& resu
     int rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
 
-    return rc == SQLITE_DONE;
+    return rc == SQLITE_DONE && sqlite3_changes(db_) == 1;
 }
 
 std::vector<Task> Database::get_user_tasks(const std::string& user_id,
                                            const std::string& status) {
+    static Histogram& latency = method_latency("get_user_tasks");
+    ScopedTimer timer(latency);
+
     std::vector<Task> tasks;
 
     std::string sql = "SELECT * FROM tasks WHERE assigned_to = ?";
@@ -358,32 +530,99 @@ std::vector<Task> Database::get_user_tasks(const std::string& user_id,
     }
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Task task;
-        task.task_id = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        task.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        tasks.push_back(read_task(stmt));
+    }
 
-        if (sqlite3_column_text(stmt, 2)) {
-            task.assigned_to = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        }
+    sqlite3_finalize(stmt);
+    return tasks;
+}
 
-        task.status = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        task.data_batch = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+int Database::requeue_tasks(const std::string& user_id) {
+    static Histogram& latency = method_latency("requeue_tasks");
+    ScopedTimer timer(latency);
 
-        if (sqlite3_column_text(stmt, 5)) {
-            task.result = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        }
+    const char* sql = "UPDATE tasks SET status = 'pending', assigned_to = NULL "
+                     "WHERE status = 'assigned' AND assigned_to = ?";
 
-        task.tokens_reward = sqlite3_column_double(stmt, 6);
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
 
-        if (sqlite3_column_text(stmt, 7)) {
-            task.completed_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-        }
+    sqlite3_bind_text(stmt, 1, user_id.c_str(), -1, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    return rc == SQLITE_DONE ? sqlite3_changes(db_) : -1;
+}
+
+int Database::requeue_orphaned_tasks() {
+    static Histogram& latency = method_latency("requeue_orphaned_tasks");
+    ScopedTimer timer(latency);
+
+    const char* sql = "UPDATE tasks SET status = 'pending', assigned_to = NULL "
+                     "WHERE status = 'assigned' AND assigned_to NOT IN "
+                     "(SELECT user_id FROM workers WHERE status = 'online')";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    return rc == SQLITE_DONE ? sqlite3_changes(db_) : -1;
+}
+
+// =============================================================================
+// Worker Operations
+// =============================================================================
+
+bool Database::set_worker_status(const std::string& user_id, const std::string& status) {
+    static Histogram& latency = method_latency("set_worker_status");
+    ScopedTimer timer(latency);
+
+    const char* sql = "INSERT INTO workers (user_id, status, changed_at) VALUES (?, ?, ?) "
+                     "ON CONFLICT(user_id) DO UPDATE SET status = excluded.status, "
+                     "changed_at = excluded.changed_at";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
 
-        tasks.push_back(std::move(task));
+    sqlite3_bind_text(stmt, 1, user_id.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, current_timestamp().c_str(), -1, SQLITE_TRANSIENT);
+
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+
+    return rc == SQLITE_DONE;
+}
+
+std::vector<std::string> Database::get_workers(const std::string& status) {
+    static Histogram& latency = method_latency("get_workers");
+    ScopedTimer timer(latency);
+
+    std::vector<std::string> workers;
+    const char* sql = "SELECT user_id FROM workers WHERE status = ?";
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return workers;
+    }
+
+    sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_TRANSIENT);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        workers.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
     }
 
     sqlite3_finalize(stmt);
-    return tasks;
+    return workers;
 }
 
 // =============================================================================
@@ -391,6 +630,9 @@ std::vector<Task> Database::get_user_tasks(const std::string& user_id,
 // =============================================================================
 
 std::vector<Transaction> Database::get_transactions(const std::string& user_id, int limit) {
+    static Histogram& latency = method_latency("get_transactions");
+    ScopedTimer timer(latency);
+
     std::vector<Transaction> transactions;
 
     std::string sql = "SELECT * FROM transactions WHERE user_id = ? ORDER BY timestamp DESC";
@@ -0,0 +1,256 @@
+/**
+ * @file gemm.cpp
+ * @brief Blocking, packing and kernel dispatch for sgemm
+ */
+
+#include "hydra/gemm.hpp"
+#include "hydra/arena.hpp"
+#include "hydra/cpu_features.hpp"
+#include "vector_ops.hpp"
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+namespace hydra {
+
+namespace {
+
+// Block sizes in elements. A kc x nr sliver of B (16 KiB at nr = 16) stays
+// in L1 while it meets every sliver of A; the mc x kc block of A (144 KiB)
+// stays in L2; the kc x nc panel of B (4 MiB) is read from L3. kMc is a
+// multiple of every kernel's mr, kNc of every nr.
+constexpr std::size_t kKc = 256;
+constexpr std::size_t kMc = 144;
+constexpr std::size_t kNc = 4096;
+
+// Up to this many rows of C with op(B) = B^T (a Linear layer decoding a
+// few tokens), packing would cost as much as the multiply itself
+constexpr std::size_t kSmallM = 4;
+
+// =============================================================================
+// Portable micro-kernel
+// =============================================================================
+
+// Fixed-size accumulators written so the compiler keeps them in whatever
+// vector registers the baseline target has
+constexpr std::size_t kPortableMr = 4;
+constexpr std::size_t kPortableNr = 16;
+
+void portable_kernel(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc) {
+    float acc[kPortableMr][kPortableNr] = {};
+    for (std::size_t p = 0; p < kc; ++p) {
+        const float* bp = b + p * kPortableNr;
+        for (std::size_t r = 0; r < kPortableMr; ++r) {
+            float ar = a[p * kPortableMr + r];
+            for (std::size_t j = 0; j < kPortableNr; ++j) {
+                acc[r][j] += ar * bp[j];
+            }
+        }
+    }
+    for (std::size_t r = 0; r < kPortableMr; ++r) {
+        for (std::size_t j = 0; j < kPortableNr; ++j) {
+            c[r * ldc + j] += acc[r][j];
+        }
+    }
+}
+
+// C += alpha * A B^T with rows of A and B contiguous: each row of B is read
+// once, from L1 for every row of A after the first
+void small_gemm_bt(std::size_t m, std::size_t n, std::size_t k, float alpha, const float* a, std::size_t lda,
+                   const float* b, std::size_t ldb, float* c, std::size_t ldc) {
+    for (std::size_t j = 0; j < n; ++j) {
+        for (std::size_t i = 0; i < m; ++i) {
+            c[i * ldc + j] += alpha * detail::dot(a + i * lda, b + j * ldb, k);
+        }
+    }
+}
+
+// =============================================================================
+// Dispatch
+// =============================================================================
+
+GemmIsa best_isa() {
+    for (GemmIsa isa : {GemmIsa::Avx512, GemmIsa::Avx2}) {
+        if (gemm_isa_supported(isa)) {
+            return isa;
+        }
+    }
+    return GemmIsa::Portable;
+}
+
+std::atomic<GemmIsa>& current_isa() {
+    static std::atomic<GemmIsa> isa{best_isa()};
+    return isa;
+}
+
+const detail::GemmKernel& kernel_for(GemmIsa isa) {
+    switch (isa) {
+#if defined(HYDRA_GEMM_X86)
+        case GemmIsa::Avx512: return detail::gemm_kernel_avx512();
+        case GemmIsa::Avx2: return detail::gemm_kernel_avx2();
+#endif
+        default: return detail::gemm_kernel_portable();
+    }
+}
+
+// =============================================================================
+// Packing
+// =============================================================================
+
+// Slivers of mr rows of alpha * op(A), column by column, zero-padded to a
+// multiple of mr rows so the kernel never reads past the block
+void pack_a(const detail::GemmKernel& kernel, bool trans, const float* a, std::size_t lda,
+            std::size_t rows, std::size_t depth, float alpha, float* out) {
+    for (std::size_t i0 = 0; i0 < rows; i0 += kernel.mr) {
+        std::size_t live = std::min(kernel.mr, rows - i0);
+        for (std::size_t p = 0; p < depth; ++p) {
+            for (std::size_t r = 0; r < kernel.mr; ++r) {
+                std::size_t i = i0 + r;
+                *out++ = r < live ? alpha * (trans ? a[p * lda + i] : a[i * lda + p]) : 0.0f;
+            }
+        }
+    }
+}
+
+// Slivers of nr columns of op(B), row by row, zero-padded likewise
+void pack_b(const detail::GemmKernel& kernel, bool trans, const float* b, std::size_t ldb,
+            std::size_t depth, std::size_t cols, float* out) {
+    for (std::size_t j0 = 0; j0 < cols; j0 += kernel.nr) {
+        std::size_t live = std::min(kernel.nr, cols - j0);
+        for (std::size_t p = 0; p < depth; ++p) {
+            if (!trans && live == kernel.nr) {
+                std::copy_n(b + p * ldb + j0, kernel.nr, out);
+                out += kernel.nr;
+                continue;
+            }
+            for (std::size_t j = 0; j < kernel.nr; ++j) {
+                std::size_t col = j0 + j;
+                *out++ = j < live ? (trans ? b[col * ldb + p] : b[p * ldb + col]) : 0.0f;
+            }
+        }
+    }
+}
+
+std::size_t round_up(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+const detail::GemmKernel& detail::gemm_kernel_portable() {
+    static const GemmKernel kernel{kPortableMr, kPortableNr, portable_kernel};
+    return kernel;
+}
+
+std::string_view to_string(GemmIsa isa) {
+    switch (isa) {
+        case GemmIsa::Avx512: return "avx512";
+        case GemmIsa::Avx2: return "avx2";
+        default: return "portable";
+    }
+}
+
+bool gemm_isa_supported(GemmIsa isa) {
+    if (isa == GemmIsa::Portable) {
+        return true;
+    }
+#if defined(HYDRA_GEMM_X86)
+    return isa == GemmIsa::Avx512 ? cpu_has_avx512f() : cpu_has_avx2_fma();
+#else
+    return false;
+#endif
+}
+
+GemmIsa gemm_isa() {
+    return current_isa().load(std::memory_order_relaxed);
+}
+
+void set_gemm_isa(GemmIsa isa) {
+    if (!gemm_isa_supported(isa)) {
+        throw std::invalid_argument("GEMM kernel " + std::string(to_string(isa)) +
+                                    " is not available on this CPU or build");
+    }
+    current_isa().store(isa, std::memory_order_relaxed);
+}
+
+void sgemm(Transpose trans_a, Transpose trans_b,
+           std::size_t m, std::size_t n, std::size_t k,
+           float alpha, const float* a, std::size_t lda,
+           const float* b, std::size_t ldb,
+           float beta, float* c, std::size_t ldc) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+    // beta is applied once up front; the kernels only accumulate
+    if (beta != 1.0f) {
+        for (std::size_t i = 0; i < m; ++i) {
+            float* row = c + i * ldc;
+            if (beta == 0.0f) {
+                std::fill_n(row, n, 0.0f);
+            } else {
+                std::for_each(row, row + n, [beta](float& x) { x *= beta; });
+            }
+        }
+    }
+    if (k == 0 || alpha == 0.0f) {
+        return;
+    }
+
+    const bool ta = trans_a == Transpose::Yes;
+    const bool tb = trans_b == Transpose::Yes;
+    if (m <= kSmallM && !ta && tb) {
+        small_gemm_bt(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+        return;
+    }
+
+    const detail::GemmKernel& kernel = kernel_for(gemm_isa());
+
+    thread_local Arena arena((kMc * kKc + kKc * kNc) * sizeof(float) + 2 * Arena::kAlignment);
+    Arena::Scope scope(arena);   // Packing memory goes back however sgemm exits
+    const std::size_t kc_max = std::min(k, kKc);
+    float* packed_b = arena.allocate_floats(kc_max * round_up(std::min(n, kNc), kernel.nr));
+    float* packed_a = arena.allocate_floats(kc_max * round_up(std::min(m, kMc), kernel.mr));
+    float* tile = arena.allocate_floats(kernel.mr * kernel.nr);
+
+    for (std::size_t jc = 0; jc < n; jc += kNc) {
+        const std::size_t nc = std::min(kNc, n - jc);
+        for (std::size_t pc = 0; pc < k; pc += kKc) {
+            const std::size_t kc = std::min(kKc, k - pc);
+            pack_b(kernel, tb, tb ? b + jc * ldb + pc : b + pc * ldb + jc, ldb, kc, nc, packed_b);
+
+            for (std::size_t ic = 0; ic < m; ic += kMc) {
+                const std::size_t mc = std::min(kMc, m - ic);
+                pack_a(kernel, ta, ta ? a + pc * lda + ic : a + ic * lda + pc, lda, mc, kc, alpha, packed_a);
+
+                for (std::size_t jr = 0; jr < nc; jr += kernel.nr) {
+                    const std::size_t cols = std::min(kernel.nr, nc - jr);
+                    const float* bs = packed_b + jr * kc;
+                    for (std::size_t ir = 0; ir < mc; ir += kernel.mr) {
+                        const std::size_t rows = std::min(kernel.mr, mc - ir);
+                        const float* as = packed_a + ir * kc;
+                        float* cs = c + (ic + ir) * ldc + jc + jr;
+                        if (rows == kernel.mr && cols == kernel.nr) {
+                            kernel.run(kc, as, bs, cs, ldc);
+                            continue;
+                        }
+                        // Edge tile: run the full kernel into scratch, add the live part
+                        std::fill_n(tile, kernel.mr * kernel.nr, 0.0f);
+                        kernel.run(kc, as, bs, tile, kernel.nr);
+                        for (std::size_t r = 0; r < rows; ++r) {
+                            for (std::size_t j = 0; j < cols; ++j) {
+                                cs[r * ldc + j] += tile[r * kernel.nr + j];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace hydra
@@ -0,0 +1,49 @@
+/**
+ * @file gemm_avx2.cpp
+ * @brief AVX2/FMA sgemm micro-kernel (built with -mavx2 -mfma)
+ */
+
+#include "hydra/gemm.hpp"
+#include <immintrin.h>
+
+namespace hydra {
+
+namespace {
+
+// 6 x 16: twelve ymm accumulators, two for the B row, one broadcast
+constexpr std::size_t kMr = 6;
+constexpr std::size_t kNr = 16;
+
+void kernel(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc) {
+    __m256 acc[kMr][2];
+    for (auto& row : acc) {
+        row[0] = _mm256_setzero_ps();
+        row[1] = _mm256_setzero_ps();
+    }
+    for (std::size_t p = 0; p < kc; ++p) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+#pragma GCC unroll 6
+        for (std::size_t r = 0; r < kMr; ++r) {
+            __m256 ar = _mm256_broadcast_ss(a + r);
+            acc[r][0] = _mm256_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_ps(ar, b1, acc[r][1]);
+        }
+        a += kMr;
+        b += kNr;
+    }
+    for (std::size_t r = 0; r < kMr; ++r) {
+        float* row = c + r * ldc;
+        _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), acc[r][0]));
+        _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[r][1]));
+    }
+}
+
+} // namespace
+
+const detail::GemmKernel& detail::gemm_kernel_avx2() {
+    static const GemmKernel avx2{kMr, kNr, kernel};
+    return avx2;
+}
+
+} // namespace hydra
@@ -0,0 +1,49 @@
+/**
+ * @file gemm_avx512.cpp
+ * @brief AVX-512F sgemm micro-kernel (built with -mavx512f)
+ */
+
+#include "hydra/gemm.hpp"
+#include <immintrin.h>
+
+namespace hydra {
+
+namespace {
+
+// 12 x 32: twenty-four zmm accumulators, two for the B row, one broadcast
+constexpr std::size_t kMr = 12;
+constexpr std::size_t kNr = 32;
+
+void kernel(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc) {
+    __m512 acc[kMr][2];
+    for (auto& row : acc) {
+        row[0] = _mm512_setzero_ps();
+        row[1] = _mm512_setzero_ps();
+    }
+    for (std::size_t p = 0; p < kc; ++p) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+#pragma GCC unroll 12
+        for (std::size_t r = 0; r < kMr; ++r) {
+            __m512 ar = _mm512_set1_ps(a[r]);
+            acc[r][0] = _mm512_fmadd_ps(ar, b0, acc[r][0]);
+            acc[r][1] = _mm512_fmadd_ps(ar, b1, acc[r][1]);
+        }
+        a += kMr;
+        b += kNr;
+    }
+    for (std::size_t r = 0; r < kMr; ++r) {
+        float* row = c + r * ldc;
+        _mm512_storeu_ps(row, _mm512_add_ps(_mm512_loadu_ps(row), acc[r][0]));
+        _mm512_storeu_ps(row + 16, _mm512_add_ps(_mm512_loadu_ps(row + 16), acc[r][1]));
+    }
+}
+
+} // namespace
+
+const detail::GemmKernel& detail::gemm_kernel_avx512() {
+    static const GemmKernel avx512{kMr, kNr, kernel};
+    return avx512;
+}
+
+} // namespace hydra
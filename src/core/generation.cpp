@@ -0,0 +1,177 @@
+/**
+ * @file generation.cpp
+ * @brief Implementation of batched autoregressive generation
+ */
+
+#include "hydra/generation.hpp"
+#include "hydra/tokenizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace hydra {
+
+const char* finish_reason_name(FinishReason reason) {
+    switch (reason) {
+        case FinishReason::End:       return "end";
+        case FinishReason::Length:    return "length";
+        case FinishReason::CacheFull: return "cache_full";
+    }
+    return "unknown";
+}
+
+// =============================================================================
+// Sampling
+// =============================================================================
+
+TokenSampler::TokenSampler(const SamplingOptions& options)
+    : options_(options),
+      rng_(options.seed ? options.seed : std::random_device{}()) {}
+
+std::size_t TokenSampler::sample(std::span<const float> logits) {
+    if (options_.temperature <= 0.0f || options_.top_k == 1) {
+        return static_cast<std::size_t>(std::max_element(logits.begin(), logits.end()) - logits.begin());
+    }
+
+    candidates_.clear();
+    for (std::size_t i = 0; i < logits.size(); ++i) {
+        candidates_.emplace_back(logits[i], static_cast<std::uint32_t>(i));
+    }
+    std::size_t k = options_.top_k ? std::min(options_.top_k, candidates_.size()) : candidates_.size();
+    std::partial_sort(candidates_.begin(), candidates_.begin() + static_cast<std::ptrdiff_t>(k), candidates_.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+    candidates_.resize(k);
+
+    // Softmax with temperature, most likely first
+    float max_logit = candidates_.front().first;
+    double total = 0.0;
+    for (auto& candidate : candidates_) {
+        candidate.first = std::exp((candidate.first - max_logit) / options_.temperature);
+        total += candidate.first;
+    }
+
+    // Nucleus: cut once the kept tokens hold top_p of the mass
+    if (options_.top_p < 1.0f) {
+        double kept = 0.0;
+        for (std::size_t i = 0; i < candidates_.size(); ++i) {
+            kept += candidates_[i].first;
+            if (kept >= options_.top_p * total) {
+                candidates_.resize(i + 1);
+                total = kept;
+                break;
+            }
+        }
+    }
+
+    double target = std::uniform_real_distribution<double>(0.0, total)(rng_);
+    for (const auto& candidate : candidates_) {
+        target -= candidate.first;
+        if (target <= 0.0) {
+            return candidate.second;
+        }
+    }
+    return candidates_.back().second;
+}
+
+// =============================================================================
+// Generation
+// =============================================================================
+
+std::vector<Generation> generate(const ModelState& model,
+                                 KvPagePool& pool,
+                                 std::span<const std::vector<std::uint32_t>> prompts,
+                                 std::span<const GenerationOptions> options,
+                                 ForwardWorkspace& workspace) {
+    if (prompts.size() != options.size()) {
+        throw std::invalid_argument("generate: need one GenerationOptions per prompt");
+    }
+
+    const auto vocab = static_cast<std::size_t>(model.config().vocab_size);
+    const auto max_length = static_cast<std::size_t>(model.config().max_seq_length);
+    std::vector<Generation> results(prompts.size());
+    std::vector<KvCache> caches;
+    std::vector<TokenSampler> samplers;
+    caches.reserve(prompts.size());
+    samplers.reserve(prompts.size());
+    for (const auto& option : options) {
+        caches.emplace_back(pool);
+        samplers.emplace_back(option.sampling);
+    }
+
+    // Sample from <END> up to token_end; <PAD>, <UNK> and <START> never
+    auto pick = [&](std::size_t s, const float* row) {
+        std::size_t end = options[s].token_end ? std::min<std::size_t>(options[s].token_end, vocab) : vocab;
+        end = std::max<std::size_t>(end, Tokenizer::kEnd + 1);
+        return static_cast<std::uint32_t>(Tokenizer::kEnd +
+            samplers[s].sample({row + Tokenizer::kEnd, end - Tokenizer::kEnd}));
+    };
+
+    // Record a sampled token; returns true if the sequence goes on
+    auto accept = [&](std::size_t s, std::uint32_t token) {
+        Generation& result = results[s];
+        if (token == Tokenizer::kEnd) {
+            result.finish = FinishReason::End;
+            return false;
+        }
+        result.tokens.push_back(token);
+        if (result.tokens.size() >= options[s].max_new_tokens || caches[s].length() >= max_length) {
+            result.finish = FinishReason::Length;
+            return false;
+        }
+        if (!caches[s].reserve(caches[s].length() + 1)) {
+            result.finish = FinishReason::CacheFull;
+            return false;
+        }
+        return true;
+    };
+
+    // Prefill every prompt that gets its pages
+    std::vector<std::size_t> active;
+    std::vector<KvCache*> active_caches;
+    std::vector<std::vector<std::uint32_t>> active_prompts;
+    for (std::size_t s = 0; s < prompts.size(); ++s) {
+        if (options[s].max_new_tokens == 0) {
+            continue;
+        }
+        if (!caches[s].reserve(prompts[s].size())) {
+            results[s].finish = FinishReason::CacheFull;
+            caches[s].clear();
+            continue;
+        }
+        active.push_back(s);
+        active_caches.push_back(&caches[s]);
+        active_prompts.push_back(prompts[s]);
+    }
+    if (active.empty()) {
+        return results;
+    }
+
+    std::vector<float> logits;
+    forward_last_logits(model, active_prompts, logits, workspace, active_caches);
+
+    // Decode the survivors in lockstep
+    std::vector<std::uint32_t> next;
+    while (!active.empty()) {
+        std::vector<std::size_t> still;
+        next.clear();
+        active_caches.clear();
+        for (std::size_t i = 0; i < active.size(); ++i) {
+            std::size_t s = active[i];
+            std::uint32_t token = pick(s, logits.data() + i * vocab);
+            if (accept(s, token)) {
+                still.push_back(s);
+                next.push_back(token);
+                active_caches.push_back(&caches[s]);
+            } else {
+                caches[s].clear();   // Pages go back to the pool right away
+            }
+        }
+        active.swap(still);
+        if (!active.empty()) {
+            decode_step(model, next, active_caches, logits, workspace);
+        }
+    }
+    return results;
+}
+
+} // namespace hydra
@@ -0,0 +1,52 @@
+/**
+ * @file hash_ring.cpp
+ * @brief Implementation of HashRing
+ */
+
+#include "hydra/hash_ring.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace hydra {
+
+HashRing::HashRing(std::vector<std::string> nodes, std::size_t virtual_nodes)
+    : nodes_(std::move(nodes)) {
+    if (nodes_.empty() || virtual_nodes == 0) {
+        throw std::invalid_argument("HashRing: need at least one node and one virtual node");
+    }
+
+    points_.reserve(nodes_.size() * virtual_nodes);
+    for (std::size_t n = 0; n < nodes_.size(); ++n) {
+        for (std::size_t v = 0; v < virtual_nodes; ++v) {
+            points_.emplace_back(hash(nodes_[n] + "#" + std::to_string(v)), static_cast<std::uint32_t>(n));
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+std::size_t HashRing::owner(std::string_view key) const {
+    auto it = std::lower_bound(points_.begin(), points_.end(),
+                               std::pair<std::uint64_t, std::uint32_t>{hash(key), 0});
+    if (it == points_.end()) {
+        it = points_.begin();   // Wrap around the ring
+    }
+    return it->second;
+}
+
+std::uint64_t HashRing::hash(std::string_view key) {
+    std::uint64_t h = 14695981039346656037ull;   // FNV-1a
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+
+    // splitmix64 finalizer: FNV alone clusters similar keys ("node#1", "node#2")
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+} // namespace hydra
@@ -0,0 +1,1003 @@
+/**
+ * @file io_loop.cpp
+ * @brief Implementation of the io_uring and epoll I/O loops
+ */
+
+#include "hydra/io_loop.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if !defined(HYDRA_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#ifdef IORING_CQE_F_NOTIF   // Zero-copy sends: kernel headers from 6.0 on
+#define HYDRA_HAVE_IO_URING 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace hydra {
+
+namespace {
+
+constexpr std::size_t kMaxIov = IOV_MAX;   // Parts per writev/sendmsg
+
+std::runtime_error io_error(const std::string& what, int error) {
+    return std::runtime_error("I/O loop: " + what + ": " + std::strerror(error));
+}
+
+std::size_t total_bytes(std::span<const iovec> parts) {
+    std::size_t total = 0;
+    for (const iovec& part : parts) {
+        total += part.iov_len;
+    }
+    return total;
+}
+
+// Drop sent bytes from the front of parts[next...]; returns the new next
+std::size_t advance(std::vector<iovec>& parts, std::size_t next, std::size_t bytes) {
+    while (next < parts.size() && bytes >= parts[next].iov_len) {
+        bytes -= parts[next].iov_len;
+        ++next;
+    }
+    if (next < parts.size()) {
+        parts[next].iov_base = static_cast<char*>(parts[next].iov_base) + bytes;
+        parts[next].iov_len -= bytes;
+    }
+    return next;
+}
+
+// pwritev in chunks of kMaxIov parts, retrying short writes, then fsync
+void pwrite_all(int fd, std::span<const iovec> parts, std::uint64_t offset, bool sync,
+                std::atomic<std::uint64_t>* syscalls) {
+    std::vector<iovec> rest(parts.begin(), parts.end());
+    std::size_t next = 0;
+    while (next < rest.size()) {
+        if (rest[next].iov_len == 0) {
+            ++next;
+            continue;
+        }
+        auto count = static_cast<int>(std::min(kMaxIov, rest.size() - next));
+        ssize_t n = ::pwritev(fd, rest.data() + next, count, static_cast<off_t>(offset));
+        if (syscalls) {
+            syscalls->fetch_add(1, std::memory_order_relaxed);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw io_error("write", errno);
+        }
+        offset += static_cast<std::uint64_t>(n);
+        next = advance(rest, next, static_cast<std::size_t>(n));
+    }
+    if (sync) {
+        if (syscalls) {
+            syscalls->fetch_add(1, std::memory_order_relaxed);
+        }
+        if (::fsync(fd) != 0) {
+            throw io_error("fsync", errno);
+        }
+    }
+}
+
+} // namespace
+
+std::optional<IoBackend> parse_io_backend(std::string_view name) {
+    if (name == "off") return IoBackend::Off;
+    if (name == "epoll") return IoBackend::Epoll;
+    if (name == "io_uring") return IoBackend::IoUring;
+    if (name == "auto") return IoBackend::Auto;
+    return std::nullopt;
+}
+
+const char* io_backend_name(IoBackend backend) {
+    switch (backend) {
+        case IoBackend::Off:     return "off";
+        case IoBackend::Epoll:   return "epoll";
+        case IoBackend::IoUring: return "io_uring";
+        case IoBackend::Auto:    return "auto";
+    }
+    return "unknown";
+}
+
+void write_file(int fd, std::span<const iovec> parts, std::uint64_t offset, bool sync, IoLoop* io) {
+    if (io) {
+        io->write_file(fd, parts, offset, sync);
+    } else {
+        pwrite_all(fd, parts, offset, sync, nullptr);
+    }
+}
+
+// =============================================================================
+// IoLoop
+// =============================================================================
+
+struct IoLoop::Posted {
+    std::mutex mutex;
+    std::vector<std::function<void()>> tasks;
+    std::atomic<bool> stopping{false};
+};
+
+IoLoop::IoLoop() : posted_(std::make_unique<Posted>()) {
+    // Blocking: io_uring would answer a read on a non-blocking eventfd with
+    // EAGAIN instead of waiting for it
+    wake_fd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        throw io_error("eventfd", errno);
+    }
+}
+
+IoLoop::~IoLoop() {
+    ::close(wake_fd_);
+}
+
+int IoLoop::register_buffer(std::span<const std::byte>) {
+    return -1;
+}
+
+void IoLoop::unregister_buffer(int) {}
+
+void IoLoop::write_file(int fd, std::span<const iovec> parts, std::uint64_t offset, bool sync) {
+    pwrite_all(fd, parts, offset, sync, &syscalls_);
+    operations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void IoLoop::close(int fd) {
+    ::close(fd);
+}
+
+void IoLoop::post(std::function<void()> task) {
+    bool wake;
+    {
+        std::lock_guard lock(posted_->mutex);
+        wake = posted_->tasks.empty();   // Otherwise a wake-up is already pending
+        posted_->tasks.push_back(std::move(task));
+    }
+    if (wake) {
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(wake_fd_, &one, sizeof(one));
+    }
+}
+
+void IoLoop::run() {
+    while (!posted_->stopping.load(std::memory_order_acquire)) {
+        poll();
+    }
+    posted_->stopping.store(false, std::memory_order_relaxed);
+}
+
+void IoLoop::stop() {
+    posted_->stopping.store(true, std::memory_order_release);
+    std::uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void IoLoop::run_posted() {
+    // The eventfd was read before this swap, so a task posted after it
+    // signals again
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard lock(posted_->mutex);
+        tasks.swap(posted_->tasks);
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+IoLoopStats IoLoop::stats() const {
+    return {syscalls_.load(std::memory_order_relaxed), operations_.load(std::memory_order_relaxed)};
+}
+
+// =============================================================================
+// epoll
+// =============================================================================
+
+namespace {
+
+class EpollLoop final : public IoLoop {
+public:
+    EpollLoop() {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw io_error("epoll_create1", errno);
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = wake_fd_;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) != 0) {
+            int error = errno;
+            ::close(epoll_fd_);
+            throw io_error("epoll_ctl", error);
+        }
+    }
+
+    ~EpollLoop() override {
+        ::close(epoll_fd_);
+    }
+
+    IoBackend backend() const override { return IoBackend::Epoll; }
+
+    void accept(int listener, Callback done) override {
+        auto& watched = watch(listener);
+        if (!watched.listener) {
+            // accept4() must not block the loop when a peer gives up first
+            ::fcntl(listener, F_SETFL, ::fcntl(listener, F_GETFL) | O_NONBLOCK);
+            syscalls_.fetch_add(2, std::memory_order_relaxed);
+            watched.listener = true;
+        }
+        auto op = std::make_unique<Op>();
+        op->kind = Op::Accept;
+        op->fd = listener;
+        op->done = std::move(done);
+        start(watched.read, std::move(op));
+    }
+
+    void recv(int fd, void* data, std::size_t size, Callback done) override {
+        auto op = std::make_unique<Op>();
+        op->kind = Op::Recv;
+        op->fd = fd;
+        op->data = static_cast<char*>(data);
+        op->size = size;
+        op->done = std::move(done);
+        start(watch(fd).read, std::move(op));
+    }
+
+    void send(int fd, std::span<const iovec> parts, Callback done, int) override {
+        auto op = std::make_unique<Op>();
+        op->kind = Op::Send;
+        op->fd = fd;
+        op->parts.assign(parts.begin(), parts.end());
+        op->size = total_bytes(parts);
+        op->done = std::move(done);
+        start(watch(fd).write, std::move(op));
+    }
+
+    void cancel(int fd) override {
+        auto it = watched_.find(fd);
+        if (it == watched_.end()) {
+            return;
+        }
+        for (auto* slot : {&it->second.read, &it->second.write}) {
+            if (*slot) {
+                (*slot)->result = -ECANCELED;
+                ready_.push_back(std::move(*slot));
+            }
+        }
+    }
+
+    void close(int fd) override {
+        watched_.erase(fd);   // Closing also drops it from the epoll set
+        ::close(fd);
+    }
+
+protected:
+    void poll() override {
+        epoll_event events[256];
+        int n = ::epoll_wait(epoll_fd_, events, 256, ready_.empty() ? -1 : 0);
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        bool woken = false;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                std::uint64_t value;
+                [[maybe_unused]] auto got = ::read(wake_fd_, &value, sizeof(value));
+                syscalls_.fetch_add(1, std::memory_order_relaxed);
+                woken = true;
+                continue;
+            }
+            auto it = watched_.find(fd);
+            if (it == watched_.end()) {
+                continue;
+            }
+            // Errors and hang-ups wake both directions; the retried
+            // syscall reports them
+            if (it->second.read && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) &&
+                attempt(*it->second.read)) {
+                ready_.push_back(std::move(it->second.read));
+            }
+            if (it->second.write && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
+                attempt(*it->second.write)) {
+                ready_.push_back(std::move(it->second.write));
+            }
+        }
+
+        // Callbacks start new operations, which may finish at once: those
+        // wait for the next round instead of recursing
+        std::vector<std::unique_ptr<Op>> ready;
+        ready.swap(ready_);
+        for (auto& op : ready) {
+            operations_.fetch_add(1, std::memory_order_relaxed);
+            op->done(op->result);
+        }
+        if (woken) {
+            run_posted();
+        }
+    }
+
+private:
+    struct Op {
+        enum Kind { Accept, Recv, Send } kind{Recv};
+        int fd{-1};
+        char* data{nullptr};
+        std::size_t size{0};
+        std::size_t moved{0};
+        std::vector<iovec> parts;
+        std::size_t next{0};
+        int result{0};
+        Callback done;
+    };
+
+    struct Watched {
+        std::unique_ptr<Op> read;      // Parked until readable
+        std::unique_ptr<Op> write;     // Parked until writable
+        bool registered{false};
+        bool listener{false};
+    };
+
+    int epoll_fd_{-1};
+    std::unordered_map<int, Watched> watched_;
+    std::vector<std::unique_ptr<Op>> ready_;
+
+    Watched& watch(int fd) {
+        return watched_[fd];
+    }
+
+    void start(std::unique_ptr<Op>& slot, std::unique_ptr<Op> op) {
+        if (attempt(*op)) {
+            ready_.push_back(std::move(op));
+            return;
+        }
+        Watched& watched = watched_[op->fd];
+        if (!watched.registered) {
+            // Edge-triggered for both directions, once per socket: every
+            // operation is tried before it parks, so no edge is missed
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.fd = op->fd;
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+            if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, op->fd, &event) != 0) {
+                op->result = -errno;
+                ready_.push_back(std::move(op));
+                return;
+            }
+            watched.registered = true;
+        }
+        slot = std::move(op);
+    }
+
+    // Make progress; true once the operation is finished (result set)
+    bool attempt(Op& op) {
+        while (true) {
+            ssize_t n;
+            if (op.kind == Op::Accept) {
+                syscalls_.fetch_add(1, std::memory_order_relaxed);
+                n = ::accept4(op.fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+                if (n >= 0) {
+                    op.result = static_cast<int>(n);
+                    return true;
+                }
+            } else if (op.kind == Op::Recv) {
+                if (op.moved == op.size) {
+                    op.result = static_cast<int>(op.moved);
+                    return true;
+                }
+                syscalls_.fetch_add(1, std::memory_order_relaxed);
+                n = ::recv(op.fd, op.data + op.moved, op.size - op.moved, 0);
+                if (n > 0) {
+                    op.moved += static_cast<std::size_t>(n);
+                    continue;
+                }
+                if (n == 0) {
+                    op.result = static_cast<int>(op.moved);   // Closed by the peer
+                    return true;
+                }
+            } else {
+                if (op.next == op.parts.size()) {
+                    op.result = static_cast<int>(std::min<std::size_t>(op.size, INT_MAX));
+                    return true;
+                }
+                msghdr message{};
+                message.msg_iov = op.parts.data() + op.next;
+                message.msg_iovlen = std::min(kMaxIov, op.parts.size() - op.next);
+                syscalls_.fetch_add(1, std::memory_order_relaxed);
+                n = ::sendmsg(op.fd, &message, MSG_NOSIGNAL);
+                if (n >= 0) {
+                    op.next = advance(op.parts, op.next, static_cast<std::size_t>(n));
+                    continue;
+                }
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            }
+            op.result = -errno;
+            return true;
+        }
+    }
+};
+
+} // namespace
+
+// =============================================================================
+// io_uring
+// =============================================================================
+
+#ifdef HYDRA_HAVE_IO_URING
+
+namespace {
+
+int uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int ring, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ring, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int uring_register(int ring, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, ring, opcode, arg, count));
+}
+
+class UringLoop final : public IoLoop {
+public:
+    explicit UringLoop(unsigned entries) {
+        // Completions are only reaped inside io_uring_enter, so the kernel
+        // need not interrupt the loop to post them
+        io_uring_params params{};
+        params.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+        ring_fd_ = uring_setup(entries, &params);
+        if (ring_fd_ < 0 && errno == EINVAL) {
+            params = {};
+            ring_fd_ = uring_setup(entries, &params);
+        }
+        if (ring_fd_ < 0) {
+            throw io_error("io_uring_setup", errno);
+        }
+        try {
+            map_rings(params);
+            probe();
+        } catch (...) {
+            unmap();
+            throw;
+        }
+        arm_wake();
+    }
+
+    ~UringLoop() override {
+        unmap();   // Closing the ring cancels whatever is still in flight
+        for (Op* op : ops_) {
+            delete op;
+        }
+    }
+
+    IoBackend backend() const override { return IoBackend::IoUring; }
+
+    void accept(int listener, Callback done) override {
+        Op* op = track(Op::Accept, listener, std::move(done));
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listener;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+    }
+
+    void recv(int fd, void* data, std::size_t size, Callback done) override {
+        Op* op = track(Op::Recv, fd, std::move(done));
+        op->data = static_cast<char*>(data);
+        op->size = size;
+        if (size == 0) {
+            finish(op);
+            return;
+        }
+        submit_recv(op);
+    }
+
+    void send(int fd, std::span<const iovec> parts, Callback done, int buffer) override {
+        Op* op = track(Op::Send, fd, std::move(done));
+        op->parts.assign(parts.begin(), parts.end());
+        op->size = total_bytes(parts);
+        op->buffer = zero_copy_ && !parts.empty() && !plain_sockets_.contains(fd) ? buffer : -1;
+        submit_send(op);
+    }
+
+    int register_buffer(std::span<const std::byte> memory) override {
+        auto free = std::find(buffers_.begin(), buffers_.end(), false);
+        if (free == buffers_.end()) {
+            return -1;
+        }
+        iovec vec{const_cast<std::byte*>(memory.data()), memory.size()};
+        io_uring_rsrc_update2 update{};
+        update.offset = static_cast<std::uint32_t>(free - buffers_.begin());
+        update.data = reinterpret_cast<std::uint64_t>(&vec);
+        update.nr = 1;
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        if (uring_register(ring_fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) != 1) {
+            return -1;   // Too large or over RLIMIT_MEMLOCK
+        }
+        *free = true;
+        return static_cast<int>(update.offset);
+    }
+
+    void unregister_buffer(int buffer) override {
+        if (buffer < 0 || static_cast<std::size_t>(buffer) >= buffers_.size() || !buffers_[buffer]) {
+            return;
+        }
+        iovec empty{nullptr, 0};
+        io_uring_rsrc_update2 update{};
+        update.offset = static_cast<std::uint32_t>(buffer);
+        update.data = reinterpret_cast<std::uint64_t>(&empty);
+        update.nr = 1;
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        uring_register(ring_fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+        buffers_[buffer] = false;
+    }
+
+    std::size_t buffer_slots() const override { return buffers_.size(); }
+
+    void write_file(int fd, std::span<const iovec> parts, std::uint64_t offset, bool sync) override {
+        int error = 0;
+        std::size_t pending = 0;
+        auto done = [&](int result) {
+            if (result < 0 && error == 0) {
+                error = -result;
+            }
+            --pending;
+        };
+        auto wait = [&] {
+            while (pending > 0) {
+                reap(static_cast<unsigned>(pending));   // Usually one io_uring_enter for the lot
+            }
+        };
+
+        // Independent writes at their own offsets, all in one submission.
+        // The fsync goes in once they are done: IOSQE_IO_DRAIN would also
+        // wait for the loop's own wake-up read, and a link chain breaks at
+        // the first short write.
+        for (std::size_t first = 0; first < parts.size(); first += kMaxIov) {
+            auto chunk = parts.subspan(first, std::min(kMaxIov, parts.size() - first));
+            Op* op = track(Op::Write, fd, done);
+            op->parts.assign(chunk.begin(), chunk.end());
+            op->size = total_bytes(chunk);
+            op->offset = offset;
+            offset += op->size;
+            ++pending;
+            submit_write(op);
+        }
+        wait();
+        if (error == 0 && sync) {
+            Op* op = track(Op::Fsync, fd, done);
+            io_uring_sqe* sqe = next_sqe();
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fd = fd;
+            sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+            ++pending;
+            wait();
+        }
+        if (error != 0) {
+            throw io_error("write", error);
+        }
+    }
+
+    void cancel(int fd) override {
+        Op* op = track(Op::Cancel, fd, nullptr);
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+    }
+
+    void close(int fd) override {
+        plain_sockets_.erase(fd);
+        ::close(fd);
+    }
+
+protected:
+    void poll() override {
+        reap(1);
+    }
+
+private:
+    struct Op {
+        enum Kind { Accept, Recv, Send, Write, Fsync, Wake, Cancel } kind{Recv};
+        int fd{-1};
+        char* data{nullptr};
+        std::size_t size{0};
+        std::size_t moved{0};
+        std::vector<iovec> parts;
+        std::size_t next{0};
+        msghdr message{};
+        std::uint64_t offset{0};
+        int buffer{-1};
+        int notifications{0};          // Zero-copy sends still holding the buffer
+        bool finished{false};
+        int result{0};
+        Callback done;
+    };
+
+    int ring_fd_{-1};
+    void* ring_{nullptr};
+    std::size_t ring_bytes_{0};
+    io_uring_sqe* sqes_{nullptr};
+    std::size_t sqes_bytes_{0};
+
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe* cqes_{nullptr};
+
+    unsigned tail_{0};                 // Local submission tail
+    unsigned queued_{0};               // Entries not yet handed to the kernel
+
+    std::unordered_set<Op*> ops_;
+    std::vector<bool> buffers_;        // Registered buffer slots in use
+    bool zero_copy_{false};
+    std::unordered_set<int> plain_sockets_;   // Refused zero-copy (Unix sockets)
+    std::uint64_t wake_value_{0};
+
+    void map_rings(const io_uring_params& params) {
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+            throw std::runtime_error("I/O loop: io_uring needs Linux 5.5 or newer");
+        }
+        ring_bytes_ = std::max<std::size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        ring_ = ::mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                       IORING_OFF_SQ_RING);
+        if (ring_ == MAP_FAILED) {
+            ring_ = nullptr;
+            throw io_error("mmap", errno);
+        }
+        sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            throw io_error("mmap", errno);
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* base = static_cast<char*>(ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+        // Slot i of the submission array always names SQE i
+        auto* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < params.sq_entries; ++i) {
+            array[i] = i;
+        }
+        tail_ = *sq_tail_;
+    }
+
+    void unmap() {
+        if (sqes_) {
+            ::munmap(sqes_, sqes_bytes_);
+        }
+        if (ring_) {
+            ::munmap(ring_, ring_bytes_);
+        }
+        ::close(ring_fd_);
+    }
+
+    // Every operation the loop uses, and whether zero-copy sends and
+    // buffer tables can be had on top
+    void probe() {
+        std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (uring_register(ring_fd_, IORING_REGISTER_PROBE, probe, 256) != 0) {
+            throw io_error("io_uring probe", errno);
+        }
+        auto supported = [probe](unsigned op) {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        };
+        for (unsigned op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_WRITEV,
+                            IORING_OP_FSYNC, IORING_OP_READ, IORING_OP_ASYNC_CANCEL}) {
+            if (!supported(op)) {
+                throw std::runtime_error("I/O loop: io_uring lacks operation " + std::to_string(op));
+            }
+        }
+        if (supported(IORING_OP_SEND_ZC)) {
+            io_uring_rsrc_register table{};
+            table.nr = 4;
+            table.flags = IORING_RSRC_REGISTER_SPARSE;
+            if (uring_register(ring_fd_, IORING_REGISTER_BUFFERS2, &table, sizeof(table)) == 0) {
+                buffers_.assign(table.nr, false);
+                zero_copy_ = true;
+            }
+        }
+    }
+
+    Op* track(Op::Kind kind, int fd, Callback done) {
+        auto* op = new Op;
+        op->kind = kind;
+        op->fd = fd;
+        op->done = std::move(done);
+        ops_.insert(op);
+        return op;
+    }
+
+    io_uring_sqe* next_sqe() {
+        if (tail_ - std::atomic_ref(*sq_head_).load(std::memory_order_acquire) == sq_entries_) {
+            submit(0);   // Full: hand the queue over before adding more
+        }
+        io_uring_sqe* sqe = &sqes_[tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++tail_;
+        ++queued_;
+        return sqe;
+    }
+
+    // Submit what is queued and wait for min_complete completions
+    void submit(unsigned min_complete) {
+        std::atomic_ref(*sq_tail_).store(tail_, std::memory_order_release);
+        while (true) {
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+            int n = uring_enter(ring_fd_, queued_, min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+            if (n >= 0) {
+                queued_ -= std::min<unsigned>(queued_, static_cast<unsigned>(n));
+                return;
+            }
+            if (errno == EINTR) {
+                if (min_complete == 0) {
+                    continue;
+                }
+                return;   // Reap what is there; the caller waits again
+            }
+            if (errno == EAGAIN || errno == EBUSY) {
+                return;   // Completion queue backed up: reaping frees room
+            }
+            throw io_error("io_uring_enter", errno);
+        }
+    }
+
+    // Submit, wait until at least wanted completions are in, and run them
+    void reap(unsigned wanted) {
+        unsigned head = *cq_head_;
+        unsigned ready = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire) - head;
+        if (queued_ > 0 || ready < wanted) {
+            submit(ready < wanted ? wanted - ready : 0);
+        }
+        unsigned tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+        // Copy the batch out first: callbacks queue submissions, which may
+        // call into the kernel and post more completions behind it
+        std::vector<io_uring_cqe> batch;
+        batch.reserve(tail - head);
+        for (; head != tail; ++head) {
+            batch.push_back(cqes_[head & cq_mask_]);
+        }
+        std::atomic_ref(*cq_head_).store(head, std::memory_order_release);
+        for (const io_uring_cqe& cqe : batch) {
+            complete(reinterpret_cast<Op*>(cqe.user_data), cqe.res, cqe.flags);
+        }
+    }
+
+    void arm_wake() {
+        Op* op = track(Op::Wake, wake_fd_, nullptr);
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = wake_fd_;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&wake_value_);
+        sqe->len = sizeof(wake_value_);
+        sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+    }
+
+    void submit_recv(Op* op) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = op->fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(op->data + op->moved);
+        sqe->len = static_cast<std::uint32_t>(std::min<std::size_t>(op->size - op->moved, 1u << 30));
+        sqe->msg_flags = MSG_WAITALL;   // One completion for the whole payload
+        sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+    }
+
+    void submit_send(Op* op) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->fd = op->fd;
+        sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+        std::size_t last = op->parts.size() - 1;
+        if (op->buffer >= 0 && op->next == last) {
+            // The registered part: straight from the pinned pages to the NIC
+            sqe->opcode = IORING_OP_SEND_ZC;
+            sqe->addr = reinterpret_cast<std::uint64_t>(op->parts[last].iov_base);
+            sqe->len = static_cast<std::uint32_t>(std::min<std::size_t>(op->parts[last].iov_len, 1u << 30));
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+            sqe->buf_index = static_cast<std::uint16_t>(op->buffer);
+            return;
+        }
+        std::size_t end = op->buffer >= 0 ? last : op->parts.size();
+        op->message = {};
+        op->message.msg_iov = op->parts.data() + op->next;
+        op->message.msg_iovlen = std::min(kMaxIov, end - op->next);
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = reinterpret_cast<std::uint64_t>(&op->message);
+        // Hold the header back until the zero-copy payload follows it
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL | (op->buffer >= 0 ? MSG_MORE : 0);
+    }
+
+    void submit_write(Op* op) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->fd = op->fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(op->parts.data() + op->next);
+        sqe->len = static_cast<std::uint32_t>(op->parts.size() - op->next);
+        sqe->off = op->offset;
+        sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+    }
+
+    void finish(Op* op) {
+        ops_.erase(op);
+        operations_.fetch_add(1, std::memory_order_relaxed);
+        Callback done = std::move(op->done);
+        int result = op->result;
+        delete op;
+        if (done) {
+            done(result);
+        }
+    }
+
+    void complete(Op* op, int res, unsigned flags) {
+        switch (op->kind) {
+            case Op::Wake:
+                ops_.erase(op);
+                delete op;
+                arm_wake();
+                run_posted();
+                return;
+
+            case Op::Accept:
+                op->result = res;
+                finish(op);
+                return;
+
+            case Op::Recv:
+                if (res > 0) {
+                    op->moved += static_cast<std::size_t>(res);
+                    if (op->moved < op->size) {
+                        submit_recv(op);
+                        return;
+                    }
+                } else if (res == -EINTR || res == -EAGAIN) {
+                    submit_recv(op);
+                    return;
+                }
+                op->result = res < 0 ? res : static_cast<int>(op->moved);
+                finish(op);
+                return;
+
+            case Op::Send:
+                if (flags & IORING_CQE_F_NOTIF) {
+                    // The kernel is done with the registered pages
+                    if (--op->notifications == 0 && op->finished) {
+                        finish(op);
+                    }
+                    return;
+                }
+                if (flags & IORING_CQE_F_MORE) {
+                    ++op->notifications;
+                }
+                if (res == -EOPNOTSUPP && op->buffer >= 0) {
+                    plain_sockets_.insert(op->fd);   // No zero-copy here; copy instead
+                    op->buffer = -1;
+                    submit_send(op);
+                    return;
+                }
+                if (res > 0) {
+                    op->next = advance(op->parts, op->next, static_cast<std::size_t>(res));
+                    if (op->next < op->parts.size()) {
+                        submit_send(op);
+                        return;
+                    }
+                    op->result = static_cast<int>(std::min<std::size_t>(op->size, INT_MAX));
+                } else if (res == -EINTR || res == -EAGAIN) {
+                    submit_send(op);
+                    return;
+                } else {
+                    op->result = res < 0 ? res : -EPIPE;
+                }
+                op->finished = true;
+                if (op->notifications == 0) {
+                    finish(op);
+                }
+                return;
+
+            case Op::Write:
+                if (res > 0 && static_cast<std::size_t>(res) < op->size - op->moved) {
+                    op->moved += static_cast<std::size_t>(res);
+                    op->offset += static_cast<std::uint64_t>(res);
+                    op->next = advance(op->parts, op->next, static_cast<std::size_t>(res));
+                    submit_write(op);
+                    return;
+                }
+                op->result = res < 0 ? res : (res == 0 && op->size > op->moved ? -EIO : 0);
+                finish(op);
+                return;
+
+            case Op::Fsync:
+            case Op::Cancel:
+                op->result = res;
+                finish(op);
+                return;
+        }
+    }
+};
+
+} // namespace
+
+bool io_uring_available() {
+    static const bool available = [] {
+        try {
+            UringLoop probe(4);
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }();
+    return available;
+}
+
+#else
+
+bool io_uring_available() {
+    return false;
+}
+
+#endif
+
+std::unique_ptr<IoLoop> IoLoop::create(IoBackend backend, unsigned entries) {
+#ifndef HYDRA_HAVE_IO_URING
+    (void)entries;
+#endif
+    switch (backend) {
+        case IoBackend::Off:
+            throw std::invalid_argument("IoLoop: no loop for IoBackend::Off");
+        case IoBackend::Epoll:
+            return std::make_unique<EpollLoop>();
+        case IoBackend::IoUring:
+#ifdef HYDRA_HAVE_IO_URING
+            return std::make_unique<UringLoop>(entries);
+#else
+            throw std::runtime_error("I/O loop: built without io_uring");
+#endif
+        case IoBackend::Auto:
+#ifdef HYDRA_HAVE_IO_URING
+            try {
+                return std::make_unique<UringLoop>(entries);
+            } catch (const std::exception&) {
+                // Old kernel, or io_uring disabled by sysctl or seccomp
+            }
+#endif
+            return std::make_unique<EpollLoop>();
+    }
+    throw std::invalid_argument("IoLoop: unknown backend");
+}
+
+} // namespace hydra
@@ -0,0 +1,102 @@
+/**
+ * @file kv_cache.cpp
+ * @brief Implementation of KvPagePool and KvCache
+ */
+
+#include "hydra/kv_cache.hpp"
+#include <stdexcept>
+
+namespace hydra {
+
+// =============================================================================
+// KvPagePool
+// =============================================================================
+
+KvPagePool::KvPagePool(const ModelConfig& config, std::size_t max_bytes, std::size_t page_tokens)
+    : layers_(static_cast<std::size_t>(config.num_layers)),
+      embed_(static_cast<std::size_t>(config.embed_dim)),
+      page_tokens_(page_tokens),
+      page_floats_(layers_ * 2 * page_tokens * embed_),
+      max_pages_(page_floats_ ? max_bytes / (page_floats_ * sizeof(float)) : 0) {
+    if (page_tokens_ == 0 || max_pages_ == 0) {
+        throw std::invalid_argument("KvPagePool: cache budget is smaller than one page");
+    }
+    slabs_.resize((max_pages_ + kSlabPages - 1) / kSlabPages);
+}
+
+std::optional<std::uint32_t> KvPagePool::allocate() {
+    std::lock_guard lock(mutex_);
+    if (!free_.empty()) {
+        std::uint32_t page = free_.back();
+        free_.pop_back();
+        return page;
+    }
+    if (created_ == max_pages_) {
+        return std::nullopt;
+    }
+
+    // Slab pointers never move, so page() needs no lock
+    std::size_t slab = created_ / kSlabPages;
+    if (!slabs_[slab]) {
+        slabs_[slab] = std::make_unique<float[]>(kSlabPages * page_floats_);
+    }
+    return static_cast<std::uint32_t>(created_++);
+}
+
+void KvPagePool::release(std::uint32_t page) {
+    std::lock_guard lock(mutex_);
+    free_.push_back(page);
+}
+
+std::size_t KvPagePool::pages_in_use() const {
+    std::lock_guard lock(mutex_);
+    return created_ - free_.size();
+}
+
+// =============================================================================
+// KvCache
+// =============================================================================
+
+KvCache::~KvCache() {
+    clear();
+}
+
+KvCache::KvCache(KvCache&& other) noexcept
+    : pool_(other.pool_), pages_(std::move(other.pages_)), length_(other.length_) {
+    other.pages_.clear();
+    other.length_ = 0;
+}
+
+KvCache& KvCache::operator=(KvCache&& other) noexcept {
+    if (this != &other) {
+        clear();
+        pool_ = other.pool_;
+        pages_ = std::move(other.pages_);
+        length_ = other.length_;
+        other.pages_.clear();
+        other.length_ = 0;
+    }
+    return *this;
+}
+
+bool KvCache::reserve(std::size_t tokens) {
+    std::size_t needed = (tokens + pool_->page_tokens() - 1) / pool_->page_tokens();
+    while (pages_.size() < needed) {
+        auto page = pool_->allocate();
+        if (!page) {
+            return false;
+        }
+        pages_.push_back(*page);
+    }
+    return true;
+}
+
+void KvCache::clear() {
+    for (auto page : pages_) {
+        pool_->release(page);
+    }
+    pages_.clear();
+    length_ = 0;
+}
+
+} // namespace hydra
@@ -0,0 +1,263 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementation of the metrics registry
+ */
+
+#include "hydra/metrics.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace detail {
+
+std::size_t metric_slot() {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t slot = next.fetch_add(1, std::memory_order_relaxed) % kMetricSlots;
+    return slot;
+}
+
+} // namespace detail
+
+namespace {
+
+void append_number(std::string& out, double value) {
+    if (std::isinf(value)) {
+        out += value > 0 ? "+Inf" : "-Inf";
+        return;
+    }
+    if (std::isnan(value)) {
+        out += "NaN";
+        return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void append_number(std::string& out, std::uint64_t value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// Label values escape backslash, quote and newline
+std::string render_labels(const MetricLabels& labels) {
+    if (labels.empty()) {
+        return "";
+    }
+    std::string out = "{";
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        out += labels[i].first;
+        out += "=\"";
+        for (char c : labels[i].second) {
+            if (c == '\\' || c == '"') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+    out += '}';
+    return out;
+}
+
+// {a="b"} + le="0.5" -> {a="b",le="0.5"}
+std::string with_le(const std::string& labels, const std::string& le) {
+    if (labels.empty()) {
+        return "{le=\"" + le + "\"}";
+    }
+    return labels.substr(0, labels.size() - 1) + ",le=\"" + le + "\"}";
+}
+
+const char* type_name(MetricType type) {
+    switch (type) {
+        case MetricType::Counter:   return "counter";
+        case MetricType::Gauge:     return "gauge";
+        case MetricType::Histogram: return "histogram";
+    }
+    return "untyped";
+}
+
+} // namespace
+
+// =============================================================================
+// Counter and Histogram
+// =============================================================================
+
+std::uint64_t Counter::value() const {
+    std::uint64_t total = 0;
+    for (const auto& slot : slots_) {
+        total += slot.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+    if (!std::is_sorted(bounds_.begin(), bounds_.end())) {
+        throw std::invalid_argument("Histogram: bucket bounds must be ascending");
+    }
+    for (auto& slot : slots_) {
+        slot.counts = std::make_unique<std::atomic<std::uint64_t>[]>(bounds_.size() + 1);
+    }
+}
+
+void Histogram::observe(double value) {
+    // Buckets are few; a linear scan beats a binary search at this size
+    std::size_t bucket = 0;
+    while (bucket < bounds_.size() && value > bounds_[bucket]) {
+        ++bucket;
+    }
+    Slot& slot = slots_[detail::metric_slot()];
+    slot.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    slot.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+Histogram::Totals Histogram::totals() const {
+    Totals totals;
+    totals.buckets.assign(bounds_.size() + 1, 0);
+    for (const auto& slot : slots_) {
+        for (std::size_t i = 0; i <= bounds_.size(); ++i) {
+            totals.buckets[i] += slot.counts[i].load(std::memory_order_relaxed);
+        }
+        totals.sum += slot.sum.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 1; i < totals.buckets.size(); ++i) {
+        totals.buckets[i] += totals.buckets[i - 1];
+    }
+    return totals;
+}
+
+std::vector<double> Histogram::latency_bounds() {
+    return {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0};
+}
+
+// =============================================================================
+// Registry
+// =============================================================================
+
+MetricsRegistry::Series& MetricsRegistry::series(const std::string& name, const std::string& help,
+                                                 MetricType type, const MetricLabels& labels) {
+    auto [it, inserted] = families_.try_emplace(name, Family{help, type, {}});
+    if (!inserted && it->second.type != type) {
+        throw std::invalid_argument("Metric " + name + " registered with two types");
+    }
+
+    std::string rendered = render_labels(labels);
+    for (auto& series : it->second.series) {
+        if (series.labels == rendered) {
+            return series;
+        }
+    }
+    it->second.series.push_back(Series{std::move(rendered), nullptr, nullptr, nullptr, nullptr, nullptr});
+    return it->second.series.back();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard lock(mutex_);
+    Series& entry = series(name, help, MetricType::Counter, labels);
+    if (!entry.counter) {
+        entry.counter = std::make_unique<Counter>();
+    }
+    return *entry.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard lock(mutex_);
+    Series& entry = series(name, help, MetricType::Gauge, labels);
+    if (!entry.gauge) {
+        entry.gauge = std::make_unique<Gauge>();
+    }
+    return *entry.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      const MetricLabels& labels, std::vector<double> bounds) {
+    std::lock_guard lock(mutex_);
+    Series& entry = series(name, help, MetricType::Histogram, labels);
+    if (!entry.histogram) {
+        entry.histogram = std::make_unique<Histogram>(std::move(bounds));
+    }
+    return *entry.histogram;
+}
+
+void MetricsRegistry::callback(const std::string& name, const std::string& help, MetricType type,
+                               std::function<double()> read, const MetricLabels& labels,
+                               const void* owner) {
+    if (type == MetricType::Histogram) {
+        throw std::invalid_argument("Metric " + name + ": histograms cannot be read through a callback");
+    }
+    std::lock_guard lock(mutex_);
+    Series& entry = series(name, help, type, labels);
+    entry.read = std::move(read);
+    entry.owner = owner;
+}
+
+void MetricsRegistry::remove_callbacks(const void* owner) {
+    std::lock_guard lock(mutex_);
+    for (auto it = families_.begin(); it != families_.end();) {
+        auto& series = it->second.series;
+        std::erase_if(series, [owner](const Series& s) { return s.read && s.owner == owner; });
+        it = series.empty() ? families_.erase(it) : std::next(it);
+    }
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard lock(mutex_);
+    std::string out;
+    out.reserve(families_.size() * 256);
+
+    for (const auto& [name, family] : families_) {
+        out += "# HELP " + name + " " + family.help + "\n";
+        out += "# TYPE " + name + " " + type_name(family.type) + "\n";
+
+        for (const auto& series : family.series) {
+            if (series.histogram) {
+                auto totals = series.histogram->totals();
+                const auto& bounds = series.histogram->bounds();
+                for (std::size_t i = 0; i < totals.buckets.size(); ++i) {
+                    std::string le;
+                    append_number(le, i < bounds.size() ? bounds[i] : INFINITY);
+                    out += name + "_bucket" + with_le(series.labels, le) + " ";
+                    append_number(out, totals.buckets[i]);
+                    out += '\n';
+                }
+                out += name + "_sum" + series.labels + " ";
+                append_number(out, totals.sum);
+                out += '\n' + name + "_count" + series.labels + " ";
+                append_number(out, totals.buckets.back());
+                out += '\n';
+                continue;
+            }
+
+            out += name + series.labels + " ";
+            if (series.counter) {
+                append_number(out, series.counter->value());
+            } else if (series.gauge) {
+                append_number(out, series.gauge->value());
+            } else if (series.read) {
+                append_number(out, series.read());
+            } else {
+                append_number(out, 0.0);
+            }
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+} // namespace hydra
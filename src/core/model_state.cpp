@@ -0,0 +1,408 @@
+/**
+ * @file model_state.cpp
+ * @brief Implementation of ModelState and the JSON skimming helpers
+ */
+
+#include "hydra/model_state.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace {
+
+// =============================================================================
+// JSON Scanning Helpers
+// =============================================================================
+
+bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+std::size_t skip_spaces(std::string_view s, std::size_t pos) {
+    while (pos < s.size() && is_space(s[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Return the position just past the string starting at pos (which must be '"')
+std::size_t skip_string(std::string_view s, std::size_t pos) {
+    for (++pos; pos < s.size(); ++pos) {
+        if (s[pos] == '\\') {
+            ++pos;
+        } else if (s[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    throw std::runtime_error("Unterminated JSON string");
+}
+
+// Return the position just past the value starting at pos
+std::size_t skip_value(std::string_view s, std::size_t pos) {
+    pos = skip_spaces(s, pos);
+    if (pos >= s.size()) {
+        throw std::runtime_error("Unexpected end of JSON");
+    }
+
+    if (s[pos] == '"') {
+        return skip_string(s, pos);
+    }
+
+    if (s[pos] == '{' || s[pos] == '[') {
+        int depth = 0;
+        while (pos < s.size()) {
+            char c = s[pos];
+            if (c == '"') {
+                pos = skip_string(s, pos);
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return pos + 1;
+                }
+            }
+            ++pos;
+        }
+        throw std::runtime_error("Unbalanced JSON brackets");
+    }
+
+    // Number, true, false or null
+    while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ']' && !is_space(s[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * @brief Walk the members of a JSON object, calling fn(raw_key, value_pos)
+ *
+ * fn returns the position just past the member's value, or npos to stop.
+ */
+template <typename Fn>
+void for_each_member(std::string_view object, Fn&& fn) {
+    std::size_t pos = skip_spaces(object, 0);
+    if (pos >= object.size() || object[pos] != '{') {
+        throw std::runtime_error("Expected JSON object");
+    }
+    pos = skip_spaces(object, pos + 1);
+    if (pos < object.size() && object[pos] == '}') {
+        return;
+    }
+
+    while (pos < object.size()) {
+        if (object[pos] != '"') {
+            throw std::runtime_error("Expected JSON member name");
+        }
+        std::size_t key_end = skip_string(object, pos);
+        std::string_view key = object.substr(pos + 1, key_end - pos - 2);
+
+        pos = skip_spaces(object, key_end);
+        if (pos >= object.size() || object[pos] != ':') {
+            throw std::runtime_error("Expected ':' in JSON object");
+        }
+
+        pos = fn(key, skip_spaces(object, pos + 1));
+        if (pos == std::string_view::npos) {
+            return;
+        }
+
+        pos = skip_spaces(object, pos);
+        if (pos < object.size() && object[pos] == ',') {
+            pos = skip_spaces(object, pos + 1);
+        } else if (pos < object.size() && object[pos] == '}') {
+            return;
+        } else {
+            throw std::runtime_error("Expected ',' or '}' in JSON object");
+        }
+    }
+    throw std::runtime_error("Unterminated JSON object");
+}
+
+/**
+ * @brief Read a nested list of numbers into dst, returning the end position
+ *
+ * Nesting is flattened in row-major order; the caller checks the count.
+ */
+std::size_t read_number_list(std::string_view s, std::size_t pos,
+                             float* dst, std::size_t capacity, std::size_t& count) {
+    if (pos >= s.size() || (s[pos] != '[' && s[pos] != '-' && !std::isdigit(static_cast<unsigned char>(s[pos])))) {
+        throw std::runtime_error("Expected a list of numbers");
+    }
+
+    int depth = 0;
+    count = 0;
+    while (pos < s.size()) {
+        char c = s[pos];
+        if (c == '[') {
+            ++depth;
+            ++pos;
+        } else if (c == ']') {
+            ++pos;
+            if (--depth <= 0) {
+                return pos;
+            }
+        } else if (c == ',' || is_space(c)) {
+            ++pos;
+        } else {
+            float value = 0.0f;
+            auto [ptr, ec] = std::from_chars(s.data() + pos, s.data() + s.size(), value);
+            if (ec != std::errc() || !std::isfinite(value)) {
+                throw std::runtime_error("Invalid number in parameter list");
+            }
+            if (count >= capacity) {
+                throw std::runtime_error("Too many values for tensor");
+            }
+            dst[count++] = value;
+            pos = static_cast<std::size_t>(ptr - s.data());
+            if (depth == 0) {
+                return pos;   // Scalar parameter
+            }
+        }
+    }
+    throw std::runtime_error("Unterminated parameter list");
+}
+
+void write_nested(std::string& out, const float* data, const std::vector<std::size_t>& shape,
+                  std::size_t dim, std::size_t& index) {
+    out += '[';
+    for (std::size_t i = 0; i < shape[dim]; ++i) {
+        if (i > 0) {
+            out += ", ";
+        }
+        if (dim + 1 < shape.size()) {
+            write_nested(out, data, shape, dim + 1, index);
+        } else {
+            char buf[32];
+            auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), data[index++]);
+            out.append(buf, ptr);
+        }
+    }
+    out += ']';
+}
+
+} // namespace
+
+// =============================================================================
+// ModelState
+// =============================================================================
+
+void ModelState::add_tensor(std::string name, std::vector<std::size_t> shape) {
+    TensorInfo info;
+    info.name = std::move(name);
+    info.size = 1;
+    for (auto dim : shape) {
+        info.size *= dim;
+    }
+    info.shape = std::move(shape);
+    info.offset = tensors_.empty() ? 0 : tensors_.back().offset + tensors_.back().size;
+    tensors_.push_back(std::move(info));
+}
+
+ModelState ModelState::layout(const ModelConfig& config) {
+    if (config.embed_dim <= 0 || config.num_heads <= 0 || config.embed_dim % config.num_heads != 0) {
+        throw std::invalid_argument("embed_dim must be a positive multiple of num_heads");
+    }
+
+    ModelState state;
+    state.config_ = config;
+
+    const auto vocab = static_cast<std::size_t>(config.vocab_size);
+    const auto embed = static_cast<std::size_t>(config.embed_dim);
+    const auto seq = static_cast<std::size_t>(config.max_seq_length);
+
+    // Same order as SimpleTransformer.named_parameters()
+    state.add_tensor("positional_encoding", {1, seq, embed});
+    state.add_tensor("embedding.weight", {vocab, embed});
+    for (int layer = 0; layer < config.num_layers; ++layer) {
+        const std::string prefix = "transformer.layers." + std::to_string(layer) + ".";
+        state.add_tensor(prefix + "self_attn.in_proj_weight", {3 * embed, embed});
+        state.add_tensor(prefix + "self_attn.in_proj_bias", {3 * embed});
+        state.add_tensor(prefix + "self_attn.out_proj.weight", {embed, embed});
+        state.add_tensor(prefix + "self_attn.out_proj.bias", {embed});
+        state.add_tensor(prefix + "linear1.weight", {4 * embed, embed});
+        state.add_tensor(prefix + "linear1.bias", {4 * embed});
+        state.add_tensor(prefix + "linear2.weight", {embed, 4 * embed});
+        state.add_tensor(prefix + "linear2.bias", {embed});
+        state.add_tensor(prefix + "norm1.weight", {embed});
+        state.add_tensor(prefix + "norm1.bias", {embed});
+        state.add_tensor(prefix + "norm2.weight", {embed});
+        state.add_tensor(prefix + "norm2.bias", {embed});
+    }
+    state.add_tensor("output_layer.weight", {vocab, embed});
+    state.add_tensor("output_layer.bias", {vocab});
+
+    const auto& last = state.tensors_.back();
+    state.values_.assign(last.offset + last.size, 0.0f);
+    return state;
+}
+
+ModelState ModelState::create(const ModelConfig& config, std::uint64_t seed) {
+    ModelState state = layout(config);
+
+    // Initialize like PyTorch's default reset_parameters()
+    std::mt19937_64 rng(seed);
+    for (const auto& tensor : state.tensors_) {
+        float* data = state.values_.data() + tensor.offset;
+        const std::string& name = tensor.name;
+        auto ends_with = [&name](std::string_view suffix) {
+            return name.size() >= suffix.size() &&
+                   name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+
+        if (name == "positional_encoding" || ends_with("in_proj_bias") ||
+            ends_with("out_proj.bias") || ends_with("norm1.bias") || ends_with("norm2.bias")) {
+            continue;   // Zeros
+        }
+
+        if (ends_with("norm1.weight") || ends_with("norm2.weight")) {
+            std::fill(data, data + tensor.size, 1.0f);
+        } else if (name == "embedding.weight") {
+            std::normal_distribution<float> dist(0.0f, 1.0f);
+            for (std::size_t i = 0; i < tensor.size; ++i) data[i] = dist(rng);
+        } else if (ends_with("in_proj_weight")) {
+            // Xavier uniform
+            float bound = std::sqrt(6.0f / static_cast<float>(tensor.shape[0] + tensor.shape[1]));
+            std::uniform_real_distribution<float> dist(-bound, bound);
+            for (std::size_t i = 0; i < tensor.size; ++i) data[i] = dist(rng);
+        } else {
+            // Linear weights and biases: U(-1/sqrt(fan_in), 1/sqrt(fan_in))
+            std::size_t fan_in = ends_with(".weight")
+                ? tensor.shape[1]
+                : state.find(name.substr(0, name.size() - 4) + "weight")->shape[1];
+            float bound = 1.0f / std::sqrt(static_cast<float>(fan_in));
+            std::uniform_real_distribution<float> dist(-bound, bound);
+            for (std::size_t i = 0; i < tensor.size; ++i) data[i] = dist(rng);
+        }
+    }
+
+    return state;
+}
+
+const TensorInfo* ModelState::find(std::string_view name) const {
+    for (const auto& tensor : tensors_) {
+        if (tensor.name == name) {
+            return &tensor;
+        }
+    }
+    return nullptr;
+}
+
+std::string ModelState::to_json() const {
+    std::string out;
+    out.reserve(values_.size() * 14 + tensors_.size() * 64);
+
+    out += '{';
+    for (std::size_t t = 0; t < tensors_.size(); ++t) {
+        const auto& tensor = tensors_[t];
+        if (t > 0) {
+            out += ", ";
+        }
+        out += '"';
+        out += tensor.name;
+        out += "\": ";
+
+        std::size_t index = 0;
+        write_nested(out, values_.data() + tensor.offset, tensor.shape, 0, index);
+    }
+    out += '}';
+    return out;
+}
+
+std::size_t ModelState::parse_json(std::string_view json, std::span<float> out) const {
+    if (out.size() != values_.size()) {
+        throw std::invalid_argument("parse_json: output buffer has the wrong size");
+    }
+
+    std::size_t read = 0;
+    for_each_member(json, [&](std::string_view key, std::size_t pos) {
+        const TensorInfo* tensor = find(key);
+        if (!tensor) {
+            return skip_value(json, pos);
+        }
+
+        std::size_t count = 0;
+        std::size_t end = read_number_list(json, pos, out.data() + tensor->offset, tensor->size, count);
+        if (count != tensor->size) {
+            throw std::runtime_error("Wrong number of values for " + tensor->name);
+        }
+        ++read;
+        return end;
+    });
+    return read;
+}
+
+// =============================================================================
+// JSON Helpers
+// =============================================================================
+
+std::string_view find_json_member(std::string_view object, std::string_view key) {
+    std::string_view result;
+    try {
+        for_each_member(object, [&](std::string_view name, std::size_t pos) {
+            std::size_t end = skip_value(object, pos);
+            if (name == key) {
+                result = object.substr(pos, end - pos);
+                return std::string_view::npos;
+            }
+            return end;
+        });
+    } catch (const std::runtime_error&) {
+        return {};
+    }
+    return result;
+}
+
+std::string json_string_value(std::string_view raw) {
+    if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"') {
+        return {};
+    }
+
+    std::string value;
+    value.reserve(raw.size() - 2);
+    for (std::size_t i = 1; i + 1 < raw.size(); ++i) {
+        char c = raw[i];
+        if (c != '\\' || i + 2 >= raw.size()) {
+            value += c;
+            continue;
+        }
+
+        c = raw[++i];
+        switch (c) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'u': {
+                // Basic Multilingual Plane only, encoded as UTF-8
+                unsigned code = 0;
+                if (i + 4 < raw.size()) {
+                    std::from_chars(raw.data() + i + 1, raw.data() + i + 5, code, 16);
+                    i += 4;
+                }
+                if (code < 0x80) {
+                    value += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    value += static_cast<char>(0xC0 | (code >> 6));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    value += static_cast<char>(0xE0 | (code >> 12));
+                    value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    value += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: value += c; break;   // \" \\ \/
+        }
+    }
+    return value;
+}
+
+} // namespace hydra
@@ -0,0 +1,464 @@
+/**
+ * @file rpc.cpp
+ * @brief Implementation of the binary RPC framing and client
+ */
+
+#include "hydra/rpc.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+namespace hydra {
+
+namespace {
+
+constexpr char kMagic[4] = {'H', 'R', 'P', 'C'};
+
+std::runtime_error socket_error(const std::string& what) {
+    return std::runtime_error("RPC: " + what + ": " + std::strerror(errno));
+}
+
+struct Endpoint {
+    bool unix_socket{false};
+    std::string host;              // Or the socket path
+    std::string port;
+};
+
+Endpoint parse_endpoint(const std::string& endpoint) {
+    Endpoint parsed;
+    if (endpoint.starts_with("unix:")) {
+        parsed.unix_socket = true;
+        parsed.host = endpoint.substr(5);
+        if (parsed.host.empty() || parsed.host.size() >= sizeof(sockaddr_un::sun_path)) {
+            throw std::runtime_error("RPC: bad Unix socket path in " + endpoint);
+        }
+        return parsed;
+    }
+    auto colon = endpoint.rfind(':');
+    if (colon == std::string::npos || colon + 1 == endpoint.size()) {
+        throw std::runtime_error("RPC: endpoint must be host:port or unix:/path, got " + endpoint);
+    }
+    parsed.host = endpoint.substr(0, colon);
+    parsed.port = endpoint.substr(colon + 1);
+    return parsed;
+}
+
+sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// Small frames must not wait for Nagle: pipelined requests would stall
+void tune_tcp(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// Read exactly size bytes; false if the peer closed before the first byte
+bool read_exact(int fd, void* data, std::size_t size, bool allow_eof) {
+    auto* out = static_cast<char*>(data);
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::recv(fd, out + done, size - done, MSG_WAITALL);
+        if (n > 0) {
+            done += static_cast<std::size_t>(n);
+        } else if (n == 0) {
+            if (done == 0 && allow_eof) {
+                return false;
+            }
+            throw std::runtime_error("RPC: connection closed in the middle of a frame");
+        } else if (errno != EINTR) {
+            throw socket_error("recv");
+        }
+    }
+    return true;
+}
+
+// Write all parts, however many calls it takes; returns the bytes written
+std::size_t write_all(int fd, iovec* next, int remaining) {
+    std::size_t total = 0;
+    while (remaining > 0) {
+        msghdr message{};
+        message.msg_iov = next;
+        message.msg_iovlen = static_cast<std::size_t>(remaining);
+        ssize_t n = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw socket_error("send");
+        }
+        // Skip what was sent, including parts that are empty
+        auto sent = static_cast<std::size_t>(n);
+        total += sent;
+        while (remaining > 0 && sent >= next->iov_len) {
+            sent -= next->iov_len;
+            ++next;
+            --remaining;
+        }
+        if (remaining > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + sent;
+            next->iov_len -= sent;
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+const char* rpc_method_name(RpcMethod method) {
+    switch (method) {
+        case RpcMethod::Register:     return "register";
+        case RpcMethod::Heartbeat:    return "heartbeat";
+        case RpcMethod::GetTask:      return "get_task";
+        case RpcMethod::SubmitResult: return "submit_result";
+        case RpcMethod::GetBalance:   return "get_balance";
+        case RpcMethod::ModelConfig:  return "model_config";
+        case RpcMethod::RelaySubmit:  return "relay_submit";
+        case RpcMethod::RelayReserve: return "relay_reserve";
+    }
+    return "unknown";
+}
+
+RpcFrameHeader rpc_frame_header(RpcMethod method, int status, std::uint64_t request_id,
+                                std::size_t meta_bytes, std::size_t payload_bytes,
+                                ContentEncoding encoding, ContentEncoding accept) {
+    if (meta_bytes > kRpcMaxMeta || payload_bytes > kRpcMaxPayload) {
+        throw std::runtime_error("RPC: frame too large");
+    }
+    if (!rpc_payload_encoding(encoding)) {
+        throw std::invalid_argument(std::string("RPC: payloads cannot be ") + content_encoding_name(encoding));
+    }
+    RpcFrameHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.method = static_cast<std::uint16_t>(method);
+    header.status = static_cast<std::uint16_t>(status);
+    header.request_id = request_id;
+    header.payload_bytes = payload_bytes;
+    header.meta_bytes = static_cast<std::uint32_t>(meta_bytes);
+    header.encoding = static_cast<std::uint8_t>(encoding);
+    header.accept_encoding = static_cast<std::uint8_t>(accept);
+    return header;
+}
+
+void rpc_check_header(const RpcFrameHeader& header) {
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("RPC: not an RPC frame");
+    }
+    if (header.meta_bytes > kRpcMaxMeta || header.payload_bytes > kRpcMaxPayload ||
+        header.payload_bytes % sizeof(float) != 0) {
+        throw std::runtime_error("RPC: frame too large or malformed");
+    }
+    // Accept is only a preference; an unknown one is ignored, as in HTTP
+    if (!rpc_payload_encoding(static_cast<ContentEncoding>(header.encoding))) {
+        throw std::runtime_error("RPC: unknown payload encoding");
+    }
+}
+
+bool rpc_payload_encoding(ContentEncoding encoding) {
+    return encoding == ContentEncoding::Identity || encoding == ContentEncoding::Lz ||
+           encoding == ContentEncoding::Deflate;
+}
+
+void rpc_decode_payload(ContentEncoding encoding, std::span<const std::byte> stream, std::span<std::byte> out) {
+    if (encoding == ContentEncoding::Identity) {
+        if (stream.size() != out.size()) {
+            throw std::runtime_error("RPC: payload size does not match its header");
+        }
+        std::memcpy(out.data(), stream.data(), stream.size());
+        return;
+    }
+    Decompressor decompressor;
+    std::size_t done = 0;
+    while (done < out.size()) {
+        EncodedBlockHeader block;
+        if (stream.size() < sizeof(block)) {
+            throw std::runtime_error("RPC: encoded payload ends early");
+        }
+        std::memcpy(&block, stream.data(), sizeof(block));
+        Decompressor::check(block, out.size() - done);
+        stream = stream.subspan(sizeof(block));
+        if (stream.size() < block.packed_bytes()) {
+            throw std::runtime_error("RPC: encoded payload ends early");
+        }
+        decompressor.decode_block(encoding, block, stream.first(block.packed_bytes()),
+                                  out.subspan(done, block.raw_bytes));
+        stream = stream.subspan(block.packed_bytes());
+        done += block.raw_bytes;
+    }
+    if (!stream.empty()) {
+        throw std::runtime_error("RPC: encoded payload runs past its size");
+    }
+}
+
+// =============================================================================
+// Sockets
+// =============================================================================
+
+int rpc_connect(const std::string& endpoint) {
+    Endpoint parsed = parse_endpoint(endpoint);
+
+    if (parsed.unix_socket) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw socket_error("socket");
+        }
+        sockaddr_un address = unix_address(parsed.host);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            auto error = socket_error("connect to " + endpoint);
+            ::close(fd);
+            throw error;
+        }
+        return fd;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (int rc = ::getaddrinfo(parsed.host.c_str(), parsed.port.c_str(), &hints, &results); rc != 0) {
+        throw std::runtime_error("RPC: cannot resolve " + endpoint + ": " + ::gai_strerror(rc));
+    }
+    int fd = -1;
+    for (addrinfo* ai = results; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && ::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(results);
+    if (fd < 0) {
+        throw socket_error("connect to " + endpoint);
+    }
+    tune_tcp(fd);
+    return fd;
+}
+
+int rpc_listen(const std::string& endpoint) {
+    Endpoint parsed = parse_endpoint(endpoint);
+
+    if (parsed.unix_socket) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw socket_error("socket");
+        }
+        ::unlink(parsed.host.c_str());   // Left behind by a previous run
+        sockaddr_un address = unix_address(parsed.host);
+        if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(fd, SOMAXCONN) != 0) {
+            auto error = socket_error("listen on " + endpoint);
+            ::close(fd);
+            throw error;
+        }
+        return fd;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* results = nullptr;
+    const char* host = parsed.host.empty() || parsed.host == "*" ? nullptr : parsed.host.c_str();
+    if (int rc = ::getaddrinfo(host, parsed.port.c_str(), &hints, &results); rc != 0) {
+        throw std::runtime_error("RPC: cannot resolve " + endpoint + ": " + ::gai_strerror(rc));
+    }
+    int fd = -1;
+    for (addrinfo* ai = results; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(results);
+    if (fd < 0) {
+        throw socket_error("listen on " + endpoint);
+    }
+    return fd;
+}
+
+// =============================================================================
+// RpcConnection
+// =============================================================================
+
+RpcConnection::RpcConnection(int fd) : fd_(fd) {}
+
+RpcConnection::~RpcConnection() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+RpcConnection::RpcConnection(RpcConnection&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), sent_(other.sent_), received_(other.received_),
+      compressor_(std::move(other.compressor_)), decompressor_(std::move(other.decompressor_)),
+      packed_(std::move(other.packed_)) {}
+
+RpcConnection& RpcConnection::operator=(RpcConnection&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = std::exchange(other.fd_, -1);
+        sent_ = other.sent_;
+        received_ = other.received_;
+        compressor_ = std::move(other.compressor_);
+        decompressor_ = std::move(other.decompressor_);
+        packed_ = std::move(other.packed_);
+    }
+    return *this;
+}
+
+void RpcConnection::send(RpcMethod method, int status, std::uint64_t request_id, std::string_view meta,
+                         std::span<const float> payload, ContentEncoding encoding, ContentEncoding accept) {
+    if (payload.empty()) {
+        encoding = ContentEncoding::Identity;
+    }
+    RpcFrameHeader header = rpc_frame_header(method, status, request_id, meta.size(), payload.size_bytes(),
+                                             encoding, accept);
+
+    // The payload goes out from where it lives; nothing is copied into a
+    // send buffer
+    iovec parts[3] = {
+        {&header, sizeof(header)},
+        {const_cast<char*>(meta.data()), meta.size()},
+        {const_cast<float*>(payload.data()), payload.size_bytes()},
+    };
+    if (encoding == ContentEncoding::Identity) {
+        sent_ += write_all(fd_, parts, 3);
+        return;
+    }
+
+    // Encoded: one block at a time, the first with header and meta
+    if (!compressor_ || compressor_->encoding() != encoding) {
+        compressor_ = std::make_unique<Compressor>(encoding);
+    }
+    auto bytes = std::as_bytes(payload);
+    iovec* first = parts;
+    int count = 3;
+    for (std::size_t offset = 0; offset < bytes.size(); offset += kEncodedBlockBytes) {
+        auto block = compressor_->encode_block(bytes.subspan(offset, std::min(kEncodedBlockBytes, bytes.size() - offset)));
+        parts[2] = {const_cast<std::byte*>(block.data()), block.size()};
+        sent_ += write_all(fd_, first, count);
+        first = parts + 2;
+        count = 1;
+    }
+}
+
+void RpcConnection::send_encoded(RpcMethod method, int status, std::uint64_t request_id, std::string_view meta,
+                                 std::size_t payload_bytes, ContentEncoding encoding,
+                                 std::span<const std::byte> stream, ContentEncoding accept) {
+    RpcFrameHeader header = rpc_frame_header(method, status, request_id, meta.size(), payload_bytes,
+                                             encoding, accept);
+    iovec parts[3] = {
+        {&header, sizeof(header)},
+        {const_cast<char*>(meta.data()), meta.size()},
+        {const_cast<std::byte*>(stream.data()), stream.size()},
+    };
+    sent_ += write_all(fd_, parts, 3);
+}
+
+bool RpcConnection::receive(RpcMessage& message, const RpcPayloadSize& expected) {
+    RpcFrameHeader header;
+    if (!read_exact(fd_, &header, sizeof(header), true)) {
+        return false;
+    }
+    rpc_check_header(header);
+    if (expected && header.payload_bytes != expected(static_cast<RpcMethod>(header.method))) {
+        throw std::runtime_error("RPC: payload size does not match the method");
+    }
+
+    message.method = static_cast<RpcMethod>(header.method);
+    message.status = header.status;
+    message.request_id = header.request_id;
+    message.encoding = static_cast<ContentEncoding>(header.encoding);
+    message.accept = static_cast<ContentEncoding>(header.accept_encoding);
+    message.meta.resize(header.meta_bytes);
+    read_exact(fd_, message.meta.data(), message.meta.size(), false);
+    received_ += sizeof(header) + message.meta.size();
+
+    // Straight into the buffer the parameters are used from
+    message.payload.resize(header.payload_bytes / sizeof(float));
+    auto out = std::as_writable_bytes(std::span(message.payload));
+    if (message.encoding == ContentEncoding::Identity) {
+        read_exact(fd_, out.data(), out.size(), false);
+        received_ += out.size();
+        return true;
+    }
+
+    // Decoded a block at a time: only one packed block is ever buffered
+    if (!decompressor_) {
+        decompressor_ = std::make_unique<Decompressor>();
+    }
+    std::size_t done = 0;
+    while (done < out.size()) {
+        EncodedBlockHeader block;
+        read_exact(fd_, &block, sizeof(block), false);
+        Decompressor::check(block, out.size() - done);
+        packed_.resize(block.packed_bytes());
+        read_exact(fd_, packed_.data(), packed_.size(), false);
+        decompressor_->decode_block(message.encoding, block, packed_, out.subspan(done, block.raw_bytes));
+        done += block.raw_bytes;
+        received_ += sizeof(block) + packed_.size();
+    }
+    return true;
+}
+
+void RpcConnection::shutdown() {
+    if (fd_ >= 0) {
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+}
+
+// =============================================================================
+// RpcClient
+// =============================================================================
+
+RpcClient::RpcClient(const std::string& endpoint, ContentEncoding encoding)
+    : endpoint_(endpoint), connection_(rpc_connect(endpoint)), encoding_(encoding) {
+    if (!rpc_payload_encoding(encoding)) {
+        throw std::invalid_argument(std::string("RPC: payloads cannot be ") + content_encoding_name(encoding));
+    }
+}
+
+std::uint64_t RpcClient::send(RpcMethod method, std::string_view meta, std::span<const float> payload) {
+    std::uint64_t id = next_id_++;
+    connection_.send(method, 0, id, meta, payload,
+                     encode_uploads_ ? encoding_ : ContentEncoding::Identity, encoding_);
+    return id;
+}
+
+RpcMessage RpcClient::receive() {
+    RpcMessage message;
+    if (!connection_.receive(message)) {
+        throw std::runtime_error("RPC: " + endpoint_ + " closed the connection");
+    }
+    // A server without encodings answers identity and is never sent any
+    encode_uploads_ = encoding_ != ContentEncoding::Identity && message.accept == encoding_;
+    return message;
+}
+
+RpcMessage RpcClient::call(RpcMethod method, std::string_view meta, std::span<const float> payload) {
+    send(method, meta, payload);
+    return receive();
+}
+
+} // namespace hydra
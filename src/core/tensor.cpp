@@ -0,0 +1,329 @@
+/**
+ * @file tensor.cpp
+ * @brief Implementation of Tensor views and in-place operations
+ */
+
+#include "hydra/tensor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace hydra {
+
+// =============================================================================
+// Shape
+// =============================================================================
+
+Shape::Shape(std::initializer_list<std::size_t> sizes) : Shape(std::span(sizes.begin(), sizes.size())) {}
+
+Shape::Shape(std::span<const std::size_t> sizes) {
+    if (sizes.size() > kMaxRank) {
+        throw std::invalid_argument("Tensors have at most " + std::to_string(kMaxRank) + " dimensions");
+    }
+    std::copy(sizes.begin(), sizes.end(), dims.begin());
+    rank = sizes.size();
+}
+
+std::size_t Shape::numel() const {
+    std::size_t count = 1;
+    for (std::size_t d = 0; d < rank; ++d) {
+        count *= dims[d];
+    }
+    return count;
+}
+
+bool Shape::operator==(const Shape& other) const {
+    return rank == other.rank && std::equal(dims.begin(), dims.begin() + rank, other.dims.begin());
+}
+
+std::string Shape::to_string() const {
+    std::string text = "[";
+    for (std::size_t d = 0; d < rank; ++d) {
+        text += (d ? ", " : "") + std::to_string(dims[d]);
+    }
+    return text + "]";
+}
+
+// =============================================================================
+// Tensor
+// =============================================================================
+
+Tensor::Tensor(float* data, const Shape& shape) : data_(data), shape_(shape) {
+    std::size_t stride = 1;
+    for (std::size_t d = shape.rank; d-- > 0;) {
+        strides_[d] = stride;
+        stride *= shape.dims[d];
+    }
+}
+
+Tensor Tensor::empty(Arena& arena, const Shape& shape) {
+    return Tensor(arena.allocate_floats(shape.numel()), shape);
+}
+
+Tensor Tensor::full(Arena& arena, const Shape& shape, float value) {
+    Tensor tensor = empty(arena, shape);
+    std::fill_n(tensor.data_, shape.numel(), value);
+    return tensor;
+}
+
+Tensor Tensor::wrap(float* data, const Shape& shape) {
+    return Tensor(data, shape);
+}
+
+bool Tensor::contiguous() const {
+    std::size_t expected = 1;
+    for (std::size_t d = shape_.rank; d-- > 0;) {
+        if (shape_.dims[d] != 1 && strides_[d] != expected) {
+            return false;
+        }
+        expected *= shape_.dims[d];
+    }
+    return true;
+}
+
+Tensor Tensor::view(const Shape& shape) const {
+    if (!contiguous()) {
+        throw std::invalid_argument("view() needs a contiguous tensor; copy it first");
+    }
+    if (shape.numel() != numel()) {
+        throw std::invalid_argument("Cannot view " + shape_.to_string() + " as " + shape.to_string());
+    }
+    return Tensor(data_, shape);
+}
+
+Tensor Tensor::slice(std::size_t dim, std::size_t begin, std::size_t end) const {
+    if (dim >= rank() || begin > end || end > shape_.dims[dim]) {
+        throw std::out_of_range("Slice " + std::to_string(begin) + ".." + std::to_string(end) +
+                                " of dimension " + std::to_string(dim) + " of " + shape_.to_string());
+    }
+    Tensor result = *this;
+    result.data_ += begin * strides_[dim];
+    result.shape_.dims[dim] = end - begin;
+    return result;
+}
+
+Tensor Tensor::select(std::size_t dim, std::size_t index) const {
+    if (dim >= rank() || index >= shape_.dims[dim]) {
+        throw std::out_of_range("Index " + std::to_string(index) + " of dimension " + std::to_string(dim) +
+                                " of " + shape_.to_string());
+    }
+    Tensor result;
+    result.data_ = data_ + index * strides_[dim];
+    for (std::size_t d = 0; d < rank(); ++d) {
+        if (d != dim) {
+            result.shape_.dims[result.shape_.rank] = shape_.dims[d];
+            result.strides_[result.shape_.rank] = strides_[d];
+            ++result.shape_.rank;
+        }
+    }
+    return result;
+}
+
+Tensor Tensor::transpose(std::size_t dim0, std::size_t dim1) const {
+    if (dim0 >= rank() || dim1 >= rank()) {
+        throw std::out_of_range("Cannot transpose dimensions " + std::to_string(dim0) + " and " +
+                                std::to_string(dim1) + " of " + shape_.to_string());
+    }
+    Tensor result = *this;
+    std::swap(result.shape_.dims[dim0], result.shape_.dims[dim1]);
+    std::swap(result.strides_[dim0], result.strides_[dim1]);
+    return result;
+}
+
+Tensor Tensor::broadcast_to(const Shape& shape) const {
+    // Dimensions line up from the right, as in NumPy
+    if (shape.rank < rank()) {
+        throw std::invalid_argument("Cannot broadcast " + shape_.to_string() + " to " + shape.to_string());
+    }
+    Tensor result;
+    result.data_ = data_;
+    result.shape_ = shape;
+    std::size_t lead = shape.rank - rank();
+    for (std::size_t d = 0; d < shape.rank; ++d) {
+        if (d < lead) {
+            result.strides_[d] = 0;
+            continue;
+        }
+        std::size_t size = shape_.dims[d - lead];
+        if (size == shape.dims[d]) {
+            result.strides_[d] = strides_[d - lead];
+        } else if (size == 1) {
+            result.strides_[d] = 0;
+        } else {
+            throw std::invalid_argument("Cannot broadcast " + shape_.to_string() + " to " + shape.to_string());
+        }
+    }
+    return result;
+}
+
+// =============================================================================
+// Element-wise kernels
+// =============================================================================
+
+namespace {
+
+void check_same(const Tensor& dst, const Tensor& src, const char* op) {
+    if (!(dst.shape() == src.shape())) {
+        throw std::invalid_argument(std::string(op) + ": shapes " + dst.shape().to_string() + " and " +
+                                    src.shape().to_string() + " differ");
+    }
+}
+
+// Calls row(dst_row, src_row, length, dst_step, src_step) for every run
+// along the last dimension; one run for contiguous operands
+template <typename Row>
+void for_each_row(const Tensor& dst, const Tensor* src, Row row) {
+    std::size_t count = dst.numel();
+    if (count == 0) {
+        return;
+    }
+    if (dst.contiguous() && (!src || src->contiguous())) {
+        row(dst.data(), src ? src->data() : nullptr, count, std::size_t{1}, std::size_t{1});
+        return;
+    }
+
+    // Pad to four dimensions; the last one is the inner loop
+    std::array<std::size_t, Shape::kMaxRank> size{1, 1, 1, 1}, ds{}, ss{};
+    std::size_t lead = Shape::kMaxRank - dst.rank();
+    for (std::size_t d = 0; d < dst.rank(); ++d) {
+        size[lead + d] = dst.size(d);
+        ds[lead + d] = dst.stride(d);
+        ss[lead + d] = src ? src->stride(d) : 0;
+    }
+    for (std::size_t i = 0; i < size[0]; ++i) {
+        for (std::size_t j = 0; j < size[1]; ++j) {
+            for (std::size_t k = 0; k < size[2]; ++k) {
+                float* d = dst.data() + i * ds[0] + j * ds[1] + k * ds[2];
+                const float* s = src ? src->data() + i * ss[0] + j * ss[1] + k * ss[2] : nullptr;
+                row(d, s, size[3], ds[3], ss[3]);
+            }
+        }
+    }
+}
+
+template <typename Op>
+void binary(const Tensor& dst, const Tensor& src, const char* name, Op op) {
+    check_same(dst, src, name);
+    for_each_row(dst, &src, [&](float* d, const float* s, std::size_t n, std::size_t dstep, std::size_t sstep) {
+        if (dstep == 1 && sstep == 1) {
+            for (std::size_t i = 0; i < n; ++i) {
+                d[i] = op(d[i], s[i]);
+            }
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                d[i * dstep] = op(d[i * dstep], s[i * sstep]);
+            }
+        }
+    });
+}
+
+template <typename Op>
+void unary(const Tensor& dst, Op op) {
+    for_each_row(dst, nullptr, [&](float* d, const float*, std::size_t n, std::size_t dstep, std::size_t) {
+        if (dstep == 1) {
+            for (std::size_t i = 0; i < n; ++i) {
+                d[i] = op(d[i]);
+            }
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                d[i * dstep] = op(d[i * dstep]);
+            }
+        }
+    });
+}
+
+} // namespace
+
+void fill(const Tensor& dst, float value) {
+    unary(dst, [value](float) { return value; });
+}
+
+void copy(const Tensor& dst, const Tensor& src) {
+    binary(dst, src, "copy", [](float, float s) { return s; });
+}
+
+Tensor contiguous_copy(Arena& arena, const Tensor& src) {
+    Tensor result = Tensor::empty(arena, src.shape());
+    copy(result, src);
+    return result;
+}
+
+void add(const Tensor& dst, const Tensor& src) {
+    binary(dst, src, "add", [](float d, float s) { return d + s; });
+}
+
+void sub(const Tensor& dst, const Tensor& src) {
+    binary(dst, src, "sub", [](float d, float s) { return d - s; });
+}
+
+void mul(const Tensor& dst, const Tensor& src) {
+    binary(dst, src, "mul", [](float d, float s) { return d * s; });
+}
+
+void scale(const Tensor& dst, float factor) {
+    unary(dst, [factor](float d) { return d * factor; });
+}
+
+void axpy(const Tensor& dst, float alpha, const Tensor& src) {
+    binary(dst, src, "axpy", [alpha](float d, float s) { return d + alpha * s; });
+}
+
+void relu(const Tensor& dst) {
+    unary(dst, [](float d) { return d > 0.0f ? d : 0.0f; });
+}
+
+void softmax_rows(const Tensor& dst) {
+    if (dst.rank() == 0 || dst.empty()) {
+        return;   // No rows, or rows of nothing
+    }
+    std::size_t last = dst.rank() - 1;
+    std::size_t n = dst.size(last);
+    std::size_t step = dst.stride(last);
+    // Every other dimension indexes a row: walk them as a [rows, 1] tensor
+    Tensor rows = dst.select(last, 0);
+    if (rows.rank() == 0) {
+        rows = Tensor::wrap(dst.data(), {1});
+    }
+    for_each_row(rows, nullptr, [&](float* first, const float*, std::size_t count, std::size_t row_step, std::size_t) {
+        for (std::size_t r = 0; r < count; ++r) {
+            float* x = first + r * row_step;
+            float max = x[0];
+            for (std::size_t i = 1; i < n; ++i) {
+                max = std::max(max, x[i * step]);
+            }
+            float total = 0.0f;
+            for (std::size_t i = 0; i < n; ++i) {
+                x[i * step] = std::exp(x[i * step] - max);
+                total += x[i * step];
+            }
+            float inverse = 1.0f / total;
+            for (std::size_t i = 0; i < n; ++i) {
+                x[i * step] *= inverse;
+            }
+        }
+    });
+}
+
+double sum(const Tensor& src) {
+    double total = 0.0;
+    // for_each_row only reads through dst here
+    for_each_row(src, nullptr, [&](float* s, const float*, std::size_t n, std::size_t step, std::size_t) {
+        for (std::size_t i = 0; i < n; ++i) {
+            total += s[i * step];
+        }
+    });
+    return total;
+}
+
+double dot(const Tensor& src, const Tensor& other) {
+    check_same(src, other, "dot");
+    double total = 0.0;
+    for_each_row(src, &other, [&](float* a, const float* b, std::size_t n, std::size_t astep, std::size_t bstep) {
+        for (std::size_t i = 0; i < n; ++i) {
+            total += static_cast<double>(a[i * astep]) * b[i * bstep];
+        }
+    });
+    return total;
+}
+
+} // namespace hydra
@@ -0,0 +1,200 @@
+/**
+ * @file token_dataset.cpp
+ * @brief Implementation of the packed token dataset
+ */
+
+#include "hydra/token_dataset.hpp"
+#include "hydra/model_state.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace {
+
+constexpr char kTokenMagic[8] = {'H', 'Y', 'D', 'R', 'A', 'T', 'K', '1'};
+constexpr std::uint32_t kTokenVersion = 1;
+
+std::optional<std::uint64_t> member_uint(std::string_view json, std::string_view key) {
+    std::string_view raw = find_json_member(json, key);
+    std::uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(raw.data(), raw.data() + raw.size(), value);
+    if (raw.empty() || ec != std::errc() || ptr != raw.data() + raw.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+} // namespace
+
+// =============================================================================
+// TokenRange
+// =============================================================================
+
+std::string TokenRange::to_json() const {
+    return "{\"token_start\": " + std::to_string(start) +
+           ", \"token_count\": " + std::to_string(count) +
+           ", \"seq_len\": " + std::to_string(seq_len) + "}";
+}
+
+std::optional<TokenRange> TokenRange::from_json(std::string_view text) {
+    auto start = member_uint(text, "token_start");
+    auto count = member_uint(text, "token_count");
+    auto seq_len = member_uint(text, "seq_len");
+    if (!start || !count || !seq_len) {
+        return std::nullopt;
+    }
+    return TokenRange{*start, *count, static_cast<std::uint32_t>(*seq_len)};
+}
+
+// =============================================================================
+// TokenDataset
+// =============================================================================
+
+TokenDataset::TokenDataset(const std::string& path) : file_(path) {
+    if (file_.size() < sizeof(TokenFileHeader)) {
+        throw std::runtime_error("Token file too small: " + path);
+    }
+
+    header_ = reinterpret_cast<const TokenFileHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kTokenMagic, sizeof(kTokenMagic)) != 0 ||
+        header_->version != kTokenVersion ||
+        (header_->token_bytes != 2 && header_->token_bytes != 4)) {
+        throw std::runtime_error("Not a token file: " + path);
+    }
+
+    // Counts are bounded by what the file can hold before they are
+    // multiplied, so a crafted header cannot wrap around into a layout
+    // that passes
+    const std::uint64_t size = file_.size();
+    const TokenFileHeader& h = *header_;
+    if (h.tokens_offset > size || h.tokens_offset % h.token_bytes != 0 ||
+        h.num_tokens > (size - h.tokens_offset) / h.token_bytes ||
+        h.docs_offset > size || h.docs_offset % alignof(std::uint64_t) != 0 ||
+        h.docs_offset < h.tokens_offset || h.docs_offset - h.tokens_offset < h.num_tokens * h.token_bytes ||
+        h.num_docs >= (size - h.docs_offset) / sizeof(std::uint64_t)) {
+        throw std::runtime_error("Corrupt token file layout: " + path);
+    }
+
+    // Document bounds are read without checks later: every offset must lie
+    // within the tokens, in order, ending at the last token
+    tokens_ = file_.data() + h.tokens_offset;
+    docs_ = reinterpret_cast<const std::uint64_t*>(file_.data() + h.docs_offset);
+    bool ordered = docs_[h.num_docs] == h.num_tokens;
+    for (std::uint64_t d = 0; ordered && d < h.num_docs; ++d) {
+        ordered = docs_[d] <= docs_[d + 1];
+    }
+    if (!ordered) {
+        throw std::runtime_error("Corrupt token file document table: " + path);
+    }
+}
+
+std::uint32_t TokenDataset::token(std::uint64_t i) const {
+    if (header_->token_bytes == 2) {
+        return reinterpret_cast<const std::uint16_t*>(tokens_)[i];
+    }
+    return reinterpret_cast<const std::uint32_t*>(tokens_)[i];
+}
+
+void TokenDataset::copy(std::uint64_t start, std::uint64_t count, std::uint32_t* out) const {
+    if (start > num_tokens() || count > num_tokens() - start) {
+        throw std::out_of_range("Token range outside the dataset");
+    }
+
+    if (header_->token_bytes == 4) {
+        std::memcpy(out, tokens_ + start * 4, count * 4);
+        return;
+    }
+    const auto* narrow = reinterpret_cast<const std::uint16_t*>(tokens_) + start;
+    std::copy(narrow, narrow + count, out);
+}
+
+std::span<const std::byte> TokenDataset::raw(std::uint64_t start, std::uint64_t count) const {
+    if (start > num_tokens() || count > num_tokens() - start) {
+        throw std::out_of_range("Token range outside the dataset");
+    }
+    return {tokens_ + start * header_->token_bytes, count * header_->token_bytes};
+}
+
+std::pair<std::uint64_t, std::uint64_t> TokenDataset::document(std::uint64_t d) const {
+    if (d >= num_docs()) {
+        throw std::out_of_range("Document index outside the dataset");
+    }
+    return {docs_[d], docs_[d + 1] - docs_[d]};
+}
+
+TokenRange TokenDataset::sample(std::uint64_t random, std::uint64_t count, std::uint32_t seq_len) const {
+    count = std::min(count, num_tokens());
+    std::uint64_t span = num_tokens() - count + 1;
+    return TokenRange{random % span, count, seq_len};
+}
+
+// =============================================================================
+// TokenDatasetWriter
+// =============================================================================
+
+TokenDatasetWriter::TokenDatasetWriter(const std::string& path, std::uint64_t vocab_size)
+    : path_(path), out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("Failed to create token file " + path);
+    }
+
+    std::memcpy(header_.magic, kTokenMagic, sizeof(kTokenMagic));
+    header_.version = kTokenVersion;
+    header_.token_bytes = vocab_size <= 65536 ? 2 : 4;
+    header_.vocab_size = vocab_size;
+    header_.tokens_offset = sizeof(TokenFileHeader);
+    doc_offsets_.push_back(0);
+
+    // Placeholder header, rewritten by finish()
+    out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+}
+
+TokenDatasetWriter::~TokenDatasetWriter() {
+    if (!finished_) {
+        try {
+            finish();
+        } catch (...) {
+            // Destructors must not throw; call finish() to see errors
+        }
+    }
+}
+
+void TokenDatasetWriter::add_document(std::span<const std::uint32_t> tokens) {
+    if (header_.token_bytes == 4) {
+        out_.write(reinterpret_cast<const char*>(tokens.data()),
+                   static_cast<std::streamsize>(tokens.size_bytes()));
+    } else {
+        narrow_.assign(tokens.begin(), tokens.end());
+        out_.write(reinterpret_cast<const char*>(narrow_.data()),
+                   static_cast<std::streamsize>(narrow_.size() * sizeof(std::uint16_t)));
+    }
+    doc_offsets_.push_back(doc_offsets_.back() + tokens.size());
+}
+
+std::uint64_t TokenDatasetWriter::finish() {
+    finished_ = true;
+
+    header_.num_tokens = doc_offsets_.back();
+    header_.num_docs = doc_offsets_.size() - 1;
+
+    const std::uint64_t token_end = header_.tokens_offset + header_.num_tokens * header_.token_bytes;
+    const std::uint64_t padding = (8 - token_end % 8) % 8;
+    const char zeros[8] = {};
+    out_.write(zeros, static_cast<std::streamsize>(padding));
+    header_.docs_offset = token_end + padding;
+
+    out_.write(reinterpret_cast<const char*>(doc_offsets_.data()),
+               static_cast<std::streamsize>(doc_offsets_.size() * sizeof(std::uint64_t)));
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+    out_.close();
+    if (out_.fail()) {
+        throw std::runtime_error("Failed to write token file " + path_);
+    }
+    return header_.num_tokens;
+}
+
+} // namespace hydra
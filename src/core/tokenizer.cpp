@@ -0,0 +1,139 @@
+/**
+ * @file tokenizer.cpp
+ * @brief Implementation of Tokenizer
+ */
+
+#include "hydra/tokenizer.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace hydra {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+char to_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+} // namespace
+
+Tokenizer::Tokenizer(std::size_t vocab_size) : vocab_size_(vocab_size) {
+    if (vocab_size_ < 4) {
+        throw std::invalid_argument("Tokenizer: vocab_size must leave room for special tokens");
+    }
+    for (const char* special : {"<PAD>", "<UNK>", "<START>", "<END>"}) {
+        add_token(special);
+    }
+}
+
+Tokenizer Tokenizer::load(const std::string& path, std::size_t vocab_size) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to open vocabulary " + path);
+    }
+
+    Tokenizer tokenizer(vocab_size);
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(in, line)) {
+        if (line_number++ < 4) {
+            continue;   // Special tokens are always present
+        }
+        if (tokenizer.tokens_.size() >= vocab_size) {
+            throw std::runtime_error("Vocabulary " + path + " is larger than vocab_size");
+        }
+        tokenizer.add_token(std::move(line));
+    }
+    return tokenizer;
+}
+
+void Tokenizer::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    for (const auto& token : tokens_) {
+        out << token << '\n';
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write vocabulary " + path);
+    }
+}
+
+void Tokenizer::split_words(std::string_view text, std::vector<std::string>& words) {
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && is_space(text[pos])) {
+            ++pos;
+        }
+        if (pos >= text.size()) {
+            break;
+        }
+
+        std::string word;
+        while (pos < text.size() && !is_space(text[pos])) {
+            word += to_lower(text[pos++]);
+        }
+        words.push_back(std::move(word));
+    }
+}
+
+void Tokenizer::encode(std::string_view text, std::vector<std::uint32_t>& out, bool grow) {
+    thread_local std::vector<std::string> words;
+    words.clear();
+    split_words(text, words);
+
+    out.push_back(kStart);
+    for (auto& word : words) {
+        if (auto it = ids_.find(word); it != ids_.end()) {
+            out.push_back(it->second);
+        } else if (grow) {
+            out.push_back(add_token(std::move(word)));
+        } else {
+            out.push_back(kUnk);
+        }
+    }
+    out.push_back(kEnd);
+}
+
+std::string Tokenizer::decode(std::span<const std::uint32_t> ids) const {
+    std::string text;
+    for (auto id : ids) {
+        if (id == kPad || id == kStart || id == kEnd || id >= tokens_.size()) {
+            continue;
+        }
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += tokens_[id];
+    }
+    return text;
+}
+
+std::optional<std::uint32_t> Tokenizer::id(std::string_view token) const {
+    if (auto it = ids_.find(token); it != ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+const std::string& Tokenizer::token(std::uint32_t id) const {
+    return id < tokens_.size() ? tokens_[id] : tokens_[kUnk];
+}
+
+std::uint32_t Tokenizer::add_token(std::string token) {
+    if (auto it = ids_.find(token); it != ids_.end()) {
+        return it->second;
+    }
+    if (tokens_.size() >= vocab_size_) {
+        return kUnk;
+    }
+
+    auto id = static_cast<std::uint32_t>(tokens_.size());
+    ids_.emplace(token, id);
+    tokens_.push_back(std::move(token));
+    return id;
+}
+
+} // namespace hydra
@@ -0,0 +1,313 @@
+/**
+ * @file transformer.cpp
+ * @brief Implementation of the native SimpleTransformer forward pass
+ */
+
+#include "hydra/transformer.hpp"
+#include "hydra/attention.hpp"
+#include "hydra/gemm.hpp"
+#include "hydra/tokenizer.hpp"
+#include "vector_ops.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace hydra {
+
+namespace {
+
+// y[r][o] = b[o] + x[r] . w[o]  (PyTorch Linear layout: w is [out][in]),
+// i.e. y = x w^T + b as one blocked sgemm over the whole batch
+void linear(const float* x, std::size_t rows, std::size_t in,
+            const float* w, const float* b, std::size_t out, float* y) {
+    for (std::size_t r = 0; r < rows; ++r) {
+        std::copy_n(b, out, y + r * out);
+    }
+    sgemm(Transpose::No, Transpose::Yes, rows, out, in, 1.0f, x, in, w, in, 1.0f, y, out);
+}
+
+void layer_norm(float* x, std::size_t rows, std::size_t n, const float* gamma, const float* beta) {
+    constexpr float kEps = 1e-5f;   // nn.LayerNorm default
+    for (std::size_t r = 0; r < rows; ++r) {
+        float* row = x + r * n;
+        float mean = 0.0f;
+        for (std::size_t i = 0; i < n; ++i) {
+            mean += row[i];
+        }
+        mean /= static_cast<float>(n);
+        float var = 0.0f;
+        for (std::size_t i = 0; i < n; ++i) {
+            float d = row[i] - mean;
+            var += d * d;
+        }
+        float scale = 1.0f / std::sqrt(var / static_cast<float>(n) + kEps);
+        for (std::size_t i = 0; i < n; ++i) {
+            row[i] = (row[i] - mean) * scale * gamma[i] + beta[i];
+        }
+    }
+}
+
+const float* param(const ModelState& model, const std::string& name) {
+    const TensorInfo* info = model.find(name);
+    if (!info) {
+        throw std::runtime_error("Model has no tensor " + name);
+    }
+    return model.values().data() + info->offset;
+}
+
+// A row whose output is needed, and the key rows it may attend to
+struct QueryRow {
+    std::size_t row;
+    std::size_t key_begin;
+    std::size_t key_end;
+};
+
+} // namespace
+
+void forward_last_logits(const ModelState& model,
+                         std::span<const std::vector<std::uint32_t>> sequences,
+                         std::vector<float>& logits,
+                         ForwardWorkspace& ws,
+                         std::span<KvCache* const> caches) {
+    const ModelConfig& config = model.config();
+    const auto vocab = static_cast<std::size_t>(config.vocab_size);
+    const auto embed = static_cast<std::size_t>(config.embed_dim);
+    const auto heads = static_cast<std::size_t>(config.num_heads);
+    const std::size_t head_dim = embed / heads;
+    const std::size_t ff = 4 * embed;
+
+    // Pack the sequences back to back
+    std::vector<QueryRow> all_rows;
+    std::vector<QueryRow> last_rows;
+    for (const auto& sequence : sequences) {
+        if (sequence.empty() || sequence.size() > static_cast<std::size_t>(config.max_seq_length)) {
+            throw std::invalid_argument("forward_last_logits: sequence length must be 1.." +
+                                        std::to_string(config.max_seq_length));
+        }
+        std::size_t begin = all_rows.size();
+        std::size_t end = begin + sequence.size();
+        for (std::size_t row = begin; row < end; ++row) {
+            all_rows.push_back({row, begin, end});
+        }
+        last_rows.push_back({end - 1, begin, end});
+    }
+    std::size_t rows = all_rows.size();
+    if (!caches.empty() && caches.size() != sequences.size()) {
+        throw std::invalid_argument("forward_last_logits: need one cache per sequence");
+    }
+
+    // Embedding + positional encoding
+    const float* embedding = param(model, "embedding.weight");
+    const float* position = param(model, "positional_encoding");
+    ws.x.resize(rows * embed);
+    std::size_t row = 0;
+    for (const auto& sequence : sequences) {
+        for (std::size_t t = 0; t < sequence.size(); ++t, ++row) {
+            std::size_t id = sequence[t] < vocab ? sequence[t] : Tokenizer::kUnk;
+            for (std::size_t i = 0; i < embed; ++i) {
+                ws.x[row * embed + i] = embedding[id * embed + i] + position[t * embed + i];
+            }
+        }
+    }
+
+    const float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+    for (int layer = 0; layer < config.num_layers; ++layer) {
+        const std::string prefix = "transformer.layers." + std::to_string(layer) + ".";
+
+        // Keys and values are needed for every row; in the last layer only
+        // the final position of each sequence needs an output
+        const bool last_only = layer + 1 == config.num_layers;
+        const auto& queries = last_only ? last_rows : all_rows;
+        std::size_t out_rows = queries.size();
+
+        ws.qkv.resize(rows * 3 * embed);
+        linear(ws.x.data(), rows, embed, param(model, prefix + "self_attn.in_proj_weight"),
+               param(model, prefix + "self_attn.in_proj_bias"), 3 * embed, ws.qkv.data());
+
+        // Prefill: keep this layer's keys and values for decode_step()
+        for (std::size_t s = 0; s < caches.size(); ++s) {
+            std::size_t begin = last_rows[s].key_begin;
+            for (std::size_t t = 0; t < sequences[s].size(); ++t) {
+                const float* kv = ws.qkv.data() + (begin + t) * 3 * embed + embed;
+                std::copy_n(kv, embed, caches[s]->key(layer, t));
+                std::copy_n(kv + embed, embed, caches[s]->value(layer, t));
+            }
+        }
+
+        // Fused attention per sequence and head; queries of the last layer
+        // are just the final row, written to output row s
+        ws.attn.resize(out_rows * embed);
+        for (std::size_t s = 0; s < last_rows.size(); ++s) {
+            const QueryRow& sequence = last_rows[s];
+            std::size_t first = last_only ? sequence.row : sequence.key_begin;
+            std::size_t out_row = last_only ? s : sequence.key_begin;
+            for (std::size_t h = 0; h < heads; ++h) {
+                const float* keys = ws.qkv.data() + sequence.key_begin * 3 * embed + h * head_dim;
+                AttentionHead head{ws.qkv.data() + first * 3 * embed + h * head_dim, 3 * embed,
+                                   keys + embed, 3 * embed, keys + 2 * embed, 3 * embed,
+                                   sequence.key_end - first, sequence.key_end - sequence.key_begin,
+                                   head_dim, scale};
+                attention_forward(head, ws.attn.data() + out_row * embed + h * head_dim, embed);
+            }
+        }
+
+        // x = norm1(x + out_proj(attn))
+        ws.residual.resize(out_rows * embed);
+        linear(ws.attn.data(), out_rows, embed, param(model, prefix + "self_attn.out_proj.weight"),
+               param(model, prefix + "self_attn.out_proj.bias"), embed, ws.residual.data());
+        for (std::size_t q = 0; q < out_rows; ++q) {
+            const float* in = ws.x.data() + queries[q].row * embed;
+            float* out = ws.residual.data() + q * embed;
+            for (std::size_t i = 0; i < embed; ++i) {
+                out[i] += in[i];
+            }
+        }
+        layer_norm(ws.residual.data(), out_rows, embed,
+                   param(model, prefix + "norm1.weight"), param(model, prefix + "norm1.bias"));
+
+        // x = norm2(x + linear2(relu(linear1(x))))
+        ws.hidden.resize(out_rows * ff);
+        linear(ws.residual.data(), out_rows, embed, param(model, prefix + "linear1.weight"),
+               param(model, prefix + "linear1.bias"), ff, ws.hidden.data());
+        for (float& v : ws.hidden) {
+            v = std::max(v, 0.0f);
+        }
+        ws.x.resize(out_rows * embed);
+        linear(ws.hidden.data(), out_rows, ff, param(model, prefix + "linear2.weight"),
+               param(model, prefix + "linear2.bias"), embed, ws.x.data());
+        for (std::size_t i = 0; i < out_rows * embed; ++i) {
+            ws.x[i] += ws.residual[i];
+        }
+        layer_norm(ws.x.data(), out_rows, embed,
+                   param(model, prefix + "norm2.weight"), param(model, prefix + "norm2.bias"));
+
+        rows = out_rows;
+    }
+
+    // Without encoder layers the last rows still have to be picked out
+    if (config.num_layers == 0) {
+        for (std::size_t s = 0; s < last_rows.size(); ++s) {
+            std::copy_n(ws.x.begin() + last_rows[s].row * embed, embed, ws.x.begin() + s * embed);
+        }
+        rows = last_rows.size();
+    }
+
+    for (std::size_t s = 0; s < caches.size(); ++s) {
+        caches[s]->set_length(sequences[s].size());
+    }
+
+    logits.resize(rows * vocab);
+    linear(ws.x.data(), rows, embed, param(model, "output_layer.weight"),
+           param(model, "output_layer.bias"), vocab, logits.data());
+}
+
+void decode_step(const ModelState& model,
+                 std::span<const std::uint32_t> tokens,
+                 std::span<KvCache* const> caches,
+                 std::vector<float>& logits,
+                 ForwardWorkspace& ws) {
+    const ModelConfig& config = model.config();
+    const auto vocab = static_cast<std::size_t>(config.vocab_size);
+    const auto embed = static_cast<std::size_t>(config.embed_dim);
+    const auto heads = static_cast<std::size_t>(config.num_heads);
+    const std::size_t head_dim = embed / heads;
+    const std::size_t ff = 4 * embed;
+    const std::size_t rows = tokens.size();
+
+    if (caches.size() != rows) {
+        throw std::invalid_argument("decode_step: need one cache per token");
+    }
+    for (const KvCache* cache : caches) {
+        if (cache->length() >= static_cast<std::size_t>(config.max_seq_length)) {
+            throw std::invalid_argument("decode_step: sequence is at max_seq_length");
+        }
+    }
+
+    // The new token sits at position length() of its sequence
+    const float* embedding = param(model, "embedding.weight");
+    const float* position = param(model, "positional_encoding");
+    ws.x.resize(rows * embed);
+    for (std::size_t r = 0; r < rows; ++r) {
+        std::size_t id = tokens[r] < vocab ? tokens[r] : Tokenizer::kUnk;
+        std::size_t t = caches[r]->length();
+        for (std::size_t i = 0; i < embed; ++i) {
+            ws.x[r * embed + i] = embedding[id * embed + i] + position[t * embed + i];
+        }
+    }
+
+    const float scale = 1.0f / std::sqrt(static_cast<float>(head_dim));
+    for (int layer = 0; layer < config.num_layers; ++layer) {
+        const std::string prefix = "transformer.layers." + std::to_string(layer) + ".";
+
+        ws.qkv.resize(rows * 3 * embed);
+        linear(ws.x.data(), rows, embed, param(model, prefix + "self_attn.in_proj_weight"),
+               param(model, prefix + "self_attn.in_proj_bias"), 3 * embed, ws.qkv.data());
+
+        ws.attn.assign(rows * embed, 0.0f);
+        for (std::size_t r = 0; r < rows; ++r) {
+            KvCache& cache = *caches[r];
+            std::size_t t = cache.length();
+            const float* qkv = ws.qkv.data() + r * 3 * embed;
+            std::copy_n(qkv + embed, embed, cache.key(layer, t));
+            std::copy_n(qkv + 2 * embed, embed, cache.value(layer, t));
+
+            std::size_t keys = t + 1;
+            ws.scores.resize(keys);
+            for (std::size_t h = 0; h < heads; ++h) {
+                const float* qv = qkv + h * head_dim;
+                float max_score = -INFINITY;
+                for (std::size_t j = 0; j < keys; ++j) {
+                    ws.scores[j] = detail::dot(qv, cache.key(layer, j) + h * head_dim, head_dim) * scale;
+                    max_score = std::max(max_score, ws.scores[j]);
+                }
+                float total = 0.0f;
+                for (std::size_t j = 0; j < keys; ++j) {
+                    ws.scores[j] = std::exp(ws.scores[j] - max_score);
+                    total += ws.scores[j];
+                }
+                float* out = ws.attn.data() + r * embed + h * head_dim;
+                for (std::size_t j = 0; j < keys; ++j) {
+                    const float* vv = cache.value(layer, j) + h * head_dim;
+                    float p = ws.scores[j] / total;
+                    for (std::size_t i = 0; i < head_dim; ++i) {
+                        out[i] += p * vv[i];
+                    }
+                }
+            }
+        }
+
+        ws.residual.resize(rows * embed);
+        linear(ws.attn.data(), rows, embed, param(model, prefix + "self_attn.out_proj.weight"),
+               param(model, prefix + "self_attn.out_proj.bias"), embed, ws.residual.data());
+        for (std::size_t i = 0; i < rows * embed; ++i) {
+            ws.residual[i] += ws.x[i];
+        }
+        layer_norm(ws.residual.data(), rows, embed,
+                   param(model, prefix + "norm1.weight"), param(model, prefix + "norm1.bias"));
+
+        ws.hidden.resize(rows * ff);
+        linear(ws.residual.data(), rows, embed, param(model, prefix + "linear1.weight"),
+               param(model, prefix + "linear1.bias"), ff, ws.hidden.data());
+        for (float& v : ws.hidden) {
+            v = std::max(v, 0.0f);
+        }
+        linear(ws.hidden.data(), rows, ff, param(model, prefix + "linear2.weight"),
+               param(model, prefix + "linear2.bias"), embed, ws.x.data());
+        for (std::size_t i = 0; i < rows * embed; ++i) {
+            ws.x[i] += ws.residual[i];
+        }
+        layer_norm(ws.x.data(), rows, embed,
+                   param(model, prefix + "norm2.weight"), param(model, prefix + "norm2.bias"));
+    }
+
+    for (KvCache* cache : caches) {
+        cache->set_length(cache->length() + 1);
+    }
+
+    logits.resize(rows * vocab);
+    linear(ws.x.data(), rows, embed, param(model, "output_layer.weight"),
+           param(model, "output_layer.bias"), vocab, logits.data());
+}
+
+} // namespace hydra
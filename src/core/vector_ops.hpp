@@ -0,0 +1,34 @@
+/**
+ * @file vector_ops.hpp
+ * @brief Small vector loops shared by the gemm, attention and transformer
+ *        translation units
+ *
+ * Private to src/core. Not for the units built with -mavx2 or -mavx512f:
+ * the linker keeps one copy of an inline function, and it could be the
+ * one compiled for an instruction set the CPU lacks.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace hydra::detail {
+
+// Eight independent accumulators so the loop pipelines (and vectorizes)
+// without reassociation flags
+inline float dot(const float* a, const float* b, std::size_t n) {
+    float acc[8] = {};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (std::size_t k = 0; k < 8; ++k) {
+            acc[k] += a[i + k] * b[i + k];
+        }
+    }
+    float sum = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+} // namespace hydra::detail
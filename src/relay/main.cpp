@@ -0,0 +1,119 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of hydra_relay
+ */
+
+#include "hydra/admission.hpp"
+#include "hydra/relay.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+hydra::RelayServer* g_relay = nullptr;
+
+void handle_signal(int) {
+    if (g_relay) {
+        g_relay->stop();
+    }
+}
+
+void print_usage() {
+    std::cout << "Usage: hydra_relay [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --upstream URL         Coordinator URL (default: http://localhost:5000)\n"
+              << "  --upstream-rpc ENDPOINT  Forward batches over the coordinator's binary RPC\n"
+              << "                         (host:port or unix:/path) instead of HTTP\n"
+              << "  --upstream-encoding E  identity, lz or deflate for RPC batch payloads (default: identity)\n"
+              << "  --port PORT            Relay port (default: 5100)\n"
+              << "  --host HOST            Relay host (default: 0.0.0.0)\n"
+              << "  --relay-id NAME        Name reported to the coordinator (default: host:port)\n"
+              << "  --relay-secret-file FILE  The coordinator's relay secret (required)\n"
+              << "  --batch-size N         Submissions combined per upstream update (default: 8)\n"
+              << "  --max-delay SECS       Longest a submission waits for its batch (default: 2)\n"
+              << "  --max-queued N         Buffered submissions before answering 429 (default: 32)\n"
+              << "  --aggregation RULE     mean, trimmed_mean or median (default: trimmed_mean)\n"
+              << "  --trim FRACTION        Fraction trimmed from each end (default: 0.1)\n"
+              << "  --help                 Show this help message\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    hydra::RelayOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--help") {
+                print_usage();
+                return 0;
+            } else if (arg == "--upstream") {
+                options.upstream = next();
+            } else if (arg == "--upstream-rpc") {
+                options.upstream_rpc = next();
+            } else if (arg == "--upstream-encoding") {
+                auto encoding = hydra::parse_content_encoding(next());
+                if (!encoding || !hydra::rpc_payload_encoding(*encoding)) {
+                    throw std::invalid_argument("expected identity, lz or deflate");
+                }
+                options.upstream_encoding = *encoding;
+            } else if (arg == "--port") {
+                options.port = std::stoi(next());
+            } else if (arg == "--host") {
+                options.host = next();
+            } else if (arg == "--relay-id") {
+                options.relay_id = next();
+            } else if (arg == "--relay-secret-file") {
+                options.secret = hydra::read_secret_file(next());
+            } else if (arg == "--batch-size") {
+                options.batch_size = std::stoul(next());
+            } else if (arg == "--max-delay") {
+                options.max_delay = std::chrono::milliseconds(
+                    static_cast<long long>(std::stod(next()) * 1000));
+            } else if (arg == "--max-queued") {
+                options.max_queued = std::stoul(next());
+            } else if (arg == "--aggregation") {
+                options.aggregation.rule = hydra::parse_aggregation_rule(next());
+            } else if (arg == "--trim") {
+                options.aggregation.trim_fraction = std::stod(next());
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n\n";
+                print_usage();
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        hydra::RelayServer relay(options);
+        g_relay = &relay;
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+
+        if (!relay.run()) {
+            std::cerr << "Relay failed to start on " << options.host << ":" << options.port << std::endl;
+            return 1;
+        }
+        g_relay = nullptr;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
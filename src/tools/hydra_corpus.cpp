@@ -0,0 +1,176 @@
+/**
+ * @file hydra_corpus.cpp
+ * @brief Command line tool to build and inspect corpus shard directories
+ */
+
+#include "hydra/corpus.hpp"
+#include "hydra/token_dataset.hpp"
+#include "hydra/tokenizer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+    std::cout << "Usage:\n"
+              << "  hydra_corpus build OUT_DIR [--shard-mb MB] FILE...\n"
+              << "      One record per non-empty line of each input file\n"
+              << "  hydra_corpus info DIR\n"
+              << "      Show the shards of a corpus\n"
+              << "  hydra_corpus tokenize DIR OUT_PREFIX [--vocab-size N] [--vocab FILE]\n"
+              << "      Tokenize every record once into OUT_PREFIX.htk (+ OUT_PREFIX.vocab);\n"
+              << "      without --vocab the N-4 most frequent words form the vocabulary\n";
+}
+
+int build(int argc, char** argv) {
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+
+    std::string out_dir = argv[2];
+    std::uint64_t shard_mb = 64;
+    std::vector<std::string> inputs;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--shard-mb" && i + 1 < argc) {
+            shard_mb = std::stoull(argv[++i]);
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    hydra::CorpusWriter writer(out_dir, shard_mb << 20);
+    std::uint64_t records = 0;
+    for (const auto& input : inputs) {
+        std::ifstream in(input);
+        if (!in) {
+            std::cerr << "Cannot read " << input << std::endl;
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                writer.add(line);
+                ++records;
+            }
+        }
+    }
+
+    std::size_t shards = writer.finish();
+    std::cout << "✓ Wrote " << records << " records in " << shards << " shards to " << out_dir << std::endl;
+    return 0;
+}
+
+int info(int argc, char** argv) {
+    if (argc < 3) {
+        print_usage();
+        return 1;
+    }
+
+    hydra::CorpusStore store(argv[2]);
+    std::cout << "Corpus: " << argv[2] << "\n"
+              << "Records: " << store.total_records() << "\n"
+              << "Shards: " << store.shards().size() << "\n";
+    for (const auto& shard : store.shards()) {
+        std::cout << "  #" << shard.id() << "  " << shard.num_records() << " records, "
+                  << shard.file_bytes().size() << " bytes  (" << shard.path() << ")\n";
+    }
+    return 0;
+}
+
+int tokenize(int argc, char** argv) {
+    if (argc < 4) {
+        print_usage();
+        return 1;
+    }
+
+    std::string prefix = argv[3];
+    std::size_t vocab_size = 10000;
+    std::string vocab_path;
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--vocab-size" && i + 1 < argc) {
+            vocab_size = std::stoul(argv[++i]);
+        } else if (arg == "--vocab" && i + 1 < argc) {
+            vocab_path = argv[++i];
+        }
+    }
+
+    hydra::CorpusStore store(argv[2]);
+
+    hydra::Tokenizer tokenizer(vocab_size);
+    if (!vocab_path.empty()) {
+        tokenizer = hydra::Tokenizer::load(vocab_path, vocab_size);
+    } else {
+        // First pass: keep the most frequent words
+        std::unordered_map<std::string, std::uint64_t> counts;
+        std::vector<std::string> words;
+        for (const auto& shard : store.shards()) {
+            for (std::uint64_t i = 0; i < shard.num_records(); ++i) {
+                words.clear();
+                hydra::Tokenizer::split_words(shard.record(i), words);
+                for (auto& word : words) {
+                    ++counts[std::move(word)];
+                }
+            }
+        }
+
+        std::vector<std::pair<std::string, std::uint64_t>> ranked(counts.begin(), counts.end());
+        std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        for (auto& [word, count] : ranked) {
+            if (tokenizer.size() >= vocab_size) {
+                break;
+            }
+            tokenizer.add_token(word);
+        }
+    }
+    tokenizer.save(prefix + ".vocab");
+
+    // Second pass: encode every record as one document
+    hydra::TokenDatasetWriter writer(prefix + ".htk", vocab_size);
+    std::vector<std::uint32_t> tokens;
+    for (const auto& shard : store.shards()) {
+        for (std::uint64_t i = 0; i < shard.num_records(); ++i) {
+            tokens.clear();
+            tokenizer.encode(shard.record(i), tokens);
+            writer.add_document(tokens);
+        }
+    }
+    std::uint64_t total = writer.finish();
+
+    std::cout << "✓ Wrote " << total << " tokens from " << store.total_records() << " records to "
+              << prefix << ".htk (vocabulary: " << tokenizer.size() << " tokens)" << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    try {
+        std::string command = argv[1];
+        if (command == "build") return build(argc, argv);
+        if (command == "info") return info(argc, argv);
+        if (command == "tokenize") return tokenize(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    print_usage();
+    return 1;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file hydra_gemm_bench.cpp
+ * @brief Measures sgemm throughput on the transformer's Linear shapes
+ *
+ * For the feed-forward layers (embed to 4*embed and back), the output
+ * layer (embed to vocab) and the output layer's two backward products,
+ * reports GFLOPS of a naive triple loop and of sgemm with every kernel
+ * this CPU supports, and checks each kernel against the naive result.
+ */
+
+#include "hydra/gemm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using hydra::Transpose;
+
+void print_usage() {
+    std::cout << "Usage: hydra_gemm_bench [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --rows N               Rows per batch, i.e. tokens (default: 512)\n"
+              << "  --embed-dim N          Model embedding size (default: 256)\n"
+              << "  --vocab-size N         Model vocabulary (default: 10000)\n"
+              << "  --seconds S            Minimum time per measurement (default: 0.5)\n"
+              << "  --no-naive             Skip the naive loop\n"
+              << "  --help                 Show this help message\n";
+}
+
+struct Case {
+    std::string name;
+    Transpose trans_a;
+    Transpose trans_b;
+    std::size_t m, n, k;
+};
+
+struct Operands {
+    std::vector<float> a, b, c;
+    std::size_t lda, ldb;
+};
+
+Operands make_operands(const Case& shape, std::mt19937& rng) {
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    Operands ops;
+    ops.a.resize(shape.m * shape.k);
+    ops.b.resize(shape.k * shape.n);
+    ops.c.resize(shape.m * shape.n);
+    std::generate(ops.a.begin(), ops.a.end(), [&] { return value(rng); });
+    std::generate(ops.b.begin(), ops.b.end(), [&] { return value(rng); });
+    ops.lda = shape.trans_a == Transpose::Yes ? shape.m : shape.k;
+    ops.ldb = shape.trans_b == Transpose::Yes ? shape.k : shape.n;
+    return ops;
+}
+
+// The textbook loop, one dot product per element of C
+void naive(const Case& shape, const Operands& ops, float* c) {
+    bool ta = shape.trans_a == Transpose::Yes;
+    bool tb = shape.trans_b == Transpose::Yes;
+    for (std::size_t i = 0; i < shape.m; ++i) {
+        for (std::size_t j = 0; j < shape.n; ++j) {
+            float sum = 0.0f;
+            for (std::size_t p = 0; p < shape.k; ++p) {
+                float a = ta ? ops.a[p * ops.lda + i] : ops.a[i * ops.lda + p];
+                float b = tb ? ops.b[j * ops.ldb + p] : ops.b[p * ops.ldb + j];
+                sum += a * b;
+            }
+            c[i * shape.n + j] = sum;
+        }
+    }
+}
+
+// Runs fn until at least min_seconds have passed; returns GFLOPS
+template <typename Fn>
+double measure(const Case& shape, double min_seconds, Fn fn) {
+    fn();   // Warm caches and the packing buffers
+    std::size_t runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        fn();
+        ++runs;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_seconds);
+    return 2.0 * shape.m * shape.n * shape.k * runs / elapsed / 1e9;
+}
+
+float max_error(const std::vector<float>& got, const std::vector<float>& want) {
+    float worst = 0.0f;
+    for (std::size_t i = 0; i < got.size(); ++i) {
+        worst = std::max(worst, std::fabs(got[i] - want[i]) / std::max(1.0f, std::fabs(want[i])));
+    }
+    return worst;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t rows = 512;
+    std::size_t embed = 256;
+    std::size_t vocab = 10000;
+    double min_seconds = 0.5;
+    bool with_naive = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--help") {
+                print_usage();
+                return 0;
+            } else if (arg == "--rows") {
+                rows = std::stoul(next());
+            } else if (arg == "--embed-dim") {
+                embed = std::stoul(next());
+            } else if (arg == "--vocab-size") {
+                vocab = std::stoul(next());
+            } else if (arg == "--seconds") {
+                min_seconds = std::stod(next());
+            } else if (arg == "--no-naive") {
+                with_naive = false;
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n\n";
+                print_usage();
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (rows == 0 || embed == 0 || vocab == 0) {
+        std::cerr << "Sizes must be positive" << std::endl;
+        return 1;
+    }
+
+    // y = x W^T forward; dx = dy W and dW = dy^T x backward
+    const std::vector<Case> cases = {
+        {"ff up      x W1^T", Transpose::No, Transpose::Yes, rows, 4 * embed, embed},
+        {"ff down    h W2^T", Transpose::No, Transpose::Yes, rows, embed, 4 * embed},
+        {"output     x Wo^T", Transpose::No, Transpose::Yes, rows, vocab, embed},
+        {"output dx  dy Wo ", Transpose::No, Transpose::No, rows, embed, vocab},
+        {"output dW  dy^T x", Transpose::Yes, Transpose::No, vocab, embed, rows},
+    };
+
+    std::vector<hydra::GemmIsa> kernels;
+    for (auto isa : {hydra::GemmIsa::Portable, hydra::GemmIsa::Avx2, hydra::GemmIsa::Avx512}) {
+        if (hydra::gemm_isa_supported(isa)) {
+            kernels.push_back(isa);
+        }
+    }
+    const hydra::GemmIsa best = hydra::gemm_isa();
+
+    std::cout << "Rows " << rows << ", embed " << embed << ", vocab " << vocab
+              << "; default kernel: " << hydra::to_string(best) << "\n\n"
+              << std::left << std::setw(20) << "GFLOPS";
+    if (with_naive) {
+        std::cout << std::right << std::setw(10) << "naive";
+    }
+    for (auto isa : kernels) {
+        std::cout << std::right << std::setw(10) << hydra::to_string(isa);
+    }
+    std::cout << std::setw(12) << "max error" << std::endl;
+
+    std::mt19937 rng(42);
+    std::cout << std::fixed;
+    try {
+        for (const auto& shape : cases) {
+            Operands ops = make_operands(shape, rng);
+            std::vector<float> reference(shape.m * shape.n);
+            naive(shape, ops, reference.data());
+
+            std::cout << std::left << std::setw(20) << shape.name << std::right << std::setprecision(1);
+            if (with_naive) {
+                double gflops = measure(shape, min_seconds, [&] { naive(shape, ops, ops.c.data()); });
+                std::cout << std::setw(10) << gflops << std::flush;
+            }
+            float worst = 0.0f;
+            for (auto isa : kernels) {
+                hydra::set_gemm_isa(isa);
+                auto run = [&] {
+                    hydra::sgemm(shape.trans_a, shape.trans_b, shape.m, shape.n, shape.k, 1.0f,
+                                 ops.a.data(), ops.lda, ops.b.data(), ops.ldb, 0.0f, ops.c.data(), shape.n);
+                };
+                run();
+                worst = std::max(worst, max_error(ops.c, reference));
+                std::cout << std::setw(10) << measure(shape, min_seconds, run) << std::flush;
+            }
+            std::cout << std::setw(12) << std::scientific << std::setprecision(1) << worst
+                      << std::fixed << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    hydra::set_gemm_isa(best);
+    return 0;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file hydra_generate.cpp
+ * @brief Measures native generation speed, with and without the KV cache
+ *
+ * Builds a freshly initialized SimpleTransformer (the weights' values don't
+ * affect speed), generates from random prompts and reports tokens/s for
+ * cached decoding and for the naive loop that reruns the whole prefix for
+ * every token.
+ */
+
+#include "hydra/generation.hpp"
+#include "hydra/tokenizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+    std::cout << "Usage: hydra_generate [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --prompt-len N         Prompt tokens (default: 32)\n"
+              << "  --new-tokens N         Tokens generated per prompt (default: 64)\n"
+              << "  --batch N              Prompts decoded together (default: 1)\n"
+              << "  --vocab-size N         Model vocabulary (default: 10000)\n"
+              << "  --embed-dim N          Model embedding size (default: 256)\n"
+              << "  --num-heads N          Attention heads (default: 4)\n"
+              << "  --num-layers N         Transformer layers (default: 2)\n"
+              << "  --no-naive             Skip the uncached baseline\n"
+              << "  --help                 Show this help message\n";
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    hydra::ModelConfig config;
+    std::size_t prompt_len = 32;
+    std::size_t new_tokens = 64;
+    std::size_t batch = 1;
+    bool naive = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--help") {
+                print_usage();
+                return 0;
+            } else if (arg == "--prompt-len") {
+                prompt_len = std::stoul(next());
+            } else if (arg == "--new-tokens") {
+                new_tokens = std::stoul(next());
+            } else if (arg == "--batch") {
+                batch = std::stoul(next());
+            } else if (arg == "--vocab-size") {
+                config.vocab_size = std::stoi(next());
+            } else if (arg == "--embed-dim") {
+                config.embed_dim = std::stoi(next());
+            } else if (arg == "--num-heads") {
+                config.num_heads = std::stoi(next());
+            } else if (arg == "--num-layers") {
+                config.num_layers = std::stoi(next());
+            } else if (arg == "--no-naive") {
+                naive = false;
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n\n";
+                print_usage();
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (prompt_len == 0 || batch == 0 || prompt_len + new_tokens > static_cast<std::size_t>(config.max_seq_length)) {
+        std::cerr << "Need 1 <= prompt-len and prompt-len + new-tokens <= " << config.max_seq_length << std::endl;
+        return 1;
+    }
+
+    try {
+        auto model = hydra::ModelState::create(config);
+        std::cout << "Model: " << model.values().size() << " parameters, "
+                  << config.num_layers << " layers, embed " << config.embed_dim << "\n"
+                  << "Prompts: " << batch << " x " << prompt_len << " tokens, generating "
+                  << new_tokens << " each\n" << std::endl;
+
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<std::uint32_t> pick(hydra::Tokenizer::kEnd + 1,
+                                                          static_cast<std::uint32_t>(config.vocab_size - 1));
+        std::vector<std::vector<std::uint32_t>> prompts(batch);
+        for (auto& prompt : prompts) {
+            prompt.push_back(hydra::Tokenizer::kStart);
+            while (prompt.size() < prompt_len) {
+                prompt.push_back(pick(rng));
+            }
+        }
+
+        // Greedy; a sequence that picks <END> stops early and counts less
+        std::vector<hydra::GenerationOptions> options(batch);
+        for (auto& option : options) {
+            option.max_new_tokens = new_tokens;
+        }
+
+        hydra::ForwardWorkspace workspace;
+        std::size_t kv_bytes = batch * (prompt_len + new_tokens + 16) * config.num_layers * 2 *
+                               config.embed_dim * sizeof(float);
+        hydra::KvPagePool pool(config, kv_bytes);
+
+        auto start = std::chrono::steady_clock::now();
+        auto generations = hydra::generate(model, pool, prompts, options, workspace);
+        double cached = seconds_since(start);
+
+        std::size_t produced = 0;
+        for (const auto& generation : generations) {
+            produced += generation.tokens.size();
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << "KV cache: " << produced << " tokens in " << cached << " s = "
+                  << produced / cached << " tokens/s" << std::endl;
+
+        if (naive) {
+            // Rerun the whole prefix for every token
+            std::vector<float> logits;
+            start = std::chrono::steady_clock::now();
+            for (std::size_t step = 0; step < new_tokens; ++step) {
+                hydra::forward_last_logits(model, prompts, logits, workspace);
+                for (std::size_t s = 0; s < batch; ++s) {
+                    const float* row = logits.data() + s * config.vocab_size;
+                    prompts[s].push_back(static_cast<std::uint32_t>(
+                        std::max_element(row + hydra::Tokenizer::kEnd + 1, row + config.vocab_size) - row));
+                }
+            }
+            double full = seconds_since(start);
+            std::cout << "No cache: " << batch * new_tokens << " tokens in " << full << " s = "
+                      << batch * new_tokens / full << " tokens/s (" << full / cached << "x slower)" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,574 @@
+/**
+ * @file hydra_loadgen.cpp
+ * @brief Simulated worker fleet for measuring coordinator capacity
+ *
+ * Runs thousands of simulated workers against a coordinator, each going
+ * through register -> get_task -> fake training -> submit_result, and
+ * reports throughput, per-route latency percentiles and (with --pid, on
+ * the same host) the coordinator's CPU and memory use.
+ *
+ * Workers are state machines, not threads: each client thread owns a
+ * slice of them and one keep-alive connection, and always serves the
+ * worker whose next step is due first. Thinking workers cost nothing, so
+ * a few dozen connections drive many thousands of workers.
+ *
+ * With --rpc the same cycle runs over the binary RPC transport (see
+ * rpc.hpp): tasks arrive with raw float parameters, and each submission
+ * sends the last parameters received back, as a real worker would.
+ * --encoding compresses both directions (see compression.hpp); the byte
+ * columns then count what crossed the socket.
+ */
+
+#include "hydra/rpc.hpp"
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+void print_usage() {
+    std::cout << "Usage: hydra_loadgen [options]\n\n"
+              << "Options:\n"
+              << "  --url URL              Coordinator (default: http://127.0.0.1:5000)\n"
+              << "  --rpc ENDPOINT         Use the binary RPC transport at host:port or unix:/path\n"
+              << "  --encoding E           identity, lz or deflate for RPC payloads (default: identity)\n"
+              << "  --workers N            Simulated workers (default: 1000)\n"
+              << "  --connections N        Client threads, one connection each (default: 64)\n"
+              << "  --duration SECS        Measured run time (default: 30)\n"
+              << "  --ramp SECS            Spread worker start-up over this time (default: 5)\n"
+              << "  --train-ms MS          Mean fake training time per task (default: 2000)\n"
+              << "  --backoff-ms MS        Pause after \"no tasks available\" (default: 1000)\n"
+              << "  --payload-kb KB        Size of each submitted update over HTTP (default: 64)\n"
+              << "  --abandon P            Probability a task is never submitted (default: 0)\n"
+              << "  --corrupt P            Probability a submission is malformed (default: 0)\n"
+              << "  --pid PID              Coordinator process to sample CPU and memory of\n"
+              << "  --prefix NAME          Worker id prefix (default: loadgen)\n"
+              << "  --help                 Show this message\n";
+}
+
+struct Options {
+    std::string url = "http://127.0.0.1:5000";
+    std::string rpc;                   // Empty = HTTP
+    hydra::ContentEncoding encoding = hydra::ContentEncoding::Identity;   // Of RPC payloads
+    std::size_t workers = 1000;
+    std::size_t connections = 64;
+    std::chrono::milliseconds duration{30000};
+    std::chrono::milliseconds ramp{5000};
+    double train_ms = 2000.0;
+    double backoff_ms = 1000.0;
+    std::size_t payload_kb = 64;
+    double abandon = 0.0;
+    double corrupt = 0.0;
+    int pid = 0;
+    std::string prefix = "loadgen";
+};
+
+// =============================================================================
+// Statistics
+// =============================================================================
+
+enum Route { kRegister, kGetTask, kSubmit, kRoutes };
+constexpr const char* kRouteNames[kRoutes] = {"register", "get_task", "submit_result"};
+
+/**
+ * @struct RouteStats
+ * @brief What one client thread saw on one route (merged at the end)
+ */
+struct RouteStats {
+    std::vector<double> latency_ms;
+    std::uint64_t ok{0};
+    std::uint64_t no_task{0};          // get_task 404: the queue was empty
+    std::uint64_t rejected{0};         // 4xx other than the above (expected for --corrupt)
+    std::uint64_t overloaded{0};       // 429 / 503
+    std::uint64_t failed{0};           // 5xx or no response
+    std::uint64_t bytes_sent{0};
+    std::uint64_t bytes_received{0};
+
+    void merge(const RouteStats& other) {
+        latency_ms.insert(latency_ms.end(), other.latency_ms.begin(), other.latency_ms.end());
+        ok += other.ok;
+        no_task += other.no_task;
+        rejected += other.rejected;
+        overloaded += other.overloaded;
+        failed += other.failed;
+        bytes_sent += other.bytes_sent;
+        bytes_received += other.bytes_received;
+    }
+};
+
+struct ThreadStats {
+    RouteStats routes[kRoutes];
+    std::uint64_t cycles{0};           // Tasks submitted successfully
+    std::uint64_t abandoned{0};
+};
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    auto rank = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+/**
+ * @struct ProcessSample
+ * @brief CPU time and memory of a process, from /proc
+ */
+struct ProcessSample {
+    bool valid{false};
+    double cpu_seconds{0.0};           // User + system
+    std::uint64_t rss_kb{0};
+    std::uint64_t peak_rss_kb{0};
+    int threads{0};
+};
+
+ProcessSample sample_process(int pid) {
+    ProcessSample sample;
+    if (pid <= 0) {
+        return sample;
+    }
+
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line)) {
+        return sample;
+    }
+    // Fields after the parenthesized command name; utime and stime are
+    // the 14th and 15th fields of the line
+    std::istringstream fields(line.substr(line.rfind(')') + 2));
+    std::string field;
+    double ticks = 0.0;
+    for (int i = 3; i <= 15 && fields >> field; ++i) {
+        if (i >= 14) {
+            ticks += std::stod(field);
+        }
+    }
+    sample.cpu_seconds = ticks / static_cast<double>(sysconf(_SC_CLK_TCK));
+
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    while (std::getline(status, line)) {
+        std::istringstream in(line);
+        std::string key;
+        in >> key;
+        if (key == "VmRSS:") {
+            in >> sample.rss_kb;
+        } else if (key == "VmHWM:") {
+            in >> sample.peak_rss_kb;
+        } else if (key == "Threads:") {
+            in >> sample.threads;
+        }
+    }
+    sample.valid = true;
+    return sample;
+}
+
+// =============================================================================
+// Simulated Workers
+// =============================================================================
+
+enum class Step { Register, GetTask, Submit };
+
+struct Worker {
+    std::string user_id;
+    Step step{Step::Register};
+    std::string task_id;
+};
+
+// Next worker due: (due time, index into the thread's workers)
+using Due = std::pair<Clock::time_point, std::size_t>;
+
+class ClientThread {
+public:
+    ClientThread(const Options& options, std::size_t first, std::size_t count, std::uint64_t seed)
+        : options_(options), client_(options.url), rng_(seed) {
+        client_.set_keep_alive(true);
+        client_.set_follow_location(true);   // Clustered coordinators redirect to the owner
+        client_.set_connection_timeout(5);
+        client_.set_read_timeout(60);
+        client_.set_write_timeout(60);
+        for (std::size_t i = 0; i < count; ++i) {
+            workers_.push_back(Worker{options.prefix + "-" + std::to_string(first + i), Step::Register, {}});
+        }
+    }
+
+    /**
+     * @brief Drive the workers until stop; only requests started in
+     *        [measure_from, measure_until) are counted
+     */
+    void run(Clock::time_point start, Clock::time_point measure_from, Clock::time_point measure_until,
+             const std::atomic<bool>& stop) {
+        measure_from_ = measure_from;
+        measure_until_ = measure_until;
+        std::uniform_real_distribution<double> ramp(0.0, static_cast<double>(options_.ramp.count()));
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            due_.push({start + std::chrono::milliseconds(static_cast<long long>(ramp(rng_))), i});
+        }
+
+        while (!stop.load(std::memory_order_relaxed) && !due_.empty()) {
+            auto [when, index] = due_.top();
+            if (when > Clock::now()) {
+                std::this_thread::sleep_until(std::min(when, Clock::now() + std::chrono::milliseconds(50)));
+                continue;
+            }
+            due_.pop();
+            due_.push({advance(workers_[index]), index});
+        }
+    }
+
+    const ThreadStats& stats() const { return stats_; }
+
+private:
+    const Options& options_;
+    httplib::Client client_;
+    std::unique_ptr<hydra::RpcClient> rpc_;   // Connected on first use with --rpc
+    std::vector<float> parameters_;            // Last parameters received over RPC
+    std::mt19937_64 rng_;
+    std::vector<Worker> workers_;
+    std::priority_queue<Due, std::vector<Due>, std::greater<>> due_;
+    Clock::time_point measure_from_;
+    Clock::time_point measure_until_;
+    ThreadStats stats_;
+
+    // One step of a worker's cycle; returns when it is due again
+    Clock::time_point advance(Worker& worker) {
+        auto now = Clock::now();
+        switch (worker.step) {
+            case Step::Register: {
+                json body = {{"user_id", worker.user_id}};
+                int status = options_.rpc.empty() ? post(kRegister, "/register", body.dump())
+                                                  : call(kRegister, hydra::RpcMethod::Register, body.dump());
+                if (status == 200) {
+                    worker.step = Step::GetTask;
+                    return Clock::now();
+                }
+                return now + backoff();
+            }
+
+            case Step::GetTask: {
+                json body = {{"user_id", worker.user_id}};
+                std::string response;
+                int status = options_.rpc.empty() ? post(kGetTask, "/get_task", body.dump(), &response)
+                                                  : call(kGetTask, hydra::RpcMethod::GetTask, body.dump(), {}, &response);
+                if (status != 200) {
+                    return now + backoff();
+                }
+                // task_id comes first; the model parameters after it are not
+                // parsed (over RPC they are not in the meta at all)
+                auto head = json::parse(response.substr(0, response.find(",\"model_parameters\"")) +
+                                        (options_.rpc.empty() ? "}" : ""),
+                                        nullptr, false);
+                worker.task_id = head.is_object() ? head.value("task_id", "") : "";
+                if (worker.task_id.empty()) {
+                    return now + backoff();
+                }
+                if (chance(options_.abandon)) {
+                    // Simulates a worker that crashes mid-task: the lease is
+                    // left for the coordinator's timeout to reclaim
+                    stats_.abandoned += counting(now) ? 1 : 0;
+                    worker.step = Step::GetTask;
+                    return now + train_time() + backoff();
+                }
+                worker.step = Step::Submit;
+                return Clock::now() + train_time();
+            }
+
+            case Step::Submit: {
+                int status = options_.rpc.empty() ? post(kSubmit, "/submit_result", submission(worker))
+                                                  : submit_rpc(worker);
+                if (status == 200 && counting(now)) {
+                    ++stats_.cycles;
+                }
+                worker.step = Step::GetTask;
+                return Clock::now();
+            }
+        }
+        return now;
+    }
+
+    int post(Route route, const std::string& path, const std::string& body, std::string* response_body = nullptr) {
+        auto start = Clock::now();
+        auto response = client_.Post(path, body, "application/json");
+        int status = response ? response->status : 0;
+        record(route, start, status, body.size(), response ? response->body.size() : 0);
+        if (response && response_body) {
+            *response_body = std::move(response->body);
+        }
+        return status;
+    }
+
+    int call(Route route, hydra::RpcMethod method, const std::string& meta, std::span<const float> payload = {},
+             std::string* reply_meta = nullptr) {
+        auto start = Clock::now();
+        hydra::RpcMessage reply;
+        std::uint64_t sent = 0;
+        std::uint64_t received = 0;
+        try {
+            if (!rpc_) {
+                rpc_ = std::make_unique<hydra::RpcClient>(options_.rpc, options_.encoding);
+            }
+            sent = rpc_->connection().bytes_sent();
+            received = rpc_->connection().bytes_received();
+            reply = rpc_->call(method, meta, payload);
+        } catch (const std::exception&) {
+            rpc_.reset();   // Reconnect on the next request
+            record(route, start, 0, meta.size() + payload.size_bytes(), 0);
+            return 0;
+        }
+        record(route, start, reply.status, rpc_->connection().bytes_sent() - sent,
+               rpc_->connection().bytes_received() - received);
+        if (!reply.payload.empty()) {
+            parameters_ = std::move(reply.payload);
+        }
+        if (reply_meta) {
+            *reply_meta = std::move(reply.meta);
+        }
+        return reply.status;
+    }
+
+    int submit_rpc(const Worker& worker) {
+        json meta = {{"user_id", worker.user_id}, {"task_id", worker.task_id}};
+        std::span<const float> update = parameters_;
+        if (chance(options_.corrupt) && !update.empty()) {
+            update = update.first(update.size() - 1);   // Wrong parameter count
+        }
+        return call(kSubmit, hydra::RpcMethod::SubmitResult, meta.dump(), update);
+    }
+
+    void record(Route route, Clock::time_point start, int status, std::size_t sent, std::size_t received) {
+        if (counting(start)) {
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            RouteStats& stats = stats_.routes[route];
+            stats.latency_ms.push_back(ms);
+            stats.bytes_sent += sent;
+            stats.bytes_received += received;
+            if (status == 200) {
+                ++stats.ok;
+            } else if (status == 404 && route == kGetTask) {
+                ++stats.no_task;
+            } else if (status == 429 || status == 503) {
+                ++stats.overloaded;
+            } else if (status >= 400 && status < 500) {
+                ++stats.rejected;
+            } else {
+                ++stats.failed;
+            }
+        }
+    }
+
+    // An update of about payload_kb: parameters the model does not have
+    // are ignored by the coordinator, so the payload costs transfer and
+    // parsing without disturbing the model
+    std::string submission(const Worker& worker) {
+        std::string out = "{\"user_id\":\"" + worker.user_id + "\",\"task_id\":\"" + worker.task_id +
+                          "\",\"updated_parameters\":{\"loadgen.padding\":[";
+        std::size_t target = options_.payload_kb << 10;
+        out.reserve(target + 64);
+        while (out.size() < target) {
+            out += "0.0,";
+        }
+        out += "0.0]}}";
+        if (chance(options_.corrupt)) {
+            out.resize(out.size() / 2);   // Truncated upload
+        }
+        return out;
+    }
+
+    bool counting(Clock::time_point when) const { return when >= measure_from_ && when < measure_until_; }
+
+    bool chance(double p) {
+        return p > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < p;
+    }
+
+    std::chrono::milliseconds train_time() {
+        std::exponential_distribution<double> train(1.0 / std::max(options_.train_ms, 1.0));
+        return std::chrono::milliseconds(static_cast<long long>(train(rng_)));
+    }
+
+    std::chrono::milliseconds backoff() {
+        // Jittered so workers that were turned away together do not return together
+        std::uniform_real_distribution<double> jitter(0.5, 1.5);
+        return std::chrono::milliseconds(static_cast<long long>(options_.backoff_ms * jitter(rng_)));
+    }
+};
+
+// =============================================================================
+// Report
+// =============================================================================
+
+void report(const Options& options, const ThreadStats& total, double seconds,
+            const ProcessSample& before, const ProcessSample& after) {
+    std::cout << "\n==================================================\n"
+              << "HydraAI Load Test: " << options.workers << " workers, " << options.connections
+              << " connections, " << std::fixed << std::setprecision(1) << seconds << " s measured\n"
+              << "==================================================\n";
+
+    std::cout << "Completed tasks: " << total.cycles << " (" << std::setprecision(1)
+              << static_cast<double>(total.cycles) / seconds << " /s)";
+    if (total.abandoned > 0) {
+        std::cout << ", abandoned: " << total.abandoned;
+    }
+    std::cout << "\n\n";
+
+    std::cout << std::left << std::setw(15) << "route" << std::right << std::setw(9) << "req/s"
+              << std::setw(9) << "p50 ms" << std::setw(9) << "p90 ms" << std::setw(9) << "p99 ms"
+              << std::setw(10) << "max ms" << std::setw(9) << "ok" << std::setw(9) << "empty"
+              << std::setw(9) << "4xx" << std::setw(9) << "busy" << std::setw(9) << "failed"
+              << std::setw(10) << "MB in" << std::setw(10) << "MB out" << "\n";
+
+    for (int r = 0; r < kRoutes; ++r) {
+        RouteStats stats = total.routes[r];
+        std::sort(stats.latency_ms.begin(), stats.latency_ms.end());
+        std::cout << std::left << std::setw(15) << kRouteNames[r] << std::right << std::setprecision(1)
+                  << std::setw(9) << static_cast<double>(stats.latency_ms.size()) / seconds
+                  << std::setprecision(2)
+                  << std::setw(9) << percentile(stats.latency_ms, 0.50)
+                  << std::setw(9) << percentile(stats.latency_ms, 0.90)
+                  << std::setw(9) << percentile(stats.latency_ms, 0.99)
+                  << std::setw(10) << (stats.latency_ms.empty() ? 0.0 : stats.latency_ms.back())
+                  << std::setw(9) << stats.ok << std::setw(9) << stats.no_task << std::setw(9) << stats.rejected
+                  << std::setw(9) << stats.overloaded << std::setw(9) << stats.failed << std::setprecision(1)
+                  << std::setw(10) << static_cast<double>(stats.bytes_sent) / (1 << 20)
+                  << std::setw(10) << static_cast<double>(stats.bytes_received) / (1 << 20) << "\n";
+    }
+
+    if (before.valid && after.valid) {
+        std::cout << "\nCoordinator (pid " << options.pid << "): " << std::setprecision(2)
+                  << (after.cpu_seconds - before.cpu_seconds) / seconds << " cores, RSS "
+                  << after.rss_kb / 1024 << " MB (peak " << after.peak_rss_kb / 1024 << " MB), "
+                  << after.threads << " threads\n";
+    } else if (options.pid > 0) {
+        std::cout << "\nCoordinator (pid " << options.pid << "): not readable from /proc\n";
+    }
+    std::cout << "==================================================" << std::endl;
+}
+
+} // namespace
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(int argc, char** argv) {
+    Options options;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(arg + " needs a value");
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--help" || arg == "-h") {
+                print_usage();
+                return 0;
+            } else if (arg == "--url") {
+                options.url = next();
+            } else if (arg == "--rpc") {
+                options.rpc = next();
+            } else if (arg == "--encoding") {
+                auto encoding = hydra::parse_content_encoding(next());
+                if (!encoding || !hydra::rpc_payload_encoding(*encoding)) {
+                    throw std::invalid_argument("expected identity, lz or deflate");
+                }
+                options.encoding = *encoding;
+            } else if (arg == "--workers") {
+                options.workers = std::stoul(next());
+            } else if (arg == "--connections") {
+                options.connections = std::max<std::size_t>(std::stoul(next()), 1);
+            } else if (arg == "--duration") {
+                options.duration = std::chrono::milliseconds(static_cast<long long>(std::stod(next()) * 1000));
+            } else if (arg == "--ramp") {
+                options.ramp = std::chrono::milliseconds(static_cast<long long>(std::stod(next()) * 1000));
+            } else if (arg == "--train-ms") {
+                options.train_ms = std::stod(next());
+            } else if (arg == "--backoff-ms") {
+                options.backoff_ms = std::stod(next());
+            } else if (arg == "--payload-kb") {
+                options.payload_kb = std::stoul(next());
+            } else if (arg == "--abandon") {
+                options.abandon = std::stod(next());
+            } else if (arg == "--corrupt") {
+                options.corrupt = std::stod(next());
+            } else if (arg == "--pid") {
+                options.pid = std::stoi(next());
+            } else if (arg == "--prefix") {
+                options.prefix = next();
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                print_usage();
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid arguments: " << e.what() << std::endl;
+        return 1;
+    }
+
+    options.connections = std::min(options.connections, std::max<std::size_t>(options.workers, 1));
+    std::cout << "→ " << options.workers << " workers against "
+              << (options.rpc.empty() ? options.url : "rpc " + options.rpc) << " ("
+              << options.ramp.count() / 1000.0 << " s ramp-up, " << options.duration.count() / 1000.0
+              << " s measured)" << std::endl;
+
+    std::vector<std::unique_ptr<ClientThread>> clients;
+    std::size_t first = 0;
+    for (std::size_t c = 0; c < options.connections; ++c) {
+        std::size_t count = options.workers / options.connections + (c < options.workers % options.connections);
+        clients.push_back(std::make_unique<ClientThread>(options, first, count, std::random_device{}()));
+        first += count;
+    }
+
+    // The ramp-up is not measured: registration storms are not steady state
+    std::atomic<bool> stop{false};
+    auto start = Clock::now();
+    auto measure_from = start + options.ramp;
+    auto measure_until = measure_from + options.duration;
+    std::vector<std::thread> threads;
+    for (auto& client : clients) {
+        threads.emplace_back([&, client = client.get()] { client->run(start, measure_from, measure_until, stop); });
+    }
+
+    std::this_thread::sleep_until(measure_from);
+    ProcessSample before = sample_process(options.pid);
+    std::this_thread::sleep_until(measure_until);
+    ProcessSample after = sample_process(options.pid);
+    double seconds = std::chrono::duration<double>(options.duration).count();
+
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ThreadStats total;
+    for (const auto& client : clients) {
+        for (int r = 0; r < kRoutes; ++r) {
+            total.routes[r].merge(client->stats().routes[r]);
+        }
+        total.cycles += client->stats().cycles;
+        total.abandoned += client->stats().abandoned;
+    }
+    report(options, total, seconds, before, after);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file check.hpp
+ * @brief Minimal assertions for the unit tests
+ *
+ * Each test is a plain executable registered with CTest. A failed CHECK
+ * prints where and what, and the test keeps going so one run reports every
+ * failure; main() returns check_exit_code().
+ *
+ * Example:
+ * @code
+ * int main() {
+ *     CHECK(ring.size() == 3);
+ *     CHECK_NEAR(out[0], 1.5, 1e-6);
+ *     return check_exit_code();
+ * }
+ * @endcode
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+namespace hydra::test {
+
+inline std::size_t g_failures = 0;
+
+inline void fail(const char* file, int line, const char* expression) {
+    if (++g_failures <= 50) {
+        std::cerr << file << ":" << line << ": CHECK failed: " << expression << std::endl;
+    }
+}
+
+// Relative to the larger magnitude, absolute near zero
+inline bool near(double actual, double expected, double tolerance) {
+    double scale = std::max(1.0, std::max(std::fabs(actual), std::fabs(expected)));
+    return std::fabs(actual - expected) <= tolerance * scale;
+}
+
+} // namespace hydra::test
+
+#define CHECK(condition)                                              \
+    do {                                                              \
+        if (!(condition)) {                                           \
+            ::hydra::test::fail(__FILE__, __LINE__, #condition);      \
+        }                                                             \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                               \
+    do {                                                                                      \
+        double check_actual_ = (actual), check_expected_ = (expected);                        \
+        if (!::hydra::test::near(check_actual_, check_expected_, (tolerance))) {              \
+            ::hydra::test::fail(__FILE__, __LINE__, #actual " ~= " #expected);                \
+            std::cerr << "    " << check_actual_ << " vs " << check_expected_ << std::endl;   \
+        }                                                                                     \
+    } while (0)
+
+#define CHECK_THROWS(expression, exception)                               \
+    do {                                                                  \
+        bool check_thrown_ = false;                                       \
+        try {                                                             \
+            (void)(expression);                                           \
+        } catch (const exception&) {                                      \
+            check_thrown_ = true;                                         \
+        }                                                                 \
+        if (!check_thrown_) {                                             \
+            ::hydra::test::fail(__FILE__, __LINE__, #expression " throws " #exception); \
+        }                                                                 \
+    } while (0)
+
+inline int check_exit_code() {
+    if (::hydra::test::g_failures > 0) {
+        std::cerr << ::hydra::test::g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file test_aggregation.cpp
+ * @brief aggregate_updates() against a per-coordinate sort
+ */
+
+#include "check.hpp"
+#include "hydra/aggregation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace hydra;
+
+namespace {
+
+std::vector<std::vector<float>> random_updates(std::size_t k, std::size_t n, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<std::vector<float>> updates(k, std::vector<float>(n));
+    for (auto& update : updates) {
+        for (auto& value : update) {
+            value = normal(rng);
+        }
+    }
+    return updates;
+}
+
+std::vector<UpdateView> views_of(const std::vector<std::vector<float>>& updates) {
+    std::vector<UpdateView> views;
+    for (const auto& update : updates) {
+        views.push_back({update.data(), 1.0});
+    }
+    return views;
+}
+
+// Sort each coordinate's K values and reduce them in double
+std::vector<double> reference(const std::vector<std::vector<float>>& updates, AggregationRule rule,
+                              double trim_fraction) {
+    const std::size_t k = updates.size();
+    const std::size_t n = updates[0].size();
+    const std::size_t trim = rule == AggregationRule::TrimmedMean
+        ? static_cast<std::size_t>(trim_fraction * static_cast<double>(k)) : 0;
+    std::vector<double> out(n);
+    std::vector<float> column(k);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t u = 0; u < k; ++u) {
+            column[u] = updates[u][i];
+        }
+        std::sort(column.begin(), column.end());
+        if (rule == AggregationRule::Median) {
+            out[i] = k % 2 == 1 ? column[k / 2] : 0.5 * (double(column[k / 2 - 1]) + column[k / 2]);
+            continue;
+        }
+        double sum = 0.0;
+        for (std::size_t u = trim; u < k - trim; ++u) {
+            sum += column[u];
+        }
+        out[i] = sum / static_cast<double>(k - 2 * trim);
+    }
+    return out;
+}
+
+void check_robust_rules() {
+    // Round sizes on both sides of the sorting-network limit; lengths that
+    // leave partial vectors and partial blocks
+    for (std::size_t k : {1, 2, 3, 5, 8, 10, 17, 33, 64, 65, 100}) {
+        for (std::size_t n : {1, 7, 16, 515, 2053}) {
+            auto updates = random_updates(k, n, static_cast<std::uint32_t>(k * 7919 + n));
+            auto views = views_of(updates);
+            for (auto rule : {AggregationRule::TrimmedMean, AggregationRule::Median}) {
+                for (std::size_t threads : {1, 3}) {
+                    AggregationOptions options;
+                    options.rule = rule;
+                    options.trim_fraction = 0.2;
+                    options.num_threads = threads;
+                    options.block_size = 64;
+                    std::vector<float> out(n, -1.0f);
+                    aggregate_updates(views, out, options);
+
+                    auto expected = reference(updates, rule, options.trim_fraction);
+                    std::size_t wrong = 0;
+                    for (std::size_t i = 0; i < n; ++i) {
+                        wrong += !test::near(out[i], expected[i], 1e-5);
+                    }
+                    CHECK(wrong == 0);
+                }
+            }
+        }
+    }
+}
+
+void check_trimmed_mean_ignores_outliers() {
+    // Two of ten workers send huge values; trimming 20% from each end drops them
+    auto updates = random_updates(10, 1000, 1);
+    std::fill(updates[3].begin(), updates[3].end(), 1e30f);
+    std::fill(updates[7].begin(), updates[7].end(), -1e30f);
+    auto views = views_of(updates);
+
+    AggregationOptions options;
+    options.rule = AggregationRule::TrimmedMean;
+    options.trim_fraction = 0.2;
+    std::vector<float> out(1000);
+    aggregate_updates(views, out, options);
+
+    auto expected = reference(updates, AggregationRule::TrimmedMean, 0.2);
+    bool bounded = true;
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        bounded = bounded && std::fabs(out[i]) < 10.0f;
+        CHECK_NEAR(out[i], expected[i], 1e-5);
+    }
+    CHECK(bounded);
+}
+
+void check_weighted_mean() {
+    auto updates = random_updates(5, 1031, 2);
+    std::vector<UpdateView> views;
+    double total = 0.0;
+    for (std::size_t u = 0; u < updates.size(); ++u) {
+        views.push_back({updates[u].data(), double(u + 1)});
+        total += double(u + 1);
+    }
+    std::vector<float> out(1031);
+    aggregate_updates(views, out, {AggregationRule::Mean});
+
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        double expected = 0.0;
+        for (std::size_t u = 0; u < updates.size(); ++u) {
+            expected += updates[u][i] * double(u + 1) / total;
+        }
+        CHECK_NEAR(out[i], expected, 1e-5);
+    }
+}
+
+void check_kernels_agree() {
+    // The dispatched vector loop (AVX2 where the CPU has it) matches the
+    // portable one, tails included
+    const auto& portable = detail::aggregation_kernels_portable();
+    const auto& chosen = detail::aggregation_kernels();
+    auto src = random_updates(1, 1037, 3)[0];
+    for (std::size_t len : {0, 1, 7, 8, 9, 31, 1037}) {
+        std::vector<float> a(len, 0.5f), b(len, 0.5f);
+        portable.accumulate(a.data(), src.data(), 0.25f, len);
+        chosen.accumulate(b.data(), src.data(), 0.25f, len);
+        for (std::size_t i = 0; i < len; ++i) {
+            CHECK_NEAR(a[i], b[i], 1e-6);
+        }
+    }
+}
+
+void check_invalid_arguments() {
+    std::vector<float> update(16), out(16);
+    std::vector<UpdateView> views{{update.data(), 1.0}};
+
+    CHECK_THROWS(aggregate_updates({}, out), std::invalid_argument);
+    AggregationOptions options;
+    options.rule = AggregationRule::TrimmedMean;
+    options.trim_fraction = 0.5;
+    CHECK_THROWS(aggregate_updates(views, out, options), std::invalid_argument);
+    options.trim_fraction = 0.1;
+    options.block_size = 24;
+    CHECK_THROWS(aggregate_updates(views, out, options), std::invalid_argument);
+    views[0].weight = 0.0;
+    CHECK_THROWS(aggregate_updates(views, out, {AggregationRule::Mean}), std::invalid_argument);
+
+    CHECK(parse_aggregation_rule("trimmed_mean") == AggregationRule::TrimmedMean);
+    CHECK(std::string(aggregation_rule_name(AggregationRule::Median)) == "median");
+    CHECK_THROWS(parse_aggregation_rule("mode"), std::invalid_argument);
+}
+
+} // namespace
+
+int main() {
+    check_robust_rules();
+    check_trimmed_mean_ignores_outliers();
+    check_weighted_mean();
+    check_kernels_agree();
+    check_invalid_arguments();
+    return check_exit_code();
+}
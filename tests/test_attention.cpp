@@ -0,0 +1,239 @@
+/**
+ * @file test_attention.cpp
+ * @brief Tiled attention forward and backward against a direct softmax,
+ *        with key padding
+ */
+
+#include "check.hpp"
+#include "hydra/attention.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace hydra;
+
+namespace {
+
+// One head with padded row strides, so the kernels must use them
+struct Head {
+    std::size_t queries, keys, dim, ld;
+    std::vector<float> q, k, v;
+    std::unique_ptr<bool[]> padding;   // What the kernels read
+    std::vector<bool> mask;            // What the reference reads
+
+    Head(std::size_t queries_, std::size_t keys_, std::size_t dim_, std::mt19937& rng)
+        : queries(queries_), keys(keys_), dim(dim_), ld(dim_ + 3),
+          q(queries_ * ld), k(keys_ * ld), v(keys_ * ld), padding(new bool[keys_]()), mask(keys_, false) {
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        for (auto* values : {&q, &k, &v}) {
+            for (auto& value : *values) {
+                value = normal(rng);
+            }
+        }
+    }
+
+    void pad(std::size_t key) {
+        padding[key] = true;
+        mask[key] = true;
+    }
+
+    AttentionHead view(const bool* key_padding) const {
+        return {q.data(), ld, k.data(), ld, v.data(), ld, queries, keys, dim,
+                1.0f / std::sqrt(static_cast<float>(dim)), key_padding};
+    }
+};
+
+struct Reference {
+    std::vector<double> out, lse, dq, dk, dv;
+};
+
+// softmax(scale Q K^T) V and its gradients, one query at a time in double
+Reference reference(const Head& head, const std::vector<float>& d_out) {
+    const std::size_t d = head.dim;
+    const double scale = 1.0 / std::sqrt(static_cast<double>(d));
+    Reference r{std::vector<double>(head.queries * d), std::vector<double>(head.queries),
+                std::vector<double>(head.queries * d), std::vector<double>(head.keys * d),
+                std::vector<double>(head.keys * d)};
+    std::vector<double> p(head.keys);
+
+    for (std::size_t i = 0; i < head.queries; ++i) {
+        double max = -std::numeric_limits<double>::infinity();
+        for (std::size_t j = 0; j < head.keys; ++j) {
+            if (head.mask[j]) {
+                p[j] = -std::numeric_limits<double>::infinity();
+                continue;
+            }
+            double s = 0.0;
+            for (std::size_t c = 0; c < d; ++c) {
+                s += double(head.q[i * head.ld + c]) * head.k[j * head.ld + c];
+            }
+            p[j] = s * scale;
+            max = std::max(max, p[j]);
+        }
+        if (std::isinf(max)) {
+            r.lse[i] = -std::numeric_limits<double>::infinity();
+            continue;   // Every key padded: zero output, zero gradients
+        }
+        double total = 0.0;
+        for (std::size_t j = 0; j < head.keys; ++j) {
+            p[j] = head.mask[j] ? 0.0 : std::exp(p[j] - max);
+            total += p[j];
+        }
+        r.lse[i] = max + std::log(total);
+        for (std::size_t j = 0; j < head.keys; ++j) {
+            p[j] /= total;
+            for (std::size_t c = 0; c < d; ++c) {
+                r.out[i * d + c] += p[j] * head.v[j * head.ld + c];
+            }
+        }
+
+        // dS = P * (dO V^T - rowsum(dO * O))
+        double delta = 0.0;
+        for (std::size_t c = 0; c < d; ++c) {
+            delta += double(d_out[i * head.ld + c]) * r.out[i * d + c];
+        }
+        for (std::size_t j = 0; j < head.keys; ++j) {
+            if (p[j] == 0.0) {
+                continue;
+            }
+            double dp = 0.0;
+            for (std::size_t c = 0; c < d; ++c) {
+                dp += double(d_out[i * head.ld + c]) * head.v[j * head.ld + c];
+                r.dv[j * d + c] += p[j] * d_out[i * head.ld + c];
+            }
+            double ds = p[j] * (dp - delta) * scale;
+            for (std::size_t c = 0; c < d; ++c) {
+                r.dq[i * d + c] += ds * head.k[j * head.ld + c];
+                r.dk[j * d + c] += ds * head.q[i * head.ld + c];
+            }
+        }
+    }
+    return r;
+}
+
+std::size_t mismatches(const std::vector<float>& actual, std::size_t rows, std::size_t ld,
+                       const std::vector<double>& expected, std::size_t d, double tolerance) {
+    std::size_t wrong = 0;
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t c = 0; c < d; ++c) {
+            wrong += !test::near(actual[i * ld + c], expected[i * d + c], tolerance);
+        }
+    }
+    return wrong;
+}
+
+void check_head(Head& head, bool use_padding, std::mt19937& rng) {
+    const std::size_t d = head.dim, ld = head.ld;
+    const bool* padding = use_padding ? head.padding.get() : nullptr;
+    if (!use_padding) {
+        std::fill(head.mask.begin(), head.mask.end(), false);
+    }
+    AttentionHead view = head.view(padding);
+
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> d_out(head.queries * ld);
+    for (auto& value : d_out) {
+        value = normal(rng);
+    }
+    Reference expected = reference(head, d_out);
+
+    // NaN-filled outputs: everything must be written, nothing accumulated
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<float> out(head.queries * ld, nan), lse(head.queries, nan);
+    attention_forward(view, out.data(), ld, lse.data());
+    CHECK(mismatches(out, head.queries, ld, expected.out, d, 1e-5) == 0);
+    for (std::size_t i = 0; i < head.queries; ++i) {
+        if (std::isinf(expected.lse[i])) {
+            CHECK(std::isinf(lse[i]) && lse[i] < 0);
+        } else {
+            CHECK_NEAR(lse[i], expected.lse[i], 1e-5);
+        }
+    }
+
+    std::vector<float> dq(head.queries * ld, nan), dk(head.keys * ld, nan), dv(head.keys * ld, nan);
+    AttentionGradients grads{dq.data(), ld, dk.data(), ld, dv.data(), ld};
+    attention_backward(view, out.data(), ld, lse.data(), d_out.data(), ld, grads);
+    CHECK(mismatches(dq, head.queries, ld, expected.dq, d, 1e-4) == 0);
+    CHECK(mismatches(dk, head.keys, ld, expected.dk, d, 1e-4) == 0);
+    CHECK(mismatches(dv, head.keys, ld, expected.dv, d, 1e-4) == 0);
+    for (std::size_t j = 0; j < head.keys; ++j) {
+        if (head.mask[j]) {
+            CHECK(dk[j * ld] == 0.0f && dv[j * ld + d - 1] == 0.0f);
+        }
+    }
+}
+
+// The reference's gradients are themselves checked against central
+// differences of the kernel's own forward pass
+void check_finite_differences(std::mt19937& rng) {
+    Head head(5, 9, 4, rng);
+    head.pad(2);
+    const bool* padding = head.padding.get();
+    std::vector<float> d_out(head.queries * head.ld, 0.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    for (auto& value : d_out) {
+        value = normal(rng);
+    }
+    Reference expected = reference(head, d_out);
+
+    auto loss = [&] {
+        std::vector<float> out(head.queries * head.ld);
+        attention_forward(head.view(padding), out.data(), head.ld);
+        double sum = 0.0;
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            sum += double(out[i]) * d_out[i];
+        }
+        return sum;
+    };
+    auto numeric = [&](std::vector<float>& values, std::size_t index) {
+        const float h = 1e-2f;
+        float saved = values[index];
+        values[index] = saved + h;
+        double plus = loss();
+        values[index] = saved - h;
+        double minus = loss();
+        values[index] = saved;
+        return (plus - minus) / (2.0 * h);
+    };
+
+    CHECK_NEAR(numeric(head.q, 1 * head.ld + 2), expected.dq[1 * head.dim + 2], 2e-3);
+    CHECK_NEAR(numeric(head.k, 4 * head.ld + 0), expected.dk[4 * head.dim + 0], 2e-3);
+    CHECK_NEAR(numeric(head.v, 7 * head.ld + 3), expected.dv[7 * head.dim + 3], 2e-3);
+    CHECK_NEAR(numeric(head.k, 2 * head.ld + 1), 0.0, 1e-6);   // A padding key has no influence
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(17);
+
+    // Within one block, and across query and key blocks with partial tails
+    const std::size_t sizes[][3] = {{1, 1, 8}, {3, 5, 16}, {70, 130, 16}, {kAttentionQueryBlock, 2 * kAttentionKeyBlock, 32}};
+    for (const auto& size : sizes) {
+        for (bool use_padding : {false, true}) {
+            Head head(size[0], size[1], size[2], rng);
+            if (use_padding) {
+                for (std::size_t j = 3; j < head.keys; j += 7) {
+                    head.pad(j);   // Scattered through every key block...
+                }
+                for (std::size_t j = kAttentionKeyBlock; j < head.keys; ++j) {
+                    head.pad(j);   // ...and whole blocks at the end (padded batches)
+                }
+            }
+            check_head(head, use_padding, rng);
+        }
+    }
+
+    // A query with nothing to attend to gets zeros, not NaN
+    Head empty(4, 6, 8, rng);
+    for (std::size_t j = 0; j < empty.keys; ++j) {
+        empty.pad(j);
+    }
+    check_head(empty, true, rng);
+
+    check_finite_differences(rng);
+    return check_exit_code();
+}
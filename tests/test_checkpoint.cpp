@@ -0,0 +1,179 @@
+/**
+ * @file test_checkpoint.cpp
+ * @brief Full and incremental checkpoints and the model log, written and
+ *        read back
+ */
+
+#include "check.hpp"
+#include "hydra/checkpoint.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace hydra;
+namespace fs = std::filesystem;
+
+namespace {
+
+ModelConfig small_config() {
+    ModelConfig config;
+    config.vocab_size = 50;
+    config.embed_dim = 16;
+    config.num_heads = 2;
+    config.num_layers = 1;
+    config.max_seq_length = 8;
+    return config;
+}
+
+// A copy of model with one tensor changed and a new version
+ModelState changed(const ModelState& model, std::size_t tensor, std::uint64_t version) {
+    ModelState next = model;
+    const TensorInfo& info = next.tensors()[tensor];
+    auto values = next.values().subspan(info.offset, info.size);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] += 0.25f + static_cast<float>(i % 7);
+    }
+    next.set_version(version);
+    return next;
+}
+
+bool same_values(const ModelState& a, const ModelState& b) {
+    return a.values().size() == b.values().size() &&
+           std::memcmp(a.values().data(), b.values().data(), a.values().size_bytes()) == 0;
+}
+
+class TempDir {
+public:
+    TempDir() {
+        std::random_device seed;
+        path_ = (fs::temp_directory_path() / ("hydra_test_checkpoint_" + std::to_string(seed()))).string();
+        fs::create_directories(path_);
+    }
+    ~TempDir() {
+        std::error_code ignored;
+        fs::remove_all(path_, ignored);
+    }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+void check_full_and_incremental() {
+    TempDir dir;
+    const auto config = small_config();
+    CHECK(!load_latest_checkpoint(dir.path(), config));
+
+    ModelState v5 = ModelState::create(config, 7);
+    v5.set_version(5);
+    auto full = write_checkpoint(dir.path(), v5);
+    CHECK(full.full);
+    CHECK(full.tensors_written == v5.tensors().size());
+
+    ModelState v9 = changed(v5, 1, 9);
+    auto increment = write_checkpoint(dir.path(), v9, &v5);
+    CHECK(!increment.full);
+    CHECK(increment.tensors_written == 1);
+    CHECK(increment.bytes < full.bytes);
+    CHECK((list_checkpoints(dir.path()) == std::vector<std::uint64_t>{5, 9}));
+
+    // Only the changed tensor is stored, mapped in place and checksummed
+    CheckpointFile file(checkpoint_path(dir.path(), 9));
+    CHECK(!file.full());
+    CHECK(file.header().base_version == 5);
+    CHECK(file.num_tensors() == v9.tensors().size());
+    CHECK(file.data(0).empty());
+    CHECK(file.data(1).size() == v9.tensors()[1].size);
+    CHECK(file.verify(1));
+    CHECK(file.name(1) == v9.tensors()[1].name);
+
+    auto loaded = load_latest_checkpoint(dir.path(), config);
+    CHECK(loaded.has_value());
+    if (loaded) {
+        CHECK(loaded->version() == 9);
+        CHECK(same_values(*loaded, v9));
+    }
+
+    // A different architecture is refused, not misread
+    auto other = config;
+    other.embed_dim = 32;
+    CHECK_THROWS(load_latest_checkpoint(dir.path(), other), std::runtime_error);
+
+    // So is an increment whose base is gone
+    fs::remove(checkpoint_path(dir.path(), 5));
+    CHECK_THROWS(load_latest_checkpoint(dir.path(), config), std::runtime_error);
+}
+
+void check_corrupt_tensor() {
+    TempDir dir;
+    const auto config = small_config();
+    ModelState model = ModelState::create(config, 11);
+    model.set_version(3);
+    auto stats = write_checkpoint(dir.path(), model);
+
+    std::uint64_t offset = 0;
+    {
+        CheckpointFile file(stats.path);
+        offset = file.tensor(2).data_offset;
+    }
+    {
+        std::fstream file(stats.path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(offset + 5));
+        char byte = static_cast<char>(file.get());
+        file.seekp(static_cast<std::streamoff>(offset + 5));
+        file.put(static_cast<char>(byte ^ 0x5a));
+    }
+    CHECK_THROWS(load_latest_checkpoint(dir.path(), config), std::runtime_error);
+}
+
+void check_model_log() {
+    TempDir dir;
+    const auto config = small_config();
+    ModelState v9 = ModelState::create(config, 13);
+    v9.set_version(9);
+    write_checkpoint(dir.path(), v9);
+
+    ModelState v10 = changed(v9, 0, 10);
+    ModelState v11 = changed(v10, 2, 11);
+    std::string path = model_log_path(dir.path(), 9);
+    {
+        ModelLogWriter log(path);
+        CHECK(log.append(v10, v9) > 0);
+        CHECK(log.append(v11, v10) > 0);
+    }
+
+    auto model = load_latest_checkpoint(dir.path(), config);
+    CHECK(model.has_value());
+    if (!model) {
+        return;
+    }
+    CHECK(replay_model_log(path, *model) == 2);
+    CHECK(model->version() == 11);
+    CHECK(same_values(*model, v11));
+
+    // A torn last record (a crash during append) is dropped, not applied
+    fs::resize_file(path, fs::file_size(path) - 3);
+    auto replayed = load_latest_checkpoint(dir.path(), config);
+    CHECK(replay_model_log(path, *replayed) == 1);
+    CHECK(replayed->version() == 10);
+    CHECK(same_values(*replayed, v10));
+
+    // Records for another version are not applied
+    ModelState unrelated = ModelState::create(config, 13);
+    unrelated.set_version(4);
+    CHECK(replay_model_log(path, unrelated) == 0);
+    CHECK(replay_model_log(dir.path() + "/missing.log", unrelated) == 0);
+}
+
+} // namespace
+
+int main() {
+    check_full_and_incremental();
+    check_corrupt_tensor();
+    check_model_log();
+    return check_exit_code();
+}
@@ -0,0 +1,216 @@
+/**
+ * @file test_compression.cpp
+ * @brief x-hydra codecs round-trip, negotiation and gzip splicing
+ */
+
+#include "check.hpp"
+#include "hydra/compression.hpp"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace hydra;
+
+namespace {
+
+// Weights-like floats: small values around zero, some runs of zeros
+std::vector<std::byte> sample_floats(std::size_t count, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> normal(0.0f, 0.02f);
+    std::vector<float> values(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = (i / 1000) % 5 == 0 ? 0.0f : normal(rng);
+    }
+    std::vector<std::byte> bytes(count * sizeof(float));
+    std::memcpy(bytes.data(), values.data(), bytes.size());
+    return bytes;
+}
+
+std::vector<std::byte> random_bytes(std::size_t count, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::byte> bytes(count);
+    for (auto& byte : bytes) {
+        byte = static_cast<std::byte>(rng() & 0xff);
+    }
+    return bytes;
+}
+
+// Decode a whole x-hydra stream of known size, the way receivers do
+std::vector<std::byte> decode(ContentEncoding encoding, std::span<const std::byte> encoded, std::size_t size) {
+    Decompressor decompressor;
+    std::vector<std::byte> out(size);
+    std::size_t in = 0, done = 0;
+    while (done < size) {
+        if (encoded.size() - in < sizeof(EncodedBlockHeader)) {
+            throw std::runtime_error("truncated stream");
+        }
+        EncodedBlockHeader header;
+        std::memcpy(&header, encoded.data() + in, sizeof(header));
+        in += sizeof(header);
+        Decompressor::check(header, size - done);
+        if (encoded.size() - in < header.packed_bytes()) {
+            throw std::runtime_error("truncated block");
+        }
+        decompressor.decode_block(encoding, header, encoded.subspan(in, header.packed_bytes()),
+                                  std::span(out).subspan(done, header.raw_bytes));
+        in += header.packed_bytes();
+        done += header.raw_bytes;
+    }
+    CHECK(in == encoded.size());
+    return out;
+}
+
+void check_round_trip() {
+    for (auto encoding : {ContentEncoding::Lz, ContentEncoding::Deflate}) {
+        // Empty, tiny, exactly one block, one block and a bit, many blocks
+        for (std::size_t count : {std::size_t{0}, std::size_t{1}, std::size_t{3},
+                                  kEncodedBlockBytes / sizeof(float), kEncodedBlockBytes / sizeof(float) + 13,
+                                  std::size_t{300000}}) {
+            auto raw = sample_floats(count, static_cast<std::uint32_t>(count));
+            for (bool shuffle : {true, false}) {
+                auto encoded = compress(encoding, raw, shuffle);
+                CHECK(decode(encoding, encoded, raw.size()) == raw);
+                if (count >= 300000) {
+                    CHECK(encoded.size() < raw.size());
+                }
+            }
+        }
+
+        // Incompressible data is stored: 8 bytes of overhead per block
+        auto noise = random_bytes(3 * kEncodedBlockBytes + 100, 9);
+        auto stored = compress(encoding, noise, false);
+        CHECK(stored.size() == noise.size() + 4 * sizeof(EncodedBlockHeader));
+        CHECK(decode(encoding, stored, noise.size()) == noise);
+    }
+}
+
+void check_streaming_matches_whole() {
+    // Blocks are cut at the same offsets however the input is split
+    auto raw = sample_floats(100000, 5);
+    for (auto encoding : {ContentEncoding::Lz, ContentEncoding::Deflate}) {
+        auto whole = compress(encoding, raw);
+
+        Compressor compressor(encoding);
+        std::vector<std::byte> streamed;
+        auto sink = [&](std::span<const std::byte> bytes) { streamed.insert(streamed.end(), bytes.begin(), bytes.end()); };
+        std::size_t offset = 0, step = 1;
+        while (offset < raw.size()) {
+            std::size_t length = std::min(step, raw.size() - offset);
+            compressor.write(std::span(raw).subspan(offset, length), sink);
+            offset += length;
+            step = step * 3 + 7;
+        }
+        compressor.finish(sink);
+        CHECK(streamed == whole);
+    }
+}
+
+void check_corrupt_input() {
+    auto raw = sample_floats(20000, 6);
+    auto encoded = compress(ContentEncoding::Lz, raw);
+
+    // A block that claims more than the stream has left is refused up front
+    EncodedBlockHeader header;
+    std::memcpy(&header, encoded.data(), sizeof(header));
+    CHECK_THROWS(Decompressor::check(header, header.raw_bytes - 1), std::runtime_error);
+    header.raw_bytes = kEncodedBlockBytes + 1;
+    CHECK_THROWS(Decompressor::check(header, raw.size()), std::runtime_error);
+
+    // A packed block cut short does not decode
+    for (auto encoding : {ContentEncoding::Lz, ContentEncoding::Deflate}) {
+        auto packed_stream = compress(encoding, raw);
+        std::memcpy(&header, packed_stream.data(), sizeof(header));
+        CHECK((header.packed & EncodedBlockHeader::kBlockStored) == 0);
+        std::size_t half = header.packed_bytes() / 2;
+        header.packed = (header.packed & ~std::uint32_t{0xFFFFFF}) | static_cast<std::uint32_t>(half);
+
+        Decompressor decompressor;
+        std::vector<std::byte> out(header.raw_bytes);
+        auto packed = std::span<const std::byte>(packed_stream).subspan(sizeof(header), half);
+        CHECK_THROWS(decompressor.decode_block(encoding, header, packed, out), std::runtime_error);
+    }
+
+    CHECK_THROWS(Compressor(ContentEncoding::Gzip), std::invalid_argument);
+}
+
+void check_negotiation() {
+    const ContentEncoding offered[] = {ContentEncoding::Lz, ContentEncoding::Deflate, ContentEncoding::Gzip};
+    CHECK(negotiate_encoding("", offered) == ContentEncoding::Identity);
+    CHECK(negotiate_encoding("gzip", offered) == ContentEncoding::Gzip);
+    CHECK(negotiate_encoding("gzip, x-hydra-deflate", offered) == ContentEncoding::Deflate);
+    CHECK(negotiate_encoding("gzip;q=1.0, x-hydra-lz;q=0.5", offered) == ContentEncoding::Gzip);
+    CHECK(negotiate_encoding("x-hydra-lz;q=0, gzip;q=0.1", offered) == ContentEncoding::Gzip);
+    CHECK(negotiate_encoding("br, identity", offered) == ContentEncoding::Identity);
+
+    CHECK(parse_content_encoding("lz") == ContentEncoding::Lz);
+    CHECK(parse_content_encoding("x-hydra-deflate") == ContentEncoding::Deflate);
+    CHECK(!parse_content_encoding("br"));
+    CHECK(std::string(content_encoding_name(ContentEncoding::Lz)) == "x-hydra-lz");
+}
+
+std::string gunzip(const std::string& body) {
+    z_stream stream{};
+    inflateInit2(&stream, 15 + 16);
+    std::string out;
+    char buffer[16384];
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    stream.avail_in = static_cast<uInt>(body.size());
+    int rc = Z_OK;
+    while (rc == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        rc = inflate(&stream, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    if (rc != Z_STREAM_END || stream.avail_in != 0) {
+        throw std::runtime_error("not a complete gzip stream");
+    }
+    return out;
+}
+
+void check_gzip_splice() {
+    // A shared middle segment compressed once, spliced between per-request parts
+    std::string head = R"({"task_id": "task-1", "model_parameters": )";
+    std::string middle;
+    for (int i = 0; i < 200000; ++i) {
+        middle += std::to_string(i % 977 * 0.001) + (i + 1 < 200000 ? "," : "");
+    }
+    middle = "[" + middle + "]";
+    std::string tail = "}";
+
+    auto first = deflate_segment(head, 1);
+    auto shared = deflate_segment(middle);
+    auto last = deflate_segment(tail, 9);
+    CHECK(shared.size == middle.size());
+    CHECK(shared.data.size() < middle.size() / 2);
+
+    std::string body = gzip_header() + first.data + shared.data + last.data +
+                       gzip_trailer({&first, &shared, &last});
+    CHECK(gunzip(body) == head + middle + tail);
+
+    // Empty segments splice too
+    auto empty = deflate_segment("");
+    std::string bare = gzip_header() + empty.data + shared.data + gzip_trailer({&empty, &shared});
+    CHECK(gunzip(bare) == middle);
+
+    // The trailer's CRC covers the segments in body order
+    std::string swapped = gzip_header() + first.data + shared.data + last.data +
+                          gzip_trailer({&last, &shared, &first});
+    CHECK_THROWS(gunzip(swapped), std::runtime_error);
+}
+
+} // namespace
+
+int main() {
+    check_round_trip();
+    check_streaming_matches_whole();
+    check_corrupt_input();
+    check_negotiation();
+    check_gzip_splice();
+    return check_exit_code();
+}
@@ -0,0 +1,125 @@
+/**
+ * @file test_gemm.cpp
+ * @brief sgemm() against a double-precision reference, for every kernel
+ *        this CPU supports
+ */
+
+#include "check.hpp"
+#include "hydra/gemm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace hydra;
+
+namespace {
+
+struct Shape {
+    std::size_t m, n, k;
+};
+
+std::vector<float> random_matrix(std::size_t rows, std::size_t ld, std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<float> values(rows * ld);
+    for (auto& value : values) {
+        value = uniform(rng);
+    }
+    return values;
+}
+
+// Checks one product; leading dimensions are padded so the kernels must
+// honour them, and the padding of C must come back untouched
+void check_product(Transpose trans_a, Transpose trans_b, Shape shape, float alpha, float beta,
+                   std::mt19937& rng) {
+    const auto [m, n, k] = shape;
+    const bool ta = trans_a == Transpose::Yes;
+    const bool tb = trans_b == Transpose::Yes;
+    const std::size_t lda = (ta ? m : k) + 3;
+    const std::size_t ldb = (tb ? k : n) + 5;
+    const std::size_t ldc = n + 2;
+    auto a = random_matrix(ta ? k : m, lda, rng);
+    auto b = random_matrix(tb ? n : k, ldb, rng);
+    auto c = random_matrix(m, ldc, rng);
+    if (beta == 0.0f) {
+        // beta = 0 must ignore what C holds, NaNs included
+        for (std::size_t i = 0; i < m; ++i) {
+            std::fill_n(c.begin() + static_cast<std::ptrdiff_t>(i * ldc), n, std::numeric_limits<float>::quiet_NaN());
+        }
+    }
+    const auto original = c;
+
+    sgemm(trans_a, trans_b, m, n, k, alpha, a.data(), lda, b.data(), ldb, beta, c.data(), ldc);
+
+    std::size_t wrong = 0, clobbered = 0;
+    for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            double sum = 0.0;
+            for (std::size_t p = 0; p < k; ++p) {
+                double x = ta ? a[p * lda + i] : a[i * lda + p];
+                double y = tb ? b[j * ldb + p] : b[p * ldb + j];
+                sum += x * y;
+            }
+            double expected = alpha * sum + (beta == 0.0f ? 0.0 : beta * double(original[i * ldc + j]));
+            wrong += !test::near(c[i * ldc + j], expected, 2e-5 * std::sqrt(double(k) + 1.0));
+        }
+        for (std::size_t j = n; j < ldc; ++j) {
+            clobbered += c[i * ldc + j] != original[i * ldc + j];
+        }
+    }
+    if (wrong != 0 || clobbered != 0) {
+        std::cerr << "  " << to_string(gemm_isa()) << " m=" << m << " n=" << n << " k=" << k
+                  << " ta=" << ta << " tb=" << tb << ": " << wrong << " wrong, " << clobbered << " clobbered"
+                  << std::endl;
+    }
+    CHECK(wrong == 0);
+    CHECK(clobbered == 0);
+}
+
+void check_kernel(GemmIsa isa) {
+    set_gemm_isa(isa);
+    CHECK(gemm_isa() == isa);
+
+    // Single elements; partial register tiles in both directions; the few-
+    // row B^T path; shapes crossing the kc, mc and nc cache blocks
+    const Shape shapes[] = {
+        {1, 1, 1}, {2, 3, 1}, {3, 17, 5}, {4, 37, 300}, {5, 7, 9}, {7, 13, 5}, {13, 31, 17},
+        {23, 47, 64}, {64, 64, 64}, {145, 33, 257}, {6, 4100, 3},
+    };
+    std::mt19937 rng(static_cast<std::uint32_t>(isa) + 1);
+    for (const auto& shape : shapes) {
+        for (auto ta : {Transpose::No, Transpose::Yes}) {
+            for (auto tb : {Transpose::No, Transpose::Yes}) {
+                check_product(ta, tb, shape, 1.0f, 0.0f, rng);
+                check_product(ta, tb, shape, -0.5f, 2.0f, rng);
+            }
+        }
+    }
+    check_product(Transpose::No, Transpose::No, {9, 11, 0}, 1.0f, 0.5f, rng);   // k = 0 only scales C
+    check_product(Transpose::No, Transpose::Yes, {9, 11, 4}, 0.0f, 1.0f, rng);  // alpha = 0 leaves C
+}
+
+} // namespace
+
+int main() {
+    const GemmIsa initial = gemm_isa();
+    CHECK(gemm_isa_supported(GemmIsa::Portable));
+    CHECK(gemm_isa_supported(initial));
+
+    for (auto isa : {GemmIsa::Portable, GemmIsa::Avx2, GemmIsa::Avx512}) {
+        if (gemm_isa_supported(isa)) {
+            check_kernel(isa);
+        } else {
+            std::cout << "skipping " << to_string(isa) << " (not supported here)" << std::endl;
+            CHECK_THROWS(set_gemm_isa(isa), std::invalid_argument);
+        }
+    }
+    set_gemm_isa(initial);
+
+    CHECK(to_string(GemmIsa::Avx512) == "avx512");
+    return check_exit_code();
+}
@@ -0,0 +1,97 @@
+/**
+ * @file test_hash_ring.cpp
+ * @brief Stability, balance and minimal movement of HashRing
+ */
+
+#include "check.hpp"
+#include "hydra/hash_ring.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace hydra;
+
+namespace {
+
+const std::vector<std::string> kNodes = {"http://10.0.0.1:5001", "http://10.0.0.2:5001", "http://10.0.0.3:5001"};
+
+std::string key(std::size_t i) {
+    return "task-" + std::to_string(i * 2654435761u);
+}
+
+void check_hash_is_stable() {
+    // Every coordinator of a cluster routes by these values; changing the
+    // function splits the cluster's view of who owns what
+    CHECK(HashRing::hash("") == 17665956581633026203ull);
+    CHECK(HashRing::hash("a") == 198367012849983736ull);
+    CHECK(HashRing::hash("task-0000000000000001") == 11040332808169467140ull);
+    CHECK(HashRing::hash("user-42") == 8797103408588478355ull);
+}
+
+void check_same_nodes_same_owners() {
+    HashRing a(kNodes);
+    HashRing b(kNodes);
+    std::size_t differ = 0;
+    for (std::size_t i = 0; i < 10000; ++i) {
+        differ += a.owner(key(i)) != b.owner(key(i));
+    }
+    CHECK(differ == 0);
+    CHECK(a.size() == 3);
+    CHECK(a.node(2) == kNodes[2]);
+}
+
+void check_balance() {
+    HashRing ring(kNodes);
+    std::vector<std::size_t> owned(ring.size());
+    const std::size_t keys = 30000;
+    for (std::size_t i = 0; i < keys; ++i) {
+        std::size_t owner = ring.owner(key(i));
+        CHECK(owner < ring.size());
+        ++owned[owner % ring.size()];
+    }
+    // 128 virtual nodes each keep every share within a few percent of 1/3
+    for (std::size_t count : owned) {
+        CHECK(count > keys * 25 / 100);
+        CHECK(count < keys * 42 / 100);
+    }
+}
+
+void check_adding_a_node_moves_keys_only_to_it() {
+    HashRing before(kNodes);
+    auto grown = kNodes;
+    grown.push_back("http://10.0.0.4:5001");
+    HashRing after(grown);
+
+    std::size_t moved = 0, elsewhere = 0;
+    const std::size_t keys = 20000;
+    for (std::size_t i = 0; i < keys; ++i) {
+        std::size_t old_owner = before.owner(key(i));
+        std::size_t new_owner = after.owner(key(i));
+        if (old_owner != new_owner) {
+            ++moved;
+            elsewhere += new_owner != 3;
+        }
+    }
+    CHECK(elsewhere == 0);
+    CHECK(moved > keys * 15 / 100);
+    CHECK(moved < keys * 35 / 100);
+}
+
+void check_invalid_arguments() {
+    CHECK_THROWS(HashRing({}), std::invalid_argument);
+    CHECK_THROWS(HashRing(kNodes, 0), std::invalid_argument);
+
+    HashRing single({"only"}, 1);
+    CHECK(single.owner("anything") == 0);
+}
+
+} // namespace
+
+int main() {
+    check_hash_is_stable();
+    check_same_nodes_same_owners();
+    check_balance();
+    check_adding_a_node_moves_keys_only_to_it();
+    check_invalid_arguments();
+    return check_exit_code();
+}
@@ -0,0 +1,272 @@
+/**
+ * @file test_tensor.cpp
+ * @brief Tensor views and in-place operations against plain loops, and
+ *        Arena rewind and reset
+ */
+
+#include "check.hpp"
+#include "hydra/tensor.hpp"
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+using namespace hydra;
+
+namespace {
+
+// Calls visit(i, j, k) for every index of a rank-3 shape
+void for_each_index(const Shape& shape, const std::function<void(std::size_t, std::size_t, std::size_t)>& visit) {
+    for (std::size_t i = 0; i < shape[0]; ++i) {
+        for (std::size_t j = 0; j < shape[1]; ++j) {
+            for (std::size_t k = 0; k < shape[2]; ++k) {
+                visit(i, j, k);
+            }
+        }
+    }
+}
+
+// Distinct values, so a view that reads the wrong element shows
+Tensor iota(Arena& arena, const Shape& shape, float first = 1.0f) {
+    Tensor tensor = Tensor::empty(arena, shape);
+    for (std::size_t i = 0; i < tensor.numel(); ++i) {
+        tensor.data()[i] = first + 0.5f * static_cast<float>(i) * (i % 2 ? -1.0f : 1.0f);
+    }
+    return tensor;
+}
+
+void check_views() {
+    Arena arena;
+    Tensor x = iota(arena, {2, 3, 4});
+    CHECK(x.contiguous());
+    CHECK(x.numel() == 24);
+    CHECK(x.stride(0) == 12 && x.stride(1) == 4 && x.stride(2) == 1);
+
+    Tensor flat = x.view({6, 4});
+    CHECK(flat(4, 1) == x(1, 1, 1));
+
+    Tensor sliced = x.slice(2, 1, 3);
+    CHECK((sliced.shape() == Shape{2, 3, 2}));
+    CHECK(!sliced.contiguous());
+    CHECK(x.slice(0, 1, 2).contiguous());
+    std::size_t wrong = 0;
+    for_each_index(sliced.shape(), [&](std::size_t i, std::size_t j, std::size_t k) {
+        wrong += sliced(i, j, k) != x(i, j, k + 1);
+    });
+    CHECK(wrong == 0);
+
+    Tensor row = x.select(1, 2);
+    CHECK((row.shape() == Shape{2, 4}));
+    CHECK(row(1, 3) == x(1, 2, 3));
+    CHECK(x[1].contiguous());
+    CHECK(x[1](2, 0) == x(1, 2, 0));
+
+    Tensor t = x.transpose(0, 2);
+    CHECK((t.shape() == Shape{4, 3, 2}));
+    CHECK(!t.contiguous());
+    wrong = 0;
+    for_each_index(t.shape(), [&](std::size_t i, std::size_t j, std::size_t k) {
+        wrong += t(i, j, k) != x(k, j, i);
+    });
+    CHECK(wrong == 0);
+
+    // Broadcasting lines dimensions up from the right, stride 0 where repeated
+    Tensor bias = iota(arena, {4}, 10.0f);
+    Tensor wide = bias.broadcast_to({2, 3, 4});
+    CHECK(wide.stride(0) == 0 && wide.stride(1) == 0 && wide.stride(2) == 1);
+    Tensor column = iota(arena, {3, 1}, 20.0f);
+    Tensor tall = column.broadcast_to({2, 3, 4});
+    wrong = 0;
+    for_each_index(wide.shape(), [&](std::size_t i, std::size_t j, std::size_t k) {
+        wrong += wide(i, j, k) != bias(k) || tall(i, j, k) != column(j, 0);
+    });
+    CHECK(wrong == 0);
+
+    CHECK_THROWS(t.view({24}), std::invalid_argument);
+    CHECK_THROWS(x.view({5, 5}), std::invalid_argument);
+    CHECK_THROWS(x.slice(1, 2, 4), std::out_of_range);
+    CHECK_THROWS(x.select(3, 0), std::out_of_range);
+    CHECK_THROWS(x.transpose(0, 3), std::out_of_range);
+    CHECK_THROWS(column.broadcast_to({2, 2}), std::invalid_argument);
+    CHECK_THROWS(x.broadcast_to({3, 4}), std::invalid_argument);
+    CHECK_THROWS((Shape{1, 2, 3, 4, 5}), std::invalid_argument);
+}
+
+// One binary operation on a destination and source of any layout, against
+// the same arithmetic done one element at a time
+void check_binary(const Tensor& dst, const Tensor& src, const std::function<void(const Tensor&, const Tensor&)>& op,
+                  const std::function<float(float, float)>& expected) {
+    Arena scratch;
+    Tensor before = contiguous_copy(scratch, dst);
+    op(dst, src);
+    std::size_t wrong = 0;
+    for_each_index(dst.shape(), [&](std::size_t i, std::size_t j, std::size_t k) {
+        wrong += !test::near(dst(i, j, k), expected(before(i, j, k), src(i, j, k)), 1e-6);
+    });
+    CHECK(wrong == 0);
+}
+
+void check_operations() {
+    Arena arena;
+    const Shape shape{3, 4, 5};
+
+    // Contiguous, transposed and sliced destinations; contiguous,
+    // transposed and broadcast sources
+    Tensor backing = iota(arena, {3, 4, 7});
+    Tensor transposed_dst = iota(arena, {5, 4, 3}).transpose(0, 2);
+    std::vector<Tensor> dsts = {iota(arena, shape), transposed_dst, backing.slice(2, 1, 6)};
+    std::vector<Tensor> srcs = {iota(arena, shape, -3.0f), iota(arena, {5, 4, 3}, 2.0f).transpose(0, 2),
+                                iota(arena, {5}, 0.25f).broadcast_to(shape),
+                                iota(arena, {3, 1, 5}, -1.0f).broadcast_to(shape)};
+
+    for (const auto& dst : dsts) {
+        for (const auto& src : srcs) {
+            check_binary(dst, src, [](auto& d, auto& s) { add(d, s); }, [](float d, float s) { return d + s; });
+            check_binary(dst, src, [](auto& d, auto& s) { sub(d, s); }, [](float d, float s) { return d - s; });
+            check_binary(dst, src, [](auto& d, auto& s) { mul(d, s); }, [](float d, float s) { return d * s; });
+            check_binary(dst, src, [](auto& d, auto& s) { axpy(d, -0.5f, s); },
+                         [](float d, float s) { return d - 0.5f * s; });
+            check_binary(dst, src, [](auto& d, auto&) { scale(d, 1.5f); }, [](float d, float) { return d * 1.5f; });
+            check_binary(dst, src, [](auto& d, auto&) { relu(d); }, [](float d, float) { return d > 0 ? d : 0.0f; });
+            check_binary(dst, src, [](auto& d, auto& s) { copy(d, s); }, [](float, float s) { return s; });
+
+            double expected = 0.0;
+            for_each_index(shape, [&](std::size_t i, std::size_t j, std::size_t k) {
+                expected += double(dst(i, j, k)) * src(i, j, k);
+            });
+            CHECK_NEAR(dot(dst, src), expected, 1e-9);
+        }
+    }
+
+    // The columns of backing outside the slice are untouched
+    Tensor fresh = iota(arena, {3, 4, 7});
+    std::size_t clobbered = 0;
+    for_each_index({3, 4, 7}, [&](std::size_t i, std::size_t j, std::size_t k) {
+        if (k == 0 || k == 6) {
+            clobbered += backing(i, j, k) != fresh(i, j, k);
+        }
+    });
+    CHECK(clobbered == 0);
+
+    // A contiguous copy of a strided view holds the same elements
+    Tensor packed = contiguous_copy(arena, transposed_dst);
+    CHECK(packed.contiguous());
+    double expected_sum = 0.0;
+    std::size_t wrong = 0;
+    for_each_index(shape, [&](std::size_t i, std::size_t j, std::size_t k) {
+        wrong += packed(i, j, k) != transposed_dst(i, j, k);
+        expected_sum += transposed_dst(i, j, k);
+    });
+    CHECK(wrong == 0);
+    CHECK_NEAR(sum(transposed_dst), expected_sum, 1e-9);
+    CHECK_NEAR(sum(packed), expected_sum, 1e-9);
+
+    fill(transposed_dst, 2.0f);
+    CHECK_NEAR(sum(transposed_dst), 2.0 * 60, 1e-12);
+
+    CHECK_THROWS(add(packed, iota(arena, {3, 4})), std::invalid_argument);
+    CHECK_THROWS(dot(packed, transposed_dst.transpose(1, 2)), std::invalid_argument);
+}
+
+// Softmax over the last dimension, for a rows-contiguous and a transposed
+// tensor (whose last dimension has a stride)
+void check_softmax() {
+    Arena arena;
+    for (bool transposed : {false, true}) {
+        Tensor x = transposed ? iota(arena, {6, 2, 3}).transpose(0, 2) : iota(arena, {3, 2, 6});
+        Tensor before = contiguous_copy(arena, x);
+        softmax_rows(x);
+        std::size_t wrong = 0;
+        for (std::size_t i = 0; i < 3; ++i) {
+            for (std::size_t j = 0; j < 2; ++j) {
+                double total = 0.0;
+                for (std::size_t k = 0; k < 6; ++k) {
+                    total += std::exp(double(before(i, j, k)));
+                }
+                for (std::size_t k = 0; k < 6; ++k) {
+                    wrong += !test::near(x(i, j, k), std::exp(double(before(i, j, k))) / total, 1e-6);
+                }
+            }
+        }
+        CHECK(wrong == 0);
+    }
+
+    Tensor vector = iota(arena, {4});
+    softmax_rows(vector);
+    CHECK_NEAR(sum(vector), 1.0, 1e-6);
+
+    // Empty rows, and no rows at all, are left alone
+    Tensor no_columns = Tensor::empty(arena, {3, 0});
+    softmax_rows(no_columns);
+    Tensor no_rows = Tensor::empty(arena, {0, 4});
+    softmax_rows(no_rows);
+    CHECK(no_columns.empty() && no_rows.empty());
+}
+
+bool aligned(const void* pointer) {
+    return reinterpret_cast<std::uintptr_t>(pointer) % Arena::kAlignment == 0;
+}
+
+void check_arena() {
+    Arena arena(1024);
+    CHECK(arena.capacity() == 1024);
+
+    float* a = arena.allocate_floats(3);
+    float* b = arena.allocate_floats(1);
+    CHECK(aligned(a) && aligned(b));
+    CHECK(reinterpret_cast<std::byte*>(b) - reinterpret_cast<std::byte*>(a) == Arena::kAlignment);
+    CHECK(arena.used() == 2 * Arena::kAlignment);
+
+    // Rewinding frees the scratch and hands the same memory out again,
+    // across a block boundary too
+    Arena::Mark mark = arena.mark();
+    float* scratch = arena.allocate_floats(10);
+    float* big = arena.allocate_floats(1000);   // Past the first block
+    CHECK(aligned(big));
+    CHECK(arena.capacity() > 1024);
+    std::size_t grown = arena.capacity();
+    arena.rewind(mark);
+    CHECK(arena.used() == 2 * Arena::kAlignment);
+    CHECK(arena.allocate_floats(10) == scratch);
+    CHECK(arena.allocate_floats(1000) == big);
+    CHECK(arena.capacity() == grown);
+    {
+        Arena::Scope scope(arena);
+        arena.allocate_floats(5000);
+    }
+    std::size_t step_peak = arena.peak();
+    CHECK(step_peak >= (1000 + 5000) * sizeof(float));
+
+    // Reset merges the blocks into one the size of the step, so the same
+    // step again asks the system for nothing
+    arena.reset();
+    CHECK(arena.used() == 0);
+    std::size_t merged = arena.capacity();
+    CHECK(merged >= step_peak);
+    for (int step = 0; step < 3; ++step) {
+        arena.allocate_floats(3);
+        arena.allocate_floats(1);
+        arena.allocate_floats(10);
+        arena.allocate_floats(1000);
+        arena.allocate_floats(5000);
+        CHECK(arena.capacity() == merged);
+        arena.reset();
+    }
+
+    // Tensors come out of the arena aligned and filled
+    Tensor zeros = Tensor::zeros(arena, {5, 3});
+    Tensor ones = Tensor::full(arena, {7}, 1.0f);
+    CHECK(aligned(zeros.data()) && aligned(ones.data()));
+    CHECK(sum(zeros) == 0.0 && sum(ones) == 7.0);
+}
+
+} // namespace
+
+int main() {
+    check_views();
+    check_operations();
+    check_softmax();
+    check_arena();
+    return check_exit_code();
+}
@@ -21,9 +21,22 @@ import torch.nn as nn
 import torch.optim as optim
 import time
 import json
+import threading
+import zlib
 from datetime import datetime
 
 from model import SimpleTransformer, SimpleTokenizer
+from corpus import CorpusCache, prepare_examples
+
+
+def gzip_chunks(data, chunk_size=1 << 20):
+    """Yield data gzipped, compressing 1 MiB at a time."""
+    compressor = zlib.compressobj(1, zlib.DEFLATED, 31)  # 31: gzip framing
+    for offset in range(0, len(data), chunk_size):
+        chunk = compressor.compress(data[offset:offset + chunk_size])
+        if chunk:
+            yield chunk
+    yield compressor.flush()
 
 
 class HydraWorker:
@@ -49,10 +62,28 @@ class HydraWorker:
         self.model = None
         self.tokenizer = SimpleTokenizer(vocab_size=10000)
 
+        # Downloaded corpus shards (for tasks that reference shard ranges)
+        self.corpus = CorpusCache(self.coordinator_url)
+
         # Training configuration
         self.learning_rate = 0.001  # How fast the model learns
         self.num_epochs = 3         # How many times to train on each batch
 
+        # How long the coordinator may hold /get_task open when it has no
+        # work (the native coordinator answers as soon as a task appears)
+        self.task_wait = 25
+        self.server_waited = False
+
+        # Tell the coordinator we're alive while training, so it doesn't
+        # hand our task to someone else
+        self.heartbeat_interval = 15
+        self.heartbeat_stop = threading.Event()
+
+        # The native coordinator sends tasks gzipped (requests inflates them
+        # for us) and says in Accept-Encoding whether it takes gzipped
+        # results too; they are under half the size of the JSON
+        self.gzip_uploads = False
+
         print(f"Worker initialized for user: {self.user_id}")
         print(f"Coordinator: {self.coordinator_url}")
 
@@ -75,6 +106,11 @@ class HydraWorker:
 
             if response.status_code == 200:
                 data = response.json()  # Parse JSON response
+                if response.history:
+                    # A clustered coordinator sent us to the node that owns
+                    # our user; talk to that node directly from now on
+                    self.coordinator_url = response.url[:-len("/register")]
+                    print(f"  ↪ Assigned to coordinator {self.coordinator_url}")
                 print(f"✓ Registered successfully!")
                 print(f"  Message: {data['message']}")
                 if 'current_tokens' in data:
@@ -90,6 +126,23 @@ class HydraWorker:
             print(f"  Make sure the coordinator is running at {self.coordinator_url}")
             return False
 
+    def heartbeat_loop(self):
+        """
+        Send a heartbeat every few seconds until the worker stops.
+
+        Runs in a background thread. Errors are ignored: a missed heartbeat
+        only matters if the coordinator hears nothing for a whole timeout.
+        """
+        while not self.heartbeat_stop.wait(self.heartbeat_interval):
+            try:
+                requests.post(
+                    f"{self.coordinator_url}/heartbeat",
+                    json={"user_id": self.user_id},
+                    timeout=10
+                )
+            except requests.exceptions.RequestException:
+                pass
+
     def get_task(self):
         """
         Get a training task from the coordinator.
@@ -99,19 +152,30 @@ class HydraWorker:
         """
         try:
             print(f"\n📥 Requesting task from coordinator...")
+            self.server_waited = False
             response = requests.post(
                 f"{self.coordinator_url}/get_task",
-                json={"user_id": self.user_id},
-                timeout=30
+                json={"user_id": self.user_id, "wait": self.task_wait},
+                timeout=self.task_wait + 30
             )
 
             if response.status_code == 200:
+                self.gzip_uploads = 'gzip' in response.headers.get('Accept-Encoding', '')
                 task_data = response.json()
                 print(f"✓ Received task: {task_data['task_id']}")
                 print(f"  Reward: {task_data['tokens_reward']} tokens")
                 return task_data
+            elif response.status_code == 429:
+                # Too many requests - honour the coordinator's Retry-After
+                retry_after = int(response.headers.get('Retry-After', 1))
+                print(f"⚠️  Coordinator busy, waiting {retry_after} seconds")
+                time.sleep(retry_after)
+                self.server_waited = True
+                return None
             elif response.status_code == 404:
                 print("⚠️  No tasks available at the moment")
+                # A long-polling coordinator already waited for us
+                self.server_waited = response.json().get('waited', 0) > 0
                 return None
             else:
                 print(f"✗ Error getting task: {response.json()}")
@@ -159,8 +223,17 @@ class HydraWorker:
             print(f"  ✓ Model loaded")
 
             # Step 2: Prepare training data
-            data_batch = json.loads(task_data['data_batch'])
-            print(f"  Training on {len(data_batch)} examples")
+            # Everything is tokenized (or read pre-tokenized) once, up front,
+            # so the epochs below only do tensor work
+            examples = [
+                (torch.tensor([input_ids]), torch.tensor([attention_mask]))
+                for input_ids, attention_mask in prepare_examples(
+                    task_data['data_batch'], self.corpus, self.tokenizer, max_length=128)
+            ]
+            if not examples:
+                print("✗ Task has no training examples")
+                return None
+            print(f"  Training on {len(examples)} examples")
 
             # Step 3: Setup training
             optimizer = optim.Adam(self.model.parameters(), lr=self.learning_rate)
@@ -179,12 +252,7 @@ class HydraWorker:
                 epoch_loss = 0
 
                 # Train on each example in the batch
-                for text_example in data_batch:
-                    # Tokenize the text
-                    encoded = self.tokenizer.encode(text_example, max_length=128)
-                    input_ids = torch.tensor([encoded['input_ids']])
-                    attention_mask = torch.tensor([encoded['attention_mask']])
-
+                for input_ids, attention_mask in examples:
                     # Create target (what the model should predict)
                     # For language modeling, we predict the next token
                     # So target is input shifted by one position
@@ -216,13 +284,13 @@ class HydraWorker:
                     epoch_loss += loss.item()
 
                 total_loss += epoch_loss
-                avg_loss = epoch_loss / len(data_batch)
+                avg_loss = epoch_loss / len(examples)
                 print(f"  Epoch {epoch + 1}/{self.num_epochs}: loss = {avg_loss:.4f}")
 
             # Step 5: Extract updated parameters
             updated_parameters = self.model.get_trainable_parameters()
             print(f"  ✓ Training completed!")
-            print(f"  Final average loss: {total_loss / (self.num_epochs * len(data_batch)):.4f}")
+            print(f"  Final average loss: {total_loss / (self.num_epochs * len(examples)):.4f}")
 
             return updated_parameters
 
@@ -245,15 +313,28 @@ class HydraWorker:
         """
         try:
             print(f"\n📤 Submitting results for task {task_id}...")
-            response = requests.post(
-                f"{self.coordinator_url}/submit_result",
-                json={
-                    "user_id": self.user_id,
-                    "task_id": task_id,
-                    "updated_parameters": updated_parameters
-                },
-                timeout=60  # Longer timeout for uploading parameters
-            )
+            body = json.dumps({
+                "user_id": self.user_id,
+                "task_id": task_id,
+                "updated_parameters": updated_parameters
+            }).encode()
+            headers = {'Content-Type': 'application/json'}
+            if self.gzip_uploads:
+                headers['Content-Encoding'] = 'gzip'
+            for attempt in range(5):
+                response = requests.post(
+                    f"{self.coordinator_url}/submit_result",
+                    # A generator is sent chunked as it is compressed
+                    data=gzip_chunks(body) if self.gzip_uploads else body,
+                    headers=headers,
+                    timeout=60  # Longer timeout for uploading parameters
+                )
+                if response.status_code != 429:
+                    break
+                # Coordinator is busy - wait as long as it asks, then retry
+                retry_after = int(response.headers.get('Retry-After', 1))
+                print(f"  ⏳ Coordinator busy, retrying in {retry_after} seconds...")
+                time.sleep(retry_after)
 
             if response.status_code == 200:
                 data = response.json()
@@ -318,6 +399,9 @@ class HydraWorker:
 
         tasks_completed = 0
 
+        heartbeat = threading.Thread(target=self.heartbeat_loop, daemon=True)
+        heartbeat.start()
+
         try:
             while True:
                 # Check if we've completed enough tasks
@@ -329,6 +413,8 @@ class HydraWorker:
                 task_data = self.get_task()
 
                 if task_data is None:
+                    if self.server_waited:
+                        continue  # Ask again right away; the coordinator does the waiting
                     print(f"⏸️  Waiting {sleep_between_tasks} seconds before trying again...")
                     time.sleep(sleep_between_tasks)
                     continue
@@ -366,6 +452,8 @@ class HydraWorker:
             print(f"\n\n⚠️  Worker stopped by user")
             print(f"Tasks completed this session: {tasks_completed}")
 
+        self.heartbeat_stop.set()
+
         # Final stats
         print(f"\n{'='*50}")
         print(f"📊 Session Summary")